@@ -0,0 +1,759 @@
+#include "./InflateStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../Utils/Logger.h"
+
+//=================================================================================================
+// Deflate constants (RFC 1951)
+//=================================================================================================
+
+static const uint16_t LENGTH_BASE[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t LENGTH_EXTRA[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t DISTANCE_BASE[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t DISTANCE_EXTRA[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const uint8_t CODE_LENGTHS_ORDER[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+//=================================================================================================
+
+/// <summary>
+/// ctor
+/// </summary>
+/// <param name="source">provider of compressed data</param>
+InflateStream::InflateStream(const SourceCallback & source) :
+	source(source),
+	inputPos(0),
+	inputEnd(0),
+	inputEof(false),
+	bitBuffer(0),
+	bitsCount(0),
+	state(State::HEADER),
+	lastBlock(false),
+	storedRemaining(0),
+	matchLength(0),
+	matchDistance(0),
+	windowPos(0),
+	totalOut(0),
+	adler(1)
+{
+	this->input.resize(INPUT_BUFFER_SIZE);
+	this->window.resize(WINDOW_SIZE);
+}
+
+/// <summary>
+/// Decompress at most count bytes to output
+/// Returns number of written bytes, it is smaller than count
+/// only at the end of stream or if data are corrupted
+/// </summary>
+/// <param name="output"></param>
+/// <param name="count"></param>
+/// <returns></returns>
+size_t InflateStream::Read(uint8_t * output, size_t count)
+{
+	size_t produced = 0;
+
+	while ((produced < count) && (this->state != State::DONE) && (this->state != State::FAILED))
+	{
+		switch (this->state)
+		{
+		case State::HEADER:
+			if (this->ReadZlibHeader())
+			{
+				this->state = State::BLOCK_HEADER;
+			}
+			break;
+
+		case State::BLOCK_HEADER:
+			this->ReadBlockHeader();
+			break;
+
+		case State::STORED:
+		{
+			size_t n = this->CopyStored(output + produced, count - produced);
+			this->adler = UpdateAdler(this->adler, output + produced, n);
+			produced += n;
+			break;
+		}
+
+		case State::CODES:
+		{
+			size_t n = this->DecodeCodes(output + produced, count - produced);
+			this->adler = UpdateAdler(this->adler, output + produced, n);
+			produced += n;
+			break;
+		}
+
+		case State::CHECKSUM:
+			this->ReadChecksum();
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return produced;
+}
+
+/// <summary>
+/// Decode rest of the stream (remaining output is discarded)
+/// and verify its checksum
+/// </summary>
+/// <returns>true if stream is complete and valid</returns>
+bool InflateStream::Finish()
+{
+	uint8_t tmp[256];
+	while ((this->state != State::DONE) && (this->state != State::FAILED))
+	{
+		this->Read(tmp, sizeof(tmp));
+	}
+
+	return (this->state == State::DONE);
+}
+
+bool InflateStream::IsFinished() const noexcept
+{
+	return (this->state == State::DONE);
+}
+
+bool InflateStream::HasError() const noexcept
+{
+	return (this->state == State::FAILED);
+}
+
+bool InflateStream::Fail(const char * msg)
+{
+	MY_LOG_ERROR("Inflate: %s", msg);
+	this->state = State::FAILED;
+	return false;
+}
+
+//=================================================================================================
+// Bit input
+//=================================================================================================
+
+/// <summary>
+/// Fill bit buffer with whole bytes from input,
+/// input buffer is refilled from source when it is empty
+/// </summary>
+void InflateStream::Refill()
+{
+	while (this->bitsCount <= 56)
+	{
+		if (this->inputPos == this->inputEnd)
+		{
+			if (this->inputEof)
+			{
+				return;
+			}
+
+			this->inputPos = 0;
+			this->inputEnd = this->source(this->input.data(), this->input.size());
+			if (this->inputEnd == 0)
+			{
+				this->inputEof = true;
+				return;
+			}
+		}
+
+		this->bitBuffer |= uint64_t(this->input[this->inputPos++]) << this->bitsCount;
+		this->bitsCount += 8;
+	}
+}
+
+bool InflateStream::NeedBits(unsigned n)
+{
+	if (this->bitsCount < n)
+	{
+		this->Refill();
+	}
+	return (this->bitsCount >= n);
+}
+
+/// <summary>
+/// Get n bits (LSB first), n <= 32
+/// </summary>
+/// <param name="n"></param>
+/// <returns></returns>
+uint32_t InflateStream::GetBits(unsigned n)
+{
+	if (this->NeedBits(n) == false)
+	{
+		this->Fail("Unexpected end of compressed data");
+		return 0;
+	}
+
+	uint32_t v = static_cast<uint32_t>(this->bitBuffer & ((uint64_t(1) << n) - 1));
+	this->bitBuffer >>= n;
+	this->bitsCount -= n;
+	return v;
+}
+
+/// <summary>
+/// Decode one symbol
+/// Codes are stored bit-reversed, so low bits of buffer index fast table directly.
+/// Longer codes (or codes near the end of input) are decoded
+/// bit by bit over canonical code ranges.
+/// </summary>
+/// <param name="h"></param>
+/// <returns>symbol or -1 on error</returns>
+int InflateStream::DecodeSymbol(const Huffman & h)
+{
+	if (this->bitsCount < MAX_CODE_BITS)
+	{
+		this->Refill();
+	}
+
+	uint16_t e = h.fast[this->bitBuffer & ((1u << FAST_BITS) - 1)];
+	if (e != 0)
+	{
+		unsigned len = e & 15;
+		if (len <= this->bitsCount)
+		{
+			this->bitBuffer >>= len;
+			this->bitsCount -= len;
+			return e >> 4;
+		}
+	}
+
+	int code = 0;
+	int first = 0;
+	int index = 0;
+
+	for (unsigned len = 1; len <= MAX_CODE_BITS; len++)
+	{
+		if (this->bitsCount == 0)
+		{
+			this->Fail("Unexpected end of compressed data");
+			return -1;
+		}
+
+		code |= static_cast<int>(this->bitBuffer & 1);
+		this->bitBuffer >>= 1;
+		this->bitsCount--;
+
+		int count = h.counts[len];
+		if (code - count < first)
+		{
+			return h.symbols[index + (code - first)];
+		}
+
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+
+	this->Fail("Invalid Huffman code");
+	return -1;
+}
+
+//=================================================================================================
+// Stream structure
+//=================================================================================================
+
+bool InflateStream::ReadZlibHeader()
+{
+	uint32_t cmf = this->GetBits(8);
+	uint32_t flg = this->GetBits(8);
+	if (this->state == State::FAILED)
+	{
+		return false;
+	}
+
+	if (((cmf & 15) != 8) || ((cmf >> 4) > 7))
+	{
+		return this->Fail("Unsupported compression method");
+	}
+
+	if ((cmf * 256 + flg) % 31 != 0)
+	{
+		return this->Fail("Invalid zlib header");
+	}
+
+	if (flg & 0x20)
+	{
+		return this->Fail("Preset dictionary is not supported");
+	}
+
+	return true;
+}
+
+bool InflateStream::ReadBlockHeader()
+{
+	if (this->lastBlock)
+	{
+		this->state = State::CHECKSUM;
+		return true;
+	}
+
+	this->lastBlock = (this->GetBits(1) != 0);
+	uint32_t type = this->GetBits(2);
+	if (this->state == State::FAILED)
+	{
+		return false;
+	}
+
+	if (type == 0)
+	{
+		//stored block starts at byte boundary
+		this->GetBits(this->bitsCount % 8);
+
+		uint32_t len = this->GetBits(16);
+		uint32_t nlen = this->GetBits(16);
+		if (this->state == State::FAILED)
+		{
+			return false;
+		}
+
+		if (len != (~nlen & 0xFFFF))
+		{
+			return this->Fail("Invalid stored block length");
+		}
+
+		this->storedRemaining = len;
+		this->state = State::STORED;
+		return true;
+	}
+
+	if (type == 1)
+	{
+		uint8_t lengths[288 + 30];
+		std::fill(lengths, lengths + 144, 8);
+		std::fill(lengths + 144, lengths + 256, 9);
+		std::fill(lengths + 256, lengths + 280, 7);
+		std::fill(lengths + 280, lengths + 288, 8);
+		std::fill(lengths + 288, lengths + 288 + 30, 5);
+
+		BuildHuffman(this->literals, lengths, 288);
+		BuildHuffman(this->distances, lengths + 288, 30);
+
+		this->state = State::CODES;
+		return true;
+	}
+
+	if (type == 2)
+	{
+		if (this->ReadDynamicTables() == false)
+		{
+			return false;
+		}
+
+		this->state = State::CODES;
+		return true;
+	}
+
+	return this->Fail("Invalid block type");
+}
+
+bool InflateStream::ReadDynamicTables()
+{
+	const uint32_t literalsCount = this->GetBits(5) + 257;
+	const uint32_t distancesCount = this->GetBits(5) + 1;
+	const uint32_t codeLengthsCount = this->GetBits(4) + 4;
+
+	if ((literalsCount > 286) || (distancesCount > 30))
+	{
+		return this->Fail("Invalid dynamic block header");
+	}
+
+	uint8_t lengths[286 + 30] = {};
+	for (uint32_t i = 0; i < codeLengthsCount; i++)
+	{
+		lengths[CODE_LENGTHS_ORDER[i]] = static_cast<uint8_t>(this->GetBits(3));
+	}
+
+	if (this->state == State::FAILED)
+	{
+		return false;
+	}
+
+	Huffman lengthsCode;
+	if (BuildHuffman(lengthsCode, lengths, 19) == false)
+	{
+		return this->Fail("Invalid code lengths code");
+	}
+
+	const uint32_t total = literalsCount + distancesCount;
+	uint32_t index = 0;
+
+	while (index < total)
+	{
+		int sym = this->DecodeSymbol(lengthsCode);
+		if (sym < 0)
+		{
+			return false;
+		}
+
+		if (sym < 16)
+		{
+			lengths[index++] = static_cast<uint8_t>(sym);
+			continue;
+		}
+
+		uint8_t len = 0;
+		uint32_t repeat = 0;
+
+		if (sym == 16)
+		{
+			if (index == 0)
+			{
+				return this->Fail("Repeated code length without previous length");
+			}
+			len = lengths[index - 1];
+			repeat = 3 + this->GetBits(2);
+		}
+		else if (sym == 17)
+		{
+			repeat = 3 + this->GetBits(3);
+		}
+		else
+		{
+			repeat = 11 + this->GetBits(7);
+		}
+
+		if ((this->state == State::FAILED) || (index + repeat > total))
+		{
+			return this->Fail("Invalid code lengths");
+		}
+
+		std::fill(lengths + index, lengths + index + repeat, len);
+		index += repeat;
+	}
+
+	if (lengths[256] == 0)
+	{
+		return this->Fail("Missing end of block code");
+	}
+
+	if ((BuildHuffman(this->literals, lengths, literalsCount) == false) ||
+		(BuildHuffman(this->distances, lengths + literalsCount, distancesCount) == false))
+	{
+		return this->Fail("Invalid literal / distance code");
+	}
+
+	return true;
+}
+
+bool InflateStream::ReadChecksum()
+{
+	this->GetBits(this->bitsCount % 8);
+
+	uint32_t expected = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		expected = (expected << 8) | this->GetBits(8);
+	}
+
+	if (this->state == State::FAILED)
+	{
+		return false;
+	}
+
+	if (expected != this->adler)
+	{
+		return this->Fail("Adler-32 checksum mismatch");
+	}
+
+	this->state = State::DONE;
+	return true;
+}
+
+//=================================================================================================
+// Block data
+//=================================================================================================
+
+/// <summary>
+/// Append decoded bytes to history window
+/// </summary>
+/// <param name="data"></param>
+/// <param name="len"></param>
+void InflateStream::AppendWindow(const uint8_t * data, size_t len)
+{
+	if (len >= WINDOW_SIZE)
+	{
+		std::memcpy(this->window.data(), data + len - WINDOW_SIZE, WINDOW_SIZE);
+		this->windowPos = 0;
+		return;
+	}
+
+	size_t first = std::min(len, WINDOW_SIZE - this->windowPos);
+	std::memcpy(this->window.data() + this->windowPos, data, first);
+	std::memcpy(this->window.data(), data + first, len - first);
+	this->windowPos = (this->windowPos + len) & (WINDOW_SIZE - 1);
+}
+
+/// <summary>
+/// Copy data of stored block
+/// Whole bytes already in bit buffer are used first,
+/// rest is copied directly from input buffer
+/// </summary>
+/// <param name="output"></param>
+/// <param name="count"></param>
+/// <returns></returns>
+size_t InflateStream::CopyStored(uint8_t * output, size_t count)
+{
+	size_t n = 0;
+
+	while ((n < count) && (this->storedRemaining > 0) && (this->bitsCount >= 8))
+	{
+		output[n++] = static_cast<uint8_t>(this->bitBuffer);
+		this->bitBuffer >>= 8;
+		this->bitsCount -= 8;
+		this->storedRemaining--;
+	}
+
+	while ((n < count) && (this->storedRemaining > 0))
+	{
+		if (this->inputPos == this->inputEnd)
+		{
+			this->inputPos = 0;
+			this->inputEnd = (this->inputEof) ? 0 : this->source(this->input.data(), this->input.size());
+			if (this->inputEnd == 0)
+			{
+				this->inputEof = true;
+				this->Fail("Unexpected end of compressed data");
+				break;
+			}
+		}
+
+		size_t len = std::min({ count - n, this->storedRemaining, this->inputEnd - this->inputPos });
+		std::memcpy(output + n, this->input.data() + this->inputPos, len);
+		this->inputPos += len;
+		this->storedRemaining -= len;
+		n += len;
+	}
+
+	this->AppendWindow(output, n);
+	this->totalOut += n;
+
+	if ((this->storedRemaining == 0) && (this->state == State::STORED))
+	{
+		this->state = State::BLOCK_HEADER;
+	}
+
+	return n;
+}
+
+/// <summary>
+/// Decode literals and matches of Huffman block until output is full
+/// or block ends. Unfinished match is continued by the next call.
+/// </summary>
+/// <param name="output"></param>
+/// <param name="count"></param>
+/// <returns></returns>
+size_t InflateStream::DecodeCodes(uint8_t * output, size_t count)
+{
+	const size_t mask = WINDOW_SIZE - 1;
+	uint8_t * window = this->window.data();
+	size_t n = 0;
+
+	while (n < count)
+	{
+		if (this->matchLength > 0)
+		{
+			const size_t len = std::min(this->matchLength, count - n);
+			size_t from = (this->windowPos - this->matchDistance) & mask;
+			size_t to = this->windowPos;
+
+			for (size_t i = 0; i < len; i++)
+			{
+				uint8_t b = window[from];
+				window[to] = b;
+				output[n + i] = b;
+				from = (from + 1) & mask;
+				to = (to + 1) & mask;
+			}
+
+			this->windowPos = to;
+			this->matchLength -= len;
+			this->totalOut += len;
+			n += len;
+			continue;
+		}
+
+		int sym = this->DecodeSymbol(this->literals);
+		if (sym < 0)
+		{
+			break;
+		}
+
+		if (sym < 256)
+		{
+			output[n++] = static_cast<uint8_t>(sym);
+			window[this->windowPos] = static_cast<uint8_t>(sym);
+			this->windowPos = (this->windowPos + 1) & mask;
+			this->totalOut++;
+			continue;
+		}
+
+		if (sym == 256)
+		{
+			this->state = State::BLOCK_HEADER;
+			break;
+		}
+
+		sym -= 257;
+		if (sym >= 29)
+		{
+			this->Fail("Invalid length symbol");
+			break;
+		}
+
+		size_t len = LENGTH_BASE[sym] + this->GetBits(LENGTH_EXTRA[sym]);
+
+		int dsym = this->DecodeSymbol(this->distances);
+		if (dsym < 0)
+		{
+			break;
+		}
+
+		if (dsym >= 30)
+		{
+			this->Fail("Invalid distance symbol");
+			break;
+		}
+
+		size_t dist = DISTANCE_BASE[dsym] + this->GetBits(DISTANCE_EXTRA[dsym]);
+		if (this->state == State::FAILED)
+		{
+			break;
+		}
+
+		if (dist > std::min(this->totalOut, size_t(WINDOW_SIZE)))
+		{
+			this->Fail("Distance is too far back");
+			break;
+		}
+
+		this->matchLength = len;
+		this->matchDistance = dist;
+	}
+
+	return n;
+}
+
+//=================================================================================================
+// Helpers
+//=================================================================================================
+
+/// <summary>
+/// Build canonical Huffman decoding tables from code lengths
+/// Incomplete codes are accepted (invalid codes fail when decoded),
+/// over-subscribed codes are rejected.
+/// </summary>
+/// <param name="h"></param>
+/// <param name="lengths"></param>
+/// <param name="count"></param>
+/// <returns></returns>
+bool InflateStream::BuildHuffman(Huffman & h, const uint8_t * lengths, size_t count)
+{
+	std::fill(h.counts, h.counts + MAX_CODE_BITS + 1, uint16_t(0));
+	for (size_t i = 0; i < count; i++)
+	{
+		h.counts[lengths[i]]++;
+	}
+	h.counts[0] = 0;
+
+	int left = 1;
+	for (unsigned len = 1; len <= MAX_CODE_BITS; len++)
+	{
+		left <<= 1;
+		left -= h.counts[len];
+		if (left < 0)
+		{
+			return false;
+		}
+	}
+
+	uint16_t offsets[MAX_CODE_BITS + 1];
+	uint16_t nextCode[MAX_CODE_BITS + 1];
+	offsets[1] = 0;
+	nextCode[1] = 0;
+	for (unsigned len = 1; len < MAX_CODE_BITS; len++)
+	{
+		offsets[len + 1] = offsets[len] + h.counts[len];
+		nextCode[len + 1] = static_cast<uint16_t>((nextCode[len] + h.counts[len]) << 1);
+	}
+
+	std::fill(h.fast, h.fast + (1 << FAST_BITS), uint16_t(0));
+
+	for (size_t sym = 0; sym < count; sym++)
+	{
+		const unsigned len = lengths[sym];
+		if (len == 0)
+		{
+			continue;
+		}
+
+		h.symbols[offsets[len]++] = static_cast<uint16_t>(sym);
+
+		unsigned code = nextCode[len]++;
+		if (len > FAST_BITS)
+		{
+			continue;
+		}
+
+		//codes are packed starting with their most significant bit
+		unsigned reversed = 0;
+		for (unsigned i = 0; i < len; i++)
+		{
+			reversed = (reversed << 1) | ((code >> i) & 1);
+		}
+
+		const uint16_t entry = static_cast<uint16_t>((sym << 4) | len);
+		for (unsigned j = reversed; j < (1u << FAST_BITS); j += (1u << len))
+		{
+			h.fast[j] = entry;
+		}
+	}
+
+	return true;
+}
+
+uint32_t InflateStream::UpdateAdler(uint32_t adler, const uint8_t * data, size_t len)
+{
+	//largest n such that 255 * n * (n + 1) / 2 + (n + 1) * 65520 fits to 32 bits
+	const size_t NMAX = 5552;
+	const uint32_t BASE = 65521;
+
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+
+	while (len > 0)
+	{
+		size_t n = std::min(len, NMAX);
+		len -= n;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		data += n;
+
+		a %= BASE;
+		b %= BASE;
+	}
+
+	return (b << 16) | a;
+}
@@ -0,0 +1,108 @@
+#ifndef INFLATE_STREAM_H
+#define INFLATE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/// <summary>
+/// Incremental zlib (RFC 1950) / deflate (RFC 1951) decoder
+/// Compressed data are pulled from source callback in small pieces,
+/// decompressed data are produced on demand by Read.
+/// Memory is 32KB history window and input buffer,
+/// independent of the size of stream.
+///
+/// Symbols are decoded with canonical Huffman tables, codes up to
+/// FAST_BITS long are resolved by single table lookup, longer codes
+/// are decoded bit by bit. Adler-32 of output is verified at the end of stream.
+/// </summary>
+class InflateStream
+{
+public:
+	/// <summary>
+	/// Fill buffer with at most size bytes of compressed data
+	/// Returns number of written bytes, 0 = end of input
+	/// </summary>
+	typedef std::function<size_t(uint8_t * buffer, size_t size)> SourceCallback;
+
+	InflateStream(const SourceCallback & source);
+
+	size_t Read(uint8_t * output, size_t count);
+	bool Finish();
+
+	bool IsFinished() const noexcept;
+	bool HasError() const noexcept;
+
+protected:
+	static const unsigned FAST_BITS = 10;
+	static const unsigned MAX_CODE_BITS = 15;
+	static const size_t WINDOW_SIZE = 32 * 1024;
+	static const size_t INPUT_BUFFER_SIZE = 16 * 1024;
+
+	enum class State
+	{
+		HEADER,
+		BLOCK_HEADER,
+		STORED,
+		CODES,
+		CHECKSUM,
+		DONE,
+		FAILED
+	};
+
+	/// <summary>
+	/// Canonical Huffman code
+	/// fast entry is (symbol << 4) | length, 0 if code is longer than FAST_BITS
+	/// </summary>
+	struct Huffman
+	{
+		uint16_t counts[MAX_CODE_BITS + 1];
+		uint16_t symbols[288];
+		uint16_t fast[1 << FAST_BITS];
+	};
+
+	SourceCallback source;
+	std::vector<uint8_t> input;
+	size_t inputPos;
+	size_t inputEnd;
+	bool inputEof;
+
+	uint64_t bitBuffer;
+	unsigned bitsCount;
+
+	State state;
+	bool lastBlock;
+	size_t storedRemaining;
+	size_t matchLength;
+	size_t matchDistance;
+
+	Huffman literals;
+	Huffman distances;
+
+	std::vector<uint8_t> window;
+	size_t windowPos;
+	size_t totalOut;
+	uint32_t adler;
+
+	bool Fail(const char * msg);
+
+	void Refill();
+	bool NeedBits(unsigned n);
+	uint32_t GetBits(unsigned n);
+	int DecodeSymbol(const Huffman & h);
+
+	bool ReadZlibHeader();
+	bool ReadBlockHeader();
+	bool ReadDynamicTables();
+	bool ReadChecksum();
+
+	void AppendWindow(const uint8_t * data, size_t len);
+	size_t CopyStored(uint8_t * output, size_t count);
+	size_t DecodeCodes(uint8_t * output, size_t count);
+
+	static bool BuildHuffman(Huffman & h, const uint8_t * lengths, size_t count);
+	static uint32_t UpdateAdler(uint32_t adler, const uint8_t * data, size_t len);
+};
+
+#endif
@@ -8,10 +8,13 @@
 #	endif
 #endif
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "./3rdParty/lodepng.h"
 
+#include "./PNGRowReader.h"
+
 #include "../Utils/Logger.h"
 
 //#include "../VFS/VFS.h"
@@ -133,6 +136,62 @@ PNGLoader::DecompressedImage PNGLoader::DecompressFromFile(IFile * file)
 }
 
 
+/// <summary>
+/// Decode PNG file in bands of rows without loading whole file
+/// or whole image to memory (see PNGRowReader)
+/// Output has 8 bits per channel, palette is handled based on SetKeepPalette.
+/// Interlaced files are not supported.
+/// </summary>
+/// <param name="fileName"></param>
+/// <param name="bandRows">number of rows passed to single callback call</param>
+/// <param name="callback"></param>
+/// <returns>false if file is not valid or callback stopped decoding</returns>
+bool PNGLoader::DecompressRowsFromFile(const char * fileName, unsigned bandRows, const RowsCallback & callback)
+{
+	RawFile rw(fileName);
+	if (rw.IsOpened() == false)
+	{
+		MY_LOG_ERROR("Failed to open file %s", fileName);
+		return false;
+	}
+
+	return this->DecompressRowsFromFile(&rw, bandRows, callback);
+}
+
+bool PNGLoader::DecompressRowsFromFile(IFile * file, unsigned bandRows, const RowsCallback & callback)
+{
+	PNGRowReader reader;
+	reader.SetKeepPalette(keepPalette);
+
+	if (reader.Open(file) == false)
+	{
+		return false;
+	}
+
+	const DecompressedImage & info = reader.GetInfo();
+	const unsigned band = std::clamp(bandRows, 1u, info.h);
+	const size_t rowBytes = reader.GetRowBytes();
+
+	std::vector<uint8_t> rows(band * rowBytes);
+
+	for (unsigned y = 0; y < info.h; y += band)
+	{
+		const unsigned n = std::min(band, info.h - y);
+
+		if (reader.ReadRows(rows.data(), rowBytes, n) == false)
+		{
+			return false;
+		}
+
+		if (callback(info, y, n, rows.data()) == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 PNGLoader::DecompressedImage PNGLoader::DecompressWithLodePNG(uint8_t * mem, size_t memSize)
 {
 	DecompressedImage dec;
@@ -7,6 +7,8 @@ struct IFile;
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <functional>
 
 
 class PNGLoader
@@ -65,10 +67,18 @@ public:
 
 		std::vector<uint8_t> data;
 		std::vector<RGBA> palette;
-		bool grayScalePallete;
+		bool grayScalePallete = false;
 
 	} DecompressedImage;
 
+	/// <summary>
+	/// Receiver of decoded band of rows [y, y + rowsCount)
+	/// rows are tightly packed, each info.w * info.channelsCount bytes
+	/// Return false to stop decoding
+	/// </summary>
+	typedef std::function<bool(const DecompressedImage & info, unsigned y, unsigned rowsCount,
+		const uint8_t * rows)> RowsCallback;
+
 	PNGLoader();
 	PNGLoader(USED_LIBRARY lib);
 	~PNGLoader();
@@ -79,6 +89,9 @@ public:
 	DecompressedImage DecompressFromFile(const char * fileName);
 	DecompressedImage DecompressFromFile(IFile * file);
 
+	bool DecompressRowsFromFile(const char * fileName, unsigned bandRows, const RowsCallback & callback);
+	bool DecompressRowsFromFile(IFile * file, unsigned bandRows, const RowsCallback & callback);
+
 private:
 
 	typedef struct PngRawData
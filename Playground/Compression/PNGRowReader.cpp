@@ -0,0 +1,698 @@
+#include "./PNGRowReader.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+#include "./InflateStream.h"
+
+#include "../FileUtils/IFile.h"
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+
+PNGRowReader::PNGRowReader() :
+	file(nullptr),
+	keepPalette(false),
+	colorType(0),
+	srcBitDepth(0),
+	srcRowBytes(0),
+	filterStep(0),
+	currentRow(0),
+	chunkRemaining(0),
+	chunkCrc(0),
+	idatEnded(false),
+	failed(false)
+{
+	this->info.w = 0;
+	this->info.h = 0;
+	this->info.channelsCount = 0;
+	this->info.bitDepth = 0;
+	this->info.grayScalePallete = false;
+}
+
+PNGRowReader::~PNGRowReader()
+{
+}
+
+/// <summary>
+/// Keep data in palette
+/// If set to false, rows are unpacked from palette to real colors
+/// If set to true, palette is kept in info and rows are indexes to palette
+/// Must be set before Open
+/// </summary>
+/// <param name="val"></param>
+void PNGRowReader::SetKeepPalette(bool val)
+{
+	this->keepPalette = val;
+}
+
+/// <summary>
+/// Read all chunks up to the start of image data
+/// File must stay opened while rows are read
+/// </summary>
+/// <param name="file"></param>
+/// <returns>false if file is not valid PNG or it is not supported</returns>
+bool PNGRowReader::Open(IFile * file)
+{
+	static const uint8_t SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+	this->file = file;
+	this->inflate.reset();
+	this->info.w = 0;
+	this->info.h = 0;
+	this->info.channelsCount = 0;
+	this->info.bitDepth = 0;
+	this->info.palette.clear();
+	this->info.grayScalePallete = false;
+	this->currentRow = 0;
+	this->chunkRemaining = 0;
+	this->idatEnded = false;
+	this->failed = false;
+
+	uint8_t sig[8];
+	if ((file == nullptr) || (file->Read(sig, sizeof(uint8_t), 8) != 8) ||
+		(std::memcmp(sig, SIGNATURE, 8) != 0))
+	{
+		return this->Fail("Not a PNG file");
+	}
+
+	bool hasHeader = false;
+	std::vector<uint8_t> alpha;
+	std::vector<uint8_t> data;
+
+	while (true)
+	{
+		uint32_t length = 0;
+		char type[4];
+		if (this->ReadChunkHeader(length, type) == false)
+		{
+			return false;
+		}
+
+		if ((hasHeader == false) && (std::memcmp(type, "IHDR", 4) != 0))
+		{
+			return this->Fail("IHDR must be the first chunk");
+		}
+
+		if (std::memcmp(type, "IDAT", 4) == 0)
+		{
+			this->chunkRemaining = length;
+			break;
+		}
+
+		if (std::memcmp(type, "IEND", 4) == 0)
+		{
+			return this->Fail("Missing image data");
+		}
+
+		const bool known = (std::memcmp(type, "IHDR", 4) == 0) ||
+			(std::memcmp(type, "PLTE", 4) == 0) || (std::memcmp(type, "tRNS", 4) == 0);
+
+		if (known == false)
+		{
+			//bit 5 of the first letter is 0 for critical chunks
+			if ((type[0] & 0x20) == 0)
+			{
+				MY_LOG_ERROR("Unsupported critical PNG chunk %.4s", type);
+				this->failed = true;
+				return false;
+			}
+
+			this->file->Seek(static_cast<long>(length), SEEK_CUR);
+			if (this->FinishChunk(false) == false)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		data.resize(length);
+		if ((this->ReadChunkData(data.data(), length) == false) || (this->FinishChunk(true) == false))
+		{
+			return false;
+		}
+
+		bool ok = true;
+		if (std::memcmp(type, "IHDR", 4) == 0)
+		{
+			ok = (hasHeader == false) && this->ParseHeader(data.data(), length);
+			hasHeader = true;
+		}
+		else if (std::memcmp(type, "PLTE", 4) == 0)
+		{
+			ok = this->ParsePalette(data.data(), length);
+		}
+		else if (this->colorType == PALETTE)
+		{
+			ok = (length <= 256);
+			alpha = data;
+		}
+
+		if (ok == false)
+		{
+			return this->failed ? false : this->Fail("Invalid chunk");
+		}
+	}
+
+	if ((this->colorType == PALETTE) && (this->info.palette.empty()))
+	{
+		return this->Fail("Missing palette");
+	}
+
+	this->SetOutputFormat(alpha);
+
+	const size_t srcChannels = (this->colorType == RGB) ? 3 :
+		(this->colorType == GRAY_ALPHA) ? 2 :
+		(this->colorType == RGB_ALPHA) ? 4 : 1;
+	const size_t bitsPerPixel = srcChannels * this->srcBitDepth;
+
+	this->srcRowBytes = (size_t(this->info.w) * bitsPerPixel + 7) / 8;
+	this->filterStep = std::max<size_t>(1, bitsPerPixel / 8);
+
+	//row with leading filter type byte, previous row of the first row is zero
+	this->curRow.assign(this->srcRowBytes + 1, 0);
+	this->prevRow.assign(this->srcRowBytes + 1, 0);
+
+	if (this->srcBitDepth < 8)
+	{
+		this->indices.resize(this->info.w);
+	}
+
+	this->inflate = std::make_unique<InflateStream>([this](uint8_t * buffer, size_t size) {
+		return this->ReadIdat(buffer, size);
+	});
+
+	return true;
+}
+
+/// <summary>
+/// Get image properties (data are always empty)
+/// </summary>
+/// <returns></returns>
+const PNGLoader::DecompressedImage & PNGRowReader::GetInfo() const noexcept
+{
+	return this->info;
+}
+
+/// <summary>
+/// Get number of bytes of one output row
+/// </summary>
+/// <returns></returns>
+size_t PNGRowReader::GetRowBytes() const noexcept
+{
+	return size_t(this->info.w) * this->info.channelsCount;
+}
+
+/// <summary>
+/// Get index of the next row returned by ReadRows
+/// </summary>
+/// <returns></returns>
+unsigned PNGRowReader::GetCurrentRow() const noexcept
+{
+	return this->currentRow;
+}
+
+/// <summary>
+/// Decode next rowsCount rows
+/// After the last row, rest of the image data is checked (Adler-32, CRC)
+/// </summary>
+/// <param name="output">rowsCount rows, each GetRowBytes() long</param>
+/// <param name="stride">distance between starts of output rows in bytes</param>
+/// <param name="rowsCount"></param>
+/// <returns>false if data are corrupted or there are not enough rows</returns>
+bool PNGRowReader::ReadRows(uint8_t * output, size_t stride, unsigned rowsCount)
+{
+	if ((this->inflate == nullptr) || (this->failed))
+	{
+		MY_LOG_ERROR("PNG reader is not opened");
+		return false;
+	}
+
+	if (rowsCount > this->info.h - this->currentRow)
+	{
+		MY_LOG_ERROR("Requested %u rows, only %u remains", rowsCount, this->info.h - this->currentRow);
+		return false;
+	}
+
+	for (unsigned i = 0; i < rowsCount; i++)
+	{
+		if (this->inflate->Read(this->curRow.data(), this->curRow.size()) != this->curRow.size())
+		{
+			return this->Fail("Image data are truncated or corrupted");
+		}
+
+		if (this->Unfilter(this->curRow[0], this->curRow.data() + 1, this->prevRow.data() + 1) == false)
+		{
+			return this->Fail("Invalid filter type");
+		}
+
+		this->ConvertRow(this->curRow.data() + 1, output + i * stride);
+
+		std::swap(this->curRow, this->prevRow);
+		this->currentRow++;
+	}
+
+	if ((rowsCount > 0) && (this->currentRow == this->info.h))
+	{
+		if (this->inflate->Finish() == false)
+		{
+			this->failed = true;
+			return false;
+		}
+
+		//remaining IDAT data are not part of zlib stream, but their CRC is checked
+		uint8_t tmp[256];
+		while (this->ReadIdat(tmp, sizeof(tmp)) > 0)
+		{
+		}
+	}
+
+	return (this->failed == false);
+}
+
+bool PNGRowReader::Fail(const char * msg)
+{
+	MY_LOG_ERROR("PNG: %s", msg);
+	this->failed = true;
+	return false;
+}
+
+//=================================================================================================
+// Chunks
+//=================================================================================================
+
+/// <summary>
+/// Read chunk length and type and start its CRC
+/// </summary>
+/// <param name="length"></param>
+/// <param name="type"></param>
+/// <returns></returns>
+bool PNGRowReader::ReadChunkHeader(uint32_t & length, char type[4])
+{
+	uint8_t header[8];
+	if (this->file->Read(header, sizeof(uint8_t), 8) != 8)
+	{
+		return this->Fail("Unexpected end of file");
+	}
+
+	length = ReadU32(header);
+	if (length > 0x7FFFFFFF)
+	{
+		return this->Fail("Invalid chunk length");
+	}
+
+	std::memcpy(type, header + 4, 4);
+	this->chunkCrc = UpdateCrc(0xFFFFFFFF, header + 4, 4);
+
+	return true;
+}
+
+bool PNGRowReader::ReadChunkData(uint8_t * data, uint32_t length)
+{
+	if (this->file->Read(data, sizeof(uint8_t), length) != length)
+	{
+		return this->Fail("Unexpected end of file");
+	}
+
+	this->chunkCrc = UpdateCrc(this->chunkCrc, data, length);
+	return true;
+}
+
+/// <summary>
+/// Read CRC at the end of chunk
+/// </summary>
+/// <param name="verify">compare CRC with data read by ReadChunkData</param>
+/// <returns></returns>
+bool PNGRowReader::FinishChunk(bool verify)
+{
+	uint8_t crc[4];
+	if (this->file->Read(crc, sizeof(uint8_t), 4) != 4)
+	{
+		return this->Fail("Unexpected end of file");
+	}
+
+	if ((verify) && (ReadU32(crc) != (this->chunkCrc ^ 0xFFFFFFFF)))
+	{
+		return this->Fail("Chunk CRC mismatch");
+	}
+
+	return true;
+}
+
+bool PNGRowReader::ParseHeader(const uint8_t * data, uint32_t length)
+{
+	if (length != 13)
+	{
+		return this->Fail("Invalid IHDR size");
+	}
+
+	const uint32_t w = ReadU32(data);
+	const uint32_t h = ReadU32(data + 4);
+	const uint8_t bitDepth = data[8];
+	const uint8_t type = data[9];
+
+	if ((w == 0) || (h == 0) || (w > 0x7FFFFFFF) || (h > 0x7FFFFFFF))
+	{
+		return this->Fail("Invalid image size");
+	}
+
+	bool valid = false;
+	switch (type)
+	{
+	case GRAY:
+		valid = (bitDepth == 1) || (bitDepth == 2) || (bitDepth == 4) || (bitDepth == 8) || (bitDepth == 16);
+		break;
+	case PALETTE:
+		valid = (bitDepth == 1) || (bitDepth == 2) || (bitDepth == 4) || (bitDepth == 8);
+		break;
+	case RGB:
+	case GRAY_ALPHA:
+	case RGB_ALPHA:
+		valid = (bitDepth == 8) || (bitDepth == 16);
+		break;
+	default:
+		break;
+	}
+
+	if (valid == false)
+	{
+		MY_LOG_ERROR("Invalid PNG color type %u with bit depth %u", type, bitDepth);
+		this->failed = true;
+		return false;
+	}
+
+	if ((data[10] != 0) || (data[11] != 0))
+	{
+		return this->Fail("Unknown compression or filter method");
+	}
+
+	if (data[12] == 1)
+	{
+		return this->Fail("Interlaced images are not supported by streaming decoder");
+	}
+	else if (data[12] != 0)
+	{
+		return this->Fail("Unknown interlace method");
+	}
+
+	this->info.w = w;
+	this->info.h = h;
+	this->colorType = type;
+	this->srcBitDepth = bitDepth;
+
+	return true;
+}
+
+bool PNGRowReader::ParsePalette(const uint8_t * data, uint32_t length)
+{
+	if ((length == 0) || (length > 3 * 256) || (length % 3 != 0))
+	{
+		return this->Fail("Invalid palette size");
+	}
+
+	this->info.palette.clear();
+	this->info.palette.reserve(length / 3);
+	this->info.grayScalePallete = true;
+
+	for (uint32_t i = 0; i < length; i += 3)
+	{
+		this->info.palette.emplace_back(data[i], data[i + 1], data[i + 2]);
+		this->info.grayScalePallete &= this->info.palette.back().IsGrayScale();
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Set channels count of output rows
+/// and build lookup table for palette expansion
+/// </summary>
+/// <param name="alpha">tRNS of palette image</param>
+void PNGRowReader::SetOutputFormat(const std::vector<uint8_t> & alpha)
+{
+	this->info.bitDepth = 8;
+
+	for (size_t i = 0; i < std::min(alpha.size(), this->info.palette.size()); i++)
+	{
+		this->info.palette[i].a = alpha[i];
+	}
+
+	switch (this->colorType)
+	{
+	case RGB:
+		this->info.channelsCount = 3;
+		return;
+	case GRAY_ALPHA:
+		this->info.channelsCount = 2;
+		return;
+	case RGB_ALPHA:
+		this->info.channelsCount = 4;
+		return;
+	case PALETTE:
+		break;
+	default:
+		this->info.channelsCount = 1;
+		return;
+	}
+
+	if (this->keepPalette)
+	{
+		this->info.channelsCount = 1;
+		return;
+	}
+
+	this->info.channelsCount = (alpha.empty() == false) ? 4 :
+		(this->info.grayScalePallete) ? 1 : 3;
+
+	//all 256 entries, so that any index is valid (indexes out of palette are black)
+	const size_t c = this->info.channelsCount;
+	this->paletteTable.assign(256 * c, 0);
+
+	for (size_t i = 0; i < 256; i++)
+	{
+		const PNGLoader::RGBA rgba = (i < this->info.palette.size()) ?
+			this->info.palette[i] : PNGLoader::RGBA(0, 0, 0);
+
+		std::copy(rgba._rgba, rgba._rgba + c, this->paletteTable.data() + i * c);
+	}
+}
+
+/// <summary>
+/// Source of compressed data for inflate
+/// Data of consecutive IDAT chunks form single zlib stream
+/// </summary>
+/// <param name="buffer"></param>
+/// <param name="size"></param>
+/// <returns></returns>
+size_t PNGRowReader::ReadIdat(uint8_t * buffer, size_t size)
+{
+	while (this->chunkRemaining == 0)
+	{
+		if ((this->idatEnded) || (this->failed))
+		{
+			return 0;
+		}
+
+		if (this->FinishChunk(true) == false)
+		{
+			return 0;
+		}
+
+		uint32_t length = 0;
+		char type[4];
+		if (this->ReadChunkHeader(length, type) == false)
+		{
+			return 0;
+		}
+
+		if (std::memcmp(type, "IDAT", 4) != 0)
+		{
+			this->idatEnded = true;
+			return 0;
+		}
+
+		this->chunkRemaining = length;
+	}
+
+	const uint32_t len = static_cast<uint32_t>(std::min<size_t>(size, this->chunkRemaining));
+	if (this->ReadChunkData(buffer, len) == false)
+	{
+		return 0;
+	}
+
+	this->chunkRemaining -= len;
+	return len;
+}
+
+//=================================================================================================
+// Rows
+//=================================================================================================
+
+/// <summary>
+/// Reverse PNG filter of row in place
+/// </summary>
+/// <param name="filter">filter type</param>
+/// <param name="row"></param>
+/// <param name="prev">unfiltered previous row (zeros for the first row)</param>
+/// <returns>false for unknown filter type</returns>
+bool PNGRowReader::Unfilter(uint8_t filter, uint8_t * row, const uint8_t * prev) const
+{
+	const size_t n = this->srcRowBytes;
+	const size_t s = std::min(this->filterStep, n);
+
+	switch (filter)
+	{
+	case 0:
+		return true;
+
+	case 1:
+		for (size_t i = s; i < n; i++)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + row[i - s]);
+		}
+		return true;
+
+	case 2:
+		for (size_t i = 0; i < n; i++)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+		}
+		return true;
+
+	case 3:
+		for (size_t i = 0; i < s; i++)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + (prev[i] >> 1));
+		}
+		for (size_t i = s; i < n; i++)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + ((row[i - s] + prev[i]) >> 1));
+		}
+		return true;
+
+	case 4:
+		//left and upper-left are zero for the first pixel, so predictor is upper value
+		for (size_t i = 0; i < s; i++)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+		}
+		for (size_t i = s; i < n; i++)
+		{
+			const int a = row[i - s];
+			const int b = prev[i];
+			const int c = prev[i - s];
+			const int pa = std::abs(b - c);
+			const int pb = std::abs(a - c);
+			const int pc = std::abs(a + b - 2 * c);
+
+			const int p = ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+			row[i] = static_cast<uint8_t>(row[i] + p);
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+/// Convert unfiltered row to 8 bits per channel output
+/// </summary>
+/// <param name="row"></param>
+/// <param name="output"></param>
+void PNGRowReader::ConvertRow(const uint8_t * row, uint8_t * output)
+{
+	const size_t w = this->info.w;
+
+	if (this->colorType == PALETTE)
+	{
+		const uint8_t * idx = row;
+		if (this->srcBitDepth < 8)
+		{
+			ImageKernels::UnpackIndices(row, w, this->srcBitDepth, this->indices.data());
+			idx = this->indices.data();
+		}
+
+		if (this->keepPalette)
+		{
+			std::copy(idx, idx + w, output);
+		}
+		else
+		{
+			ImageKernels::ExpandPalette(idx, w, this->paletteTable.data(), 256,
+				this->info.channelsCount, output);
+		}
+		return;
+	}
+
+	const size_t len = w * this->info.channelsCount;
+
+	if (this->srcBitDepth == 16)
+	{
+		//big-endian samples, keep high byte
+		for (size_t i = 0; i < len; i++)
+		{
+			output[i] = row[2 * i];
+		}
+	}
+	else if (this->srcBitDepth < 8)
+	{
+		//gray only, 1 / 2 / 4 bit values scaled by 255 / 85 / 17
+		ImageKernels::UnpackIndices(row, w, this->srcBitDepth, output);
+
+		const uint8_t scale = static_cast<uint8_t>(255 / ((1 << this->srcBitDepth) - 1));
+		for (size_t i = 0; i < w; i++)
+		{
+			output[i] = static_cast<uint8_t>(output[i] * scale);
+		}
+	}
+	else
+	{
+		std::copy(row, row + len, output);
+	}
+}
+
+//=================================================================================================
+// Helpers
+//=================================================================================================
+
+/// <summary>
+/// Update CRC-32 (ISO 3309) used by PNG chunks
+/// Initial value is 0xFFFFFFFF, final CRC is crc ^ 0xFFFFFFFF
+/// </summary>
+/// <param name="crc"></param>
+/// <param name="data"></param>
+/// <param name="len"></param>
+/// <returns></returns>
+uint32_t PNGRowReader::UpdateCrc(uint32_t crc, const uint8_t * data, size_t len)
+{
+	static const std::array<uint32_t, 256> TABLE = []() {
+		std::array<uint32_t, 256> t;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			}
+			t[i] = c;
+		}
+		return t;
+	}();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		crc = TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+uint32_t PNGRowReader::ReadU32(const uint8_t * data)
+{
+	return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) |
+		(uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
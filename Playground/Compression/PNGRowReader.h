@@ -0,0 +1,96 @@
+#ifndef PNG_ROW_READER_H
+#define PNG_ROW_READER_H
+
+struct IFile;
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "./PNGLoader.h"
+
+class InflateStream;
+
+/// <summary>
+/// Streaming PNG decoder
+/// Chunks are read from IFile incrementally, IDAT stream is inflated
+/// and unfiltered one scanline at a time, so memory is proportional
+/// to few rows and not to the size of image.
+///
+/// Rows are returned with 8 bits per channel:
+/// - 16-bit channels are reduced to their high byte
+/// - 1, 2, 4-bit gray is scaled to [0, 255]
+/// - palette is kept as indices (SetKeepPalette(true)) or expanded
+///   to gray / RGB / RGBA (based on palette colors and tRNS)
+/// tRNS color key of gray / RGB images is ignored.
+/// Interlaced (Adam7) images are not supported.
+/// </summary>
+class PNGRowReader
+{
+public:
+	PNGRowReader();
+	~PNGRowReader();
+
+	void SetKeepPalette(bool val);
+
+	bool Open(IFile * file);
+
+	const PNGLoader::DecompressedImage & GetInfo() const noexcept;
+	size_t GetRowBytes() const noexcept;
+	unsigned GetCurrentRow() const noexcept;
+
+	bool ReadRows(uint8_t * output, size_t stride, unsigned rowsCount);
+
+protected:
+	enum ColorType
+	{
+		GRAY = 0,
+		RGB = 2,
+		PALETTE = 3,
+		GRAY_ALPHA = 4,
+		RGB_ALPHA = 6
+	};
+
+	IFile * file;
+	bool keepPalette;
+
+	PNGLoader::DecompressedImage info;
+	uint8_t colorType;
+	uint8_t srcBitDepth;
+	size_t srcRowBytes;
+	size_t filterStep;
+	unsigned currentRow;
+
+	std::vector<uint8_t> paletteTable;
+	std::vector<uint8_t> indices;
+
+	uint32_t chunkRemaining;
+	uint32_t chunkCrc;
+	bool idatEnded;
+	bool failed;
+
+	std::unique_ptr<InflateStream> inflate;
+	std::vector<uint8_t> prevRow;
+	std::vector<uint8_t> curRow;
+
+	bool Fail(const char * msg);
+
+	bool ReadChunkHeader(uint32_t & length, char type[4]);
+	bool ReadChunkData(uint8_t * data, uint32_t length);
+	bool FinishChunk(bool verify);
+
+	bool ParseHeader(const uint8_t * data, uint32_t length);
+	bool ParsePalette(const uint8_t * data, uint32_t length);
+	void SetOutputFormat(const std::vector<uint8_t> & alpha);
+
+	size_t ReadIdat(uint8_t * buffer, size_t size);
+
+	bool Unfilter(uint8_t filter, uint8_t * row, const uint8_t * prev) const;
+	void ConvertRow(const uint8_t * row, uint8_t * output);
+
+	static uint32_t UpdateCrc(uint32_t crc, const uint8_t * data, size_t len);
+	static uint32_t ReadU32(const uint8_t * data);
+};
+
+#endif
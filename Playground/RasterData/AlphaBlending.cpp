@@ -0,0 +1,207 @@
+#include "./AlphaBlending.h"
+
+#include <algorithm>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Multiply colors of RGBA image by its alpha
+/// </summary>
+/// <param name="img"></param>
+template <typename T>
+void AlphaBlending::Premultiply(Image2d<T> & img)
+{
+	ProcessAlpha<T>(img, &ImageKernels::PremultiplyAlpha);
+}
+
+/// <summary>
+/// Divide colors of premultiplied RGBA image by its alpha
+/// Pixels with zero alpha get zero colors
+/// </summary>
+/// <param name="img"></param>
+template <typename T>
+void AlphaBlending::Unpremultiply(Image2d<T> & img)
+{
+	ProcessAlpha<T>(img, &ImageKernels::UnpremultiplyAlpha);
+}
+
+/// <summary>
+/// Composite premultiplied RGBA src over dst with top left corner of src at [x, y]
+/// Part of src outside of dst is skipped
+/// </summary>
+/// <param name="dst">premultiplied RGBA or RGB image</param>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="src">premultiplied RGBA image</param>
+template <typename T>
+void AlphaBlending::BlendOver(Image2d<T> & dst, int x, int y, const Image2d<T> & src)
+{
+	if (src.GetChannelsCount() != 4)
+	{
+		MY_LOG_ERROR("Blend source must have 4 channels (RGBA), has %zu", src.GetChannelsCount());
+		return;
+	}
+
+	const size_t dstChannelsCount = dst.GetChannelsCount();
+	if ((dstChannelsCount != 3) && (dstChannelsCount != 4))
+	{
+		MY_LOG_ERROR("Blend destination must have 3 or 4 channels, has %zu", dstChannelsCount);
+		return;
+	}
+
+	const int subX = std::max(0, -x);
+	const int subY = std::max(0, -y);
+
+	auto target = dst.CreateView(x + subX, y + subY, src.GetDimension());
+	auto source = src.CreateView(subX, subY, target.GetDimension());
+
+	const size_t w = size_t(source.GetWidth());
+	const size_t h = size_t(source.GetHeight());
+	if ((w == 0) || (h == 0))
+	{
+		return;
+	}
+
+	const size_t rowBytes = w * 4 * sizeof(T);
+	const size_t grainRows = std::max<size_t>(1, size_t(PARALLEL_MIN_TASK_SIZE) / rowBytes);
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+		std::vector<T> srcTmp;
+		std::vector<T> dstTmp;
+
+		for (size_t row = y0; row < y1; row++)
+		{
+			const T * s = GetInterleavedRow(source, int(row), srcTmp);
+			T * d = GetInterleavedRow(target, int(row), dstTmp);
+
+			ImageKernels::BlendOver(s, d, w, dstChannelsCount);
+
+			if (d == dstTmp.data())
+			{
+				SetInterleavedRow(target, int(row), d);
+			}
+		}
+	});
+}
+
+/// <summary>
+/// Run in-place alpha kernel over all rows of RGBA image
+/// </summary>
+/// <param name="img"></param>
+/// <param name="kernel"></param>
+template <typename T>
+void AlphaBlending::ProcessAlpha(Image2d<T> & img, void (*kernel)(T *, size_t))
+{
+	if (img.GetChannelsCount() != 4)
+	{
+		MY_LOG_ERROR("Alpha is supported only for 4 channels (RGBA), image has %zu", img.GetChannelsCount());
+		return;
+	}
+
+	const size_t w = size_t(img.GetWidth());
+	const size_t h = size_t(img.GetHeight());
+	if ((w == 0) || (h == 0))
+	{
+		return;
+	}
+
+	if (img.GetLayout() == ImageUtils::DataLayout::INTERLEAVED)
+	{
+		//whole image is single contiguous row
+		T * data = img.GetData().data();
+		const size_t grainPixels = std::max<size_t>(1, size_t(PARALLEL_MIN_TASK_SIZE) / (4 * sizeof(T)));
+
+		MyUtils::ThreadPool::GetInstance()->ParallelFor(0, w * h, grainPixels, [&](size_t i0, size_t i1) {
+			kernel(data + i0 * 4, i1 - i0);
+		});
+		return;
+	}
+
+	auto view = img.CreateView();
+	const size_t grainRows = std::max<size_t>(1, size_t(PARALLEL_MIN_TASK_SIZE) / (w * 4 * sizeof(T)));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+		std::vector<T> tmp;
+
+		for (size_t row = y0; row < y1; row++)
+		{
+			T * d = GetInterleavedRow(view, int(row), tmp);
+			kernel(d, w);
+			SetInterleavedRow(view, int(row), d);
+		}
+	});
+}
+
+/// <summary>
+/// Get row of view as interleaved pixels
+/// Interleaved row is returned directly, planar row is gathered to tmp
+/// </summary>
+/// <param name="view"></param>
+/// <param name="y"></param>
+/// <param name="tmp"></param>
+/// <returns></returns>
+template <typename V, typename T>
+V * AlphaBlending::GetInterleavedRow(const Image2dView<V> & view, int y, std::vector<T> & tmp)
+{
+	const size_t channelsCount = view.GetChannelsCount();
+	if (view.GetPixelStride() == channelsCount)
+	{
+		return view.GetRowStart(y);
+	}
+
+	const size_t w = size_t(view.GetWidth());
+	const size_t pixelStride = view.GetPixelStride();
+	const size_t channelStride = view.GetChannelStride();
+	const V * row = view.GetRowStart(y);
+
+	tmp.resize(w * channelsCount);
+	for (size_t c = 0; c < channelsCount; c++)
+	{
+		const V * channel = row + c * channelStride;
+		for (size_t i = 0; i < w; i++)
+		{
+			tmp[i * channelsCount + c] = channel[i * pixelStride];
+		}
+	}
+
+	return tmp.data();
+}
+
+/// <summary>
+/// Scatter interleaved pixels back to row of planar view
+/// </summary>
+/// <param name="view"></param>
+/// <param name="y"></param>
+/// <param name="row"></param>
+template <typename T>
+void AlphaBlending::SetInterleavedRow(const Image2dView<T> & view, int y, const T * row)
+{
+	const size_t channelsCount = view.GetChannelsCount();
+	const size_t w = size_t(view.GetWidth());
+	const size_t pixelStride = view.GetPixelStride();
+	const size_t channelStride = view.GetChannelStride();
+	T * dst = view.GetRowStart(y);
+
+	for (size_t c = 0; c < channelsCount; c++)
+	{
+		T * channel = dst + c * channelStride;
+		for (size_t i = 0; i < w; i++)
+		{
+			channel[i * pixelStride] = row[i * channelsCount + c];
+		}
+	}
+}
+
+//=================================================================================================
+
+template void AlphaBlending::Premultiply(Image2d<uint8_t> & img);
+template void AlphaBlending::Premultiply(Image2d<float> & img);
+
+template void AlphaBlending::Unpremultiply(Image2d<uint8_t> & img);
+template void AlphaBlending::Unpremultiply(Image2d<float> & img);
+
+template void AlphaBlending::BlendOver(Image2d<uint8_t> & dst, int x, int y, const Image2d<uint8_t> & src);
+template void AlphaBlending::BlendOver(Image2d<float> & dst, int x, int y, const Image2d<float> & src);
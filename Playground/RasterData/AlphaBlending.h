@@ -0,0 +1,47 @@
+#ifndef ALPHA_BLENDING_H
+#define ALPHA_BLENDING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./Image2d.h"
+#include "./Image2dView.h"
+
+/// <summary>
+/// Premultiplied alpha and Porter-Duff "over" compositing of Image2d<uint8_t / float>
+///
+/// Alpha is the last channel of 4 channel (RGBA) image.
+/// uint8_t colors are premultiplied with rounding, c' = round(c * a / 255),
+/// and composited with exact rounded division by 255 (SIMD, ImageKernels).
+/// BlendOver expects premultiplied RGBA source; destination is premultiplied RGBA
+/// or RGB (treated as opaque). Source is clipped like Image2d::SetSubImage.
+/// Rows are processed in parallel on the shared ThreadPool,
+/// planar rows are converted to interleaved temporary rows.
+/// </summary>
+class AlphaBlending
+{
+public:
+	template <typename T>
+	static void Premultiply(Image2d<T> & img);
+
+	template <typename T>
+	static void Unpremultiply(Image2d<T> & img);
+
+	template <typename T>
+	static void BlendOver(Image2d<T> & dst, int x, int y, const Image2d<T> & src);
+
+private:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+
+	template <typename T>
+	static void ProcessAlpha(Image2d<T> & img, void (*kernel)(T *, size_t));
+
+	template <typename V, typename T>
+	static V * GetInterleavedRow(const Image2dView<V> & view, int y, std::vector<T> & tmp);
+
+	template <typename T>
+	static void SetInterleavedRow(const Image2dView<T> & view, int y, const T * row);
+};
+
+#endif
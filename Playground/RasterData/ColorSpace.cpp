@@ -1,6 +1,30 @@
 #include "./ColorSpace.h"
 
+#include <algorithm>
 
+#include "./Image2d.h"
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+//sRGB (D65) <-> XYZ
+static const float RGB_TO_XYZ[9] = {
+	0.4124564f, 0.3575761f, 0.1804375f,
+	0.2126729f, 0.7151522f, 0.0721750f,
+	0.0193339f, 0.1191920f, 0.9503041f
+};
+
+static const float XYZ_TO_RGB[9] = {
+	3.2404542f, -1.5371385f, -0.4985314f,
+	-0.9692660f, 1.8760108f, 0.0415560f,
+	0.0556434f, -0.2040259f, 1.0572252f
+};
+
+//D65 white point chromaticity for CIE_LUV
+static const float WHITE_U = 0.1978398f;
+static const float WHITE_V = 0.4683363f;
 
 /// <summary>
 /// Get number of channels based on PixelFormat
@@ -15,10 +39,635 @@ size_t ColorSpace::GetChannelsCount(PixelFormat pf)
 	case PixelFormat::RGB: return 3;
 	case PixelFormat::RG: return 2;
 	case PixelFormat::RGBA: return 4;
-	case PixelFormat::XYZ: return 3;	
+	case PixelFormat::XYZ: return 3;
 	case PixelFormat::CIE_LUV: return 3;
 	case PixelFormat::HSV: return 3;
 	default: return 0;
 	}
 }
 
+/// <summary>
+/// Test if conversion between formats is supported
+/// </summary>
+/// <param name="from"></param>
+/// <param name="to"></param>
+/// <returns></returns>
+bool ColorSpace::IsConversionSupported(PixelFormat from, PixelFormat to) noexcept
+{
+	auto isSupported = [](PixelFormat pf) {
+		return (pf == PixelFormat::GRAY) || (pf == PixelFormat::RGB) || (pf == PixelFormat::RGBA) ||
+			(pf == PixelFormat::XYZ) || (pf == PixelFormat::CIE_LUV) || (pf == PixelFormat::HSV);
+	};
+
+	return isSupported(from) && isSupported(to);
+}
+
+/// <summary>
+/// Formats computed from linear RGB
+/// </summary>
+/// <param name="pf"></param>
+/// <returns></returns>
+bool ColorSpace::IsLinearRgbFormat(PixelFormat pf) noexcept
+{
+	return (pf == PixelFormat::XYZ) || (pf == PixelFormat::CIE_LUV);
+}
+
+//=================================================================================================
+// Image conversion
+//=================================================================================================
+
+/// <summary>
+/// Convert image to pixel format
+/// If both formats have the same number of channels, data are converted in place,
+/// otherwise image data are reallocated. Layout is kept.
+/// Alpha is dropped if target has no alpha, missing alpha is set to max value.
+/// </summary>
+/// <param name="img"></param>
+/// <param name="pf">target format</param>
+/// <returns>false if conversion is not supported</returns>
+template <typename T>
+bool ColorSpace::Convert(Image2d<T> & img, PixelFormat pf)
+{
+	if (img.GetPixelFormat() == pf)
+	{
+		return true;
+	}
+
+	if (IsConversionSupported(img.GetPixelFormat(), pf) == false)
+	{
+		MY_LOG_ERROR("Conversion between pixel formats %d and %d is not supported",
+			int(img.GetPixelFormat()), int(pf));
+		return false;
+	}
+
+	if (img.GetChannelsCount() != GetChannelsCount(pf))
+	{
+		img = CreateConverted(img, pf);
+		return true;
+	}
+
+	T * data = img.GetData().data();
+	ConvertRows<T>(data, img.GetPixelFormat(), img.GetPixelStride(), img.GetChannelStride(),
+		data, pf, img.GetPixelStride(), img.GetChannelStride(), img.GetWidth(), img.GetHeight());
+
+	img.SetPixelFormat(pf);
+	return true;
+}
+
+/// <summary>
+/// Create copy of image converted to pixel format
+/// (see Convert)
+/// </summary>
+/// <param name="img"></param>
+/// <param name="pf">target format</param>
+/// <returns>empty image if conversion is not supported</returns>
+template <typename T>
+Image2d<T> ColorSpace::CreateConverted(const Image2d<T> & img, PixelFormat pf)
+{
+	if (img.GetPixelFormat() == pf)
+	{
+		return img;
+	}
+
+	if (IsConversionSupported(img.GetPixelFormat(), pf) == false)
+	{
+		MY_LOG_ERROR("Conversion between pixel formats %d and %d is not supported",
+			int(img.GetPixelFormat()), int(pf));
+		return Image2d<T>();
+	}
+
+	Image2d<T> res(img.GetWidth(), img.GetHeight(), pf, img.GetLayout(),
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	ConvertRows<T>(img.GetData().data(), img.GetPixelFormat(), img.GetPixelStride(), img.GetChannelStride(),
+		res.GetData().data(), pf, res.GetPixelStride(), res.GetChannelStride(), img.GetWidth(), img.GetHeight());
+
+	return res;
+}
+
+/// <summary>
+/// Convert all rows, rows are processed in parallel
+/// Each row is decoded to RGB planes and encoded to target format,
+/// so src and dst can be the same memory
+/// </summary>
+template <typename T>
+void ColorSpace::ConvertRows(const T * src, PixelFormat srcPf, size_t srcPixelStride, size_t srcChannelStride,
+	T * dst, PixelFormat dstPf, size_t dstPixelStride, size_t dstChannelStride, int w, int h)
+{
+	const size_t count = size_t(w);
+	const bool linear = IsLinearRgbFormat(dstPf);
+
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / std::max<size_t>(1, count * 4));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(h), grainRows, [&](size_t y0, size_t y1) {
+		std::vector<float> buffer(4 * count);
+		std::vector<T> scratch(4 * count);
+		RowPlanes rgb = { buffer.data(), buffer.data() + count, buffer.data() + 2 * count, buffer.data() + 3 * count };
+
+		for (size_t y = y0; y < y1; y++)
+		{
+			DecodeRow(src + y * count * srcPixelStride, srcPixelStride, srcChannelStride, count,
+				srcPf, linear, rgb, scratch.data());
+			EncodeRow(rgb, count, dstPf, dst + y * count * dstPixelStride, dstPixelStride, dstChannelStride,
+				scratch.data());
+		}
+	});
+}
+
+//=================================================================================================
+// Row decoding / encoding
+//=================================================================================================
+
+/// <summary>
+/// Decode row of pixels to RGB planes
+/// RGB is gamma encoded sRGB or linear RGB, both in [0, 1] (alpha is 1 if format has none)
+/// Interleaved pixels are split with SIMD ImageKernels::Deinterleave first,
+/// so all per-channel loops run over contiguous planes
+/// </summary>
+/// <param name="src">first pixel of row</param>
+/// <param name="pixelStride"></param>
+/// <param name="channelStride"></param>
+/// <param name="count">number of pixels</param>
+/// <param name="pf">source format</param>
+/// <param name="linear">output linear RGB</param>
+/// <param name="rgb">output planes</param>
+/// <param name="scratch">buffer for 4 * count values</param>
+template <typename T>
+void ColorSpace::DecodeRow(const T * src, size_t pixelStride, size_t channelStride, size_t count,
+	PixelFormat pf, bool linear, const RowPlanes & rgb, T * scratch)
+{
+	const bool isU8 = std::is_same<T, uint8_t>::value;
+	const CurveTables & curves = GetCurveTables();
+	const size_t c = GetChannelsCount(pf);
+
+	//source channel planes
+	const T * channels[4] = { nullptr, nullptr, nullptr, nullptr };
+	float * planes[4] = { rgb.r, rgb.g, rgb.b, rgb.a };
+
+	if (pixelStride > 1)
+	{
+		T * out = (isU8) ? scratch : reinterpret_cast<T *>(rgb.r);
+		ImageKernels::Deinterleave(src, count, c, out);
+		for (size_t k = 0; k < c; k++)
+		{
+			channels[k] = out + k * count;
+		}
+	}
+	else
+	{
+		for (size_t k = 0; k < c; k++)
+		{
+			channels[k] = src + k * channelStride;
+		}
+	}
+
+	//plane = stored * scale + offset
+	auto loadChannel = [&](size_t k, float scale, float offset) {
+		float * out = planes[k];
+		if constexpr (std::is_same<T, uint8_t>::value)
+		{
+			ImageKernels::Convert(channels[k], out, count);
+		}
+		else if (channels[k] != out)
+		{
+			std::copy(channels[k], channels[k] + count, out);
+		}
+
+		if ((scale != 1.0f) || (offset != 0.0f))
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				out[i] = out[i] * scale + offset;
+			}
+		}
+	};
+
+	//gamma encoded channel, uint8_t values are linearized directly by table
+	auto loadGammaChannel = [&](size_t k) {
+		if (isU8 && linear)
+		{
+			const T * in = channels[k];
+			float * out = planes[k];
+			for (size_t i = 0; i < count; i++)
+			{
+				out[i] = curves.u8ToLinear[size_t(in[i])];
+			}
+			return;
+		}
+
+		loadChannel(k, (isU8) ? 1.0f / 255.0f : 1.0f, 0.0f);
+		if (linear)
+		{
+			ApplyLut(curves.toLinear, planes[k], count);
+		}
+	};
+
+	const float unitScale = (isU8) ? 1.0f / 255.0f : 1.0f;
+
+	switch (pf)
+	{
+	case PixelFormat::GRAY:
+		loadGammaChannel(0);
+		std::copy(rgb.r, rgb.r + count, rgb.g);
+		std::copy(rgb.r, rgb.r + count, rgb.b);
+		break;
+
+	case PixelFormat::RGB:
+	case PixelFormat::RGBA:
+		loadGammaChannel(0);
+		loadGammaChannel(1);
+		loadGammaChannel(2);
+		break;
+
+	case PixelFormat::HSV:
+		loadChannel(0, (isU8) ? 2.0f : 1.0f, 0.0f);
+		loadChannel(1, unitScale, 0.0f);
+		loadChannel(2, unitScale, 0.0f);
+		HsvToRgb(rgb.r, rgb.g, rgb.b, count);
+		if (linear)
+		{
+			ApplyLut(curves.toLinear, rgb.r, count);
+			ApplyLut(curves.toLinear, rgb.g, count);
+			ApplyLut(curves.toLinear, rgb.b, count);
+		}
+		break;
+
+	case PixelFormat::CIE_LUV:
+	case PixelFormat::XYZ:
+		if (pf == PixelFormat::XYZ)
+		{
+			loadChannel(0, unitScale, 0.0f);
+			loadChannel(1, unitScale, 0.0f);
+			loadChannel(2, unitScale, 0.0f);
+		}
+		else
+		{
+			loadChannel(0, (isU8) ? 100.0f / 255.0f : 1.0f, 0.0f);
+			loadChannel(1, (isU8) ? 354.0f / 255.0f : 1.0f, (isU8) ? -134.0f : 0.0f);
+			loadChannel(2, (isU8) ? 262.0f / 255.0f : 1.0f, (isU8) ? -140.0f : 0.0f);
+			LuvToXyz(rgb.r, rgb.g, rgb.b, count);
+		}
+
+		MultiplyMatrix(XYZ_TO_RGB, rgb.r, rgb.g, rgb.b, rgb.r, rgb.g, rgb.b, count);
+		if (linear == false)
+		{
+			ApplyLut(curves.toGamma, rgb.r, count);
+			ApplyLut(curves.toGamma, rgb.g, count);
+			ApplyLut(curves.toGamma, rgb.b, count);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (pf == PixelFormat::RGBA)
+	{
+		loadChannel(3, unitScale, 0.0f);
+	}
+	else
+	{
+		std::fill(rgb.a, rgb.a + count, 1.0f);
+	}
+}
+
+/// <summary>
+/// Encode RGB planes to row of pixels
+/// RGB must be linear for XYZ and CIE_LUV, gamma encoded otherwise
+/// Planes are modified. Values are computed in planes, converted with SIMD
+/// ImageKernels::ConvertSaturated (uint8_t) and joined with ImageKernels::Interleave.
+/// </summary>
+/// <param name="rgb">input planes</param>
+/// <param name="count">number of pixels</param>
+/// <param name="pf">target format</param>
+/// <param name="dst">first pixel of row</param>
+/// <param name="pixelStride"></param>
+/// <param name="channelStride"></param>
+/// <param name="scratch">buffer for 4 * count values</param>
+template <typename T>
+void ColorSpace::EncodeRow(const RowPlanes & rgb, size_t count, PixelFormat pf,
+	T * dst, size_t pixelStride, size_t channelStride, T * scratch)
+{
+	const bool isU8 = std::is_same<T, uint8_t>::value;
+	const size_t c = GetChannelsCount(pf);
+	float * planes[4] = { rgb.r, rgb.g, rgb.b, rgb.a };
+
+	//plane = value * scale + offset
+	auto scaleChannel = [&](size_t k, float scale, float offset) {
+		if ((scale == 1.0f) && (offset == 0.0f))
+		{
+			return;
+		}
+
+		float * p = planes[k];
+		for (size_t i = 0; i < count; i++)
+		{
+			p[i] = p[i] * scale + offset;
+		}
+	};
+
+	const float unitScale = (isU8) ? 255.0f : 1.0f;
+
+	switch (pf)
+	{
+	case PixelFormat::GRAY:
+		for (size_t i = 0; i < count; i++)
+		{
+			rgb.r[i] = 0.299f * rgb.r[i] + 0.587f * rgb.g[i] + 0.114f * rgb.b[i];
+		}
+		scaleChannel(0, unitScale, 0.0f);
+		break;
+
+	case PixelFormat::RGBA:
+		scaleChannel(3, unitScale, 0.0f);
+		[[fallthrough]];
+	case PixelFormat::RGB:
+		scaleChannel(0, unitScale, 0.0f);
+		scaleChannel(1, unitScale, 0.0f);
+		scaleChannel(2, unitScale, 0.0f);
+		break;
+
+	case PixelFormat::HSV:
+		RgbToHsv(rgb.r, rgb.g, rgb.b, count);
+		if (isU8)
+		{
+			//H / 2 is rounded, 180 is the same as 0
+			for (size_t i = 0; i < count; i++)
+			{
+				const float h = rgb.r[i] * 0.5f;
+				rgb.r[i] = (h >= 179.5f) ? h - 180.0f : h;
+			}
+		}
+		scaleChannel(1, unitScale, 0.0f);
+		scaleChannel(2, unitScale, 0.0f);
+		break;
+
+	case PixelFormat::XYZ:
+		MultiplyMatrix(RGB_TO_XYZ, rgb.r, rgb.g, rgb.b, rgb.r, rgb.g, rgb.b, count);
+		scaleChannel(0, unitScale, 0.0f);
+		scaleChannel(1, unitScale, 0.0f);
+		scaleChannel(2, unitScale, 0.0f);
+		break;
+
+	case PixelFormat::CIE_LUV:
+		MultiplyMatrix(RGB_TO_XYZ, rgb.r, rgb.g, rgb.b, rgb.r, rgb.g, rgb.b, count);
+		XyzToLuv(rgb.r, rgb.g, rgb.b, count);
+		scaleChannel(0, (isU8) ? 255.0f / 100.0f : 1.0f, 0.0f);
+		scaleChannel(1, (isU8) ? 255.0f / 354.0f : 1.0f, (isU8) ? 134.0f * 255.0f / 354.0f : 0.0f);
+		scaleChannel(2, (isU8) ? 255.0f / 262.0f : 1.0f, (isU8) ? 140.0f * 255.0f / 262.0f : 0.0f);
+		break;
+
+	default:
+		break;
+	}
+
+	//planes are consecutive, channel k starts at rgb.r + k * count
+	if constexpr (std::is_same<T, uint8_t>::value)
+	{
+		if (pixelStride > 1)
+		{
+			ImageKernels::ConvertSaturated(rgb.r, scratch, c * count);
+			ImageKernels::Interleave(scratch, count, c, dst);
+		}
+		else
+		{
+			for (size_t k = 0; k < c; k++)
+			{
+				ImageKernels::ConvertSaturated(planes[k], dst + k * channelStride, count);
+			}
+		}
+	}
+	else
+	{
+		if (pixelStride > 1)
+		{
+			ImageKernels::Interleave(rgb.r, count, c, dst);
+		}
+		else
+		{
+			for (size_t k = 0; k < c; k++)
+			{
+				std::copy(planes[k], planes[k] + count, dst + k * channelStride);
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Color math on planes
+//=================================================================================================
+
+/// <summary>
+/// Multiply each [x, y, z] with 3x3 row-major matrix m, result is stored to [u, v, w]
+/// Outputs can be the same as inputs
+/// </summary>
+void ColorSpace::MultiplyMatrix(const float * m, const float * x, const float * y, const float * z,
+	float * u, float * v, float * w, size_t count) noexcept
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const float a = x[i];
+		const float b = y[i];
+		const float c = z[i];
+		u[i] = m[0] * a + m[1] * b + m[2] * c;
+		v[i] = m[3] * a + m[4] * b + m[5] * c;
+		w[i] = m[6] * a + m[7] * b + m[8] * c;
+	}
+}
+
+/// <summary>
+/// In-place XYZ -> CIE_LUV (D65 white)
+/// </summary>
+void ColorSpace::XyzToLuv(float * x, float * y, float * z, size_t count) noexcept
+{
+	const float * lightness = GetCurveTables().lightness.data();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float X = x[i];
+		const float Y = std::max(0.0f, y[i]);
+		const float Z = z[i];
+
+		//Y > 1 is outside of the table (out of gamut input)
+		const float L = (Y <= 1.0f) ? InterpolateLut(lightness, Y) : 116.0f * std::cbrt(Y) - 16.0f;
+		const float d = X + 15.0f * Y + 3.0f * Z;
+		const float invD = (d > 1e-10f) ? 1.0f / d : 0.0f;
+		const float up = 4.0f * X * invD;
+		const float vp = 9.0f * Y * invD;
+
+		x[i] = L;
+		y[i] = 13.0f * L * (up - WHITE_U);
+		z[i] = 13.0f * L * (vp - WHITE_V);
+	}
+}
+
+/// <summary>
+/// In-place CIE_LUV -> XYZ (D65 white)
+/// </summary>
+void ColorSpace::LuvToXyz(float * l, float * u, float * v, size_t count) noexcept
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const float L = l[i];
+		if (L <= 1e-6f)
+		{
+			l[i] = 0.0f;
+			u[i] = 0.0f;
+			v[i] = 0.0f;
+			continue;
+		}
+
+		const float t = (L + 16.0f) / 116.0f;
+		const float Y = (L > 8.0f) ? t * t * t : L / 903.2963f;
+		const float up = u[i] / (13.0f * L) + WHITE_U;
+		const float vp = std::max(1e-6f, v[i] / (13.0f * L) + WHITE_V);
+
+		l[i] = Y * 9.0f * up / (4.0f * vp);
+		u[i] = Y;
+		v[i] = Y * (12.0f - 3.0f * up - 20.0f * vp) / (4.0f * vp);
+	}
+}
+
+/// <summary>
+/// In-place RGB -> HSV, H in [0, 360)
+/// </summary>
+void ColorSpace::RgbToHsv(float * r, float * g, float * b, size_t count) noexcept
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const float R = r[i];
+		const float G = g[i];
+		const float B = b[i];
+
+		const float maxV = std::max(R, std::max(G, B));
+		const float minV = std::min(R, std::min(G, B));
+		const float d = maxV - minV;
+		const float invD = (d > 0.0f) ? 60.0f / d : 0.0f;
+
+		float h = (maxV == R) ? (G - B) * invD :
+			(maxV == G) ? 120.0f + (B - R) * invD :
+			240.0f + (R - G) * invD;
+		h = (h < 0.0f) ? h + 360.0f : h;
+
+		r[i] = h;
+		g[i] = (maxV > 0.0f) ? d / maxV : 0.0f;
+		b[i] = maxV;
+	}
+}
+
+/// <summary>
+/// In-place HSV -> RGB, H in [0, 360)
+/// </summary>
+void ColorSpace::HsvToRgb(float * h, float * s, float * v, size_t count) noexcept
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		float hh = h[i] / 60.0f;
+		hh -= 6.0f * std::floor(hh / 6.0f);
+		const float S = s[i];
+		const float V = v[i];
+
+		const int sector = std::min(5, int(hh));
+		const float f = hh - float(sector);
+		const float p = V * (1.0f - S);
+		const float q = V * (1.0f - S * f);
+		const float t = V * (1.0f - S * (1.0f - f));
+
+		float R, G, B;
+		switch (sector)
+		{
+		case 0: R = V; G = t; B = p; break;
+		case 1: R = q; G = V; B = p; break;
+		case 2: R = p; G = V; B = t; break;
+		case 3: R = p; G = q; B = V; break;
+		case 4: R = t; G = p; B = V; break;
+		default: R = V; G = p; B = q; break;
+		}
+
+		h[i] = R;
+		s[i] = G;
+		v[i] = B;
+	}
+}
+
+//=================================================================================================
+// Curve tables
+//=================================================================================================
+
+/// <summary>
+/// Get curve tables, tables are created on the first call
+/// </summary>
+/// <returns></returns>
+const ColorSpace::CurveTables & ColorSpace::GetCurveTables()
+{
+	static const CurveTables tables = []() {
+		auto toLinear = [](double x) {
+			return (x <= 0.04045) ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+		};
+		auto toGamma = [](double x) {
+			return (x <= 0.0031308) ? 12.92 * x : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055;
+		};
+		auto lightness = [](double y) {
+			return (y > 0.008856452) ? 116.0 * std::cbrt(y) - 16.0 : 903.2963 * y;
+		};
+
+		CurveTables t;
+		for (size_t i = 0; i < t.u8ToLinear.size(); i++)
+		{
+			t.u8ToLinear[i] = float(toLinear(double(i) / 255.0));
+		}
+
+		t.toLinear.resize(CURVE_LUT_SIZE + 1);
+		t.toGamma.resize(CURVE_LUT_SIZE + 1);
+		t.lightness.resize(CURVE_LUT_SIZE + 1);
+		for (size_t i = 0; i <= CURVE_LUT_SIZE; i++)
+		{
+			const double x = double(i) / double(CURVE_LUT_SIZE);
+			t.toLinear[i] = float(toLinear(x));
+			t.toGamma[i] = float(toGamma(x));
+			t.lightness[i] = float(lightness(x));
+		}
+		return t;
+	}();
+
+	return tables;
+}
+
+/// <summary>
+/// Map values with linearly interpolated table of CURVE_LUT_SIZE + 1 samples of [0, 1]
+/// Values are clamped to [0, 1]
+/// </summary>
+/// <param name="lut"></param>
+/// <param name="values"></param>
+/// <param name="count"></param>
+void ColorSpace::ApplyLut(const std::vector<float> & lut, float * values, size_t count) noexcept
+{
+	const float * table = lut.data();
+	for (size_t i = 0; i < count; i++)
+	{
+		values[i] = InterpolateLut(table, values[i]);
+	}
+}
+
+/// <summary>
+/// Get value from linearly interpolated table of CURVE_LUT_SIZE + 1 samples of [0, 1]
+/// Value is clamped to [0, 1]
+/// </summary>
+/// <param name="table"></param>
+/// <param name="value"></param>
+/// <returns></returns>
+float ColorSpace::InterpolateLut(const float * table, float value) noexcept
+{
+	const float pos = std::min(1.0f, std::max(0.0f, value)) * float(CURVE_LUT_SIZE);
+	const size_t index = std::min(size_t(pos), CURVE_LUT_SIZE - 1);
+	const float f = pos - float(index);
+	return table[index] + f * (table[index + 1] - table[index]);
+}
+
+//=================================================================================================
+
+template bool ColorSpace::Convert(Image2d<uint8_t> & img, PixelFormat pf);
+template bool ColorSpace::Convert(Image2d<float> & img, PixelFormat pf);
+
+template Image2d<uint8_t> ColorSpace::CreateConverted(const Image2d<uint8_t> & img, PixelFormat pf);
+template Image2d<float> ColorSpace::CreateConverted(const Image2d<float> & img, PixelFormat pf);
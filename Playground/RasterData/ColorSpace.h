@@ -1,12 +1,34 @@
 #ifndef COLOR_SPACE_H
 #define COLOR_SPACE_H
 
+template <typename T>
+class Image2d;
+
 #include <cstdint>
 #include <cmath>
 #include <string>
 #include <array>
+#include <vector>
+#include <type_traits>
 
-class ColorSpace 
+/// <summary>
+/// Pixel formats and conversions between them
+///
+/// Supported formats for conversion: GRAY, RGB, RGBA, XYZ, CIE_LUV, HSV
+/// RGB is sRGB (D65), XYZ and CIE_LUV are computed from linear RGB,
+/// sRGB gamma curves are evaluated with lookup tables.
+/// GRAY is Rec. 601 luma of gamma encoded RGB.
+///
+/// Value ranges:
+/// float: RGB, GRAY [0, 1], XYZ [0, 1], HSV H [0, 360), S, V [0, 1],
+///        CIE_LUV L [0, 100], u [-134, 220], v [-140, 122]
+/// uint8_t: RGB, GRAY, XYZ [0, 255], HSV H / 2 [0, 180), S, V [0, 255],
+///        CIE_LUV L * 255 / 100, (u + 134) * 255 / 354, (v + 140) * 255 / 262
+///
+/// Conversion runs in float on rows in parallel (shared ThreadPool).
+/// Each row is split to channel planes, so per-pixel math vectorizes.
+/// </summary>
+class ColorSpace
 {
 public:
 
@@ -21,10 +43,10 @@ public:
 		HSV,
 		RG //special format - only 2 chanels (cannot be saved) - for compatibility with OpenGL GL_RG
 	};
-	
+
 
 	static size_t GetChannelsCount(PixelFormat pf);
-	
+
 	template <typename T>
 	static constexpr PixelFormat GetFormatFromChannelsCount(size_t c)
 	{
@@ -39,20 +61,80 @@ public:
 			default: return PixelFormat::NONE;
 			}
 		}
-		else 
+		else
 		{
 			switch (c)
 			{
-			case 1: return PixelFormat::GRAY;			
-			case 3: return PixelFormat::XYZ;			
+			case 1: return PixelFormat::GRAY;
+			case 3: return PixelFormat::XYZ;
 			default: return PixelFormat::NONE;
 			}
 		}
 	}
 
+	static bool IsConversionSupported(PixelFormat from, PixelFormat to) noexcept;
+
+	template <typename T>
+	static bool Convert(Image2d<T> & img, PixelFormat pf);
+
+	template <typename T>
+	static Image2d<T> CreateConverted(const Image2d<T> & img, PixelFormat pf);
+
+private:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+	static const size_t CURVE_LUT_SIZE = 4096;
+
+	/// <summary>
+	/// Tables of nonlinear curves
+	/// u8ToLinear - sRGB gamma, exact values for uint8_t input
+	/// toLinear, toGamma - sRGB gamma, CURVE_LUT_SIZE + 1 samples of [0, 1], linearly interpolated
+	/// lightness - CIE L of Y, CURVE_LUT_SIZE + 1 samples of [0, 1], linearly interpolated
+	/// </summary>
+	struct CurveTables
+	{
+		std::array<float, 256> u8ToLinear;
+		std::vector<float> toLinear;
+		std::vector<float> toGamma;
+		std::vector<float> lightness;
+	};
+
+	/// <summary>
+	/// Single row split to channel planes
+	/// Planes are consecutive in one buffer (g = r + count, ...)
+	/// </summary>
+	struct RowPlanes
+	{
+		float * r;
+		float * g;
+		float * b;
+		float * a;
+	};
+
+	static const CurveTables & GetCurveTables();
+	static void ApplyLut(const std::vector<float> & lut, float * values, size_t count) noexcept;
+	static float InterpolateLut(const float * table, float value) noexcept;
+
+	static bool IsLinearRgbFormat(PixelFormat pf) noexcept;
+
+	template <typename T>
+	static void DecodeRow(const T * src, size_t pixelStride, size_t channelStride, size_t count,
+		PixelFormat pf, bool linear, const RowPlanes & rgb, T * scratch);
+
+	template <typename T>
+	static void EncodeRow(const RowPlanes & rgb, size_t count, PixelFormat pf,
+		T * dst, size_t pixelStride, size_t channelStride, T * scratch);
 
+	template <typename T>
+	static void ConvertRows(const T * src, PixelFormat srcPf, size_t srcPixelStride, size_t srcChannelStride,
+		T * dst, PixelFormat dstPf, size_t dstPixelStride, size_t dstChannelStride, int w, int h);
+
+	static void MultiplyMatrix(const float * m, const float * x, const float * y, const float * z,
+		float * u, float * v, float * w, size_t count) noexcept;
 
+	static void XyzToLuv(float * x, float * y, float * z, size_t count) noexcept;
+	static void LuvToXyz(float * l, float * u, float * v, size_t count) noexcept;
+	static void RgbToHsv(float * r, float * g, float * b, size_t count) noexcept;
+	static void HsvToRgb(float * h, float * s, float * v, size_t count) noexcept;
 };
 
 #endif
-
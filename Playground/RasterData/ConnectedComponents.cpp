@@ -0,0 +1,454 @@
+#include "./ConnectedComponents.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+ConnectedComponents::ConnectedComponents() :
+	dim({ 0, 0 })
+{
+}
+
+/// <summary>
+/// Label connected components of mask
+/// </summary>
+/// <param name="mask">foreground pixels have non-zero first channel</param>
+/// <param name="connectivity"></param>
+ConnectedComponents::ConnectedComponents(const Image2d<uint8_t> & mask,
+	ImageUtils::Connectivity connectivity) :
+	dim(mask.GetDimension())
+{
+	this->Build(mask.CreateView(), connectivity);
+}
+
+/// <summary>
+/// Label mask in parallel stripes, merge labels across stripe borders
+/// and compute final labels and components
+/// </summary>
+/// <param name="mask"></param>
+/// <param name="connectivity"></param>
+void ConnectedComponents::Build(const Image2dView<const uint8_t> & mask, ImageUtils::Connectivity connectivity)
+{
+	const size_t w = size_t(this->dim.w);
+	const size_t h = size_t(this->dim.h);
+
+	if ((w == 0) || (h == 0))
+	{
+		return;
+	}
+
+	auto pool = MyUtils::ThreadPool::GetInstance();
+
+	//stripes are independent tasks, each of them should be large enough
+	const size_t minStripeRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / w);
+	const size_t stripesCount = std::max<size_t>(1, std::min(pool->GetThreadsCount(), h / minStripeRows));
+
+	std::vector<Stripe> stripes(stripesCount);
+
+	//label 0 is background
+	uint64_t labelsCount = 1;
+	for (size_t s = 0; s < stripesCount; s++)
+	{
+		Stripe & stripe = stripes[s];
+		stripe.yStart = int(h * s / stripesCount);
+		stripe.yEnd = int(h * (s + 1) / stripesCount);
+		stripe.labelsStart = uint32_t(labelsCount - 1);
+
+		labelsCount += GetMaxLabelsCount(w, size_t(stripe.yEnd - stripe.yStart), connectivity);
+		if (labelsCount > std::numeric_limits<uint32_t>::max())
+		{
+			MY_LOG_ERROR("Image %zu x %zu is too large for 32-bit labels", w, h);
+			this->dim = { 0, 0 };
+			return;
+		}
+	}
+
+	this->labels.resize(w * h);
+
+	//equivalence table, parent[label] <= label, root has parent[label] == label
+	ImageBuffer<uint32_t> parent;
+	parent.resize(size_t(labelsCount));
+	parent[0] = 0;
+
+	pool->ParallelFor(0, stripesCount, 1, [&](size_t s0, size_t s1) {
+		for (size_t s = s0; s < s1; s++)
+		{
+			this->LabelStripe(mask, connectivity, stripes[s], parent.data());
+		}
+	});
+
+	for (size_t s = 1; s < stripesCount; s++)
+	{
+		this->MergeStripes(connectivity, stripes[s], parent.data());
+	}
+
+	this->FlattenLabels(stripes, parent.data());
+
+	//replace provisional labels with final ones
+	const uint32_t * finalLabels = parent.data();
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / w);
+
+	pool->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+		uint32_t * l = this->labels.data() + y0 * w;
+		uint32_t * lEnd = this->labels.data() + y1 * w;
+		for (; l < lEnd; l++)
+		{
+			*l = finalLabels[*l];
+		}
+	});
+}
+
+//=================================================================================================
+// Labelling
+//=================================================================================================
+
+/// <summary>
+/// First pass over rows of stripe
+/// Each foreground pixel gets label from already labelled neighbors
+/// (W, NW, N, NE for 8-connectivity, W, N for 4-connectivity),
+/// if they have different labels, labels are merged.
+/// Pixel without labelled neighbors starts new provisional label.
+/// Rows above stripe are not visited, so stripe writes only
+/// its own labels and its own part of equivalence table.
+/// </summary>
+/// <param name="mask"></param>
+/// <param name="connectivity"></param>
+/// <param name="stripe"></param>
+/// <param name="parent"></param>
+void ConnectedComponents::LabelStripe(const Image2dView<const uint8_t> & mask, ImageUtils::Connectivity connectivity,
+	Stripe & stripe, uint32_t * parent)
+{
+	const int w = this->dim.w;
+	const size_t pixelStride = mask.GetPixelStride();
+	const bool eight = (connectivity == ImageUtils::Connectivity::EIGHT);
+
+	uint32_t lastLabel = stripe.labelsStart;
+
+	for (int y = stripe.yStart; y < stripe.yEnd; y++)
+	{
+		const uint8_t * m = mask.GetRowStart(y);
+		uint32_t * l = this->labels.data() + size_t(y) * size_t(w);
+		const uint32_t * lp = (y > stripe.yStart) ? l - w : nullptr;
+
+		int x = 0;
+		while (x < w)
+		{
+			if (m[size_t(x) * pixelStride] == 0)
+			{
+				l[x] = 0;
+				x++;
+				continue;
+			}
+
+			//run of foreground pixels [runStart, x), all of them are in the same component
+			const int runStart = x;
+
+			for (; (x < w) && (m[size_t(x) * pixelStride] != 0); x++)
+			{
+				const uint32_t n = (lp != nullptr) ? lp[x] : 0;
+				const uint32_t west = (x > runStart) ? l[x - 1] : 0;
+				uint32_t label = 0;
+
+				if (eight)
+				{
+					//N is neighbor of NW, NE and W, they are already merged with it
+					const uint32_t ne = ((lp != nullptr) && (x + 1 < w)) ? lp[x + 1] : 0;
+					const uint32_t nw = ((lp != nullptr) && (x > 0)) ? lp[x - 1] : 0;
+
+					if (n != 0)
+					{
+						label = n;
+					}
+					else if (ne != 0)
+					{
+						label = ne;
+						if (nw != 0)
+						{
+							Union(parent, ne, nw);
+						}
+						else if (west != 0)
+						{
+							Union(parent, ne, west);
+						}
+					}
+					else if (nw != 0)
+					{
+						label = nw;
+					}
+					else
+					{
+						label = west;
+					}
+				}
+				else
+				{
+					label = (n != 0) ? n : west;
+					if ((n != 0) && (west != 0) && (n != west))
+					{
+						Union(parent, n, west);
+					}
+				}
+
+				if (label == 0)
+				{
+					lastLabel++;
+					parent[lastLabel] = lastLabel;
+					stripe.stats.push_back({ x, y, x, y, 0, 0, 0 });
+					label = lastLabel;
+				}
+
+				l[x] = label;
+			}
+
+			//statistics of the run are added to label of its first pixel
+			Stats & st = stripe.stats[l[runStart] - stripe.labelsStart - 1];
+			const uint64_t len = uint64_t(x - runStart);
+
+			st.xMin = std::min(st.xMin, runStart);
+			st.xMax = std::max(st.xMax, x - 1);
+			st.yMin = std::min(st.yMin, y);
+			st.yMax = std::max(st.yMax, y);
+			st.area += len;
+			st.sumX += (uint64_t(runStart) + uint64_t(x - 1)) * len / 2;
+			st.sumY += uint64_t(y) * len;
+		}
+	}
+}
+
+/// <summary>
+/// Merge labels of first row of lower stripe with labels
+/// of last row of stripe above it
+/// </summary>
+/// <param name="connectivity"></param>
+/// <param name="lower"></param>
+/// <param name="parent"></param>
+void ConnectedComponents::MergeStripes(ImageUtils::Connectivity connectivity, const Stripe & lower, uint32_t * parent) const
+{
+	const int w = this->dim.w;
+	const bool eight = (connectivity == ImageUtils::Connectivity::EIGHT);
+
+	const uint32_t * l = this->labels.data() + size_t(lower.yStart) * size_t(w);
+	const uint32_t * lp = l - w;
+
+	for (int x = 0; x < w; x++)
+	{
+		if (l[x] == 0)
+		{
+			continue;
+		}
+
+		if (lp[x] != 0)
+		{
+			//NW and NE are neighbors of N, they are already merged with it
+			Union(parent, l[x], lp[x]);
+		}
+		else if (eight)
+		{
+			if ((x > 0) && (lp[x - 1] != 0))
+			{
+				Union(parent, l[x], lp[x - 1]);
+			}
+			if ((x + 1 < w) && (lp[x + 1] != 0))
+			{
+				Union(parent, l[x], lp[x + 1]);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Replace equivalence table with final labels 1..N and create components
+/// Provisional labels are visited in increasing order, parent of each label
+/// is smaller and already has its final label.
+/// </summary>
+/// <param name="stripes"></param>
+/// <param name="parent"></param>
+void ConnectedComponents::FlattenLabels(const std::vector<Stripe> & stripes, uint32_t * parent)
+{
+	std::vector<Stats> merged;
+
+	for (const Stripe & stripe : stripes)
+	{
+		for (size_t i = 0; i < stripe.stats.size(); i++)
+		{
+			const uint32_t label = stripe.labelsStart + uint32_t(i) + 1;
+			const Stats & st = stripe.stats[i];
+
+			if (parent[label] == label)
+			{
+				merged.push_back(st);
+				parent[label] = uint32_t(merged.size());
+				continue;
+			}
+
+			parent[label] = parent[parent[label]];
+
+			Stats & m = merged[parent[label] - 1];
+			m.xMin = std::min(m.xMin, st.xMin);
+			m.yMin = std::min(m.yMin, st.yMin);
+			m.xMax = std::max(m.xMax, st.xMax);
+			m.yMax = std::max(m.yMax, st.yMax);
+			m.area += st.area;
+			m.sumX += st.sumX;
+			m.sumY += st.sumY;
+		}
+	}
+
+	this->components.clear();
+	this->components.reserve(merged.size());
+
+	for (const Stats & m : merged)
+	{
+		this->components.push_back({
+			m.xMin, m.yMin, m.xMax, m.yMax,
+			size_t(m.area),
+			double(m.sumX) / double(m.area),
+			double(m.sumY) / double(m.area)
+		});
+	}
+}
+
+//=================================================================================================
+// Union-find
+//=================================================================================================
+
+/// <summary>
+/// Upper bound of new labels in w x h stripe
+/// New label starts only at pixel without foreground neighbors visited before it
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="connectivity"></param>
+/// <returns></returns>
+uint64_t ConnectedComponents::GetMaxLabelsCount(size_t w, size_t h, ImageUtils::Connectivity connectivity) noexcept
+{
+	if (connectivity == ImageUtils::Connectivity::EIGHT)
+	{
+		//isolated pixels in every other row and column
+		return uint64_t((w + 1) / 2) * uint64_t((h + 1) / 2);
+	}
+
+	//checkerboard
+	return (uint64_t(w) * uint64_t(h) + 1) / 2;
+}
+
+/// <summary>
+/// Find root of label with path halving
+/// </summary>
+/// <param name="parent"></param>
+/// <param name="label"></param>
+/// <returns></returns>
+uint32_t ConnectedComponents::FindRoot(uint32_t * parent, uint32_t label) noexcept
+{
+	while (parent[label] != label)
+	{
+		parent[label] = parent[parent[label]];
+		label = parent[label];
+	}
+	return label;
+}
+
+/// <summary>
+/// Merge sets of labels a and b
+/// Smaller root becomes root of both sets, so parent[label] <= label holds
+/// </summary>
+/// <param name="parent"></param>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns>root of merged set</returns>
+uint32_t ConnectedComponents::Union(uint32_t * parent, uint32_t a, uint32_t b) noexcept
+{
+	const uint32_t ra = FindRoot(parent, a);
+	const uint32_t rb = FindRoot(parent, b);
+
+	if (ra < rb)
+	{
+		parent[rb] = ra;
+		return ra;
+	}
+
+	parent[ra] = rb;
+	return rb;
+}
+
+//=================================================================================================
+// Getters
+//=================================================================================================
+
+int ConnectedComponents::GetWidth() const noexcept
+{
+	return this->dim.w;
+}
+
+int ConnectedComponents::GetHeight() const noexcept
+{
+	return this->dim.h;
+}
+
+size_t ConnectedComponents::GetComponentsCount() const noexcept
+{
+	return this->components.size();
+}
+
+const std::vector<ConnectedComponents::Component> & ConnectedComponents::GetComponents() const noexcept
+{
+	return this->components;
+}
+
+/// <summary>
+/// Get component with given label
+/// </summary>
+/// <param name="label">label in range [1, GetComponentsCount()]</param>
+/// <returns></returns>
+const ConnectedComponents::Component & ConnectedComponents::GetComponent(uint32_t label) const
+{
+	return this->components.at(label - 1);
+}
+
+/// <summary>
+/// Get label of pixel, 0 for background
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <returns></returns>
+uint32_t ConnectedComponents::GetLabel(int x, int y) const noexcept
+{
+	return this->labels[size_t(y) * size_t(this->dim.w) + size_t(x)];
+}
+
+/// <summary>
+/// Get labels of all pixels, row-major w x h
+/// </summary>
+/// <returns></returns>
+const ImageBuffer<uint32_t> & ConnectedComponents::GetLabels() const noexcept
+{
+	return this->labels;
+}
+
+/// <summary>
+/// Create gray mask with 255 at pixels of component with given label
+/// and 0 elsewhere
+/// </summary>
+/// <param name="label"></param>
+/// <returns></returns>
+Image2d<uint8_t> ConnectedComponents::CreateMask(uint32_t label) const
+{
+	Image2d<uint8_t> mask(this->dim.w, this->dim.h, ColorSpace::PixelFormat::GRAY,
+		ImageUtils::DataLayout::INTERLEAVED, ImageUtils::InitMode::UNINITIALIZED);
+
+	uint8_t * m = mask.GetData().data();
+	const size_t len = this->labels.size();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		m[i] = (this->labels[i] == label) ? 255 : 0;
+	}
+
+	return mask;
+}
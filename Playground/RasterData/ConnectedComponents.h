@@ -0,0 +1,108 @@
+#ifndef CONNECTED_COMPONENTS_H
+#define CONNECTED_COMPONENTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./Image2d.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Connected-component labelling of binary mask Image2d<uint8_t>
+/// Pixel is foreground if its first channel is not zero.
+///
+/// Output is label of each pixel (0 = background, components are 1..N
+/// numbered in order of their first pixel in row-major order) and
+/// bounding box, area and centroid of each component.
+///
+/// Two-pass union-find labelling run in parallel horizontal stripes:
+/// 1. each stripe is labelled independently with provisional labels
+///    from its own label range (decision tree over already visited neighbors),
+///    statistics are accumulated per provisional label
+/// 2. provisional labels touching across stripe borders are merged
+/// 3. equivalence table is flattened to consecutive labels, statistics are merged
+/// 4. provisional labels are replaced by final labels (stripes in parallel)
+///
+/// Memory is the label image and equivalence table bounded by
+/// the maximal number of provisional labels (at most half of pixels).
+/// Result does not depend on number of threads.
+/// </summary>
+class ConnectedComponents
+{
+public:
+	/// <summary>
+	/// Component properties
+	/// Bounding box is [xMin, xMax] x [yMin, yMax] (inclusive)
+	/// </summary>
+	struct Component
+	{
+		int xMin;
+		int yMin;
+		int xMax;
+		int yMax;
+		size_t area;
+		double centroidX;
+		double centroidY;
+	};
+
+	ConnectedComponents();
+	ConnectedComponents(const Image2d<uint8_t> & mask,
+		ImageUtils::Connectivity connectivity = ImageUtils::Connectivity::EIGHT);
+
+	int GetWidth() const noexcept;
+	int GetHeight() const noexcept;
+	size_t GetComponentsCount() const noexcept;
+	const std::vector<Component> & GetComponents() const noexcept;
+	const Component & GetComponent(uint32_t label) const;
+
+	uint32_t GetLabel(int x, int y) const noexcept;
+	const ImageBuffer<uint32_t> & GetLabels() const noexcept;
+
+	Image2d<uint8_t> CreateMask(uint32_t label) const;
+
+protected:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+
+	/// <summary>
+	/// Statistics of provisional label
+	/// </summary>
+	struct Stats
+	{
+		int xMin;
+		int yMin;
+		int xMax;
+		int yMax;
+		uint64_t area;
+		uint64_t sumX;
+		uint64_t sumY;
+	};
+
+	/// <summary>
+	/// Rows [yStart, yEnd) with provisional labels (labelsStart, labelsStart + stats.size()]
+	/// </summary>
+	struct Stripe
+	{
+		int yStart;
+		int yEnd;
+		uint32_t labelsStart;
+		std::vector<Stats> stats;
+	};
+
+	ImageDimension dim;
+	ImageBuffer<uint32_t> labels;
+	std::vector<Component> components;
+
+	void Build(const Image2dView<const uint8_t> & mask, ImageUtils::Connectivity connectivity);
+
+	void LabelStripe(const Image2dView<const uint8_t> & mask, ImageUtils::Connectivity connectivity,
+		Stripe & stripe, uint32_t * parent);
+	void MergeStripes(ImageUtils::Connectivity connectivity, const Stripe & lower, uint32_t * parent) const;
+	void FlattenLabels(const std::vector<Stripe> & stripes, uint32_t * parent);
+
+	static uint64_t GetMaxLabelsCount(size_t w, size_t h, ImageUtils::Connectivity connectivity) noexcept;
+	static uint32_t FindRoot(uint32_t * parent, uint32_t label) noexcept;
+	static uint32_t Union(uint32_t * parent, uint32_t a, uint32_t b) noexcept;
+};
+
+#endif
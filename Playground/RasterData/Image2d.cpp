@@ -10,6 +10,19 @@
 #include "../FileUtils/FileMacros.h"
 #include "../FileUtils/RawFile.h"
 
+#include "../Simd/ImageKernels.h"
+
+#include "./AlphaBlending.h"
+#include "./ImageConvolution.h"
+#include "./ImageHistogram.h"
+#include "./ImageMorphology.h"
+#include "./ImagePyramid.h"
+#include "./ImageResampler.h"
+#include "./ImageTransform.h"
+#include "./IntegralImage.h"
+#include "./LookupTable.h"
+#include "./NeighborhoodKernel.h"
+
 
 #ifdef HAVE_OPENCV
 #	include <opencv2/highgui.hpp>
@@ -79,13 +92,14 @@ Image2d<T> Image2d<T>::CreateWithSingleValue(int w, int h, const T * value, Colo
 		img.dim = { w, h };
 		img.channelsCount = chanCount;
 		img.pf = pf;
-		img.data = std::vector<T>(w * h * img.channelsCount, *value);
+		img.data.assign(size_t(w) * size_t(h), *value);
 
 		return img;
 	}
 	else
 	{
-		Image2d<T> img(w, h, pf);
+		Image2d<T> img(w, h, pf,
+			ImageUtils::DataLayout::INTERLEAVED, ImageUtils::InitMode::UNINITIALIZED);
 
 		for (size_t i = 0; i < img.GetPixelsCount(); i++)
 		{
@@ -111,7 +125,8 @@ template <typename T>
 Image2d<T>::Image2d() : 
 	dim({ 0, 0 }),
 	pf(ColorSpace::PixelFormat::NONE),
-	channelsCount(ColorSpace::GetChannelsCount(ColorSpace::PixelFormat::NONE))
+	channelsCount(ColorSpace::GetChannelsCount(ColorSpace::PixelFormat::NONE)),
+	layout(ImageUtils::DataLayout::INTERLEAVED)
 {
 }
 
@@ -126,7 +141,8 @@ template <typename T>
 Image2d<T>::Image2d(const char * fileName) :
 	dim({ 0, 0 }),
 	pf(ColorSpace::PixelFormat::NONE),
-	channelsCount(ColorSpace::GetChannelsCount(ColorSpace::PixelFormat::NONE))
+	channelsCount(ColorSpace::GetChannelsCount(ColorSpace::PixelFormat::NONE)),
+	layout(ImageUtils::DataLayout::INTERLEAVED)
 {
 	RawFile f = RawFile(fileName, "rb");
 	if (f.GetRawFilePtr() == nullptr)
@@ -168,7 +184,7 @@ Image2d<T>::Image2d(const char * fileName) :
 		this->channelsCount = dPng.channelsCount;
 		if constexpr (std::is_same<T, uint8_t>::value)
 		{
-			this->data = std::move(dPng.data);
+			this->data.assign(dPng.data.begin(), dPng.data.end());
 		}
 		else 
 		{
@@ -191,17 +207,35 @@ Image2d<T>::Image2d(const char * fileName) :
 
 /// <summary>
 /// Create empty image with size w x h and given pixel format
+/// Data are filled with 0, unless init is UNINITIALIZED
 /// </summary>
 /// <param name="w"></param>
 /// <param name="h"></param>
 /// <param name="pf"></param>
+/// <param name="layout"></param>
+/// <param name="init"></param>
+/// <param name="allocator">allocator of pixel data
+/// (nullptr - IBufferAllocator::GetDefault())</param>
 template <typename T>
-Image2d<T>::Image2d(int w, int h, ColorSpace::PixelFormat pf) :
-	dim({ w, h }),	
-	data(std::vector<T>(w * h * ColorSpace::GetChannelsCount(pf), 0)),
+Image2d<T>::Image2d(int w, int h, ColorSpace::PixelFormat pf, ImageUtils::DataLayout layout,
+	ImageUtils::InitMode init, MyUtils::IBufferAllocator * allocator) :
+	dim({ w, h }),
+	data(MyUtils::StdBufferAllocator<T>(
+		(allocator != nullptr) ? allocator : MyUtils::IBufferAllocator::GetDefault())),
 	pf(pf),
-	channelsCount(ColorSpace::GetChannelsCount(pf))
+	channelsCount(ColorSpace::GetChannelsCount(pf)),
+	layout(layout)
 {		
+	size_t len = size_t(w) * size_t(h) * this->channelsCount;
+
+	if (init == ImageUtils::InitMode::UNINITIALIZED)
+	{
+		this->data.resize(len);
+	}
+	else
+	{
+		this->data.resize(len, T(0));
+	}
 }
 
 /// <summary>
@@ -211,12 +245,15 @@ Image2d<T>::Image2d(int w, int h, ColorSpace::PixelFormat pf) :
 /// <param name="h"></param>
 /// <param name="data"></param>
 /// <param name="pf"></param>
+/// <param name="layout">layout of data</param>
 template <typename T>
-Image2d<T>::Image2d(int w, int h, const std::vector<T> & data, ColorSpace::PixelFormat pf) :
+Image2d<T>::Image2d(int w, int h, const std::vector<T> & data, ColorSpace::PixelFormat pf,
+	ImageUtils::DataLayout layout) :
 	dim({ w, h }),
-	data(data),
+	data(data.begin(), data.end()),
 	pf(pf),
-	channelsCount(ColorSpace::GetChannelsCount(pf))
+	channelsCount(ColorSpace::GetChannelsCount(pf)),
+	layout(layout)
 {
 }
 
@@ -232,7 +269,8 @@ Image2d<T>::Image2d(int w, int h, const T * rawData, ColorSpace::PixelFormat pf)
 	dim({ w, h }),
 	data(rawData, rawData + w * h * ColorSpace::GetChannelsCount(pf)),
 	pf(pf),
-	channelsCount(ColorSpace::GetChannelsCount(pf))
+	channelsCount(ColorSpace::GetChannelsCount(pf)),
+	layout(ImageUtils::DataLayout::INTERLEAVED)
 {
 }
 
@@ -240,7 +278,8 @@ template <typename T>
 Image2d<T>::Image2d(int w, int h, const T ** rawData, ColorSpace::PixelFormat pf) :
 	dim({ w, h }),	
 	pf(pf),
-	channelsCount(ColorSpace::GetChannelsCount(pf))
+	channelsCount(ColorSpace::GetChannelsCount(pf)),
+	layout(ImageUtils::DataLayout::INTERLEAVED)
 {
 	for (int i = 0; i < h; i++)
 	{
@@ -248,6 +287,26 @@ Image2d<T>::Image2d(int w, int h, const T ** rawData, ColorSpace::PixelFormat pf
 	}
 }
 
+/// <summary>
+/// Create image with size w x h, filled with data and given pixel format
+/// std::vector uses different allocator, so data are copied
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="data"></param>
+/// <param name="pf"></param>
+/// <param name="layout">layout of data</param>
+template <typename T>
+Image2d<T>::Image2d(int w, int h, std::vector<T> && data, ColorSpace::PixelFormat pf,
+	ImageUtils::DataLayout layout) :
+	dim({ w, h }),	
+	data(data.begin(), data.end()),
+	pf(pf),
+	channelsCount(ColorSpace::GetChannelsCount(pf)),
+	layout(layout)
+{	
+}
+
 /// <summary>
 /// Create image with size w x h, filled with data and given pixel format
 /// data are moved
@@ -256,12 +315,15 @@ Image2d<T>::Image2d(int w, int h, const T ** rawData, ColorSpace::PixelFormat pf
 /// <param name="h"></param>
 /// <param name="data"></param>
 /// <param name="pf"></param>
+/// <param name="layout">layout of data</param>
 template <typename T>
-Image2d<T>::Image2d(int w, int h, std::vector<T> && data, ColorSpace::PixelFormat pf) :
+Image2d<T>::Image2d(int w, int h, ImageBuffer<T> && data, ColorSpace::PixelFormat pf,
+	ImageUtils::DataLayout layout) :
 	dim({ w, h }),	
 	data(std::move(data)),
 	pf(pf),
-	channelsCount(ColorSpace::GetChannelsCount(pf))
+	channelsCount(ColorSpace::GetChannelsCount(pf)),
+	layout(layout)
 {	
 }
 
@@ -270,7 +332,8 @@ Image2d<T>::Image2d(const Image2d<T> & other) :
 	dim(other.dim),	
 	data(other.data),
 	pf(other.pf),
-	channelsCount(other.channelsCount)
+	channelsCount(other.channelsCount),
+	layout(other.layout)
 {
 }
 
@@ -283,7 +346,8 @@ Image2d<T>::Image2d(Image2d<T> && other) noexcept :
 	dim(other.dim),
 	data(std::move(other.data)),
 	pf(other.pf),
-	channelsCount(other.channelsCount)
+	channelsCount(other.channelsCount),
+	layout(other.layout)
 {
 	other.Release();
 }
@@ -302,7 +366,8 @@ Image2d<T>::Image2d(Image2d<T> && other) noexcept :
 template <typename T>
 Image2d<T>::Image2d(const cv::Mat & cvMat) :
 	dim({ cvMat.cols, cvMat.rows }),	
-	channelsCount(cvMat.channels())
+	channelsCount(cvMat.channels()),
+	layout(ImageUtils::DataLayout::INTERLEAVED)
 {	
 	if (channelsCount == 1) pf = ColorSpace::PixelFormat::GRAY;
 	else if (channelsCount == 3) pf = ColorSpace::PixelFormat::RGB;
@@ -334,16 +399,18 @@ Image2d<T>::~Image2d()
 
 /// <summary>
 /// Manually release data
+/// (buffer is returned to its allocator)
 /// dimensions of image are set to 0
 /// </summary>
 template <typename T>
 void Image2d<T>::Release() noexcept
 {
-	this->data.clear();
+	ImageBuffer<T>().swap(this->data);
 	this->channelsCount = 0;
 	this->dim.w = 0;
 	this->dim.h = 0;
 	this->pf = ColorSpace::PixelFormat::NONE;
+	this->layout = ImageUtils::DataLayout::INTERLEAVED;
 }
 
 //=================================================================================================
@@ -358,6 +425,7 @@ Image2d<T> & Image2d<T>::operator=(const Image2d<T> & other)
 	this->data = other.data;
 	this->pf = other.pf;
 	this->channelsCount = other.channelsCount;
+	this->layout = other.layout;
 	return *this;
 }
 
@@ -368,6 +436,7 @@ Image2d<T> & Image2d<T>::operator=(Image2d<T> && other) noexcept
 	this->data = std::move(other.data);	
 	this->pf = other.pf;
 	this->channelsCount = other.channelsCount;
+	this->layout = other.layout;
 
 	other.Release();
 
@@ -382,15 +451,19 @@ Image2d<T> & Image2d<T>::operator=(Image2d<T> && other) noexcept
 /// <summary>
 /// Create empty image with same parametrs as the current one
 /// </summary>
+/// <param name="allocator">allocator of pixel data
+/// (nullptr - IBufferAllocator::GetDefault())</param>
 /// <returns></returns>
 template <typename T>
 template <typename V>
-Image2d<V> Image2d<T>::CreateEmpty() const
+Image2d<V> Image2d<T>::CreateEmpty(MyUtils::IBufferAllocator * allocator) const
 {	
 	return Image2d<V>(this->GetWidth(),
 		this->GetHeight(),
-		std::vector<V>(this->data.size(), 0),
-		this->pf);
+		this->pf,
+		this->layout,
+		ImageUtils::InitMode::ZERO,
+		allocator);
 }
 
 /// <summary>
@@ -400,10 +473,7 @@ Image2d<V> Image2d<T>::CreateEmpty() const
 template <typename T>
 Image2d<T> Image2d<T>::CreateDeepCopy() const
 {
-	return Image2d<T>(this->GetWidth(),
-		this->GetHeight(),
-		this->data,
-		this->pf);
+	return Image2d<T>(*this);
 }
 
 /// <summary>
@@ -415,67 +485,174 @@ Image2d<T> Image2d<T>::CreateDeepCopy() const
 template <typename T>
 Image2d<T> Image2d<T>::CreateFromChannel(size_t channelIndex) const
 {
-	size_t len = size_t(this->dim.w) * size_t(this->dim.h);
+	return this->CreateFromChannelParallel(channelIndex, size_t(this->dim.h));
+}
 
-	std::vector<T> channelData;
-	channelData.resize(len);
-	
-	for (size_t i = 0; i < len; i++)
+/// <summary>
+/// Parallel version of CreateFromChannel
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <param name="grainRows">rows processed by single task (0 - auto)</param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateFromChannelParallel(size_t channelIndex, size_t grainRows) const
+{
+	if (channelIndex >= this->channelsCount)
 	{
-		const T * tmp = this->GetPixelStart(i);
+		MY_LOG_ERROR("Channel %zu is out of range (%zu channels)", channelIndex, this->channelsCount);
+		return Image2d<T>();
+	}
 
-		channelData[i] = tmp[channelIndex];
+	const std::vector<int> sources = { static_cast<int>(channelIndex) };
+
+	Image2d<T> res(this->GetWidth(), this->GetHeight(), ColorSpace::PixelFormat::GRAY,
+		ImageUtils::DataLayout::INTERLEAVED, ImageUtils::InitMode::UNINITIALIZED);
+	this->ShuffleChannelsTo(res.data.data(), sources, T(0), grainRows);
+
+	return res;
+}
+
+/// <summary>
+/// Create new image with channels taken from the current image
+/// output channel c = channel sources[c] of the current image,
+/// or constant if sources[c] is CONSTANT_CHANNEL
+/// (e.g. RGB -> BGRA: { 2, 1, 0, CONSTANT_CHANNEL } with constant 255, RGBA -> RA: { 0, 3 })
+///
+/// Output has the same layout. Pixel format is kept for the same number of channels,
+/// otherwise it is GRAY / RG / RGB / RGBA based on the number of channels.
+/// Interleaved pixels are shuffled with SIMD byte shuffles (ImageKernels::ShuffleChannels)
+/// </summary>
+/// <param name="sources">channel of the current image for each output channel</param>
+/// <param name="constant">value of CONSTANT_CHANNEL channels</param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateWithChannels(const std::vector<int> & sources, T constant) const
+{
+	if (!this->IsChannelsShuffleValid(sources))
+	{
+		return Image2d<T>();
 	}
 
-	return Image2d<T>(this->GetWidth(),
-		this->GetHeight(),
-		std::move(channelData),
-		ColorSpace::PixelFormat::GRAY);
+	Image2d<T> res;
+	res.dim = this->dim;
+	res.layout = this->layout;
+	res.channelsCount = sources.size();
+	res.pf = this->GetShuffledPixelFormat(sources.size());
+	res.data.resize(this->GetPixelsCount() * sources.size());
+
+	this->ShuffleChannelsTo(res.data.data(), sources, constant, 0);
+
+	return res;
 }
 
 /// <summary>
-/// Create new image from the current image sub-image
-/// sub-image starts at [x, y] and has given size 
+/// Test if all sources are valid channels or CONSTANT_CHANNEL
 /// </summary>
-/// <param name="x"></param>
-/// <param name="y"></param>
-/// <param name="size"></param>
+/// <param name="sources"></param>
 /// <returns></returns>
 template <typename T>
-Image2d<T> Image2d<T>::CreateSubImage(int x, int y, const ImageDimension & size) const
+bool Image2d<T>::IsChannelsShuffleValid(const std::vector<int> & sources) const
 {
-	size_t len = size_t(size.w) * size_t(size.h) * this->channelsCount;
+	if (sources.empty())
+	{
+		MY_LOG_ERROR("Channels shuffle must have at least one output channel");
+		return false;
+	}
 
-	std::vector<T> subData;
-	subData.resize(len);
+	for (int src : sources)
+	{
+		if ((src != CONSTANT_CHANNEL) && ((src < 0) || (size_t(src) >= this->channelsCount)))
+		{
+			MY_LOG_ERROR("Channel %d is out of range (%zu channels)", src, this->channelsCount);
+			return false;
+		}
+	}
 
-	x = std::max(0, x);
-	y = std::max(0, y);
-	
-	int endX = x + size.w;
-	int endY = y + size.h;
-		
-	endX = std::min(endX, this->GetWidth());
-	endY = std::min(endY, this->GetHeight());
+	return true;
+}
+
+/// <summary>
+/// Get pixel format of image with shuffled channels
+/// Format is kept for the same number of channels,
+/// otherwise generic format for the number of channels is used
+/// </summary>
+/// <param name="channelsCount"></param>
+/// <returns></returns>
+template <typename T>
+ColorSpace::PixelFormat Image2d<T>::GetShuffledPixelFormat(size_t channelsCount) const noexcept
+{
+	if (channelsCount == this->channelsCount)
+	{
+		return this->pf;
+	}
+
+	//uint8_t mapping: GRAY, RG, RGB, RGBA
+	return ColorSpace::GetFormatFromChannelsCount<uint8_t>(channelsCount);
+}
 
-	size_t index = 0;
-	for (int yy = y; yy < endY; yy++)
+/// <summary>
+/// Write shuffled channels to output with the same layout
+/// Output must not be the same as the current data, unless number of channels is the same
+/// (rows are processed in parallel)
+/// </summary>
+/// <param name="output"></param>
+/// <param name="sources"></param>
+/// <param name="constant"></param>
+/// <param name="grainRows">rows processed by single task (0 - auto)</param>
+template <typename T>
+void Image2d<T>::ShuffleChannelsTo(T * output, const std::vector<int> & sources, T constant,
+	size_t grainRows) const
+{
+	const size_t len = this->GetPixelsCount();
+	const size_t w = size_t(this->dim.w);
+	const size_t outChannelsCount = sources.size();
+
+	if (this->layout == ImageUtils::DataLayout::PLANAR)
 	{
-		for (int xx = x; xx < endX; xx++)
+		//whole planes are copied
+		for (size_t c = 0; c < outChannelsCount; c++)
 		{
-			const T * tmp = this->GetPixelStart(xx, yy);
-			for (size_t c = 0; c < this->channelsCount; c++)
+			if (sources[c] == CONSTANT_CHANNEL)
+			{
+				ImageKernels::Fill(output + c * len, len, constant);
+			}
+			else
 			{
-				subData[index] = tmp[c];
-				index++;
+				const T * plane = this->GetChannelStart(size_t(sources[c]));
+				std::copy(plane, plane + len, output + c * len);
 			}
 		}
+		return;
 	}
 
-	return Image2d<T>(size.w,
-		size.h,
-		std::move(subData),
-		this->pf);
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(this->dim.h), this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		ImageKernels::ShuffleChannels(this->data.data() + y0 * w * this->channelsCount, this->channelsCount,
+			output + y0 * w * outChannelsCount, outChannelsCount, (y1 - y0) * w, sources.data(), constant);
+	});
+}
+
+/// <summary>
+/// Create new image from the current image sub-image
+/// sub-image starts at [x, y] and has given size 
+/// Part of sub-image outside of the current image is set to 0
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="size"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateSubImage(int x, int y, const ImageDimension & size) const
+{
+	Image2d<T> sub;
+	sub.dim = size;
+	sub.pf = this->pf;
+	sub.channelsCount = this->channelsCount;
+	sub.layout = this->layout;
+	sub.data.resize(size_t(size.w) * size_t(size.h) * this->channelsCount, T(0));
+
+	sub.CreateView().CopyFrom(this->CreateView(std::max(0, x), std::max(0, y), size));
+	return sub;
 }
 
 /// <summary>
@@ -490,7 +667,11 @@ Image2d<T> Image2d<T>::CreateWithBorder(int w, int h) const
 {
 	Image2d<T> newImage(this->GetWidth() + 2 * w,
 		this->GetHeight() + 2 * h,		
-		this->pf);
+		this->pf,
+		this->layout);
+
+	const size_t cs = this->GetChannelStride();
+	const size_t newCs = newImage.GetChannelStride();
 	
 	for (int yy = 0; yy < this->GetHeight(); yy++)
 	{
@@ -502,7 +683,7 @@ Image2d<T> Image2d<T>::CreateWithBorder(int w, int h) const
 
 			for (size_t c = 0; c < this->channelsCount; c++)
 			{				
-				tmp2[c] = tmp[c];			
+				tmp2[c * newCs] = tmp[c * cs];
 			}
 		}
 	}
@@ -510,6 +691,173 @@ Image2d<T> Image2d<T>::CreateWithBorder(int w, int h) const
 	return newImage;
 }
 
+/// <summary>
+/// Create new image from the current image by adding border
+/// Border values are filled based on border mode
+/// (see ImageUtils::MapBorderIndex)
+/// </summary>
+/// <param name="left"></param>
+/// <param name="top"></param>
+/// <param name="right"></param>
+/// <param name="bottom"></param>
+/// <param name="border"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateWithBorder(int left, int top, int right, int bottom,
+	ImageUtils::BorderMode border) const
+{
+	if ((left < 0) || (top < 0) || (right < 0) || (bottom < 0))
+	{
+		MY_LOG_ERROR("Border size must not be negative");
+		return Image2d<T>();
+	}
+
+	const int w = this->GetWidth();
+	const int h = this->GetHeight();
+	if ((w == 0) || (h == 0))
+	{
+		return this->CreateWithBorder(0, 0);
+	}
+
+	Image2d<T> newImage(w + left + right, h + top + bottom, this->pf, this->layout,
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	const size_t planesCount = this->GetPlanesCount();
+	const size_t c = this->GetPlaneChannelsCount();
+
+	const size_t rowLen = size_t(w) * c;
+	const size_t newRowLen = size_t(newImage.GetWidth()) * c;
+
+	//source column for each border column (-1 for zero)
+	std::vector<int> borderColumns;
+	for (int x = -left; x < 0; x++)
+	{
+		borderColumns.push_back(ImageUtils::MapBorderIndex(x, w, border));
+	}
+	for (int x = w; x < w + right; x++)
+	{
+		borderColumns.push_back(ImageUtils::MapBorderIndex(x, w, border));
+	}
+
+	for (size_t p = 0; p < planesCount; p++)
+	{
+		const T * src = this->GetPlaneStart(p);
+		T * dst = newImage.GetPlaneStart(p);
+
+		for (int y = 0; y < newImage.GetHeight(); y++)
+		{
+			T * dstRow = dst + size_t(y) * newRowLen;
+
+			int sy = ImageUtils::MapBorderIndex(y - top, h, border);
+			if (sy < 0)
+			{
+				std::fill(dstRow, dstRow + newRowLen, T(0));
+				continue;
+			}
+
+			const T * srcRow = src + size_t(sy) * rowLen;
+			std::copy(srcRow, srcRow + rowLen, dstRow + size_t(left) * c);
+
+			for (int i = 0; i < left + right; i++)
+			{
+				int dx = (i < left) ? i : w + i;
+				T * px = dstRow + size_t(dx) * c;
+
+				if (borderColumns[i] < 0)
+				{
+					std::fill(px, px + c, T(0));
+				}
+				else
+				{
+					std::copy(srcRow + size_t(borderColumns[i]) * c, srcRow + size_t(borderColumns[i] + 1) * c, px);
+				}
+			}
+		}
+	}
+
+	return newImage;
+}
+
+/// <summary>
+/// Create new image by convolution of the current image with kernel
+/// (see ImageConvolution::Convolve)
+/// </summary>
+/// <param name="kernel"></param>
+/// <param name="border"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateConvolved(const NeighborhoodKernel & kernel, ImageUtils::BorderMode border) const
+{
+	return ImageConvolution::Convolve(*this, kernel, border);
+}
+
+/// <summary>
+/// Create new image by morphological operation on the current image
+/// (see ImageMorphology::Apply)
+/// </summary>
+/// <param name="op"></param>
+/// <param name="shape"></param>
+/// <param name="radiusX"></param>
+/// <param name="radiusY"></param>
+/// <param name="border"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateMorphology(ImageUtils::MorphologyOperation op, ImageUtils::StructuringElement shape,
+	int radiusX, int radiusY, ImageUtils::BorderMode border) const
+{
+	return ImageMorphology::Apply(*this, op, shape, radiusX, radiusY, border);
+}
+
+/// <summary>
+/// Create integral image (summed-area table) of the current image
+/// </summary>
+/// <param name="withSquares">build also sums of squared values (needed for variance)</param>
+/// <returns></returns>
+template <typename T>
+IntegralImage<T> Image2d<T>::CreateIntegralImage(bool withSquares) const
+{
+	return IntegralImage<T>(*this, withSquares);
+}
+
+/// <summary>
+/// Create new image resized to given size
+/// (see ImageResampler::Resize)
+/// </summary>
+/// <param name="size"></param>
+/// <param name="mode"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateResized(const ImageDimension & size, ImageUtils::ResampleMode mode) const
+{
+	return ImageResampler::Resize(*this, size, mode);
+}
+
+/// <summary>
+/// Create flipped / rotated / transposed copy of the current image
+/// (see ImageTransform)
+/// </summary>
+/// <param name="t"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateTransformed(ImageUtils::GeometricTransform t) const
+{
+	return ImageTransform::CreateTransformed(*this, t);
+}
+
+/// <summary>
+/// Create image pyramid (mipmap chain) of the current image
+/// (see ImagePyramid)
+/// </summary>
+/// <param name="filter"></param>
+/// <param name="maxLevelsCount">max number of levels including the current image
+/// (0 - all levels down to 1x1)</param>
+/// <returns></returns>
+template <typename T>
+ImagePyramid<T> Image2d<T>::CreatePyramid(ImageUtils::PyramidFilter filter, size_t maxLevelsCount) const
+{
+	return ImagePyramid<T>(*this, filter, maxLevelsCount);
+}
+
 
 /// <summary>
 /// Create new Image2d from current
@@ -526,45 +874,235 @@ template <typename T>
 template <typename V>
 Image2d<V> Image2d<T>::CreateAs() const
 {	
-	std::vector<V> d;
-	d.resize(this->data.size());
+	ImageBuffer<V> d;
+
+	if constexpr (std::is_same<T, V>::value)
+	{
+		d = this->data;
+	}
+	else
+	{
+		d.resize(this->data.size());
+		ImageKernels::Convert(this->data.data(), d.data(), this->data.size());
+	}
+
+	return Image2d<V>(this->GetWidth(),
+		this->GetHeight(),
+		std::move(d),
+		this->pf,
+		this->layout);
+}
+
+/// <summary>
+/// Parallel version of CreateAs
+/// </summary>
+/// <param name="grainRows">rows processed by single task (0 - auto)</param>
+/// <returns></returns>
+template <typename T>
+template <typename V>
+Image2d<V> Image2d<T>::CreateAsParallel(size_t grainRows) const
+{	
+	ImageBuffer<V> d(this->data.size());
+
+	//data are converted as continuous array, planes of planar image are rows too
+	const size_t rowSize = size_t(this->dim.w) * this->GetPixelStride();
+	const size_t rowsCount = (rowSize == 0) ? 0 : this->data.size() / rowSize;
+	const T * src = this->data.data();
+	V * dst = d.data();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, rowsCount, this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		if constexpr (std::is_same<T, V>::value)
+		{
+			std::copy(src + y0 * rowSize, src + y1 * rowSize, dst + y0 * rowSize);
+		}
+		else
+		{
+			ImageKernels::Convert(src + y0 * rowSize, dst + y0 * rowSize, (y1 - y0) * rowSize);
+		}
+	});
+
+	return Image2d<V>(this->GetWidth(),
+		this->GetHeight(),
+		std::move(d),
+		this->pf,
+		this->layout);
+}
+
+/// <summary>
+/// Create copy of the current image with data in given layout
+/// Conversion interleaved <-> planar is done with SIMD kernels
+/// </summary>
+/// <param name="layout"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateWithLayout(ImageUtils::DataLayout layout) const
+{
+	Image2d<T> img;
+	img.dim = this->dim;
+	img.pf = this->pf;
+	img.channelsCount = this->channelsCount;
+	img.layout = layout;
+
+	if ((layout == this->layout) || (this->channelsCount <= 1))
+	{
+		//for single channel, both layouts are same
+		img.data = this->data;
+		return img;
+	}
+
+	size_t len = this->GetPixelsCount();
+	if (this->data.size() != len * this->channelsCount)
+	{
+		MY_LOG_ERROR("Image data size does not match its dimension");
+		return img;
+	}
+
+	img.data.resize(this->data.size());
+
+	if (layout == ImageUtils::DataLayout::PLANAR)
+	{
+		ImageKernels::Deinterleave(this->data.data(), len, this->channelsCount, img.data.data());
+	}
+	else
+	{
+		ImageKernels::Interleave(this->data.data(), len, this->channelsCount, img.data.data());
+	}
+
+	return img;
+}
+
+/// <summary>
+/// Create new image with pixels converted to given pixel format
+/// (see ColorSpace::CreateConverted)
+/// </summary>
+/// <param name="pf"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> Image2d<T>::CreateWithPixelFormat(ColorSpace::PixelFormat pf) const
+{
+	return ColorSpace::CreateConverted(*this, pf);
+}
+
+
+/// <summary>
+/// Create non-owning view to the whole image
+/// </summary>
+/// <returns></returns>
+template <typename T>
+Image2dView<T> Image2d<T>::CreateView()
+{
+	return Image2dView<T>(this->data.data(), this->dim, this->pf, this->channelsCount, this->layout,
+		size_t(this->dim.w) * this->GetPixelStride(), this->GetPixelStride(), this->GetChannelStride());
+}
+
+template <typename T>
+Image2dView<const T> Image2d<T>::CreateView() const
+{
+	return Image2dView<const T>(this->data.data(), this->dim, this->pf, this->channelsCount, this->layout,
+		size_t(this->dim.w) * this->GetPixelStride(), this->GetPixelStride(), this->GetChannelStride());
+}
+
+/// <summary>
+/// Create non-owning view to the part of the image
+/// View starts at [x, y] and has given size
+/// Region is clipped to the image bounds
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="size"></param>
+/// <returns></returns>
+template <typename T>
+Image2dView<T> Image2d<T>::CreateView(int x, int y, const ImageDimension & size)
+{
+	return this->CreateView().CreateSubView(x, y, size);
+}
+
+template <typename T>
+Image2dView<const T> Image2d<T>::CreateView(int x, int y, const ImageDimension & size) const
+{
+	return this->CreateView().CreateSubView(x, y, size);
+}
+
+
+//=================================================================================================
+// Setters
+//=================================================================================================
+
+template <typename T>
+void Image2d<T>::SetPixelFormat(ColorSpace::PixelFormat pf) noexcept
+{
+	this->pf = pf;
+	this->channelsCount = ColorSpace::GetChannelsCount(pf);
+}
+
+/// <summary>
+/// Convert data of the current image to given layout
+/// </summary>
+/// <param name="layout"></param>
+template <typename T>
+void Image2d<T>::SetLayout(ImageUtils::DataLayout layout)
+{
+	if (layout == this->layout)
+	{
+		return;
+	}
 
-	size_t dataSize4 = this->data.size() - this->data.size() % 4;
+	*this = this->CreateWithLayout(layout);
+}
 
-	for (size_t i = 0; i < dataSize4; i += 4)
-	{		
-		d[i] = static_cast<V>(this->data[i]);
-		d[i + 1] = static_cast<V>(this->data[i + 1]);
-		d[i + 2] = static_cast<V>(this->data[i + 2]);
-		d[i + 3] = static_cast<V>(this->data[i + 3]);
+/// <summary>
+/// Remap values of the current image with lookup table
+/// (see LookupTable::Apply, only uint8_t images are supported)
+/// </summary>
+/// <param name="lut"></param>
+template <typename T>
+void Image2d<T>::ApplyLookupTable(const LookupTable & lut)
+{
+	if constexpr (std::is_same<T, uint8_t>::value)
+	{
+		lut.Apply(*this);
 	}
-
-	for (size_t i = dataSize4; i < this->data.size(); i++)
+	else
 	{
-		d[i] = static_cast<V>(this->data[i]);
+		MY_LOG_ERROR("Lookup table can be applied only to uint8_t image");
 	}
-
-	return Image2d<V>(this->GetWidth(),
-		this->GetHeight(),
-		std::move(d),
-		this->pf);
 }
 
+/// <summary>
+/// Flip / rotate / transpose the current image in place
+/// (width and height are swapped for rotation by 90 / 270 degrees and transpose)
+/// </summary>
+/// <param name="t"></param>
+template <typename T>
+void Image2d<T>::ApplyTransform(ImageUtils::GeometricTransform t)
+{
+	ImageTransform::Apply(*this, t);
+}
 
-//=================================================================================================
-// Setters
-//=================================================================================================
+/// <summary>
+/// Multiply colors of RGBA image by alpha (see AlphaBlending)
+/// </summary>
+template <typename T>
+void Image2d<T>::Premultiply()
+{
+	AlphaBlending::Premultiply(*this);
+}
 
+/// <summary>
+/// Divide colors of premultiplied RGBA image by alpha (see AlphaBlending)
+/// </summary>
 template <typename T>
-void Image2d<T>::SetPixelFormat(ColorSpace::PixelFormat pf) noexcept
+void Image2d<T>::Unpremultiply()
 {
-	this->pf = pf;
-	this->channelsCount = ColorSpace::GetChannelsCount(pf);
+	AlphaBlending::Unpremultiply(*this);
 }
 
 /// <summary>
 /// Save file to JPG or PNG
 /// In case of JPG, default quality 80 is used
+/// RAW file is saved with data in the current layout,
+/// other formats are always saved interleaved
 /// </summary>
 /// <param name="fileName"></param>
 template <typename T>
@@ -587,6 +1125,12 @@ void Image2d<T>::Save(const char * fileName) const
 		return;
 	}
 
+	if ((this->layout == ImageUtils::DataLayout::PLANAR) && (this->channelsCount > 1))
+	{
+		this->CreateWithLayout(ImageUtils::DataLayout::INTERLEAVED).Save(fileName);
+		return;
+	}
+
 	struct RawData
 	{
 		const uint8_t* data;
@@ -653,7 +1197,7 @@ void Image2d<T>::Save(const char * fileName) const
 
 	if constexpr (std::is_same<T, uint8_t>::value == false)
 	{
-		delete rd.data;
+		delete[] rd.data;
 		rd.data = nullptr;
 	}
 }
@@ -675,6 +1219,55 @@ size_t Image2d<T>::GetChannelsCount() const noexcept
 	return this->channelsCount;
 }
 
+template <typename T>
+ImageUtils::DataLayout Image2d<T>::GetLayout() const noexcept
+{
+	return this->layout;
+}
+
+/// <summary>
+/// Get distance (in elements) between two channels of the same pixel
+/// Channel c of pixel is at GetPixelStart(...)[c * GetChannelStride()]
+/// </summary>
+/// <returns></returns>
+template <typename T>
+size_t Image2d<T>::GetChannelStride() const noexcept
+{
+	return (this->layout == ImageUtils::DataLayout::PLANAR) ? this->GetPixelsCount() : 1;
+}
+
+/// <summary>
+/// Get distance (in elements) between two neighbor pixels
+/// </summary>
+/// <returns></returns>
+template <typename T>
+size_t Image2d<T>::GetPixelStride() const noexcept
+{
+	return (this->layout == ImageUtils::DataLayout::PLANAR) ? 1 : this->channelsCount;
+}
+
+/// <summary>
+/// Get number of planes (continuous w x h blocks of pixels)
+/// Interleaved image is single plane with all channels,
+/// planar image has plane with single channel for each channel
+/// </summary>
+/// <returns></returns>
+template <typename T>
+size_t Image2d<T>::GetPlanesCount() const noexcept
+{
+	return (this->layout == ImageUtils::DataLayout::PLANAR) ? this->channelsCount : 1;
+}
+
+/// <summary>
+/// Get number of interleaved channels in single plane
+/// </summary>
+/// <returns></returns>
+template <typename T>
+size_t Image2d<T>::GetPlaneChannelsCount() const noexcept
+{
+	return (this->layout == ImageUtils::DataLayout::PLANAR) ? 1 : this->channelsCount;
+}
+
 
 template <typename T>
 int Image2d<T>::GetWidth() const noexcept
@@ -856,29 +1449,15 @@ std::array<const T *, 8> Image2d<T>::GetNeighborsPixelStartsFromPosition(int x,
 template <typename T>
 void Image2d<T>::FindMinMax(size_t channelIndex, T & min, T & max) const
 {
-#ifdef ENABLE_SIMD
-	if constexpr (std::is_same<T, float>::value)
+	if (this->layout == ImageUtils::DataLayout::PLANAR)
 	{
-		if (this->GetChannelsCount() == 1)
-		{
-			this->FindMinMaxSimd(min, max);
-			return;
-		}
+		ImageKernels::FindMinMax(this->GetChannelStart(channelIndex), this->GetPixelsCount(), 1,
+			0, min, max);
+		return;
 	}
-#endif
 
-	const T * tmp = this->GetPixelStart(0);
-	min = tmp[channelIndex];
-	max = tmp[channelIndex];
-	
-	size_t len = this->GetPixelsCount();
-	for (size_t i = 1; i < len; i++)
-	{
-		const T * tmp = this->GetPixelStart(i);
-
-		max = std::max(tmp[channelIndex], max);
-		min = std::min(tmp[channelIndex], min);		
-	}
+	ImageKernels::FindMinMax(this->data.data(), this->GetPixelsCount(), this->channelsCount,
+		channelIndex, min, max);
 }
 
 /// <summary>
@@ -890,33 +1469,131 @@ void Image2d<T>::FindMinMax(size_t channelIndex, T & min, T & max) const
 template <typename T>
 T Image2d<T>::CalcAvgValue(size_t channelIndex) const
 {
-	float avg = 0.0f;
+	size_t len = this->GetPixelsCount();
+	if (len == 0)
+	{
+		return T(0);
+	}
+
+	double sum = 0.0;
+	if (this->layout == ImageUtils::DataLayout::PLANAR)
+	{
+		sum = static_cast<double>(ImageKernels::Sum(this->GetChannelStart(channelIndex), len, 1, 0));
+	}
+	else
+	{
+		sum = static_cast<double>(ImageKernels::Sum(this->data.data(), len, this->channelsCount,
+			channelIndex));
+	}
+
+	return static_cast<T>(sum / len);
+}
+
+/// <summary>
+/// Parallel version of FindMinMax
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <param name="min"></param>
+/// <param name="max"></param>
+/// <param name="grainRows">rows processed by single task (0 - auto)</param>
+template <typename T>
+void Image2d<T>::FindMinMaxParallel(size_t channelIndex, T & min, T & max, size_t grainRows) const
+{
+	if (this->GetPixelsCount() == 0)
+	{
+		this->FindMinMax(channelIndex, min, max);
+		return;
+	}
+
+	const size_t w = size_t(this->dim.w);
+	const bool planar = (this->layout == ImageUtils::DataLayout::PLANAR);
+	const T * src = planar ? this->GetChannelStart(channelIndex) : this->data.data();
+	const size_t chanCount = planar ? 1 : this->channelsCount;
+	const size_t chanIndex = planar ? 0 : channelIndex;
+
+	auto res = MyUtils::ThreadPool::GetInstance()->ParallelReduce(0, size_t(this->dim.h), 
+		this->GetParallelGrainRows(grainRows),
+		std::make_pair(src[chanIndex], src[chanIndex]),
+		[&](size_t y0, size_t y1) {
+			std::pair<T, T> r;
+			ImageKernels::FindMinMax(src + y0 * w * chanCount, (y1 - y0) * w, chanCount, chanIndex,
+				r.first, r.second);
+			return r;
+		},
+		[](const std::pair<T, T> & a, const std::pair<T, T> & b) {
+			return std::make_pair(std::min(a.first, b.first), std::max(a.second, b.second));
+		});
+
+	min = res.first;
+	max = res.second;
+}
 
+/// <summary>
+/// Parallel version of CalcAvgValue
+/// Bands are summed separately, so result can slightly differ from CalcAvgValue,
+/// but it does not depend on the number of threads
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <param name="grainRows">rows processed by single task (0 - auto)</param>
+/// <returns></returns>
+template <typename T>
+T Image2d<T>::CalcAvgValueParallel(size_t channelIndex, size_t grainRows) const
+{
 	size_t len = this->GetPixelsCount();
-	for (size_t i = 0; i < len; i++)
+	if (len == 0)
 	{
-		const T * tmp = this->GetPixelStart(i);
-		avg += tmp[channelIndex];		
+		return T(0);
 	}
 
-	return static_cast<T>(avg / len);
+	const size_t w = size_t(this->dim.w);
+	const bool planar = (this->layout == ImageUtils::DataLayout::PLANAR);
+	const T * src = planar ? this->GetChannelStart(channelIndex) : this->data.data();
+	const size_t chanCount = planar ? 1 : this->channelsCount;
+	const size_t chanIndex = planar ? 0 : channelIndex;
+
+	double sum = MyUtils::ThreadPool::GetInstance()->ParallelReduce(0, size_t(this->dim.h), 
+		this->GetParallelGrainRows(grainRows),
+		0.0,
+		[&](size_t y0, size_t y1) {
+			return static_cast<double>(ImageKernels::Sum(src + y0 * w * chanCount, (y1 - y0) * w,
+				chanCount, chanIndex));
+		},
+		[](double a, double b) {
+			return a + b;
+		});
+
+	return static_cast<T>(sum / len);
+}
+
+/// <summary>
+/// Create histogram and statistics of all channels in one parallel pass
+/// (see ImageHistogram)
+/// </summary>
+/// <param name="mask">single channel mask, only pixels with non-zero mask are counted (can be nullptr)</param>
+/// <returns></returns>
+template <typename T>
+ImageHistogram<T> Image2d<T>::CreateHistogram(const Image2d<uint8_t> * mask) const
+{
+	return ImageHistogram<T>(*this, mask);
 }
 
 /// <summary>
 /// Get pointer to the first element of pixel
+/// Other channels of pixel are GetChannelStride() elements apart
+/// (for interleaved layout, they directly follow)
 /// </summary>
 /// <param name="index"></param>
 /// <returns></returns>
 template <typename T>
 const T * Image2d<T>::GetPixelStart(size_t index) const
 {
-	return &this->data[index * this->GetChannelsCount()];
+	return &this->data[index * this->GetPixelStride()];
 }
 
 template <typename T>
 T * Image2d<T>::GetPixelStart(size_t index)
 {
-	return &this->data[index * this->GetChannelsCount()];
+	return &this->data[index * this->GetPixelStride()];
 }
 
 
@@ -990,47 +1667,58 @@ T * Image2d<T>::operator[](size_t index)
 	return this->GetPixelStart(index);
 }
 
+/// <summary>
+/// Get pointer to the first element of channel
+/// Next values of channel are GetPixelStride() elements apart
+/// (for planar layout, they directly follow)
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
 template <typename T>
-const std::vector<T> & Image2d<T>::GetData() const noexcept
+const T * Image2d<T>::GetChannelStart(size_t channelIndex) const
 {
-	return this->data;
+	return this->data.data() + channelIndex * this->GetChannelStride();
 }
 
 template <typename T>
-std::vector<T> & Image2d<T>::GetData() noexcept
+T * Image2d<T>::GetChannelStart(size_t channelIndex)
 {
-	return this->data;
+	return this->data.data() + channelIndex * this->GetChannelStride();
 }
 
-//=================================================================================================
-// Methods
-//=================================================================================================
-
-
+/// <summary>
+/// Get pointer to the first element of plane
+/// Plane has GetHeight() rows of GetWidth() * GetPlaneChannelsCount() elements
+/// </summary>
+/// <param name="planeIndex">[0, GetPlanesCount())</param>
+/// <returns></returns>
 template <typename T>
-void Image2d<T>::ForEachPixel(std::function<void(T *, size_t)> callback)
+const T * Image2d<T>::GetPlaneStart(size_t planeIndex) const
 {
-	size_t len = this->GetPixelsCount();
+	return this->data.data() + planeIndex * this->GetPixelsCount();
+}
 
-	for (size_t i = 0; i < len; i++)
-	{
-		T * tmp = this->GetPixelStart(i);
-		callback(tmp, i);
-	}	
+template <typename T>
+T * Image2d<T>::GetPlaneStart(size_t planeIndex)
+{
+	return this->data.data() + planeIndex * this->GetPixelsCount();
 }
 
 template <typename T>
-void Image2d<T>::ForEachPixel(std::function<void(const T *, size_t)> callback) const
+const ImageBuffer<T> & Image2d<T>::GetData() const noexcept
 {
-	size_t len = this->GetPixelsCount();
+	return this->data;
+}
 
-	for (size_t i = 0; i < len; i++)
-	{
-		const T * tmp = this->GetPixelStart(i);
-		callback(tmp, i);
-	}	
+template <typename T>
+ImageBuffer<T> & Image2d<T>::GetData() noexcept
+{
+	return this->data;
 }
 
+//=================================================================================================
+// Methods
+//=================================================================================================
 
 
 /// <summary>
@@ -1048,48 +1736,10 @@ void Image2d<T>::Abs()
 	}
 	else
 	{
-		size_t len8 = 0;
-
-#ifdef ENABLE_SIMD
-		len8 = this->data.size() - this->data.size() % MM256_ELEMENT_COUNT;
-
-		for (size_t i = 0; i < len8; i += MM256_ELEMENT_COUNT)
-		{
-			auto v = _mm256_loadu_ps(this->data.data() + i);
-			v = _my_mm256_abs_ps(v);
-			_mm256_storeu_ps(this->data.data() + i, v);
-		}
-
-#endif
-
-		for (size_t i = len8; i < this->data.size(); i++)
-		{
-			this->data[i] = std::abs(this->data[i]);
-		}
-	}
-}
-
-/// <summary>
-/// Combine current image and input img
-/// for each pixel, callback is called with user defined combination
-/// Result can be written to a in callback (a = this)
-/// </summary>
-/// <param name="img"></param>
-/// <param name="callback"></param>
-template <typename T>
-void Image2d<T>::Combine(const Image2d<T> & img, std::function<void(T *, const T *, size_t size)> callback)
-{
-	size_t len = this->GetPixelsCount();
-	for (size_t i = 0; i < len; i++)
-	{
-		T * a = this->GetPixelStart(i);
-		const T * b = img.GetPixelStart(i);
-		callback(a, b, this->GetChannelsCount());
+		ImageKernels::Abs(this->data.data(), this->data.size());
 	}
 }
 
-
-
 /// <summary>
 /// Append image to the right of the current image
 /// Appended image must have same number of channels as the current one
@@ -1104,14 +1754,57 @@ void Image2d<T>::AppendRight(const Image2d<T> & img)
 		return;
 	}
 
+	if (this->layout != img.layout)
+	{
+		MY_LOG_ERROR("Layout of append image is not same");
+		return;
+	}
+
 	ImageDimension newDim;
 	newDim.w = dim.w + img.GetWidth();
 	newDim.h = std::max(dim.h, img.GetHeight());
 		
 	size_t len = size_t(newDim.w) * size_t(newDim.h) * this->channelsCount;
 
-	std::vector<T> channelData;
-	channelData.resize(len);
+	//if heights are different, part of the new image is not covered
+	ImageBuffer<T> channelData;
+	if (dim.h == img.dim.h)
+	{
+		channelData.resize(len);
+	}
+	else
+	{
+		channelData.resize(len, T(0));
+	}
+
+	if (this->layout == ImageUtils::DataLayout::PLANAR)
+	{
+		//append rows of each plane
+		size_t newPixelsCount = size_t(newDim.w) * size_t(newDim.h);
+
+		for (size_t c = 0; c < this->channelsCount; c++)
+		{
+			const T * plane = this->GetChannelStart(c);
+			const T * imgPlane = img.GetChannelStart(c);
+			T * newPlane = channelData.data() + c * newPixelsCount;
+
+			for (size_t y = 0; y < size_t(dim.h); y++)
+			{
+				std::copy(plane + y * dim.w, plane + (y + 1) * dim.w,
+					newPlane + y * newDim.w);
+			}
+
+			for (size_t y = 0; y < size_t(img.dim.h); y++)
+			{
+				std::copy(imgPlane + y * img.dim.w, imgPlane + (y + 1) * img.dim.w,
+					newPlane + dim.w + y * newDim.w);
+			}
+		}
+
+		this->dim = newDim;
+		this->data = std::move(channelData);
+		return;
+	}
 
 	//size_t newIndex = 0;
 
@@ -1162,6 +1855,8 @@ void Image2d<T>::AppendRight(const Image2d<T> & img)
 
 /// <summary>
 /// Insert subimage at position given by top left corner [x, y]
+/// Part of subimage outside of the current image is skipped.
+/// If channels count differs, only common channels are copied
 /// </summary>
 /// <param name="x"></param>
 /// <param name="y"></param>
@@ -1169,38 +1864,26 @@ void Image2d<T>::AppendRight(const Image2d<T> & img)
 template <typename T>
 void Image2d<T>::SetSubImage(int x, int y, const Image2d<T>& img)
 {
-	if (this->GetChannelsCount() == img.GetChannelsCount())
-	{
-		for (int yy = y; yy < y + img.GetHeight(); yy++)
-		{		
-			T * lineStart = &this->data[x + yy * this->GetWidth()];
-			const T* lineStartSub = &img.data[(yy - y) * img.GetWidth()];
-
-			std::copy(lineStartSub,
-				lineStartSub + img.GetWidth() * img.GetChannelsCount(),
-				lineStart);
-			
-		}				
-	}
-	else
-	{
-		size_t chanCount = std::min(this->GetChannelsCount(), img.GetChannelsCount());
-
-		for (int yy = y; yy < y + img.GetHeight(); yy++)
-		{
-			for (int xx = x; xx < x + img.GetWidth(); xx++)
-			{
-				T* val = this->GetPixelStart(xx, yy);
+	int subX = std::max(0, -x);
+	int subY = std::max(0, -y);
 
-				const T* valSub = img.GetPixelStart(xx - x, yy - y);
+	auto target = this->CreateView(x + subX, y + subY, img.GetDimension());
+	target.CopyFrom(img.CreateView(subX, subY, target.GetDimension()));
+}
 
-				for (size_t c = 0; c < chanCount; c++)
-				{
-					val[c] = valSub[c];
-				}
-			}
-		}
-	}
+/// <summary>
+/// Composite premultiplied RGBA subimage over current image
+/// at position given by top left corner [x, y] (Porter-Duff "over").
+/// Part of subimage outside of the current image is skipped.
+/// Current image must be premultiplied RGBA or RGB (see AlphaBlending)
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="img"></param>
+template <typename T>
+void Image2d<T>::BlendOver(int x, int y, const Image2d<T>& img)
+{
+	AlphaBlending::BlendOver(*this, x, y, img);
 }
 
 /// <summary>
@@ -1214,34 +1897,34 @@ template <typename T>
 void Image2d<T>::SetValue(double tmp, size_t channel, size_t index)
 {
 	T * val = this->GetPixelStart(index);
-	val[channel] = ImageUtils::clamp_cast<T>(tmp);
+	val[channel * this->GetChannelStride()] = ImageUtils::clamp_cast<T>(tmp);
 }
 
 template <typename T>
 void Image2d<T>::SetValue(double tmp, size_t channel, int x, int y)
 {
 	T * val = this->GetPixelStart(x, y);
-	val[channel] = ImageUtils::clamp_cast<T>(tmp);
+	val[channel * this->GetChannelStride()] = ImageUtils::clamp_cast<T>(tmp);
 }
 
 template <typename T>
 void Image2d<T>::SetValue(T value, size_t channel, size_t index)
 {
 	T * val = this->GetPixelStart(index);
-	val[channel] = value;
+	val[channel * this->GetChannelStride()] = value;
 }
 
 template <typename T>
 void Image2d<T>::SetValue(T value, size_t channel, int x, int y)
 {
 	T * val = this->GetPixelStart(x, y);
-	val[channel] = value;
+	val[channel * this->GetChannelStride()] = value;
 }
 
 template <typename T>
 void Image2d<T>::Clear(T clearValue)
 {	
-	std::fill(data.begin(), data.end(), clearValue);
+	ImageKernels::Fill(this->data.data(), this->data.size(), clearValue);
 }
 
 template <typename T>
@@ -1252,37 +1935,91 @@ void Image2d<T>::SwapChannels(size_t c0, size_t c1)
 		return;
 	}
 
-	size_t len = this->GetPixelsCount();
-	
-	for (size_t i = 0; i < len; i++)
+	if (this->layout == ImageUtils::DataLayout::PLANAR)
+	{
+		//swap whole planes
+		if (c0 != c1)
+		{
+			std::swap_ranges(this->GetChannelStart(c0),
+				this->GetChannelStart(c0) + this->GetPixelsCount(),
+				this->GetChannelStart(c1));
+		}
+		return;
+	}
+
+	ImageKernels::SwapChannels(this->data.data(), this->GetPixelsCount(), this->channelsCount, c0, c1);
+}
+
+/// <summary>
+/// Rearrange channels of the current image
+/// (see CreateWithChannels)
+/// Interleaved image with not more channels is shuffled in place,
+/// otherwise data are reallocated
+/// </summary>
+/// <param name="sources">channel of the current image for each output channel</param>
+/// <param name="constant">value of CONSTANT_CHANNEL channels</param>
+template <typename T>
+void Image2d<T>::ShuffleChannels(const std::vector<int> & sources, T constant)
+{
+	if (!this->IsChannelsShuffleValid(sources))
+	{
+		return;
+	}
+
+	const size_t outChannelsCount = sources.size();
+
+	if ((this->layout == ImageUtils::DataLayout::PLANAR) || (outChannelsCount > this->channelsCount))
 	{
-		T * val = this->GetPixelStart(i);
+		*this = this->CreateWithChannels(sources, constant);
+		return;
+	}
 
-		T tmp = val[c0];
-		val[c0] = val[c1];
-		val[c1] = tmp;		
+	if (outChannelsCount == this->channelsCount)
+	{
+		//rows stay at the same place - can run in parallel
+		this->ShuffleChannelsTo(this->data.data(), sources, constant, 0);
+	}
+	else
+	{
+		//smaller pixels are written over the already processed input
+		ImageKernels::ShuffleChannels(this->data.data(), this->channelsCount, this->data.data(),
+			outChannelsCount, this->GetPixelsCount(), sources.data(), constant);
+		this->data.resize(this->GetPixelsCount() * outChannelsCount);
 	}
+
+	this->pf = this->GetShuffledPixelFormat(outChannelsCount);
+	this->channelsCount = outChannelsCount;
 }
 
+/// <summary>
+/// Add count channels filled with 0 after the current channels
+/// Pixel format is set to NONE
+/// </summary>
+/// <param name="count"></param>
 template <typename T>
 void Image2d<T>::AddChannels(size_t count)
 {
 	size_t len = this->GetPixelsCount();
 
-	std::vector<T> d;
-	d.resize(len * (this->channelsCount + count), 0);
-
-	for (size_t i = 0; i < len; i++)
-	{		
-		const T * val = this->GetPixelStart(i);
+	if (this->layout == ImageUtils::DataLayout::PLANAR)
+	{
+		//new planes are added at the end
+		this->data.resize(len * (this->channelsCount + count), 0);
+		this->channelsCount += count;
+		this->pf = ColorSpace::PixelFormat::NONE;
+		return;
+	}
 
-		size_t newIndex = i * (this->channelsCount + count);
-		for (size_t c = 0; c < this->channelsCount; c++)
-		{
-			d[newIndex + c] = val[c];
-		}
+	std::vector<int> sources(this->channelsCount + count, CONSTANT_CHANNEL);
+	for (size_t c = 0; c < this->channelsCount; c++)
+	{
+		sources[c] = static_cast<int>(c);
 	}
 
+	ImageBuffer<T> d(len * sources.size());
+	this->ShuffleChannelsTo(d.data(), sources, T(0), 0);
+
+	this->data = std::move(d);
 	this->channelsCount += count;
 	this->pf = ColorSpace::PixelFormat::NONE;
 }
@@ -1304,6 +2041,12 @@ void Image2d<T>::AddChannels(size_t count)
 template <typename T>
 cv::Mat Image2d<T>::CreateOpenCVLightCopy()
 {
+	if ((this->layout == ImageUtils::DataLayout::PLANAR) && (this->channelsCount > 1))
+	{
+		MY_LOG_ERROR("OpenCV light copy is not supported for planar image");
+		return cv::Mat();
+	}
+
 	int cvFormat = 0;
 
 	if constexpr (std::is_same<T, uint8_t>::value)
@@ -1341,6 +2084,11 @@ cv::Mat Image2d<T>::CreateOpenCVLightCopy()
 template <typename T>
 cv::Mat Image2d<T>::CreateOpenCVDeepCopy()
 {
+	if ((this->layout == ImageUtils::DataLayout::PLANAR) && (this->channelsCount > 1))
+	{
+		return this->CreateWithLayout(ImageUtils::DataLayout::INTERLEAVED).CreateOpenCVDeepCopy();
+	}
+
 	int cvFormat = 0;
 
 	if constexpr (std::is_same<T, uint8_t>::value)
@@ -1383,6 +2131,7 @@ Image2d<T> & Image2d<T>::operator=(const cv::Mat & cvMat)
 	this->dim.w = cvMat.cols;
 	this->dim.h = cvMat.rows;
 	this->channelsCount = cvMat.channels();
+	this->layout = ImageUtils::DataLayout::INTERLEAVED;
 	
 	data.clear();
 
@@ -1444,11 +2193,16 @@ template Image2d<float> Image2d<uint8_t>::CreateAs() const;
 template Image2d<uint8_t> Image2d<float>::CreateAs() const;
 template Image2d<uint8_t> Image2d<uint8_t>::CreateAs() const;
 
+template Image2d<float> Image2d<float>::CreateAsParallel(size_t grainRows) const;
+template Image2d<float> Image2d<uint8_t>::CreateAsParallel(size_t grainRows) const;
+template Image2d<uint8_t> Image2d<float>::CreateAsParallel(size_t grainRows) const;
+template Image2d<uint8_t> Image2d<uint8_t>::CreateAsParallel(size_t grainRows) const;
+
 
-template Image2d<float> Image2d<uint8_t>::CreateEmpty() const;
-template Image2d<uint8_t> Image2d<uint8_t>::CreateEmpty() const;
-template Image2d<float> Image2d<float>::CreateEmpty() const;
-template Image2d<uint8_t> Image2d<float>::CreateEmpty() const;
+template Image2d<float> Image2d<uint8_t>::CreateEmpty(MyUtils::IBufferAllocator * allocator) const;
+template Image2d<uint8_t> Image2d<uint8_t>::CreateEmpty(MyUtils::IBufferAllocator * allocator) const;
+template Image2d<float> Image2d<float>::CreateEmpty(MyUtils::IBufferAllocator * allocator) const;
+template Image2d<uint8_t> Image2d<float>::CreateEmpty(MyUtils::IBufferAllocator * allocator) const;
 
 template class Image2d<uint8_t>;
 template class Image2d<float>;
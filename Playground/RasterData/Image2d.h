@@ -2,6 +2,19 @@
 #define IMAGE_2D_H
 
 struct NeighborhoodKernel;
+class LookupTable;
+
+template <typename E>
+class ImageExpression;
+
+template <typename T>
+class IntegralImage;
+
+template <typename T>
+class ImageHistogram;
+
+template <typename T>
+class ImagePyramid;
 
 #include <vector>
 #include <functional>
@@ -15,25 +28,53 @@ struct NeighborhoodKernel;
 
 #include "./ImageUtils.h"
 #include "./ColorSpace.h"
+#include "./Image2dView.h"
+
+#include "../Utils/BufferAllocator.h"
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Storage of image data
+/// Buffers are allocated with IBufferAllocator::GetDefault() (64-byte aligned by default),
+/// unless allocator is passed to the constructor / CreateEmpty
+///
+/// Note: Image2d::GetData() returns ImageBuffer<T> (not std::vector<T>),
+/// code that binds it to std::vector<T> & must use ImageBuffer<T> & (or auto &)
+/// or copy the data with std::vector<T>(d.begin(), d.end())
+/// </summary>
+template <typename T>
+using ImageBuffer = std::vector<T, MyUtils::StdBufferAllocator<T>>;
 
 template <typename T>
 class Image2d 
 {
 public:
-	
+	//source of channel filled with constant value (CreateWithChannels, ShuffleChannels)
+	static constexpr int CONSTANT_CHANNEL = -1;
+
 	static Image2d<T> CreateFromRawFile(int w, int h, ColorSpace::PixelFormat pf, const char * fileName);
 	static Image2d<T> CreateWithSingleValue(int w, int h, const T * value, ColorSpace::PixelFormat pf);
 	
 
 	Image2d();		
 	Image2d(const char * fileName);	
-	Image2d(int w, int h, ColorSpace::PixelFormat pf);	
-	Image2d(int w, int h, const std::vector<T> & data, ColorSpace::PixelFormat pf);
+	Image2d(int w, int h, ColorSpace::PixelFormat pf,
+		ImageUtils::DataLayout layout = ImageUtils::DataLayout::INTERLEAVED,
+		ImageUtils::InitMode init = ImageUtils::InitMode::ZERO,
+		MyUtils::IBufferAllocator * allocator = nullptr);
+	Image2d(int w, int h, const std::vector<T> & data, ColorSpace::PixelFormat pf,
+		ImageUtils::DataLayout layout = ImageUtils::DataLayout::INTERLEAVED);
 	Image2d(int w, int h, const T * rawData, ColorSpace::PixelFormat pf);
 	Image2d(int w, int h, const T ** rawData, ColorSpace::PixelFormat pf);
-	Image2d(int w, int h, std::vector<T> && data, ColorSpace::PixelFormat pf);
+	Image2d(int w, int h, std::vector<T> && data, ColorSpace::PixelFormat pf,
+		ImageUtils::DataLayout layout = ImageUtils::DataLayout::INTERLEAVED);
+	Image2d(int w, int h, ImageBuffer<T> && data, ColorSpace::PixelFormat pf,
+		ImageUtils::DataLayout layout = ImageUtils::DataLayout::INTERLEAVED);
 	Image2d(const Image2d<T> & other);
 	Image2d(Image2d<T> && other) noexcept;
+	template <typename E>
+	Image2d(const ImageExpression<E> & expr);
 #ifdef HAVE_OPENCV
 	Image2d(const cv::Mat & cvMat);
 #endif
@@ -43,17 +84,41 @@ public:
 
 	Image2d<T> & operator=(const Image2d<T> & other);
 	Image2d<T> & operator=(Image2d<T> && other) noexcept;
+	template <typename E>
+	Image2d<T> & operator=(const ImageExpression<E> & expr);
 
 	template <typename V = T>
-	Image2d<V> CreateEmpty() const;
+	Image2d<V> CreateEmpty(MyUtils::IBufferAllocator * allocator = nullptr) const;
 	Image2d<T> CreateDeepCopy() const;
 	Image2d<T> CreateFromChannel(size_t channelIndex) const;
+	Image2d<T> CreateWithChannels(const std::vector<int> & sources, T constant = T(0)) const;
 	Image2d<T> CreateSubImage(int x, int y, const ImageDimension & size) const;
 	Image2d<T> CreateWithBorder(int w, int h) const;
+	Image2d<T> CreateWithBorder(int left, int top, int right, int bottom,
+		ImageUtils::BorderMode border) const;
+	Image2d<T> CreateConvolved(const NeighborhoodKernel & kernel, ImageUtils::BorderMode border) const;
+	Image2d<T> CreateMorphology(ImageUtils::MorphologyOperation op, ImageUtils::StructuringElement shape,
+		int radiusX, int radiusY, ImageUtils::BorderMode border = ImageUtils::BorderMode::CLAMP) const;
+	IntegralImage<T> CreateIntegralImage(bool withSquares = false) const;
+	Image2d<T> CreateResized(const ImageDimension & size,
+		ImageUtils::ResampleMode mode = ImageUtils::ResampleMode::BILINEAR) const;
+	Image2d<T> CreateTransformed(ImageUtils::GeometricTransform t) const;
+	ImagePyramid<T> CreatePyramid(ImageUtils::PyramidFilter filter, size_t maxLevelsCount = 0) const;
+	Image2d<T> CreateWithLayout(ImageUtils::DataLayout layout) const;
+	Image2d<T> CreateWithPixelFormat(ColorSpace::PixelFormat pf) const;
+
+	Image2dView<T> CreateView();
+	Image2dView<const T> CreateView() const;
+	Image2dView<T> CreateView(int x, int y, const ImageDimension & size);
+	Image2dView<const T> CreateView(int x, int y, const ImageDimension & size) const;
 
 	template <typename V>
 	Image2d<V> CreateAs() const;
 
+	Image2d<T> CreateFromChannelParallel(size_t channelIndex, size_t grainRows = 0) const;
+	template <typename V>
+	Image2d<V> CreateAsParallel(size_t grainRows = 0) const;
+
 	
 #ifdef HAVE_OPENCV
 	cv::Mat CreateOpenCVLightCopy();
@@ -61,11 +126,21 @@ public:
 #endif
 	
 	void SetPixelFormat(ColorSpace::PixelFormat pf) noexcept;
+	void SetLayout(ImageUtils::DataLayout layout);
+	void ApplyLookupTable(const LookupTable & lut);
+	void ApplyTransform(ImageUtils::GeometricTransform t);
+	void Premultiply();
+	void Unpremultiply();
 	
 	void Save(const char * fileName) const;
 
 	ColorSpace::PixelFormat GetPixelFormat() const noexcept;
 	size_t GetChannelsCount() const noexcept;
+	ImageUtils::DataLayout GetLayout() const noexcept;
+	size_t GetChannelStride() const noexcept;
+	size_t GetPixelStride() const noexcept;
+	size_t GetPlanesCount() const noexcept;
+	size_t GetPlaneChannelsCount() const noexcept;
 	
 
 	int GetWidth() const noexcept;
@@ -84,6 +159,9 @@ public:
 
 	void FindMinMax(size_t channelIndex, T & min, T & max) const;
 	T CalcAvgValue(size_t channelIndex) const;
+	void FindMinMaxParallel(size_t channelIndex, T & min, T & max, size_t grainRows = 0) const;
+	T CalcAvgValueParallel(size_t channelIndex, size_t grainRows = 0) const;
+	ImageHistogram<T> CreateHistogram(const Image2d<uint8_t> * mask = nullptr) const;
 
 	const T * GetPixelStart(size_t index) const;
 	const T * GetPixelStart(int x, int y) const;
@@ -92,19 +170,48 @@ public:
 	T * GetPixelStart(int x, int y);
 	const T * operator[](size_t index) const;
 	T * operator[](size_t index);
+	const T * GetChannelStart(size_t channelIndex) const;
+	T * GetChannelStart(size_t channelIndex);
+	const T * GetPlaneStart(size_t planeIndex) const;
+	T * GetPlaneStart(size_t planeIndex);
 
-	const std::vector<T> & GetData() const noexcept;
-	std::vector<T> & GetData() noexcept;
+	const ImageBuffer<T> & GetData() const noexcept;
+	ImageBuffer<T> & GetData() noexcept;
 		
-	void ForEachPixel(std::function<void(T *, size_t)> callback);
-	void ForEachPixel(std::function<void(const T *, size_t)> callback) const;
+	template <typename Func>
+	void ForEachPixel(Func && callback);
+	template <typename Func>
+	void ForEachPixel(Func && callback) const;
+	template <typename Func>
+	void ForEachPixelPosition(Func && callback);
+	template <typename Func>
+	void ForEachPixelPosition(Func && callback) const;
+	template <typename Func>
+	void ForEachRow(Func && callback);
+	template <typename Func>
+	void ForEachRow(Func && callback) const;
+
+	template <typename Func>
+	void ForEachPixelParallel(Func && callback, size_t grainRows = 0);
+	template <typename Func>
+	void ForEachPixelParallel(Func && callback, size_t grainRows = 0) const;
+	template <typename Func>
+	void ForEachRowParallel(Func && callback, size_t grainRows = 0);
+	template <typename Func>
+	void ForEachRowParallel(Func && callback, size_t grainRows = 0) const;
 
 	
 
 	void Abs();	
-	void Combine(const Image2d<T> & img, std::function<void(T *, const T *, size_t size)> callback);
+	template <typename Func>
+	void Combine(const Image2d<T> & img, Func && callback);
+	template <typename Func>
+	void CombineRows(const Image2d<T> & img, Func && callback);
+	template <typename Func>
+	void CombineParallel(const Image2d<T> & img, Func && callback, size_t grainRows = 0);
 	void AppendRight(const Image2d<T> & img);
 	void SetSubImage(int x, int y, const Image2d<T>& img);
+	void BlendOver(int x, int y, const Image2d<T>& img);
 	void SetValue(double tmp, size_t channel, size_t index);
 	void SetValue(double tmp, size_t channel, int x, int y);
 	void SetValue(T value, size_t channel, size_t index);
@@ -112,6 +219,7 @@ public:
 
 	void Clear(T clearValue = T(0));
 	void SwapChannels(size_t c0, size_t c1);
+	void ShuffleChannels(const std::vector<int> & sources, T constant = T(0));
 	void AddChannels(size_t count);
 		
 #ifdef HAVE_OPENCV
@@ -125,14 +233,349 @@ public:
     //We have to create Image2d friend with itself
     //so we can access protected members of float from uint8_t and vice versa
     template<typename> friend class Image2d;
+    template<typename> friend class Image2dView;
+    template<typename, size_t> friend class Image2dFixed;
     
 protected:	
+	//minimal number of values processed by single parallel task (if grain is not set)
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+
 	ImageDimension dim;
-	std::vector<T> data;
+	ImageBuffer<T> data;
 	ColorSpace::PixelFormat pf;	
 	size_t channelsCount;
+	ImageUtils::DataLayout layout;
+
+	size_t GetParallelGrainRows(size_t grainRows) const noexcept;
 
+	bool IsChannelsShuffleValid(const std::vector<int> & sources) const;
+	ColorSpace::PixelFormat GetShuffledPixelFormat(size_t channelsCount) const noexcept;
+	void ShuffleChannelsTo(T * output, const std::vector<int> & sources, T constant, size_t grainRows) const;
 };
 
 
+//=================================================================================================
+// Iteration methods
+// - defined in header, so callback can be inlined
+//=================================================================================================
+
+/// <summary>
+/// Call callback(T * px, size_t index) for each pixel
+/// For planar layout, channels of pixel are GetChannelStride() apart
+/// </summary>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachPixel(Func && callback)
+{
+	const size_t len = this->GetPixelsCount();
+	const size_t stride = this->GetPixelStride();
+	T * px = this->data.data();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		callback(px + i * stride, i);
+	}
+}
+
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachPixel(Func && callback) const
+{
+	const size_t len = this->GetPixelsCount();
+	const size_t stride = this->GetPixelStride();
+	const T * px = this->data.data();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		callback(px + i * stride, i);
+	}
+}
+
+/// <summary>
+/// Call callback(T * px, int x, int y) for each pixel
+/// </summary>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachPixelPosition(Func && callback)
+{
+	const size_t stride = this->GetPixelStride();
+	T * px = this->data.data();
+
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		for (int x = 0; x < this->dim.w; x++)
+		{
+			callback(px, x, y);
+			px += stride;
+		}
+	}
+}
+
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachPixelPosition(Func && callback) const
+{
+	const size_t stride = this->GetPixelStride();
+	const T * px = this->data.data();
+
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		for (int x = 0; x < this->dim.w; x++)
+		{
+			callback(px, x, y);
+			px += stride;
+		}
+	}
+}
+
+/// <summary>
+/// Call callback(T * row, int y) for each row
+/// For interleaved layout, row is contiguous range of GetWidth() * GetChannelsCount() values.
+/// For planar layout, row points to the first channel,
+/// other channels are GetChannelStride() apart
+/// </summary>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachRow(Func && callback)
+{
+	const size_t rowStride = size_t(this->dim.w) * this->GetPixelStride();
+	T * row = this->data.data();
+
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		callback(row, y);
+		row += rowStride;
+	}
+}
+
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachRow(Func && callback) const
+{
+	const size_t rowStride = size_t(this->dim.w) * this->GetPixelStride();
+	const T * row = this->data.data();
+
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		callback(row, y);
+		row += rowStride;
+	}
+}
+
+/// <summary>
+/// Combine current image and input img
+/// for each pixel, callback(T * a, const T * b, size_t channelsCount) is called 
+/// with user defined combination
+/// Result can be written to a in callback (a = this)
+/// Both images must have same layout and size
+/// </summary>
+/// <param name="img"></param>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::Combine(const Image2d<T> & img, Func && callback)
+{
+	if (this->layout != img.layout)
+	{
+		MY_LOG_ERROR("Layout of combined image is not same");
+		return;
+	}
+
+	if (this->data.size() != img.data.size())
+	{
+		MY_LOG_ERROR("Size of combined image is not same");
+		return;
+	}
+
+	const size_t len = this->GetPixelsCount();
+	const size_t stride = this->GetPixelStride();
+	const size_t chanCount = this->channelsCount;
+	T * a = this->data.data();
+	const T * b = img.data.data();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		callback(a + i * stride, b + i * stride, chanCount);
+	}
+}
+
+/// <summary>
+/// Combine current image and input img row by row
+/// for each row, callback(T * a, const T * b, int y) is called,
+/// rows are same as in ForEachRow
+/// Both images must have same layout and size
+/// </summary>
+/// <param name="img"></param>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::CombineRows(const Image2d<T> & img, Func && callback)
+{
+	if (this->layout != img.layout)
+	{
+		MY_LOG_ERROR("Layout of combined image is not same");
+		return;
+	}
+
+	if (this->data.size() != img.data.size())
+	{
+		MY_LOG_ERROR("Size of combined image is not same");
+		return;
+	}
+
+	const size_t rowStride = size_t(this->dim.w) * this->GetPixelStride();
+	T * a = this->data.data();
+	const T * b = img.data.data();
+
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		callback(a, b, y);
+		a += rowStride;
+		b += rowStride;
+	}
+}
+
+
+//=================================================================================================
+// Parallel iteration methods
+// - image is split into bands of grainRows rows, bands are processed
+//   by the shared MyUtils::ThreadPool
+// - if grainRows is 0, bands have at least PARALLEL_MIN_TASK_SIZE values
+//=================================================================================================
+
+template <typename T>
+size_t Image2d<T>::GetParallelGrainRows(size_t grainRows) const noexcept
+{
+	if (grainRows != 0)
+	{
+		return grainRows;
+	}
+
+	size_t rowSize = size_t(this->dim.w) * this->channelsCount;
+	if (rowSize == 0)
+	{
+		return 1;
+	}
+	return (PARALLEL_MIN_TASK_SIZE + rowSize - 1) / rowSize;
+}
+
+/// <summary>
+/// Parallel version of ForEachPixel
+/// Callback is called from multiple threads at once
+/// </summary>
+/// <param name="callback"></param>
+/// <param name="grainRows"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachPixelParallel(Func && callback, size_t grainRows)
+{
+	const size_t w = size_t(this->dim.w);
+	const size_t stride = this->GetPixelStride();
+	T * px = this->data.data();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(this->dim.h), this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		for (size_t i = y0 * w; i < y1 * w; i++)
+		{
+			callback(px + i * stride, i);
+		}
+	});
+}
+
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachPixelParallel(Func && callback, size_t grainRows) const
+{
+	const size_t w = size_t(this->dim.w);
+	const size_t stride = this->GetPixelStride();
+	const T * px = this->data.data();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(this->dim.h), this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		for (size_t i = y0 * w; i < y1 * w; i++)
+		{
+			callback(px + i * stride, i);
+		}
+	});
+}
+
+/// <summary>
+/// Parallel version of ForEachRow
+/// Callback is called from multiple threads at once
+/// </summary>
+/// <param name="callback"></param>
+/// <param name="grainRows"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachRowParallel(Func && callback, size_t grainRows)
+{
+	const size_t rowStride = size_t(this->dim.w) * this->GetPixelStride();
+	T * px = this->data.data();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(this->dim.h), this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; y++)
+		{
+			callback(px + y * rowStride, int(y));
+		}
+	});
+}
+
+template <typename T>
+template <typename Func>
+void Image2d<T>::ForEachRowParallel(Func && callback, size_t grainRows) const
+{
+	const size_t rowStride = size_t(this->dim.w) * this->GetPixelStride();
+	const T * px = this->data.data();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(this->dim.h), this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; y++)
+		{
+			callback(px + y * rowStride, int(y));
+		}
+	});
+}
+
+/// <summary>
+/// Parallel version of Combine
+/// Callback is called from multiple threads at once
+/// </summary>
+/// <param name="img"></param>
+/// <param name="callback"></param>
+/// <param name="grainRows"></param>
+template <typename T>
+template <typename Func>
+void Image2d<T>::CombineParallel(const Image2d<T> & img, Func && callback, size_t grainRows)
+{
+	if (this->layout != img.layout)
+	{
+		MY_LOG_ERROR("Layout of combined image is not same");
+		return;
+	}
+
+	if (this->data.size() != img.data.size())
+	{
+		MY_LOG_ERROR("Size of combined image is not same");
+		return;
+	}
+
+	const size_t w = size_t(this->dim.w);
+	const size_t stride = this->GetPixelStride();
+	const size_t chanCount = this->channelsCount;
+	T * a = this->data.data();
+	const T * b = img.data.data();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(this->dim.h), this->GetParallelGrainRows(grainRows),
+		[&](size_t y0, size_t y1) {
+		for (size_t i = y0 * w; i < y1 * w; i++)
+		{
+			callback(a + i * stride, b + i * stride, chanCount);
+		}
+	});
+}
+
 #endif
@@ -0,0 +1,193 @@
+#include "./Image2dFixed.h"
+
+#include <algorithm>
+
+#include "../Utils/Logger.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+/// <summary>
+/// Create empty image with size 0
+/// </summary>
+template <typename T, size_t C>
+Image2dFixed<T, C>::Image2dFixed() :
+	img()
+{
+}
+
+/// <summary>
+/// Create image with size w x h and given pixel format
+/// Pixel format must have C channels
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pf"></param>
+/// <param name="init"></param>
+template <typename T, size_t C>
+Image2dFixed<T, C>::Image2dFixed(int w, int h, ColorSpace::PixelFormat pf, ImageUtils::InitMode init) :
+	img()
+{
+	if (ColorSpace::GetChannelsCount(pf) != C)
+	{
+		MY_LOG_ERROR("Pixel format has %zu channels, %zu expected", ColorSpace::GetChannelsCount(pf), C);
+		return;
+	}
+
+	this->img = Image2d<T>(w, h, pf, ImageUtils::DataLayout::INTERLEAVED, init);
+}
+
+/// <summary>
+/// Take data of dynamic image (no copy)
+/// Image must be INTERLEAVED and have C channels,
+/// otherwise error is logged and result is empty
+/// </summary>
+/// <param name="img"></param>
+template <typename T, size_t C>
+Image2dFixed<T, C>::Image2dFixed(Image2d<T> && img) :
+	img()
+{
+	if (img.GetChannelsCount() != C)
+	{
+		MY_LOG_ERROR("Image has %zu channels, %zu expected", img.GetChannelsCount(), C);
+		return;
+	}
+
+	if ((img.GetLayout() != ImageUtils::DataLayout::INTERLEAVED) && (C > 1))
+	{
+		MY_LOG_ERROR("Only INTERLEAVED layout is supported");
+		return;
+	}
+
+	this->img = std::move(img);
+	this->img.layout = ImageUtils::DataLayout::INTERLEAVED;
+}
+
+//=================================================================================================
+// Conversions
+//=================================================================================================
+
+/// <summary>
+/// Move data to dynamic image (no copy)
+/// Current image is empty after the call
+/// </summary>
+/// <returns></returns>
+template <typename T, size_t C>
+Image2d<T> Image2dFixed<T, C>::MoveToDynamic()
+{
+	return std::move(this->img);
+}
+
+/// <summary>
+/// Get underlying dynamic image
+/// (for read-only use of Image2d<T> methods)
+/// </summary>
+/// <returns></returns>
+template <typename T, size_t C>
+const Image2d<T> & Image2dFixed<T, C>::GetImage() const noexcept
+{
+	return this->img;
+}
+
+//=================================================================================================
+// Creators
+//=================================================================================================
+
+/// <summary>
+/// Create new image from the current image by adding empty
+/// border with size w and h around the image
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <returns></returns>
+template <typename T, size_t C>
+Image2dFixed<T, C> Image2dFixed<T, C>::CreateWithBorder(int w, int h) const
+{
+	Image2dFixed<T, C> newImage;
+	newImage.img.dim = { this->GetWidth() + 2 * w, this->GetHeight() + 2 * h };
+	newImage.img.pf = this->GetPixelFormat();
+	newImage.img.channelsCount = C;
+	newImage.img.data.resize(newImage.GetPixelsCount() * C, T(0));
+
+	for (int y = 0; y < this->GetHeight(); y++)
+	{
+		const T * row = this->GetRowStart(y);
+		std::copy(row, row + size_t(this->GetWidth()) * C, newImage.GetPixelStart(w, y + h));
+	}
+
+	return newImage;
+}
+
+template <typename T, size_t C>
+Image2dView<T> Image2dFixed<T, C>::CreateView()
+{
+	return this->img.CreateView();
+}
+
+template <typename T, size_t C>
+Image2dView<const T> Image2dFixed<T, C>::CreateView() const
+{
+	return this->img.CreateView();
+}
+
+template <typename T, size_t C>
+Image2dView<T> Image2dFixed<T, C>::CreateView(int x, int y, const ImageDimension & size)
+{
+	return this->img.CreateView(x, y, size);
+}
+
+template <typename T, size_t C>
+Image2dView<const T> Image2dFixed<T, C>::CreateView(int x, int y, const ImageDimension & size) const
+{
+	return this->img.CreateView(x, y, size);
+}
+
+template <typename T, size_t C>
+void Image2dFixed<T, C>::Save(const char * fileName) const
+{
+	this->img.Save(fileName);
+}
+
+//=================================================================================================
+// Methods
+//=================================================================================================
+
+/// <summary>
+/// Insert subimage at position given by top left corner [x, y]
+/// Part of subimage outside of the current image is skipped
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="img"></param>
+template <typename T, size_t C>
+void Image2dFixed<T, C>::SetSubImage(int x, int y, const Image2dFixed<T, C> & img)
+{
+	int startX = std::max(0, x);
+	int startY = std::max(0, y);
+	int endX = std::min(x + img.GetWidth(), this->GetWidth());
+	int endY = std::min(y + img.GetHeight(), this->GetHeight());
+
+	if ((startX >= endX) || (startY >= endY))
+	{
+		return;
+	}
+
+	for (int yy = startY; yy < endY; yy++)
+	{
+		const T * src = img.GetPixelStart(startX - x, yy - y);
+		std::copy(src, src + size_t(endX - startX) * C, this->GetPixelStart(startX, yy));
+	}
+}
+
+//=================================================================================================
+
+template class Image2dFixed<uint8_t, 1>;
+template class Image2dFixed<uint8_t, 2>;
+template class Image2dFixed<uint8_t, 3>;
+template class Image2dFixed<uint8_t, 4>;
+
+template class Image2dFixed<float, 1>;
+template class Image2dFixed<float, 2>;
+template class Image2dFixed<float, 3>;
+template class Image2dFixed<float, 4>;
@@ -0,0 +1,212 @@
+#ifndef IMAGE_2D_FIXED_H
+#define IMAGE_2D_FIXED_H
+
+#include "./Image2d.h"
+
+/// <summary>
+/// Interleaved image with number of channels known at compile time
+/// Per-pixel loops have constant trip count, so compiler can unroll
+/// and vectorize them.
+///
+/// Image2dFixed owns Image2d<T>. Conversion from / to Image2d<T>
+/// moves the data (no copy). Only INTERLEAVED layout is supported.
+/// </summary>
+template <typename T, size_t C>
+class Image2dFixed
+{
+public:
+	static_assert(C > 0, "Channels count must be positive");
+
+	static const size_t CHANNELS_COUNT = C;
+
+	Image2dFixed();
+	Image2dFixed(int w, int h, ColorSpace::PixelFormat pf,
+		ImageUtils::InitMode init = ImageUtils::InitMode::ZERO);
+	explicit Image2dFixed(Image2d<T> && img);
+
+	Image2d<T> MoveToDynamic();
+	const Image2d<T> & GetImage() const noexcept;
+
+	Image2dFixed<T, C> CreateWithBorder(int w, int h) const;
+
+	Image2dView<T> CreateView();
+	Image2dView<const T> CreateView() const;
+	Image2dView<T> CreateView(int x, int y, const ImageDimension & size);
+	Image2dView<const T> CreateView(int x, int y, const ImageDimension & size) const;
+
+	void Save(const char * fileName) const;
+
+	ColorSpace::PixelFormat GetPixelFormat() const noexcept;
+	static constexpr size_t GetChannelsCount() noexcept { return C; }
+
+	int GetWidth() const noexcept;
+	int GetHeight() const noexcept;
+	size_t GetPixelsCount() const noexcept;
+	const ImageDimension & GetDimension() const noexcept;
+
+	const T * GetPixelStart(size_t index) const noexcept;
+	const T * GetPixelStart(int x, int y) const noexcept;
+	T * GetPixelStart(size_t index) noexcept;
+	T * GetPixelStart(int x, int y) noexcept;
+	const T * GetRowStart(int y) const noexcept;
+	T * GetRowStart(int y) noexcept;
+
+	template <typename Func>
+	void ForEachPixel(Func && callback);
+	template <typename Func>
+	void ForEachPixel(Func && callback) const;
+	template <typename Func>
+	void ForEachRow(Func && callback);
+	template <typename Func>
+	void ForEachRow(Func && callback) const;
+
+	void SetPixel(int x, int y, const T * value) noexcept;
+	void SetSubImage(int x, int y, const Image2dFixed<T, C> & img);
+
+protected:
+	Image2d<T> img;
+};
+
+//=================================================================================================
+// Inlined accessors
+//=================================================================================================
+
+template <typename T, size_t C>
+inline ColorSpace::PixelFormat Image2dFixed<T, C>::GetPixelFormat() const noexcept
+{
+	return this->img.pf;
+}
+
+template <typename T, size_t C>
+inline int Image2dFixed<T, C>::GetWidth() const noexcept
+{
+	return this->img.dim.w;
+}
+
+template <typename T, size_t C>
+inline int Image2dFixed<T, C>::GetHeight() const noexcept
+{
+	return this->img.dim.h;
+}
+
+template <typename T, size_t C>
+inline size_t Image2dFixed<T, C>::GetPixelsCount() const noexcept
+{
+	return size_t(this->img.dim.w) * size_t(this->img.dim.h);
+}
+
+template <typename T, size_t C>
+inline const ImageDimension & Image2dFixed<T, C>::GetDimension() const noexcept
+{
+	return this->img.dim;
+}
+
+template <typename T, size_t C>
+inline const T * Image2dFixed<T, C>::GetPixelStart(size_t index) const noexcept
+{
+	return this->img.data.data() + index * C;
+}
+
+template <typename T, size_t C>
+inline const T * Image2dFixed<T, C>::GetPixelStart(int x, int y) const noexcept
+{
+	return this->GetPixelStart(size_t(x) + size_t(y) * size_t(this->img.dim.w));
+}
+
+template <typename T, size_t C>
+inline T * Image2dFixed<T, C>::GetPixelStart(size_t index) noexcept
+{
+	return this->img.data.data() + index * C;
+}
+
+template <typename T, size_t C>
+inline T * Image2dFixed<T, C>::GetPixelStart(int x, int y) noexcept
+{
+	return this->GetPixelStart(size_t(x) + size_t(y) * size_t(this->img.dim.w));
+}
+
+template <typename T, size_t C>
+inline const T * Image2dFixed<T, C>::GetRowStart(int y) const noexcept
+{
+	return this->GetPixelStart(size_t(y) * size_t(this->img.dim.w));
+}
+
+template <typename T, size_t C>
+inline T * Image2dFixed<T, C>::GetRowStart(int y) noexcept
+{
+	return this->GetPixelStart(size_t(y) * size_t(this->img.dim.w));
+}
+
+/// <summary>
+/// Set all channels of pixel [x, y]
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="value">C values</param>
+template <typename T, size_t C>
+inline void Image2dFixed<T, C>::SetPixel(int x, int y, const T * value) noexcept
+{
+	T * px = this->GetPixelStart(x, y);
+	for (size_t c = 0; c < C; c++)
+	{
+		px[c] = value[c];
+	}
+}
+
+/// <summary>
+/// Call callback(T * px, size_t index) for each pixel
+/// Pixels are C values apart
+/// </summary>
+/// <param name="callback"></param>
+template <typename T, size_t C>
+template <typename Func>
+inline void Image2dFixed<T, C>::ForEachPixel(Func && callback)
+{
+	const size_t len = this->GetPixelsCount();
+	T * px = this->img.data.data();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		callback(px + i * C, i);
+	}
+}
+
+template <typename T, size_t C>
+template <typename Func>
+inline void Image2dFixed<T, C>::ForEachPixel(Func && callback) const
+{
+	const size_t len = this->GetPixelsCount();
+	const T * px = this->img.data.data();
+
+	for (size_t i = 0; i < len; i++)
+	{
+		callback(px + i * C, i);
+	}
+}
+
+/// <summary>
+/// Call callback(T * row, int y) for each row
+/// Row is contiguous range of GetWidth() * C values
+/// </summary>
+/// <param name="callback"></param>
+template <typename T, size_t C>
+template <typename Func>
+inline void Image2dFixed<T, C>::ForEachRow(Func && callback)
+{
+	for (int y = 0; y < this->img.dim.h; y++)
+	{
+		callback(this->GetRowStart(y), y);
+	}
+}
+
+template <typename T, size_t C>
+template <typename Func>
+inline void Image2dFixed<T, C>::ForEachRow(Func && callback) const
+{
+	for (int y = 0; y < this->img.dim.h; y++)
+	{
+		callback(this->GetRowStart(y), y);
+	}
+}
+
+#endif
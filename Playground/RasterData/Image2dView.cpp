@@ -0,0 +1,281 @@
+#include "./Image2dView.h"
+
+#include <algorithm>
+
+#include "./Image2d.h"
+
+#include "../Utils/Logger.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+template <typename T>
+Image2dView<T>::Image2dView() :
+	data(nullptr),
+	dim({ 0, 0 }),
+	pf(ColorSpace::PixelFormat::NONE),
+	channelsCount(0),
+	layout(ImageUtils::DataLayout::INTERLEAVED),
+	rowStride(0),
+	pixelStride(0),
+	channelStride(0)
+{
+}
+
+/// <summary>
+/// Create view to existing memory
+/// All strides are in elements (not bytes)
+/// </summary>
+/// <param name="data">first element of pixel [0, 0]</param>
+/// <param name="dim"></param>
+/// <param name="pf"></param>
+/// <param name="channelsCount"></param>
+/// <param name="layout"></param>
+/// <param name="rowStride"></param>
+/// <param name="pixelStride"></param>
+/// <param name="channelStride"></param>
+template <typename T>
+Image2dView<T>::Image2dView(T * data, const ImageDimension & dim,
+	ColorSpace::PixelFormat pf, size_t channelsCount, ImageUtils::DataLayout layout,
+	size_t rowStride, size_t pixelStride, size_t channelStride) :
+	data(data),
+	dim(dim),
+	pf(pf),
+	channelsCount(channelsCount),
+	layout(layout),
+	rowStride(rowStride),
+	pixelStride(pixelStride),
+	channelStride(channelStride)
+{
+}
+
+//=================================================================================================
+// Factories
+//=================================================================================================
+
+/// <summary>
+/// Create view to the part of the current view
+/// sub-view starts at [x, y] and has given size
+/// Region is clipped to the current view
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="size"></param>
+/// <returns></returns>
+template <typename T>
+Image2dView<T> Image2dView<T>::CreateSubView(int x, int y, const ImageDimension & size) const
+{
+	int startX = std::clamp(x, 0, this->GetWidth());
+	int startY = std::clamp(y, 0, this->GetHeight());
+	int endX = std::clamp(x + size.w, startX, this->GetWidth());
+	int endY = std::clamp(y + size.h, startY, this->GetHeight());
+
+	Image2dView<T> view = *this;
+	view.dim = { endX - startX, endY - startY };
+	if ((view.dim.w > 0) && (view.dim.h > 0))
+	{
+		view.data = this->GetPixelStart(startX, startY);
+	}
+	return view;
+}
+
+/// <summary>
+/// Create new image with deep copy of the view data
+/// Image has the same layout as the image the view points to
+/// </summary>
+/// <returns></returns>
+template <typename T>
+Image2d<typename Image2dView<T>::ValueType> Image2dView<T>::CreateImage() const
+{
+	Image2d<ValueType> img;
+	img.dim = this->dim;
+	img.pf = this->pf;
+	img.channelsCount = this->channelsCount;
+	img.layout = this->layout;
+	img.data.resize(this->GetPixelsCount() * this->channelsCount);
+
+	img.CreateView().CopyFrom(*this);
+
+	return img;
+}
+
+/// <summary>
+/// Save view to file
+/// Data are copied to temporary image first
+/// </summary>
+/// <param name="fileName"></param>
+template <typename T>
+void Image2dView<T>::Save(const char * fileName) const
+{
+	this->CreateImage().Save(fileName);
+}
+
+//=================================================================================================
+// Getters
+//=================================================================================================
+
+template <typename T>
+ColorSpace::PixelFormat Image2dView<T>::GetPixelFormat() const noexcept
+{
+	return this->pf;
+}
+
+template <typename T>
+size_t Image2dView<T>::GetChannelsCount() const noexcept
+{
+	return this->channelsCount;
+}
+
+template <typename T>
+ImageUtils::DataLayout Image2dView<T>::GetLayout() const noexcept
+{
+	return this->layout;
+}
+
+template <typename T>
+int Image2dView<T>::GetWidth() const noexcept
+{
+	return this->dim.w;
+}
+
+template <typename T>
+int Image2dView<T>::GetHeight() const noexcept
+{
+	return this->dim.h;
+}
+
+template <typename T>
+size_t Image2dView<T>::GetPixelsCount() const noexcept
+{
+	return size_t(this->dim.w) * size_t(this->dim.h);
+}
+
+template <typename T>
+const ImageDimension & Image2dView<T>::GetDimension() const noexcept
+{
+	return this->dim;
+}
+
+template <typename T>
+size_t Image2dView<T>::GetRowStride() const noexcept
+{
+	return this->rowStride;
+}
+
+template <typename T>
+size_t Image2dView<T>::GetPixelStride() const noexcept
+{
+	return this->pixelStride;
+}
+
+template <typename T>
+size_t Image2dView<T>::GetChannelStride() const noexcept
+{
+	return this->channelStride;
+}
+
+/// <summary>
+/// Get pointer to the first channel of pixel [x, y] (in view coordinates)
+/// Other channels are GetChannelStride() apart
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <returns></returns>
+template <typename T>
+T * Image2dView<T>::GetPixelStart(int x, int y) const noexcept
+{
+	return this->data + size_t(y) * this->rowStride + size_t(x) * this->pixelStride;
+}
+
+/// <summary>
+/// Get pointer to the first pixel of row y (in view coordinates)
+/// Pixels of row are GetPixelStride() apart
+/// </summary>
+/// <param name="y"></param>
+/// <returns></returns>
+template <typename T>
+T * Image2dView<T>::GetRowStart(int y) const noexcept
+{
+	return this->data + size_t(y) * this->rowStride;
+}
+
+//=================================================================================================
+// Methods
+//=================================================================================================
+
+/// <summary>
+/// Copy data from src view to the current view
+/// Only the overlapping part (top left corner) and common channels are copied.
+/// Views may have different layouts.
+/// Views must not overlap
+/// </summary>
+/// <param name="src"></param>
+template <typename T>
+void Image2dView<T>::CopyFrom(const Image2dView<const ValueType> & src) const
+{
+	if constexpr (std::is_const<T>::value)
+	{
+		MY_LOG_ERROR("Unable to copy to read-only view");
+	}
+	else
+	{
+		const int w = std::min(this->GetWidth(), src.GetWidth());
+		const int h = std::min(this->GetHeight(), src.GetHeight());
+		const size_t chanCount = std::min(this->channelsCount, src.channelsCount);
+
+		if ((w <= 0) || (h <= 0))
+		{
+			return;
+		}
+
+		if ((this->channelsCount == src.channelsCount) &&
+			(this->pixelStride == src.pixelStride) &&
+			(this->channelStride == 1) && (src.channelStride == 1))
+		{
+			//interleaved with same pixel size - copy whole rows
+			for (int y = 0; y < h; y++)
+			{
+				const ValueType * srcRow = src.GetRowStart(y);
+				std::copy(srcRow, srcRow + size_t(w) * src.pixelStride, this->GetRowStart(y));
+			}
+			return;
+		}
+
+		if ((this->pixelStride == 1) && (src.pixelStride == 1))
+		{
+			//planar - copy rows of each plane
+			for (size_t c = 0; c < chanCount; c++)
+			{
+				for (int y = 0; y < h; y++)
+				{
+					const ValueType * srcRow = src.GetRowStart(y) + c * src.channelStride;
+					std::copy(srcRow, srcRow + w, this->GetRowStart(y) + c * this->channelStride);
+				}
+			}
+			return;
+		}
+
+		for (int y = 0; y < h; y++)
+		{
+			T * px = this->GetRowStart(y);
+			const ValueType * srcPx = src.GetRowStart(y);
+			for (int x = 0; x < w; x++)
+			{
+				for (size_t c = 0; c < chanCount; c++)
+				{
+					px[c * this->channelStride] = srcPx[c * src.channelStride];
+				}
+				px += this->pixelStride;
+				srcPx += src.pixelStride;
+			}
+		}
+	}
+}
+
+//=================================================================================================
+
+template class Image2dView<uint8_t>;
+template class Image2dView<float>;
+template class Image2dView<const uint8_t>;
+template class Image2dView<const float>;
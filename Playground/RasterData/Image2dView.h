@@ -0,0 +1,157 @@
+#ifndef IMAGE_2D_VIEW_H
+#define IMAGE_2D_VIEW_H
+
+template <typename T>
+class Image2d;
+
+#include <type_traits>
+
+#include "./ImageUtils.h"
+#include "./ColorSpace.h"
+
+/// <summary>
+/// Non-owning view to rectangular part of Image2d
+/// View does not copy any data, it only points to the image memory
+/// - image must exist while the view is used
+/// - operations that reallocate image data (AddChannels, AppendRight, SetLayout...)
+///   invalidate the view
+///
+/// View behaves like a pointer - const view still allows to modify pixels.
+/// For read-only access use Image2dView<const T>
+/// </summary>
+template <typename T>
+class Image2dView
+{
+public:
+	typedef typename std::remove_const<T>::type ValueType;
+
+	Image2dView();
+	Image2dView(T * data, const ImageDimension & dim,
+		ColorSpace::PixelFormat pf, size_t channelsCount, ImageUtils::DataLayout layout,
+		size_t rowStride, size_t pixelStride, size_t channelStride);
+
+	/// <summary>
+	/// Create read-only view from writable view
+	/// </summary>
+	/// <param name="other"></param>
+	template <typename V,
+		typename = typename std::enable_if<std::is_same<const V, T>::value>::type>
+	Image2dView(const Image2dView<V> & other) :
+		data(other.data),
+		dim(other.dim),
+		pf(other.pf),
+		channelsCount(other.channelsCount),
+		layout(other.layout),
+		rowStride(other.rowStride),
+		pixelStride(other.pixelStride),
+		channelStride(other.channelStride)
+	{
+	}
+
+	Image2dView<T> CreateSubView(int x, int y, const ImageDimension & size) const;
+	Image2d<ValueType> CreateImage() const;
+
+	void Save(const char * fileName) const;
+
+	ColorSpace::PixelFormat GetPixelFormat() const noexcept;
+	size_t GetChannelsCount() const noexcept;
+	ImageUtils::DataLayout GetLayout() const noexcept;
+
+	int GetWidth() const noexcept;
+	int GetHeight() const noexcept;
+	size_t GetPixelsCount() const noexcept;
+	const ImageDimension & GetDimension() const noexcept;
+
+	size_t GetRowStride() const noexcept;
+	size_t GetPixelStride() const noexcept;
+	size_t GetChannelStride() const noexcept;
+
+	T * GetPixelStart(int x, int y) const noexcept;
+	T * GetRowStart(int y) const noexcept;
+
+	template <typename Func>
+	void ForEachPixel(Func && callback) const;
+	template <typename Func>
+	void ForEachPixelPosition(Func && callback) const;
+	template <typename Func>
+	void ForEachRow(Func && callback) const;
+
+	void CopyFrom(const Image2dView<const ValueType> & src) const;
+
+	template<typename> friend class Image2dView;
+
+protected:
+	T * data;		//first element of pixel [0, 0]
+	ImageDimension dim;
+	ColorSpace::PixelFormat pf;
+	size_t channelsCount;
+	ImageUtils::DataLayout layout;
+
+	size_t rowStride;		//distance between rows (in elements)
+	size_t pixelStride;		//distance between pixels in row (in elements)
+	size_t channelStride;	//distance between channels of pixel (in elements)
+};
+
+//=================================================================================================
+// Iteration methods
+// - defined in header, so callback can be inlined
+//=================================================================================================
+
+/// <summary>
+/// Call callback(T * px, size_t index) for each pixel
+/// Index is in view coordinates (x + y * view width)
+/// </summary>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2dView<T>::ForEachPixel(Func && callback) const
+{
+	size_t index = 0;
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		T * px = this->data + size_t(y) * this->rowStride;
+		for (int x = 0; x < this->dim.w; x++)
+		{
+			callback(px, index);
+			px += this->pixelStride;
+			index++;
+		}
+	}
+}
+
+/// <summary>
+/// Call callback(T * px, int x, int y) for each pixel
+/// Position is in view coordinates
+/// </summary>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2dView<T>::ForEachPixelPosition(Func && callback) const
+{
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		T * px = this->data + size_t(y) * this->rowStride;
+		for (int x = 0; x < this->dim.w; x++)
+		{
+			callback(px, x, y);
+			px += this->pixelStride;
+		}
+	}
+}
+
+/// <summary>
+/// Call callback(T * row, int y) for each row
+/// Pixels of row are GetPixelStride() apart
+/// </summary>
+/// <param name="callback"></param>
+template <typename T>
+template <typename Func>
+void Image2dView<T>::ForEachRow(Func && callback) const
+{
+	for (int y = 0; y < this->dim.h; y++)
+	{
+		callback(this->data + size_t(y) * this->rowStride, y);
+	}
+}
+
+#endif
@@ -0,0 +1,262 @@
+#include "./ImageConvolution.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Convolve image with kernel
+/// Each channel is filtered separately, output has the same format and layout as input
+/// </summary>
+/// <param name="img"></param>
+/// <param name="kernel"></param>
+/// <param name="border">how values outside of image are computed</param>
+/// <param name="stripRows">number of rows processed by one task
+/// (0 - computed from the kernel height)</param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> ImageConvolution::Convolve(const Image2d<T> & img, const NeighborhoodKernel & kernel,
+	ImageUtils::BorderMode border, size_t stripRows)
+{
+	if (kernel.IsValid() == false)
+	{
+		MY_LOG_ERROR("Invalid convolution kernel");
+		return Image2d<T>();
+	}
+
+	if ((img.GetWidth() == 0) || (img.GetHeight() == 0))
+	{
+		return img;
+	}
+
+	Image2d<T> padded = img.CreateWithBorder(kernel.anchorX, kernel.anchorY,
+		kernel.w - 1 - kernel.anchorX, kernel.h - 1 - kernel.anchorY, border);
+
+	Image2d<T> res(img.GetWidth(), img.GetHeight(), img.GetPixelFormat(), img.GetLayout(),
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	for (size_t p = 0; p < img.GetPlanesCount(); p++)
+	{
+		ConvolvePlane(padded.GetPlaneStart(p), res.GetPlaneStart(p),
+			img.GetWidth(), img.GetHeight(), img.GetPlaneChannelsCount(), kernel, stripRows);
+	}
+
+	return res;
+}
+
+/// <summary>
+/// Convolve single plane of interleaved data
+/// </summary>
+/// <param name="src">padded input (w + kernel.w - 1) x (h + kernel.h - 1)</param>
+/// <param name="dst">output w x h</param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="channelsCount"></param>
+/// <param name="kernel"></param>
+/// <param name="stripRows"></param>
+template <typename T>
+void ImageConvolution::ConvolvePlane(const T * src, T * dst, int w, int h, size_t channelsCount,
+	const NeighborhoodKernel & kernel, size_t stripRows)
+{
+	const size_t kh = size_t(kernel.h);
+
+	PlaneInfo info;
+	info.rowLen = size_t(w) * channelsCount;
+	info.srcRowLen = size_t(w + kernel.w - 1) * channelsCount;
+	info.channelsCount = channelsCount;
+
+	//ring buffer has 2 * kernel.h rows of tile
+	info.tileLen = TILE_BYTES / (2 * kh * sizeof(float));
+	info.tileLen = std::max<size_t>(64, info.tileLen - info.tileLen % 64);
+	info.tileLen = std::min(info.tileLen, info.rowLen);
+
+	if (stripRows == 0)
+	{
+		//each strip has to filter kernel.h - 1 rows of the next strip,
+		//keep this overhead small
+		stripRows = std::max(size_t(MIN_STRIP_ROWS), 4 * kh);
+	}
+
+	const bool separable = kernel.IsSeparable();
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(h), stripRows,
+		[&](size_t y0, size_t y1) {
+		if (separable)
+		{
+			ConvolveStripSeparable(src, dst, y0, y1, info, kernel);
+		}
+		else
+		{
+			ConvolveStrip(src, dst, y0, y1, info, kernel);
+		}
+	});
+}
+
+/// <summary>
+/// Compute output rows [y0, y1) with separable kernel
+/// Each input row of the tile is filtered horizontally to ring buffer.
+/// Row is stored twice (slot and slot + kernel.h), so the last kernel.h rows are
+/// always contiguous in the buffer and vertical pass can use fixed step.
+/// </summary>
+template <typename T>
+void ImageConvolution::ConvolveStripSeparable(const T * src, T * dst, size_t y0, size_t y1,
+	const PlaneInfo & info, const NeighborhoodKernel & kernel)
+{
+	const size_t kw = size_t(kernel.w);
+	const size_t kh = size_t(kernel.h);
+	const size_t c = info.channelsCount;
+	const size_t border = (kw - 1) * c;
+
+	std::vector<float> ring(2 * kh * info.tileLen);
+	std::vector<float> srcRow;
+	std::vector<float> outRow;
+	if constexpr (std::is_same<T, float>::value == false)
+	{
+		srcRow.resize(info.tileLen + border);
+		outRow.resize(info.tileLen);
+	}
+
+	for (size_t t0 = 0; t0 < info.rowLen; t0 += info.tileLen)
+	{
+		const size_t len = std::min(info.tileLen, info.rowLen - t0);
+
+		for (size_t r = y0; r < y1 + kh - 1; r++)
+		{
+			//horizontal pass
+			const float * in = LoadRow(src + r * info.srcRowLen + t0, len + border, srcRow.data());
+
+			const size_t slot = (r - y0) % kh;
+			float * tmp = ring.data() + slot * info.tileLen;
+			ImageKernels::ConvolveRow(in, len, c, kernel.rowValues.data(), kw, tmp, false);
+			std::copy(tmp, tmp + len, tmp + kh * info.tileLen);
+
+			if (r + 1 < y0 + kh)
+			{
+				continue;
+			}
+
+			//vertical pass - all input rows of output row y are ready
+			const size_t y = r + 1 - kh;
+			const float * first = ring.data() + ((y - y0) % kh) * info.tileLen;
+			T * out = dst + y * info.rowLen + t0;
+
+			if constexpr (std::is_same<T, float>::value)
+			{
+				ImageKernels::ConvolveRow(first, len, info.tileLen,
+					kernel.columnValues.data(), kh, out, false);
+			}
+			else
+			{
+				ImageKernels::ConvolveRow(first, len, info.tileLen,
+					kernel.columnValues.data(), kh, outRow.data(), false);
+				StoreRow(outRow.data(), out, len);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Compute output rows [y0, y1) with general 2D kernel
+/// Each output row is sum of horizontal convolutions of kernel.h input rows
+/// (uint8_t input rows are converted to float ring buffer of kernel.h rows)
+/// </summary>
+template <typename T>
+void ImageConvolution::ConvolveStrip(const T * src, T * dst, size_t y0, size_t y1,
+	const PlaneInfo & info, const NeighborhoodKernel & kernel)
+{
+	const size_t kw = size_t(kernel.w);
+	const size_t kh = size_t(kernel.h);
+	const size_t c = info.channelsCount;
+	const size_t srcLen = info.tileLen + (kw - 1) * c;
+
+	std::vector<float> ring;
+	std::vector<float> outRow(info.tileLen);
+	if constexpr (std::is_same<T, float>::value == false)
+	{
+		ring.resize(kh * srcLen);
+	}
+
+	for (size_t t0 = 0; t0 < info.rowLen; t0 += info.tileLen)
+	{
+		const size_t len = std::min(info.tileLen, info.rowLen - t0);
+
+		for (size_t r = y0; r < y1 + kh - 1; r++)
+		{
+			if constexpr (std::is_same<T, float>::value == false)
+			{
+				ImageKernels::Convert(src + r * info.srcRowLen + t0,
+					ring.data() + ((r - y0) % kh) * srcLen, len + (kw - 1) * c);
+			}
+
+			if (r + 1 < y0 + kh)
+			{
+				continue;
+			}
+
+			const size_t y = r + 1 - kh;
+			for (size_t j = 0; j < kh; j++)
+			{
+				const float * in = nullptr;
+				if constexpr (std::is_same<T, float>::value)
+				{
+					in = src + (y + j) * info.srcRowLen + t0;
+				}
+				else
+				{
+					in = ring.data() + ((y + j - y0) % kh) * srcLen;
+				}
+
+				ImageKernels::ConvolveRow(in, len, c,
+					kernel.values.data() + j * kw, kw, outRow.data(), j > 0);
+			}
+
+			StoreRow(outRow.data(), dst + y * info.rowLen + t0, len);
+		}
+	}
+}
+
+/// <summary>
+/// Get input values as float
+/// uint8_t values are converted to buffer, float values are used directly
+/// </summary>
+template <typename T>
+const float * ImageConvolution::LoadRow(const T * input, size_t count, float * buffer)
+{
+	if constexpr (std::is_same<T, float>::value)
+	{
+		return input;
+	}
+	else
+	{
+		ImageKernels::Convert(input, buffer, count);
+		return buffer;
+	}
+}
+
+/// <summary>
+/// Store computed float values to output
+/// uint8_t values are rounded and saturated
+/// </summary>
+template <typename T>
+void ImageConvolution::StoreRow(const float * input, T * output, size_t count)
+{
+	if constexpr (std::is_same<T, float>::value)
+	{
+		std::copy(input, input + count, output);
+	}
+	else
+	{
+		ImageKernels::ConvertSaturated(input, output, count);
+	}
+}
+
+//=================================================================================================
+
+template Image2d<uint8_t> ImageConvolution::Convolve(const Image2d<uint8_t> & img,
+	const NeighborhoodKernel & kernel, ImageUtils::BorderMode border, size_t stripRows);
+template Image2d<float> ImageConvolution::Convolve(const Image2d<float> & img,
+	const NeighborhoodKernel & kernel, ImageUtils::BorderMode border, size_t stripRows);
@@ -0,0 +1,63 @@
+#ifndef IMAGE_CONVOLUTION_H
+#define IMAGE_CONVOLUTION_H
+
+#include <cstddef>
+
+#include "./Image2d.h"
+#include "./ImageUtils.h"
+#include "./NeighborhoodKernel.h"
+
+/// <summary>
+/// Convolution of Image2d<uint8_t / float> with NeighborhoodKernel
+/// (kernel is not flipped, value = sum kernel[j][i] * image[y + j - anchorY][x + i - anchorX])
+///
+/// Image is padded once based on border mode, so inner loops do not check borders.
+/// Output is computed in horizontal strips that run in parallel on the shared ThreadPool.
+/// Each strip is processed in column tiles, so the rows kept for the vertical
+/// direction fit into cache.
+/// Separable kernels are applied as two 1D passes: each input row is filtered
+/// horizontally once to a ring buffer of kernel.h rows and output rows are computed
+/// by vertical pass over this buffer.
+/// Both passes use SIMD ImageKernels::ConvolveRow.
+///
+/// Values are computed in float, uint8_t output is rounded and saturated.
+/// </summary>
+class ImageConvolution
+{
+public:
+	template <typename T>
+	static Image2d<T> Convolve(const Image2d<T> & img, const NeighborhoodKernel & kernel,
+		ImageUtils::BorderMode border, size_t stripRows = 0);
+
+private:
+	static const size_t TILE_BYTES = 256 * 1024;
+	static const size_t MIN_STRIP_ROWS = 32;
+
+	struct PlaneInfo
+	{
+		size_t rowLen;		//number of values in output row
+		size_t srcRowLen;	//number of values in padded input row
+		size_t channelsCount;
+		size_t tileLen;		//max number of output values in column tile
+	};
+
+	template <typename T>
+	static void ConvolvePlane(const T * src, T * dst, int w, int h, size_t channelsCount,
+		const NeighborhoodKernel & kernel, size_t stripRows);
+
+	template <typename T>
+	static void ConvolveStripSeparable(const T * src, T * dst, size_t y0, size_t y1,
+		const PlaneInfo & info, const NeighborhoodKernel & kernel);
+
+	template <typename T>
+	static void ConvolveStrip(const T * src, T * dst, size_t y0, size_t y1,
+		const PlaneInfo & info, const NeighborhoodKernel & kernel);
+
+	template <typename T>
+	static const float * LoadRow(const T * input, size_t count, float * buffer);
+
+	template <typename T>
+	static void StoreRow(const float * input, T * output, size_t count);
+};
+
+#endif
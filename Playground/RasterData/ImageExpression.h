@@ -0,0 +1,446 @@
+#ifndef IMAGE_EXPRESSION_H
+#define IMAGE_EXPRESSION_H
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "./Image2d.h"
+
+#include "../Utils/Logger.h"
+
+//=================================================================================================
+// Lazy element-wise image arithmetic
+//
+// Operators (+, -, *, /) and functions (Abs, Min, Max, ClampCast) on Image2d
+// do not compute anything, they build an expression tree.
+// Expression is evaluated when it is assigned to Image2d:
+//
+//   Image2d<uint8_t> res = ...;
+//   res = Abs(a - b) * 3 + c;
+//
+// All values are computed in a single loop without temporary images.
+// All images in the expression (and the destination) must have same width, height,
+// channels count and layout.
+// Values are computed with standard C++ promotions (uint8_t -> int),
+// result is saturated when stored to uint8_t image.
+// Destination can be one of the operands.
+//=================================================================================================
+
+/// <summary>
+/// Shape of images used in expression
+/// </summary>
+struct ImageExpressionShape
+{
+	const void * image;
+	ImageDimension dim;
+	ColorSpace::PixelFormat pf;
+	size_t channelsCount;
+	ImageUtils::DataLayout layout;
+	size_t size;
+};
+
+/// <summary>
+/// Base of all expression nodes (CRTP)
+/// Each node has:
+/// - value_type
+/// - value_type Eval(size_t i) const - value of i-th element
+/// - bool CheckShape(ImageExpressionShape & shape) const - fill shape from the first image
+///   and check that all images have the same shape
+/// </summary>
+template <typename E>
+class ImageExpression
+{
+public:
+	const E & Derived() const noexcept
+	{
+		return static_cast<const E &>(*this);
+	}
+};
+
+//=================================================================================================
+// Leaf nodes
+//=================================================================================================
+
+/// <summary>
+/// Image operand
+/// Image must exist until expression is evaluated
+/// </summary>
+template <typename T>
+class ImageTerminal : public ImageExpression<ImageTerminal<T>>
+{
+public:
+	typedef T value_type;
+
+	ImageTerminal(const Image2d<T> & img) noexcept :
+		img(&img),
+		data(img.GetData().data())
+	{
+	}
+
+	value_type Eval(size_t i) const noexcept
+	{
+		return this->data[i];
+	}
+
+	bool CheckShape(ImageExpressionShape & shape) const
+	{
+		if (shape.image == nullptr)
+		{
+			shape.image = this->img;
+			shape.dim = this->img->GetDimension();
+			shape.pf = this->img->GetPixelFormat();
+			shape.channelsCount = this->img->GetChannelsCount();
+			shape.layout = this->img->GetLayout();
+			shape.size = this->img->GetData().size();
+			return true;
+		}
+
+		return (shape.dim.w == this->img->GetWidth()) &&
+			(shape.dim.h == this->img->GetHeight()) &&
+			(shape.channelsCount == this->img->GetChannelsCount()) &&
+			(shape.layout == this->img->GetLayout()) &&
+			(shape.size == this->img->GetData().size());
+	}
+
+protected:
+	const Image2d<T> * img;
+	const T * data;
+};
+
+/// <summary>
+/// Scalar operand (same value for all elements)
+/// </summary>
+template <typename T>
+class ScalarTerminal : public ImageExpression<ScalarTerminal<T>>
+{
+public:
+	typedef T value_type;
+
+	ScalarTerminal(T value) noexcept :
+		value(value)
+	{
+	}
+
+	value_type Eval(size_t) const noexcept
+	{
+		return this->value;
+	}
+
+	bool CheckShape(ImageExpressionShape &) const noexcept
+	{
+		return true;
+	}
+
+protected:
+	T value;
+};
+
+//=================================================================================================
+// Operations
+//=================================================================================================
+
+struct ImageExpressionOps
+{
+	struct Add { template <typename A, typename B> static auto Apply(A a, B b) { return a + b; } };
+	struct Sub { template <typename A, typename B> static auto Apply(A a, B b) { return a - b; } };
+	struct Mul { template <typename A, typename B> static auto Apply(A a, B b) { return a * b; } };
+	struct Div { template <typename A, typename B> static auto Apply(A a, B b) { return a / b; } };
+
+	struct Min
+	{
+		template <typename A, typename B>
+		static typename std::common_type<A, B>::type Apply(A a, B b)
+		{
+			typedef typename std::common_type<A, B>::type R;
+			return (R(b) < R(a)) ? R(b) : R(a);
+		}
+	};
+
+	struct Max
+	{
+		template <typename A, typename B>
+		static typename std::common_type<A, B>::type Apply(A a, B b)
+		{
+			typedef typename std::common_type<A, B>::type R;
+			return (R(a) < R(b)) ? R(b) : R(a);
+		}
+	};
+
+	struct Abs
+	{
+		template <typename A>
+		static A Apply(A a)
+		{
+			if constexpr (std::is_unsigned<A>::value)
+			{
+				return a;
+			}
+			else
+			{
+				return (a < A(0)) ? -a : a;
+			}
+		}
+	};
+
+	/// <summary>
+	/// Convert value to V
+	/// if V is uint8_t, value is clamped to [0, 255]
+	/// (same as ImageUtils::clamp_cast, but without conversion to double,
+	/// so it can be vectorized)
+	/// </summary>
+	template <typename V>
+	struct Cast
+	{
+		template <typename A>
+		static V Apply(A a)
+		{
+			if constexpr (std::is_same<V, uint8_t>::value && (std::is_same<A, uint8_t>::value == false))
+			{
+				return (a < A(0)) ? V(0) : (a > A(255)) ? V(255) : static_cast<V>(a);
+			}
+			else
+			{
+				return static_cast<V>(a);
+			}
+		}
+	};
+};
+
+template <typename Op, typename L, typename R>
+class BinaryImageExpression : public ImageExpression<BinaryImageExpression<Op, L, R>>
+{
+public:
+	typedef decltype(Op::Apply(std::declval<typename L::value_type>(),
+		std::declval<typename R::value_type>())) value_type;
+
+	BinaryImageExpression(const L & l, const R & r) :
+		l(l),
+		r(r)
+	{
+	}
+
+	value_type Eval(size_t i) const noexcept
+	{
+		return Op::Apply(this->l.Eval(i), this->r.Eval(i));
+	}
+
+	bool CheckShape(ImageExpressionShape & shape) const
+	{
+		return this->l.CheckShape(shape) && this->r.CheckShape(shape);
+	}
+
+protected:
+	L l;
+	R r;
+};
+
+template <typename Op, typename E>
+class UnaryImageExpression : public ImageExpression<UnaryImageExpression<Op, E>>
+{
+public:
+	typedef decltype(Op::Apply(std::declval<typename E::value_type>())) value_type;
+
+	UnaryImageExpression(const E & e) :
+		e(e)
+	{
+	}
+
+	value_type Eval(size_t i) const noexcept
+	{
+		return Op::Apply(this->e.Eval(i));
+	}
+
+	bool CheckShape(ImageExpressionShape & shape) const
+	{
+		return this->e.CheckShape(shape);
+	}
+
+protected:
+	E e;
+};
+
+//=================================================================================================
+// Conversion of operands to expression nodes
+//=================================================================================================
+
+template <typename X, typename = void>
+struct ImageExpressionOperand
+{
+	static const bool IS_EXPRESSION = false;
+};
+
+template <typename T>
+struct ImageExpressionOperand<Image2d<T>>
+{
+	static const bool IS_EXPRESSION = true;
+	typedef ImageTerminal<T> type;
+	static type Create(const Image2d<T> & img) { return type(img); }
+};
+
+template <typename E>
+struct ImageExpressionOperand<E, typename std::enable_if<std::is_base_of<ImageExpression<E>, E>::value>::type>
+{
+	static const bool IS_EXPRESSION = true;
+	typedef E type;
+	static const E & Create(const E & e) { return e; }
+};
+
+template <typename S>
+struct ImageExpressionOperand<S, typename std::enable_if<std::is_arithmetic<S>::value>::type>
+{
+	static const bool IS_EXPRESSION = false;
+	typedef ScalarTerminal<S> type;
+	static type Create(S s) { return type(s); }
+};
+
+/// <summary>
+/// Operators are enabled if at least one operand is image or expression
+/// and the other one is image, expression or scalar
+/// </summary>
+template <typename A, typename B>
+struct ImageExpressionBinaryEnabled
+{
+	typedef ImageExpressionOperand<typename std::decay<A>::type> OA;
+	typedef ImageExpressionOperand<typename std::decay<B>::type> OB;
+
+	static const bool value = (OA::IS_EXPRESSION || OB::IS_EXPRESSION) &&
+		(OA::IS_EXPRESSION || std::is_arithmetic<typename std::decay<A>::type>::value) &&
+		(OB::IS_EXPRESSION || std::is_arithmetic<typename std::decay<B>::type>::value);
+};
+
+template <typename Op, typename A, typename B>
+using ImageExpressionBinaryResult = typename std::enable_if<ImageExpressionBinaryEnabled<A, B>::value,
+	BinaryImageExpression<Op,
+		typename ImageExpressionOperand<typename std::decay<A>::type>::type,
+		typename ImageExpressionOperand<typename std::decay<B>::type>::type>>::type;
+
+template <typename Op, typename A, typename B>
+ImageExpressionBinaryResult<Op, A, B> CreateBinaryImageExpression(const A & a, const B & b)
+{
+	return ImageExpressionBinaryResult<Op, A, B>(
+		ImageExpressionOperand<A>::Create(a),
+		ImageExpressionOperand<B>::Create(b));
+}
+
+template <typename A, typename B>
+ImageExpressionBinaryResult<ImageExpressionOps::Add, A, B> operator+(const A & a, const B & b)
+{
+	return CreateBinaryImageExpression<ImageExpressionOps::Add>(a, b);
+}
+
+template <typename A, typename B>
+ImageExpressionBinaryResult<ImageExpressionOps::Sub, A, B> operator-(const A & a, const B & b)
+{
+	return CreateBinaryImageExpression<ImageExpressionOps::Sub>(a, b);
+}
+
+template <typename A, typename B>
+ImageExpressionBinaryResult<ImageExpressionOps::Mul, A, B> operator*(const A & a, const B & b)
+{
+	return CreateBinaryImageExpression<ImageExpressionOps::Mul>(a, b);
+}
+
+template <typename A, typename B>
+ImageExpressionBinaryResult<ImageExpressionOps::Div, A, B> operator/(const A & a, const B & b)
+{
+	return CreateBinaryImageExpression<ImageExpressionOps::Div>(a, b);
+}
+
+template <typename A, typename B>
+ImageExpressionBinaryResult<ImageExpressionOps::Min, A, B> Min(const A & a, const B & b)
+{
+	return CreateBinaryImageExpression<ImageExpressionOps::Min>(a, b);
+}
+
+template <typename A, typename B>
+ImageExpressionBinaryResult<ImageExpressionOps::Max, A, B> Max(const A & a, const B & b)
+{
+	return CreateBinaryImageExpression<ImageExpressionOps::Max>(a, b);
+}
+
+template <typename A,
+	typename = typename std::enable_if<ImageExpressionOperand<A>::IS_EXPRESSION>::type>
+UnaryImageExpression<ImageExpressionOps::Abs, typename ImageExpressionOperand<A>::type> Abs(const A & a)
+{
+	return UnaryImageExpression<ImageExpressionOps::Abs, typename ImageExpressionOperand<A>::type>(
+		ImageExpressionOperand<A>::Create(a));
+}
+
+template <typename V, typename A,
+	typename = typename std::enable_if<ImageExpressionOperand<A>::IS_EXPRESSION>::type>
+UnaryImageExpression<ImageExpressionOps::Cast<V>, typename ImageExpressionOperand<A>::type> ClampCast(const A & a)
+{
+	return UnaryImageExpression<ImageExpressionOps::Cast<V>, typename ImageExpressionOperand<A>::type>(
+		ImageExpressionOperand<A>::Create(a));
+}
+
+//=================================================================================================
+// Evaluation
+//=================================================================================================
+
+/// <summary>
+/// Create image from evaluated expression
+/// Image has shape of images in expression
+/// </summary>
+/// <param name="expr"></param>
+template <typename T>
+template <typename E>
+Image2d<T>::Image2d(const ImageExpression<E> & expr) :
+	Image2d()
+{
+	*this = expr;
+}
+
+/// <summary>
+/// Evaluate expression to the current image
+/// If the current image is empty, it is created with shape of images in expression
+/// </summary>
+/// <param name="expr"></param>
+/// <returns></returns>
+template <typename T>
+template <typename E>
+Image2d<T> & Image2d<T>::operator=(const ImageExpression<E> & expr)
+{
+	const E & e = expr.Derived();
+
+	ImageExpressionShape shape = {};
+	if (e.CheckShape(shape) == false)
+	{
+		MY_LOG_ERROR("Images in expression have different shape");
+		return *this;
+	}
+
+	if (shape.image == nullptr)
+	{
+		MY_LOG_ERROR("Expression does not contain any image");
+		return *this;
+	}
+
+	if (this->data.empty() && (this->GetPixelsCount() == 0))
+	{
+		this->dim = shape.dim;
+		this->pf = shape.pf;
+		this->channelsCount = shape.channelsCount;
+		this->layout = shape.layout;
+		this->data.resize(shape.size);
+	}
+	else if ((this->dim.w != shape.dim.w) || (this->dim.h != shape.dim.h) ||
+		(this->channelsCount != shape.channelsCount) || (this->layout != shape.layout) ||
+		(this->data.size() != shape.size))
+	{
+		MY_LOG_ERROR("Expression result has different shape than target image");
+		return *this;
+	}
+
+	T * dst = this->data.data();
+	const size_t len = this->data.size();
+	for (size_t i = 0; i < len; i++)
+	{
+		dst[i] = ImageExpressionOps::Cast<T>::Apply(e.Eval(i));
+	}
+
+	return *this;
+}
+
+#endif
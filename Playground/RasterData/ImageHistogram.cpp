@@ -0,0 +1,515 @@
+#include "./ImageHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+template <typename T>
+ImageHistogram<T>::ImageHistogram() :
+	channelsCount(0),
+	binsCount(0),
+	rangeMin(0.0),
+	rangeMax(0.0),
+	count(0)
+{
+}
+
+/// <summary>
+/// Build histogram with default bins
+/// uint8_t - 256 bins [0, 256), float - 256 bins [0, 1)
+/// </summary>
+/// <param name="img"></param>
+/// <param name="mask">single channel mask of the same size, can be nullptr</param>
+template <typename T>
+ImageHistogram<T>::ImageHistogram(const Image2d<T> & img, const Image2d<uint8_t> * mask) :
+	ImageHistogram(img, VALUES_COUNT, 0.0, (std::is_same<T, uint8_t>::value) ? 256.0 : 1.0, mask)
+{
+}
+
+/// <summary>
+/// Build histogram with binsCount bins of equal width over [rangeMin, rangeMax)
+/// </summary>
+/// <param name="img"></param>
+/// <param name="binsCount"></param>
+/// <param name="rangeMin"></param>
+/// <param name="rangeMax"></param>
+/// <param name="mask">single channel mask of the same size, can be nullptr</param>
+template <typename T>
+ImageHistogram<T>::ImageHistogram(const Image2d<T> & img, size_t binsCount, double rangeMin, double rangeMax,
+	const Image2d<uint8_t> * mask) :
+	channelsCount(img.GetChannelsCount()),
+	binsCount(binsCount),
+	rangeMin(rangeMin),
+	rangeMax(rangeMax),
+	count(0)
+{
+	if ((binsCount == 0) || (rangeMax <= rangeMin))
+	{
+		MY_LOG_ERROR("Invalid histogram bins count or range");
+		*this = ImageHistogram<T>();
+		return;
+	}
+
+	if ((mask != nullptr) && ((mask->GetWidth() != img.GetWidth()) ||
+		(mask->GetHeight() != img.GetHeight()) || (mask->GetChannelsCount() != 1)))
+	{
+		MY_LOG_ERROR("Histogram mask must have single channel and the same size as image");
+		*this = ImageHistogram<T>();
+		return;
+	}
+
+	this->Build(img, mask);
+}
+
+//=================================================================================================
+// Build
+//=================================================================================================
+
+/// <summary>
+/// Compute partial results of row chunks in parallel and merge them
+/// </summary>
+/// <param name="img"></param>
+/// <param name="mask"></param>
+template <typename T>
+void ImageHistogram<T>::Build(const Image2d<T> & img, const Image2d<uint8_t> * mask)
+{
+	const size_t c = this->channelsCount;
+	const size_t w = size_t(img.GetWidth());
+	const uint8_t * maskData = (mask != nullptr) ? mask->GetData().data() : nullptr;
+
+	this->bins.assign(c * this->binsCount, 0);
+	this->stats.assign(c, { SumType(0), SumType(0), 0.0, 0.0 });
+
+	if ((w == 0) || (img.GetHeight() == 0) || (c == 0))
+	{
+		return;
+	}
+
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (w * c));
+
+	const Partial res = MyUtils::ThreadPool::GetInstance()->ParallelReduce(0, size_t(img.GetHeight()),
+		grainRows, Partial(),
+		[&](size_t y0, size_t y1) {
+			return this->ProcessPixels(img, maskData, y0 * w, y1 * w);
+		},
+		[](const Partial & a, const Partial & b) {
+			return Merge(a, b);
+		});
+
+	this->count = res.count;
+
+	for (size_t ch = 0; ch < c; ch++)
+	{
+		ChannelStats & s = this->stats[ch];
+		uint64_t * chBins = this->bins.data() + ch * this->binsCount;
+
+		if constexpr (std::is_same<T, uint8_t>::value)
+		{
+			//exact statistics from value counts
+			const uint64_t * values = res.counts.data() + ch * VALUES_COUNT;
+
+			s.min = -1.0;
+			for (size_t v = 0; v < VALUES_COUNT; v++)
+			{
+				if (values[v] == 0)
+				{
+					continue;
+				}
+
+				s.sum += values[v] * v;
+				s.squares += values[v] * v * v;
+				s.min = (s.min < 0.0) ? double(v) : s.min;
+				s.max = double(v);
+				chBins[this->GetBinIndex(double(v))] += values[v];
+			}
+			s.min = std::max(0.0, s.min);
+		}
+		else
+		{
+			std::copy(res.counts.begin() + ch * this->binsCount,
+				res.counts.begin() + (ch + 1) * this->binsCount, chBins);
+			s.sum = res.sums[ch];
+			s.squares = res.squares[ch];
+			s.min = (this->count > 0) ? res.mins[ch] : 0.0;
+			s.max = (this->count > 0) ? res.maxs[ch] : 0.0;
+		}
+	}
+}
+
+/// <summary>
+/// Process pixels [p0, p1) of all channels
+/// </summary>
+/// <param name="img"></param>
+/// <param name="mask">mask data, can be nullptr</param>
+/// <param name="p0"></param>
+/// <param name="p1"></param>
+/// <returns></returns>
+template <typename T>
+typename ImageHistogram<T>::Partial ImageHistogram<T>::ProcessPixels(const Image2d<T> & img,
+	const uint8_t * mask, size_t p0, size_t p1) const
+{
+	const size_t c = this->channelsCount;
+	const size_t pixelStride = img.GetPixelStride();
+	const size_t channelStride = img.GetChannelStride();
+
+	Partial r;
+	r.count = 0;
+
+	if constexpr (std::is_same<T, uint8_t>::value)
+	{
+		if (mask == nullptr)
+		{
+			r.count = p1 - p0;
+		}
+		else
+		{
+			for (size_t i = p0; i < p1; i++)
+			{
+				r.count += (mask[i] != 0) ? 1 : 0;
+			}
+		}
+
+		r.counts.assign(c * VALUES_COUNT, 0);
+
+		//4 sub-histograms, so consecutive equal values do not wait for each other
+		//(chunk has less than 2^32 pixels)
+		std::vector<uint32_t> sub(4 * VALUES_COUNT);
+
+		for (size_t ch = 0; ch < c; ch++)
+		{
+			const T * src = img.GetData().data() + ch * channelStride;
+			std::fill(sub.begin(), sub.end(), 0);
+			uint32_t * h0 = sub.data();
+			uint32_t * h1 = h0 + VALUES_COUNT;
+			uint32_t * h2 = h1 + VALUES_COUNT;
+			uint32_t * h3 = h2 + VALUES_COUNT;
+
+			size_t i = p0;
+			if (mask == nullptr)
+			{
+				for (; i + 4 <= p1; i += 4)
+				{
+					h0[src[i * pixelStride]]++;
+					h1[src[(i + 1) * pixelStride]]++;
+					h2[src[(i + 2) * pixelStride]]++;
+					h3[src[(i + 3) * pixelStride]]++;
+				}
+				for (; i < p1; i++)
+				{
+					h0[src[i * pixelStride]]++;
+				}
+			}
+			else
+			{
+				for (; i < p1; i++)
+				{
+					h0[src[i * pixelStride]] += (mask[i] != 0) ? 1 : 0;
+				}
+			}
+
+			uint64_t * out = r.counts.data() + ch * VALUES_COUNT;
+			for (size_t v = 0; v < VALUES_COUNT; v++)
+			{
+				out[v] = uint64_t(h0[v]) + h1[v] + h2[v] + h3[v];
+			}
+		}
+	}
+	else
+	{
+		r.counts.assign(c * this->binsCount, 0);
+		r.sums.assign(c, 0.0);
+		r.squares.assign(c, 0.0);
+		r.mins.assign(c, std::numeric_limits<double>::max());
+		r.maxs.assign(c, std::numeric_limits<double>::lowest());
+
+		//pixels outside of mask or with NaN in any channel are skipped in all channels
+		std::vector<uint8_t> valid(p1 - p0);
+		for (size_t i = p0; i < p1; i++)
+		{
+			bool isValid = (mask == nullptr) || (mask[i] != 0);
+			for (size_t ch = 0; (isValid) && (ch < c); ch++)
+			{
+				isValid = (std::isnan(img.GetData()[ch * channelStride + i * pixelStride]) == false);
+			}
+			valid[i - p0] = isValid ? 1 : 0;
+			r.count += isValid ? 1 : 0;
+		}
+
+		for (size_t ch = 0; ch < c; ch++)
+		{
+			const T * src = img.GetData().data() + ch * channelStride;
+			uint64_t * chBins = r.counts.data() + ch * this->binsCount;
+
+			double sum = 0.0;
+			double squares = 0.0;
+			T minV = std::numeric_limits<T>::max();
+			T maxV = std::numeric_limits<T>::lowest();
+
+			for (size_t i = p0; i < p1; i++)
+			{
+				if (valid[i - p0] == 0)
+				{
+					continue;
+				}
+
+				const T v = src[i * pixelStride];
+				sum += v;
+				squares += double(v) * double(v);
+				minV = std::min(minV, v);
+				maxV = std::max(maxV, v);
+				chBins[this->GetBinIndex(double(v))]++;
+			}
+
+			r.sums[ch] = sum;
+			r.squares[ch] = squares;
+			r.mins[ch] = double(minV);
+			r.maxs[ch] = double(maxV);
+		}
+	}
+
+	return r;
+}
+
+/// <summary>
+/// Merge partial results
+/// Default constructed (empty) partial is the initial value of reduction
+/// </summary>
+template <typename T>
+typename ImageHistogram<T>::Partial ImageHistogram<T>::Merge(const Partial & a, const Partial & b)
+{
+	if (a.counts.empty())
+	{
+		return b;
+	}
+	if (b.counts.empty())
+	{
+		return a;
+	}
+
+	Partial r = a;
+	r.count += b.count;
+	for (size_t i = 0; i < r.counts.size(); i++)
+	{
+		r.counts[i] += b.counts[i];
+	}
+	for (size_t ch = 0; ch < r.sums.size(); ch++)
+	{
+		r.sums[ch] += b.sums[ch];
+		r.squares[ch] += b.squares[ch];
+		r.mins[ch] = std::min(r.mins[ch], b.mins[ch]);
+		r.maxs[ch] = std::max(r.maxs[ch], b.maxs[ch]);
+	}
+
+	return r;
+}
+
+/// <summary>
+/// Get bin of value, values outside of range are in the first / last bin
+/// (NaN is in the first bin)
+/// </summary>
+/// <param name="value"></param>
+/// <returns></returns>
+template <typename T>
+size_t ImageHistogram<T>::GetBinIndex(double value) const noexcept
+{
+	const double pos = (value - this->rangeMin) * double(this->binsCount) / (this->rangeMax - this->rangeMin);
+	if (!(pos >= 1.0))
+	{
+		return 0;
+	}
+	if (pos >= double(this->binsCount - 1))
+	{
+		return this->binsCount - 1;
+	}
+	return size_t(pos);
+}
+
+//=================================================================================================
+// Getters
+//=================================================================================================
+
+template <typename T>
+size_t ImageHistogram<T>::GetChannelsCount() const noexcept
+{
+	return this->channelsCount;
+}
+
+template <typename T>
+size_t ImageHistogram<T>::GetBinsCount() const noexcept
+{
+	return this->binsCount;
+}
+
+template <typename T>
+double ImageHistogram<T>::GetRangeMin() const noexcept
+{
+	return this->rangeMin;
+}
+
+template <typename T>
+double ImageHistogram<T>::GetRangeMax() const noexcept
+{
+	return this->rangeMax;
+}
+
+/// <summary>
+/// Get lower edge of bin
+/// </summary>
+/// <param name="binIndex"></param>
+/// <returns></returns>
+template <typename T>
+double ImageHistogram<T>::GetBinStart(size_t binIndex) const noexcept
+{
+	return this->rangeMin + (this->rangeMax - this->rangeMin) * double(binIndex) / double(this->binsCount);
+}
+
+/// <summary>
+/// Get number of counted pixels (pixels inside mask, without NaN)
+/// </summary>
+/// <returns></returns>
+template <typename T>
+uint64_t ImageHistogram<T>::GetCount() const noexcept
+{
+	return this->count;
+}
+
+/// <summary>
+/// Get binsCount bins of channel
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+const uint64_t * ImageHistogram<T>::GetBins(size_t channelIndex) const noexcept
+{
+	return this->bins.data() + channelIndex * this->binsCount;
+}
+
+//=================================================================================================
+// Statistics
+//=================================================================================================
+
+template <typename T>
+typename ImageHistogram<T>::SumType ImageHistogram<T>::GetSum(size_t channelIndex) const noexcept
+{
+	return this->stats[channelIndex].sum;
+}
+
+template <typename T>
+typename ImageHistogram<T>::SumType ImageHistogram<T>::GetSquaresSum(size_t channelIndex) const noexcept
+{
+	return this->stats[channelIndex].squares;
+}
+
+template <typename T>
+double ImageHistogram<T>::GetMin(size_t channelIndex) const noexcept
+{
+	return this->stats[channelIndex].min;
+}
+
+template <typename T>
+double ImageHistogram<T>::GetMax(size_t channelIndex) const noexcept
+{
+	return this->stats[channelIndex].max;
+}
+
+/// <summary>
+/// Get mean of channel values, 0 if there are no pixels
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+double ImageHistogram<T>::GetMean(size_t channelIndex) const noexcept
+{
+	if (this->count == 0)
+	{
+		return 0.0;
+	}
+	return double(this->stats[channelIndex].sum) / double(this->count);
+}
+
+/// <summary>
+/// Get population variance of channel values, 0 if there are no pixels
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+double ImageHistogram<T>::GetVariance(size_t channelIndex) const noexcept
+{
+	if (this->count == 0)
+	{
+		return 0.0;
+	}
+
+	const double mean = this->GetMean(channelIndex);
+	const double meanSq = double(this->stats[channelIndex].squares) / double(this->count);
+	return std::max(0.0, meanSq - mean * mean);
+}
+
+template <typename T>
+double ImageHistogram<T>::GetStdDev(size_t channelIndex) const noexcept
+{
+	return std::sqrt(this->GetVariance(channelIndex));
+}
+
+/// <summary>
+/// Get percentile of channel values from histogram (nearest rank)
+/// Result is the lower edge of bin with the rank (exact value for default uint8_t bins),
+/// float values are interpolated inside the bin.
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <param name="percent">[0, 100]</param>
+/// <returns></returns>
+template <typename T>
+double ImageHistogram<T>::GetPercentile(size_t channelIndex, double percent) const noexcept
+{
+	if (this->count == 0)
+	{
+		return 0.0;
+	}
+
+	percent = std::min(100.0, std::max(0.0, percent));
+	const uint64_t rank = std::max<uint64_t>(1,
+		uint64_t(std::ceil(percent / 100.0 * double(this->count))));
+
+	const uint64_t * chBins = this->GetBins(channelIndex);
+	uint64_t cumulative = 0;
+	for (size_t b = 0; b < this->binsCount; b++)
+	{
+		if (cumulative + chBins[b] < rank)
+		{
+			cumulative += chBins[b];
+			continue;
+		}
+
+		if constexpr (std::is_same<T, uint8_t>::value)
+		{
+			return this->GetBinStart(b);
+		}
+		else
+		{
+			const double f = double(rank - cumulative) / double(chBins[b]);
+			const double width = (this->rangeMax - this->rangeMin) / double(this->binsCount);
+			return this->GetBinStart(b) + f * width;
+		}
+	}
+
+	return this->GetBinStart(this->binsCount - 1);
+}
+
+template <typename T>
+double ImageHistogram<T>::GetMedian(size_t channelIndex) const noexcept
+{
+	return this->GetPercentile(channelIndex, 50.0);
+}
+
+//=================================================================================================
+
+template class ImageHistogram<uint8_t>;
+template class ImageHistogram<float>;
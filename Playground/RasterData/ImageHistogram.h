@@ -0,0 +1,96 @@
+#ifndef IMAGE_HISTOGRAM_H
+#define IMAGE_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "./Image2d.h"
+
+/// <summary>
+/// Per-channel histogram and statistics of Image2d<uint8_t / float>
+/// Histogram has binsCount bins of equal width over [rangeMin, rangeMax),
+/// values outside are counted in the first / last bin.
+/// Default: uint8_t - 256 bins [0, 256) (bin = value), float - 256 bins [0, 1)
+///
+/// Optional mask (single channel uint8_t image of the same size) selects
+/// pixels with non-zero mask value. Pixels of float images with NaN
+/// in any channel are skipped (not counted in any channel).
+///
+/// All values are computed in one parallel pass (shared ThreadPool).
+/// Each task fills its own sub-histogram, sub-histograms are merged at the end.
+/// uint8_t images count occurrences of each value, so sum, sum of squares, min and max
+/// are computed exactly from the counts. float images use double accumulators.
+/// </summary>
+template <typename T>
+class ImageHistogram
+{
+public:
+	typedef typename std::conditional<std::is_same<T, uint8_t>::value, uint64_t, double>::type SumType;
+
+	ImageHistogram();
+	explicit ImageHistogram(const Image2d<T> & img, const Image2d<uint8_t> * mask = nullptr);
+	ImageHistogram(const Image2d<T> & img, size_t binsCount, double rangeMin, double rangeMax,
+		const Image2d<uint8_t> * mask = nullptr);
+
+	size_t GetChannelsCount() const noexcept;
+	size_t GetBinsCount() const noexcept;
+	double GetRangeMin() const noexcept;
+	double GetRangeMax() const noexcept;
+	double GetBinStart(size_t binIndex) const noexcept;
+	uint64_t GetCount() const noexcept;
+	const uint64_t * GetBins(size_t channelIndex) const noexcept;
+
+	SumType GetSum(size_t channelIndex) const noexcept;
+	SumType GetSquaresSum(size_t channelIndex) const noexcept;
+	double GetMin(size_t channelIndex) const noexcept;
+	double GetMax(size_t channelIndex) const noexcept;
+	double GetMean(size_t channelIndex) const noexcept;
+	double GetVariance(size_t channelIndex) const noexcept;
+	double GetStdDev(size_t channelIndex) const noexcept;
+	double GetPercentile(size_t channelIndex, double percent) const noexcept;
+	double GetMedian(size_t channelIndex) const noexcept;
+
+protected:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 256 * 1024;
+	static const size_t VALUES_COUNT = 256;
+
+	/// <summary>
+	/// Result of single task
+	/// counts - uint8_t: occurrences of each value, float: bins (for each channel)
+	/// </summary>
+	struct Partial
+	{
+		uint64_t count;
+		std::vector<uint64_t> counts;
+		std::vector<SumType> sums;
+		std::vector<SumType> squares;
+		std::vector<double> mins;
+		std::vector<double> maxs;
+	};
+
+	struct ChannelStats
+	{
+		SumType sum;
+		SumType squares;
+		double min;
+		double max;
+	};
+
+	size_t channelsCount;
+	size_t binsCount;
+	double rangeMin;
+	double rangeMax;
+	uint64_t count;
+
+	std::vector<uint64_t> bins;
+	std::vector<ChannelStats> stats;
+
+	void Build(const Image2d<T> & img, const Image2d<uint8_t> * mask);
+	Partial ProcessPixels(const Image2d<T> & img, const uint8_t * mask, size_t p0, size_t p1) const;
+	static Partial Merge(const Partial & a, const Partial & b);
+	size_t GetBinIndex(double value) const noexcept;
+};
+
+#endif
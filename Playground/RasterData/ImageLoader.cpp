@@ -4,6 +4,7 @@
 #include "../Compression/PNGLoader.h"
 
 #include "../FileUtils/IFile.h"
+#include "../Simd/ImageKernels.h"
 #include "../Utils/Logger.h"
 
 #include "../Macros.h"
@@ -460,35 +461,11 @@ void ImageLoader::LoadPNG(IFile * f, size_t fileIndex)
 		l.channelsCount = outChannelsCount;
 		l.rawData.resize(dec.w * dec.h * outChannelsCount, 255);
 
-		if (dec.bitDepth == 1)
-		{	
-			this->UnpackPallete1Bit(dec, outChannelsCount, mapping,
-				l.rawData);
-		}
-		else if (dec.bitDepth == 2)
-		{
-			this->UnpackPallete2Bit(dec, outChannelsCount, mapping,
-				l.rawData);
-
-		}
-		else if (dec.bitDepth == 4)
-		{
-			this->UnpackPallete4Bit(dec, outChannelsCount, mapping,
-				l.rawData);
+		std::vector<uint8_t> palette = this->CreateMappedPalette(dec, outChannelsCount, mapping);
 
-		}
-		else
-		{
-			int index = 0;
-			for (unsigned int i = 0; i < dec.w * dec.h; i++)
-			{
-				auto rgba = dec.palette[dec.data[i]];
-
-				WriteToTarget(index, rgba, mapping, l.rawData);
-
-				index += outChannelsCount;								
-			}
-		}
+		ImageLoader::UnpackRows(dec.data, dec.w, dec.h, dec.bitDepth,
+			palette.data(), palette.size() / outChannelsCount, outChannelsCount,
+			l.rawData);
 	}
 	
 
@@ -508,89 +485,14 @@ void ImageLoader::LoadPNG(IFile * f, size_t fileIndex)
 /// <returns></returns>
 std::vector<uint8_t> ImageLoader::Convert1BitTo8Bit(const std::vector<uint8_t> & data, size_t w, size_t h)
 {
-	
-	const uint64_t MASK = 0x00000000000000ff;
+	const uint8_t values[2] = { 0, 255 };
 
 	std::vector<uint8_t> unpacked;
 	unpacked.resize(w * h);
 
-	size_t index = 0;
-
-
-	//end size must be multiple of sizeof(uint64_t)
-	//rest of data is processed after that
-	size_t remain = data.size() % sizeof(uint64_t);
-	size_t endSize = data.size();
-	endSize -= remain;
-	
-	//process multiples of sizeof(uint64_t)
-	for (size_t i = 0; i < endSize; i += sizeof(uint64_t))
-	{				
-		const uint64_t val = *(reinterpret_cast<const uint64_t *>(data.data() + i));
-
-		const uint8_t v[sizeof(uint64_t)] = {
-				static_cast<uint8_t>(val & MASK),
-				static_cast<uint8_t>((val & MASK << 8) >> 8),
-				static_cast<uint8_t>((val & MASK << 16) >> 16),
-				static_cast<uint8_t>((val & MASK << 24) >> 24),
-				static_cast<uint8_t>((val & MASK << 32) >> 32),
-				static_cast<uint8_t>((val & MASK << 40) >> 40),
-				static_cast<uint8_t>((val & MASK << 48) >> 48),
-				static_cast<uint8_t>((val & MASK << 56) >> 56)
-		};
-
-		for (size_t j = 0; j < sizeof(uint64_t); j++)
-		{
-			uint8_t t = v[j];
-			//calculate last "column" width
-			int endB = static_cast<int>(w - (index % w));
-			if (endB > 7)
-			{
-				endB = 0;
-			}
-			else
-			{
-				endB = sizeof(uint64_t) - endB;
-			}
-
-			//endian !!
-			for (int b = 7; b >= endB; b--)			
-			{
-				uint32_t bit = (t >> b) & 1;
-				unpacked[index] = static_cast<uint8_t>(bit * 255);
-				index++;
-			}
-		}		
-	}
-	
-	for (size_t i = endSize; i < data.size(); i++)
-	{
-		uint8_t val = data[i];
-
-		//calculate last "column" width
-		int endB = static_cast<int>(w - (index % w));
-		if (endB > 7)
-		{
-			endB = 0;
-		}
-		else
-		{
-			endB = sizeof(uint64_t) - endB;
-		}
-
-		//endian !!
-		for (int b = 7; b >= endB; b--)
-		{
-			uint32_t bit = (val >> b) & 1;
-			unpacked[index] = static_cast<uint8_t>(bit * 255);
-			index++;
-		}
-	}
-
-
+	ImageLoader::UnpackRows(data, w, h, 1, values, 2, 1, unpacked);
 
 	return unpacked;
-	
 }
 
 
@@ -602,358 +504,94 @@ std::vector<uint8_t> ImageLoader::Convert1BitTo8Bit(const std::vector<uint8_t> &
 /// <returns></returns>
 std::vector<uint8_t> ImageLoader::Convert4BitTo8Bit(const std::vector<uint8_t> & data, size_t w, size_t h)
 {
-	const uint64_t MASK = 0x00000000000000ff;
+	uint8_t values[16];
+	for (int i = 0; i < 16; i++)
+	{
+		values[i] = static_cast<uint8_t>(i * 16);
+	}
 
 	std::vector<uint8_t> unpacked;
 	unpacked.resize(w * h);
 
-	int index = 0;
-
-
-	//end size must be multiple of sizeof(uint64_t)
-	//rest of data is processed after that
-	size_t remain = data.size() % sizeof(uint64_t);
-	size_t endSize = data.size();
-	endSize -= remain;
-
-	//process multiples of sizeof(uint64_t)
-	for (size_t i = 0; i < endSize; i += sizeof(uint64_t))
-	{		
-		const uint64_t val = *(reinterpret_cast<const uint64_t *>(data.data() + i));
-
-		const uint8_t v[sizeof(uint64_t)] = {
-				static_cast<uint8_t>(val & MASK),
-				static_cast<uint8_t>((val & MASK << 8) >> 8),
-				static_cast<uint8_t>((val & MASK << 16) >> 16),
-				static_cast<uint8_t>((val & MASK << 24) >> 24),
-				static_cast<uint8_t>((val & MASK << 32) >> 32),
-				static_cast<uint8_t>((val & MASK << 40) >> 40),
-				static_cast<uint8_t>((val & MASK << 48) >> 48),
-				static_cast<uint8_t>((val & MASK << 56) >> 56)
-		};
-
-		for (size_t j = 0; j < sizeof(uint64_t); j++)
-		{
-			uint8_t t = v[j];
-			//calculate last "column" width
-			int endB = static_cast<int>(w - (index % w));
-			if (endB > 2)
-			{
-				uint32_t fourBit1 = (t >> 4) & 0xF;
-				uint32_t fourBit2 = (t) & 0x0F;
-
-				unpacked[index] = static_cast<uint8_t>(fourBit1 * 16);
-				index++;
-
-				unpacked[index] = static_cast<uint8_t>(fourBit2 * 16);
-				index++;
-
-			}
-			else
-			{
-				uint32_t fourBit1 = (t >> 4) & 0xF;
-
-				unpacked[index] = static_cast<uint8_t>(fourBit1 * 16);
-				index++;
-			}
-
-		}
-	}
-
-	for (size_t i = endSize; i < data.size(); i++)
-	{
-		uint8_t val = data[i];
-
-		//calculate last "column" width
-		int endB = static_cast<int>(w - (index % w));
-		if (endB > 2)
-		{
-			uint32_t fourBit1 = (val >> 4) & 0xF;
-			uint32_t fourBit2 = (val) & 0x0F;
-
-			unpacked[index] = static_cast<uint8_t>(fourBit1 * 16);
-			index++;
-
-			unpacked[index] = static_cast<uint8_t>(fourBit2 * 16);
-			index++;
-		}
-		else
-		{
-			uint32_t fourBit1 = (val >> 4) & 0xF;
-
-			unpacked[index] = static_cast<uint8_t>(fourBit1 * 16);
-			index++;
-		}
-
-	}
-
+	ImageLoader::UnpackRows(data, w, h, 4, values, 16, 1, unpacked);
 
 	return unpacked;
 }
 
 /// <summary>
-/// Unpack 1bit pallete (2 colors) to output target
-/// with color mapping
+/// Create palette with color mapping already applied
+/// Each entry has outChannelsCount values, unmapped channels are 255.
+/// Palette has all 2^bitDepth entries, so any index in data is valid
 /// </summary>
 /// <param name="dec"></param>
 /// <param name="outChannelsCount"></param>
 /// <param name="mapping"></param>
-/// <param name="target"></param>
-void ImageLoader::UnpackPallete1Bit(const PNGLoader::DecompressedImage & dec,
-	int outChannelsCount,
-	const std::array<char, 4> & mapping,
-	std::vector<uint8_t> & target)
-{
-	int index = 0;
-
-	const uint64_t MASK = 0x00000000000000ff;
-
-	//end size must be multiple of sizeof(uint64_t)
-	//rest of data is processed after that
-	size_t remain = dec.data.size() % sizeof(uint64_t);
-	size_t endSize = dec.data.size();
-	endSize -= remain;
-
-
-	//process multiples of sizeof(uint64_t)
-	for (size_t i = 0; i < endSize; i += sizeof(uint64_t))
-	{
-		const uint64_t val = *(reinterpret_cast<const uint64_t *>(dec.data.data() + i));
-
-		const uint8_t v[sizeof(uint64_t)] = {
-			static_cast<uint8_t>(val & MASK),
-			static_cast<uint8_t>((val & MASK << 8) >> 8),
-			static_cast<uint8_t>((val & MASK << 16) >> 16),
-			static_cast<uint8_t>((val & MASK << 24) >> 24),
-			static_cast<uint8_t>((val & MASK << 32) >> 32),
-			static_cast<uint8_t>((val & MASK << 40) >> 40),
-			static_cast<uint8_t>((val & MASK << 48) >> 48),
-			static_cast<uint8_t>((val & MASK << 56) >> 56)
-		};
-
-		for (size_t j = 0; j < sizeof(uint64_t); j++)
-		{
-			uint8_t t = v[j];
-
-			//calculate last "column" width
-			int endB = (dec.w - (index % dec.w));
-			if (endB > 7)
-			{
-				endB = 0;
-			}
-			else
-			{
-				endB = sizeof(uint64_t) - endB;
-			}
-
-			//endian !!
-			for (int b = 7; b >= endB; b--)
-			{
-				uint32_t bit = (t >> b) & 1;
-				const auto & rgba = dec.palette[bit];
-
-
-				WriteToTarget(index, rgba, mapping, target);
-
-				index += outChannelsCount;
-			}
-		}
-	}
-
-	//process rest of data
-	for (size_t i = endSize; i < dec.data.size(); i++)
-	{
-		uint8_t val = dec.data[i];
-
-		//calculate last "column" width
-		int endB = (dec.w - (index % dec.w));
-		if (endB > 7)
-		{
-			endB = 0;
-		}
-		else
-		{
-			endB = sizeof(uint64_t) - endB;
-		}
-
-		//endian !!
-		for (int b = 7; b >= endB; b--)
-		{
-			uint32_t bit = (val >> b) & 1;
-			const auto & rgba = dec.palette[bit];
-
-			WriteToTarget(index, rgba, mapping, target);
-
-			index += outChannelsCount;
-		}
-	}
-}
-
-/// <summary>
-/// Unpack 2bit pallete (4 colors) to output target
-/// with color mapping
-/// </summary>
-/// <param name="dec"></param>
-/// <param name="outChannelsCount"></param>
-/// <param name="mapping"></param>
-/// <param name="target"></param>
-void ImageLoader::UnpackPallete2Bit(const PNGLoader::DecompressedImage & dec,
+/// <returns></returns>
+std::vector<uint8_t> ImageLoader::CreateMappedPalette(const PNGLoader::DecompressedImage & dec,
 	int outChannelsCount,
-	const std::array<char, 4> & mapping,
-	std::vector<uint8_t> & target)
+	const std::array<char, 4> & mapping) const
 {
-	int index = 0;	
-	const int lastByteCount = dec.w % 4;
-
-	if (lastByteCount == 0)
-	{
-		//even width - all bytes are used
-
-		size_t count = (dec.w * dec.h) / 4;
-		for (size_t i = 0; i < count; i++)
-		{
-			const uint8_t val = dec.data[i];
-			
-			WriteToTarget(index, dec.palette[(val & 0xC0) >> 6], mapping, target);
-			index += outChannelsCount;
-
-			WriteToTarget(index, dec.palette[(val & 0x30) >> 4], mapping, target);
-			index += outChannelsCount;
+	size_t entriesCount = size_t(1) << ((dec.bitDepth < 8) ? dec.bitDepth : 8);
 
-			WriteToTarget(index, dec.palette[(val & 0x0C) >> 2], mapping, target);
-			index += outChannelsCount;
+	std::vector<uint8_t> palette;
+	palette.resize(entriesCount * outChannelsCount, 255);
 
-			WriteToTarget(index, dec.palette[(val & 0x03)], mapping, target);
-			index += outChannelsCount;
-		}
-	}
-	else
+	for (size_t i = 0; (i < dec.palette.size()) && (i < entriesCount); i++)
 	{
-		uint8_t indices[4];
+		const PNGLoader::RGBA & val = dec.palette[i];
+		uint8_t * entry = palette.data() + i * outChannelsCount;
 
-		//width not multiple of 4 - last byte is only used from part
-		size_t i = 0;
-		for (size_t y = 0; y < dec.h; y++)
+		const uint8_t rgba[4] = { val.r, val.g, val.b, val.a };
+		for (int j = 0; j < 4; j++)
 		{
-			for (size_t x = 0; x < dec.w - lastByteCount; x += 4)
+			if ((j == CHANNEL::ALPHA) && (this->storeAlpha == false))
 			{
-				const uint8_t val = dec.data[i];
-				i++;
-								
-				WriteToTarget(index, dec.palette[(val & 0xC0) >> 6], mapping, target);
-				index += outChannelsCount;
-
-				WriteToTarget(index, dec.palette[(val & 0x30) >> 4], mapping, target);
-				index += outChannelsCount;
-
-				WriteToTarget(index, dec.palette[(val & 0x0C) >> 2], mapping, target);
-				index += outChannelsCount;
-
-				WriteToTarget(index, dec.palette[(val & 0x03)], mapping, target);
-				index += outChannelsCount;				
+				continue;
 			}
 
-			const uint8_t val = dec.data[i];
-			i++;
-			
-			indices[0] = (val & 0xC0) >> 6;
-			indices[1] = (val & 0x30) >> 4;
-			indices[2] = (val & 0x0C) >> 2;
-			indices[3] = (val & 0x03);			
-
-			for (int b = 0; b < lastByteCount; b++)
-			{				
-				WriteToTarget(index, dec.palette[indices[b]], mapping, target);
-				index += outChannelsCount;
+			if ((mapping[j] != CHANNEL::NONE) && (mapping[j] < outChannelsCount))
+			{
+				entry[size_t(mapping[j])] = rgba[j];
 			}
 		}
 	}
 
+	return palette;
 }
 
-
 /// <summary>
-/// Unpack 4bit pallete (16 colors) to output target
-/// with color mapping
+/// Unpack bit-packed rows (each row starts at byte boundary)
+/// and write palette values for unpacked indices to target
 /// </summary>
-/// <param name="dec"></param>
-/// <param name="outChannelsCount"></param>
-/// <param name="mapping"></param>
+/// <param name="data"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="bitDepth">1, 2, 4 or 8</param>
+/// <param name="palette"></param>
+/// <param name="paletteSize">number of entries in palette (must cover all indices)</param>
+/// <param name="channelsCount">number of values in palette entry</param>
 /// <param name="target"></param>
-void ImageLoader::UnpackPallete4Bit(const PNGLoader::DecompressedImage & dec,
-	int outChannelsCount,
-	const std::array<char, 4> & mapping,
+void ImageLoader::UnpackRows(const std::vector<uint8_t> & data, size_t w, size_t h,
+	unsigned int bitDepth,
+	const uint8_t * palette, size_t paletteSize, size_t channelsCount,
 	std::vector<uint8_t> & target)
 {
-	int index = 0;
-	
-	if (dec.w % 2 == 0)
-	{
-		//even width - all bytes are used
-
-		size_t count = (dec.w * dec.h) / 2;
-		for (size_t i = 0; i < count; i++)
-		{
-			const uint8_t val = dec.data[i];
-			
-			WriteToTarget(index, dec.palette[(val & 0xF0) >> 4], mapping, target);
-			index += outChannelsCount;
-			
-			WriteToTarget(index, dec.palette[(val & 0x0F)], mapping, target);
-			index += outChannelsCount;
-			
-		}
-	}
-	else
-	{
-		//odd width - last byte is only used from half
-		size_t i = 0;
-		for (size_t y = 0; y < dec.h; y++)
-		{
-			for (size_t x = 0; x < dec.w - 1; x += 2)
-			{
-				const uint8_t val = dec.data[i];				
-				i++;
-
-				WriteToTarget(index, dec.palette[(val & 0xF0) >> 4], mapping, target);
-				index += outChannelsCount;
-
-				WriteToTarget(index, dec.palette[(val & 0x0F)], mapping, target);
-				index += outChannelsCount;				
-			}
-
-			const uint8_t val = dec.data[i];
-			i++;
-
-			WriteToTarget(index, dec.palette[(val & 0xF0) >> 4], mapping, target);
-			index += outChannelsCount;						
-		}
-	}
-
-}
+	const size_t rowBytes = (w * bitDepth + 7) / 8;
 
-void ImageLoader::WriteToTarget(int index, const PNGLoader::RGBA & val,
-	const std::array<char, 4> & mapping,
-	std::vector<uint8_t> & target)
-{	
-	if (mapping[0] != CHANNEL::NONE)
+	if ((data.size() < rowBytes * h) || (target.size() < w * h * channelsCount))
 	{
-		target[index + mapping[0]] = val.r;
-	}
-
-	if (mapping[1] != CHANNEL::NONE)
-	{
-		target[index + mapping[1]] = val.g;
+		MY_LOG_ERROR("Not enough data to unpack %zu x %zu image with %u bits", w, h, bitDepth);
+		return;
 	}
 
-	if (mapping[2] != CHANNEL::NONE)
-	{
-		target[index + mapping[2]] = val.b;
-	}
+	std::vector<uint8_t> indices;
+	indices.resize(w);
 
-	if ((mapping[3] != CHANNEL::NONE) && (this->storeAlpha))
+	for (size_t y = 0; y < h; y++)
 	{
-		target[index + mapping[3]] = val.a;
+		ImageKernels::UnpackIndices(data.data() + y * rowBytes, w, bitDepth, indices.data());
+		ImageKernels::ExpandPalette(indices.data(), w, palette, paletteSize, channelsCount,
+			target.data() + y * w * channelsCount);
 	}
 }
 
@@ -977,149 +615,46 @@ void ImageLoader::ColorMapping(size_t fileIndex, size_t w, size_t h, int channel
 	int outChannelsCount = this->outputChannelsCount[fileIndex];
 	const auto & mapping = this->outMapping[fileIndex];
 
-	size_t imgSize = w * h * channelsCount;
-
-
-	int index = 0;
-
-	if (channelsCount == 4)  //PNG_COLOR_TYPE_RGB_ALPHA
+	if ((channelsCount < 1) || (channelsCount > 4) || 
+		(data.size() < w * h * channelsCount))
 	{
-		for (size_t i = 0; i < imgSize; i += channelsCount)
-		{
-			for (int j = 0; j < 4; j++)
-			{
-				if (mapping[j] != CHANNEL::NONE)
-				{
-					l.rawData[index + mapping[j]] = data[i + j];
-				}
-			}
-
-			index += outChannelsCount;
-		}
+		MY_LOG_ERROR("Unsupported input data for color mapping");
+		return;
 	}
-	else if (channelsCount == 2) //PNG_COLOR_TYPE_GRAY_ALPHA 
-	{
-		for (size_t i = 0; i < imgSize; i += channelsCount)
-		{
-
-			if (mapping[0] != CHANNEL::NONE) //RED
-			{
-				l.rawData[index + mapping[0]] = data[i + 0];
-			}
-			if (mapping[3] != CHANNEL::NONE) //ALPHA
-			{
-				l.rawData[index + mapping[3]] = data[i + 1];
-			}
-
-			//added channels
-			/*
-			if (mapping[1] != CHANNEL::NONE) //GREEN
-			{
-				l.rawData[index + mapping[1]] = 255;
-			}
-			if (mapping[2] != CHANNEL::NONE) //BLUE
-			{
-				l.rawData[index + mapping[2]] = 255;
-			}
-			*/
 
-			index += outChannelsCount;
-		}
+	//input channel for each mapping entry
+	//(gray has only RED, gray-alpha RED and ALPHA)
+	int inputChannel[4] = { 0, 1, 2, 3 };
+	if (channelsCount == 2) //PNG_COLOR_TYPE_GRAY_ALPHA
+	{
+		inputChannel[1] = -1;
+		inputChannel[2] = -1;
+		inputChannel[3] = 1;
 	}
-	else if (channelsCount == 3) //PNG_COLOR_TYPE_RGB
+	else if (channelsCount < 4)
 	{
-		for (size_t i = 0; i < imgSize; i += channelsCount)
+		for (int j = channelsCount; j < 4; j++)
 		{
-
-			if (mapping[0] != CHANNEL::NONE) //RED
-			{
-				l.rawData[index + mapping[0]] = data[i + 0];
-			}
-
-			if (mapping[1] != CHANNEL::NONE) //GREEN
-			{
-				l.rawData[index + mapping[1]] = data[i + 1];
-			}
-			if (mapping[2] != CHANNEL::NONE) //BLUE
-			{
-				l.rawData[index + mapping[2]] = data[i + 2];
-			}
-
-			//added channels
-			/*
-			if (mapping[3] != CHANNEL::NONE) //ALPHA
-			{
-				l.rawData[index + mapping[3]] = 255;
-			}
-			*/
-
-			index += outChannelsCount;
+			inputChannel[j] = -1;
 		}
 	}
-	else if (channelsCount == 1) //PNG_COLOR_TYPE_GRAY
-	{
-		//data.size() == imgSize
-		
-		const uint64_t MASK = 0x00000000000000ff;
-
-		//end size must be multiple of sizeof(uint64_t)
-		//rest of data is processed after that
-		size_t remain = data.size() % sizeof(uint64_t);
-		size_t endSize = data.size();
-		endSize -= remain;
-		
-		for (size_t i = 0; i < endSize; i += sizeof(uint64_t))
-		{
 
-			//uint64_t val = 0;
-			//memcpy(&val, data.data() + i, sizeof(uint64_t));
-
-			/*
-			uint8_t v[sizeof(uint64_t)];
-			v[0] = static_cast<uint8_t>(val & MASK);
-			v[1] = static_cast<uint8_t>((val & MASK << 8) >> 8);
-			v[2] = static_cast<uint8_t>((val & MASK << 16) >> 16);
-			v[3] = static_cast<uint8_t>((val & MASK << 24) >> 24);
-			v[4] = static_cast<uint8_t>((val & MASK << 32) >> 32);
-			v[5] = static_cast<uint8_t>((val & MASK << 40) >> 40);
-			v[6] = static_cast<uint8_t>((val & MASK << 48) >> 48);
-			v[7] = static_cast<uint8_t>((val & MASK << 56) >> 56);
-			*/
-
-			const uint64_t val = *(reinterpret_cast<const uint64_t *>(data.data() + i));
-
-			const uint8_t v[sizeof(uint64_t)] = {
-				static_cast<uint8_t>(val & MASK),
-				static_cast<uint8_t>((val & MASK << 8) >> 8),
-				static_cast<uint8_t>((val & MASK << 16) >> 16),
-				static_cast<uint8_t>((val & MASK << 24) >> 24),
-				static_cast<uint8_t>((val & MASK << 32) >> 32),
-				static_cast<uint8_t>((val & MASK << 40) >> 40),
-				static_cast<uint8_t>((val & MASK << 48) >> 48),
-				static_cast<uint8_t>((val & MASK << 56) >> 56)
-			};
-		
-			for (size_t j = 0; j < sizeof(uint64_t); j++)
-			{
-				if (mapping[0] != CHANNEL::NONE) //RED
-				{
-					//l.rawData[index + mapping[0]] = data[i];
-					l.rawData[index + mapping[0]] = v[j];
-				}
+	//output is prefilled, added channels are not modified
+	ImageKernels::PixelShuffle shuffle;
+	shuffle.inputPixelBytes = channelsCount;
+	shuffle.outputPixelBytes = outChannelsCount;
+	for (size_t b = 0; b < ImageKernels::PixelShuffle::MAX_PIXEL_BYTES; b++)
+	{
+		shuffle.source[b] = ImageKernels::PixelShuffle::KEEP;
+	}
 
-				index += outChannelsCount;
-			}
-		}
-		
-		
-		for (size_t i = endSize; i < data.size(); i++)
+	for (int j = 0; j < 4; j++)
+	{
+		if ((inputChannel[j] != -1) && (mapping[j] != CHANNEL::NONE) && (mapping[j] < outChannelsCount))
 		{
-			if (mapping[0] != CHANNEL::NONE) //RED
-			{
-				l.rawData[index + mapping[0]] = data[i];
-			}
-			index += outChannelsCount;
+			shuffle.source[static_cast<size_t>(mapping[j])] = static_cast<int8_t>(inputChannel[j]);
 		}
-
 	}
+
+	ImageKernels::ShufflePixels(data.data(), l.rawData.data(), w * h, shuffle);
 }
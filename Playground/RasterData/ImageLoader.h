@@ -55,21 +55,13 @@ private:
 	std::vector<uint8_t> Convert1BitTo8Bit(const std::vector<uint8_t> & data, size_t w, size_t h);
 	std::vector<uint8_t> Convert4BitTo8Bit(const std::vector<uint8_t> & data, size_t w, size_t h);
 
-	void UnpackPallete1Bit(const PNGLoader::DecompressedImage & dec,
+	std::vector<uint8_t> CreateMappedPalette(const PNGLoader::DecompressedImage & dec,
 		int outChannelsCount,
-		const std::array<char, 4> & mapping,
-		std::vector<uint8_t> & target);
-	void UnpackPallete2Bit(const PNGLoader::DecompressedImage & dec,
-		int outChannelsCount,
-		const std::array<char, 4> & mapping,
-		std::vector<uint8_t> & target);
-	void UnpackPallete4Bit(const PNGLoader::DecompressedImage & dec,
-		int outChannelsCount,
-		const std::array<char, 4> & mapping,
-		std::vector<uint8_t> & target);
+		const std::array<char, 4> & mapping) const;
 
-	void WriteToTarget(int index, const PNGLoader::RGBA & val, 
-		const std::array<char, 4> & mapping,
+	static void UnpackRows(const std::vector<uint8_t> & data, size_t w, size_t h,
+		unsigned int bitDepth,
+		const uint8_t * palette, size_t paletteSize, size_t channelsCount,
 		std::vector<uint8_t> & target);
 
 	void ColorMapping(size_t fileIndex, size_t w, size_t, int channelsCount, const std::vector<uint8_t> & data, 
@@ -0,0 +1,316 @@
+#include "./ImageMorphology.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Apply morphological operation to image
+/// </summary>
+/// <param name="img"></param>
+/// <param name="op"></param>
+/// <param name="shape">structuring element</param>
+/// <param name="radiusX">horizontal radius of element (0 - single column)</param>
+/// <param name="radiusY">vertical radius of element (0 - single row)</param>
+/// <param name="border">how values outside of image are computed</param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> ImageMorphology::Apply(const Image2d<T> & img, ImageUtils::MorphologyOperation op,
+	ImageUtils::StructuringElement shape, int radiusX, int radiusY,
+	ImageUtils::BorderMode border)
+{
+	if ((radiusX < 0) || (radiusY < 0))
+	{
+		MY_LOG_ERROR("Invalid structuring element radius [%d, %d]", radiusX, radiusY);
+		return Image2d<T>();
+	}
+
+	if ((img.GetWidth() == 0) || (img.GetHeight() == 0))
+	{
+		return img;
+	}
+
+	switch (op)
+	{
+	case ImageUtils::MorphologyOperation::ERODE:
+		return Filter<T, false>(img, shape, radiusX, radiusY, border);
+
+	case ImageUtils::MorphologyOperation::DILATE:
+		return Filter<T, true>(img, shape, radiusX, radiusY, border);
+
+	case ImageUtils::MorphologyOperation::OPEN:
+		return Filter<T, true>(Filter<T, false>(img, shape, radiusX, radiusY, border),
+			shape, radiusX, radiusY, border);
+
+	case ImageUtils::MorphologyOperation::CLOSE:
+		return Filter<T, false>(Filter<T, true>(img, shape, radiusX, radiusY, border),
+			shape, radiusX, radiusY, border);
+
+	case ImageUtils::MorphologyOperation::GRADIENT:
+	{
+		Image2d<T> res = Filter<T, true>(img, shape, radiusX, radiusY, border);
+		const Image2d<T> eroded = Filter<T, false>(img, shape, radiusX, radiusY, border);
+
+		//element contains center pixel, so dilated value is never smaller than eroded one
+		T * d = res.GetData().data();
+		const T * e = eroded.GetData().data();
+		const size_t len = res.GetData().size();
+
+		for (size_t i = 0; i < len; i++)
+		{
+			d[i] = static_cast<T>(d[i] - e[i]);
+		}
+
+		return res;
+	}
+	}
+
+	return img;
+}
+
+/// <summary>
+/// Erode (IS_MAX = false) or dilate (IS_MAX = true) image
+/// </summary>
+template <typename T, bool IS_MAX>
+Image2d<T> ImageMorphology::Filter(const Image2d<T> & img, ImageUtils::StructuringElement shape,
+	int radiusX, int radiusY, ImageUtils::BorderMode border)
+{
+	Image2d<T> padded = img.CreateWithBorder(radiusX, radiusY, radiusX, radiusY, border);
+
+	Image2d<T> res(img.GetWidth(), img.GetHeight(), img.GetPixelFormat(), img.GetLayout(),
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	PlaneInfo info;
+	info.w = size_t(img.GetWidth());
+	info.channelsCount = img.GetPlaneChannelsCount();
+	info.rowLen = info.w * info.channelsCount;
+	info.srcRowLen = (info.w + 2 * size_t(radiusX)) * info.channelsCount;
+	info.radiusX = size_t(radiusX);
+	info.radiusY = size_t(radiusY);
+
+	//strip shorter than block of 2 * radiusY + 1 rows would compute suffixes of rows it does not output
+	const size_t stripRows = std::max(size_t(MIN_STRIP_ROWS), 4 * info.radiusY + 2);
+
+	for (size_t p = 0; p < img.GetPlanesCount(); p++)
+	{
+		const T * src = padded.GetPlaneStart(p);
+		T * dst = res.GetPlaneStart(p);
+
+		MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(img.GetHeight()), stripRows,
+			[&](size_t y0, size_t y1) {
+			FilterStrip<T, IS_MAX>(src, dst, y0, y1, info, shape);
+		});
+	}
+
+	return res;
+}
+
+/// <summary>
+/// Compute output rows [y0, y1) of single plane
+/// Rectangle: vertical pass of padded rows to strip buffer,
+/// horizontal pass of strip buffer to output.
+/// Cross: vertical pass of center columns directly to output,
+/// horizontal pass of center rows is merged to it.
+///
+/// Horizontal pass transposes chunks of rows, so it is vertical pass
+/// over columns of pixels with the same SIMD min / max as vertical direction.
+/// </summary>
+/// <param name="src">padded input (w + 2 * radiusX) x (h + 2 * radiusY)</param>
+/// <param name="dst">output w x h</param>
+/// <param name="y0"></param>
+/// <param name="y1"></param>
+/// <param name="info"></param>
+/// <param name="shape"></param>
+template <typename T, bool IS_MAX>
+void ImageMorphology::FilterStrip(const T * src, T * dst, size_t y0, size_t y1,
+	const PlaneInfo & info, ImageUtils::StructuringElement shape)
+{
+	const size_t rows = y1 - y0;
+	const size_t c = info.channelsCount;
+	const bool rect = (shape == ImageUtils::StructuringElement::RECTANGLE);
+
+	//input of horizontal pass: rows of (w + 2 * radiusX) pixels with srcRowLen step
+	const T * rowsSrc = nullptr;
+	std::vector<T> columns;
+
+	if (rect == false)
+	{
+		FilterColumns<T, IS_MAX>(src + y0 * info.srcRowLen + info.radiusX * c, info.srcRowLen,
+			dst + y0 * info.rowLen, info.rowLen, info.rowLen, rows, info.radiusY);
+		rowsSrc = src + (y0 + info.radiusY) * info.srcRowLen;
+	}
+	else if (info.radiusY > 0)
+	{
+		columns.resize(rows * info.srcRowLen);
+		FilterColumns<T, IS_MAX>(src + y0 * info.srcRowLen, info.srcRowLen,
+			columns.data(), info.srcRowLen, info.srcRowLen, rows, info.radiusY);
+		rowsSrc = columns.data();
+	}
+	else
+	{
+		rowsSrc = src + y0 * info.srcRowLen;
+	}
+
+	if (info.radiusX == 0)
+	{
+		for (size_t y = 0; y < rows; y++)
+		{
+			const T * in = rowsSrc + y * info.srcRowLen;
+			T * out = dst + (y0 + y) * info.rowLen;
+			if (rect)
+			{
+				std::copy(in, in + info.rowLen, out);
+			}
+			else
+			{
+				Combine<T, IS_MAX>(in, out, out, info.rowLen);
+			}
+		}
+		return;
+	}
+
+	const size_t srcW = info.w + 2 * info.radiusX;
+	const size_t pixelBytes = c * sizeof(T);
+	const size_t chunkRows = std::min(rows,
+		std::clamp(TILE_BYTES / (srcW * pixelBytes), size_t(MIN_TRANSPOSED_ROWS), size_t(MAX_TRANSPOSED_ROWS)));
+
+	std::vector<T> transposed(srcW * chunkRows * c);
+	std::vector<T> filtered(info.w * chunkRows * c);
+	std::vector<T> crossRows;
+	if (rect == false)
+	{
+		crossRows.resize(chunkRows * info.rowLen);
+	}
+
+	for (size_t cy = 0; cy < rows; cy += chunkRows)
+	{
+		const size_t n = std::min(chunkRows, rows - cy);
+		const size_t len = n * c;
+
+		ImageKernels::TransposePixels(reinterpret_cast<const uint8_t *>(rowsSrc + cy * info.srcRowLen),
+			ptrdiff_t(info.srcRowLen * sizeof(T)), reinterpret_cast<uint8_t *>(transposed.data()),
+			ptrdiff_t(len * sizeof(T)), srcW, n, pixelBytes);
+
+		FilterColumns<T, IS_MAX>(transposed.data(), len, filtered.data(), len, len, info.w, info.radiusX);
+
+		T * out = dst + (y0 + cy) * info.rowLen;
+		T * tmp = (rect) ? out : crossRows.data();
+
+		ImageKernels::TransposePixels(reinterpret_cast<const uint8_t *>(filtered.data()),
+			ptrdiff_t(len * sizeof(T)), reinterpret_cast<uint8_t *>(tmp),
+			ptrdiff_t(info.rowLen * sizeof(T)), n, info.w, pixelBytes);
+
+		if (rect == false)
+		{
+			//output rows of chunk are contiguous
+			Combine<T, IS_MAX>(tmp, out, out, n * info.rowLen);
+		}
+	}
+}
+
+/// <summary>
+/// Van Herk / Gil-Werman pass over columns
+/// Output row y is min / max of input rows [y, y + 2 * radius]
+/// Rows are split to blocks of 2 * radius + 1 rows starting at the first output row.
+/// Output row at block start is the whole block (its suffix),
+/// other rows are suffix of their block merged with prefix of the next block.
+/// Suffixes of block are kept for column tile, prefix is accumulated in one row.
+/// </summary>
+/// <param name="src">input rows [0, rows + 2 * radius)</param>
+/// <param name="srcRowLen"></param>
+/// <param name="dst">output rows [0, rows)</param>
+/// <param name="dstRowLen"></param>
+/// <param name="len">number of values in row</param>
+/// <param name="rows"></param>
+/// <param name="radius"></param>
+template <typename T, bool IS_MAX>
+void ImageMorphology::FilterColumns(const T * src, size_t srcRowLen, T * dst, size_t dstRowLen,
+	size_t len, size_t rows, size_t radius)
+{
+	if (radius == 0)
+	{
+		for (size_t y = 0; y < rows; y++)
+		{
+			std::copy(src + y * srcRowLen, src + y * srcRowLen + len, dst + y * dstRowLen);
+		}
+		return;
+	}
+
+	const size_t k = 2 * radius + 1;
+
+	size_t tileLen = TILE_BYTES / (k * sizeof(T));
+	tileLen = std::max<size_t>(64, tileLen - tileLen % 64);
+	tileLen = std::min(tileLen, len);
+
+	std::vector<T> suffix(k * tileLen);
+	std::vector<T> prefix(tileLen);
+
+	for (size_t t0 = 0; t0 < len; t0 += tileLen)
+	{
+		const size_t n = std::min(tileLen, len - t0);
+
+		for (size_t b = 0; b < rows; b += k)
+		{
+			//suffixes of input rows [b, b + k)
+			T * s = suffix.data();
+			const T * last = src + (b + k - 1) * srcRowLen + t0;
+			std::copy(last, last + n, s + (k - 1) * tileLen);
+
+			for (size_t j = k - 1; j-- > 0;)
+			{
+				Combine<T, IS_MAX>(src + (b + j) * srcRowLen + t0, s + (j + 1) * tileLen, s + j * tileLen, n);
+			}
+
+			std::copy(s, s + n, dst + b * dstRowLen + t0);
+
+			//prefixes of input rows [b + k, b + k + j)
+			const size_t blockRows = std::min(k, rows - b);
+			const T * p = nullptr;
+
+			for (size_t j = 1; j < blockRows; j++)
+			{
+				const T * in = src + (b + k + j - 1) * srcRowLen + t0;
+				if (j == 1)
+				{
+					p = in;
+				}
+				else
+				{
+					Combine<T, IS_MAX>(p, in, prefix.data(), n);
+					p = prefix.data();
+				}
+
+				Combine<T, IS_MAX>(s + j * tileLen, p, dst + (b + j) * dstRowLen + t0, n);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Element-wise min / max of a and b
+/// </summary>
+template <typename T, bool IS_MAX>
+void ImageMorphology::Combine(const T * a, const T * b, T * output, size_t count)
+{
+	if constexpr (IS_MAX)
+	{
+		ImageKernels::Max(a, b, output, count);
+	}
+	else
+	{
+		ImageKernels::Min(a, b, output, count);
+	}
+}
+
+//=================================================================================================
+
+template Image2d<uint8_t> ImageMorphology::Apply(const Image2d<uint8_t> & img,
+	ImageUtils::MorphologyOperation op, ImageUtils::StructuringElement shape,
+	int radiusX, int radiusY, ImageUtils::BorderMode border);
+template Image2d<float> ImageMorphology::Apply(const Image2d<float> & img,
+	ImageUtils::MorphologyOperation op, ImageUtils::StructuringElement shape,
+	int radiusX, int radiusY, ImageUtils::BorderMode border);
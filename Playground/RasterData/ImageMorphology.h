@@ -0,0 +1,65 @@
+#ifndef IMAGE_MORPHOLOGY_H
+#define IMAGE_MORPHOLOGY_H
+
+#include <cstddef>
+
+#include "./Image2d.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Morphology of Image2d<uint8_t / float> with rectangle or cross structuring element
+/// Each channel is processed separately, output has the same format and layout as input.
+///
+/// Erode / dilate are separable into 1D min / max over lines of 2 * r + 1 values,
+/// both are computed by van Herk / Gil-Werman algorithm: line is split to blocks
+/// of window size, prefix and suffix min / max of each block are computed and
+/// window value is min / max of suffix at its start and prefix at its end.
+/// Cost is 3 min / max per value regardless of radius.
+///
+/// Both passes work on whole rows with SIMD ImageKernels::Min / Max
+/// (rows are processed in column tiles, so block of rows stays in cache),
+/// horizontal pass runs on chunks of rows transposed with ImageKernels::TransposePixels.
+/// Image is padded once based on border mode, strips of rows run in parallel
+/// on the shared ThreadPool.
+/// </summary>
+class ImageMorphology
+{
+public:
+	template <typename T>
+	static Image2d<T> Apply(const Image2d<T> & img, ImageUtils::MorphologyOperation op,
+		ImageUtils::StructuringElement shape, int radiusX, int radiusY,
+		ImageUtils::BorderMode border);
+
+private:
+	static const size_t TILE_BYTES = 256 * 1024;
+	static const size_t MIN_STRIP_ROWS = 32;
+	static const size_t MIN_TRANSPOSED_ROWS = 16;
+	static const size_t MAX_TRANSPOSED_ROWS = 256;
+
+	struct PlaneInfo
+	{
+		size_t w;
+		size_t channelsCount;
+		size_t rowLen;		//number of values in output row
+		size_t srcRowLen;	//number of values in padded input row
+		size_t radiusX;
+		size_t radiusY;
+	};
+
+	template <typename T, bool IS_MAX>
+	static Image2d<T> Filter(const Image2d<T> & img, ImageUtils::StructuringElement shape,
+		int radiusX, int radiusY, ImageUtils::BorderMode border);
+
+	template <typename T, bool IS_MAX>
+	static void FilterStrip(const T * src, T * dst, size_t y0, size_t y1,
+		const PlaneInfo & info, ImageUtils::StructuringElement shape);
+
+	template <typename T, bool IS_MAX>
+	static void FilterColumns(const T * src, size_t srcRowLen, T * dst, size_t dstRowLen,
+		size_t len, size_t rows, size_t radius);
+
+	template <typename T, bool IS_MAX>
+	static void Combine(const T * a, const T * b, T * output, size_t count);
+};
+
+#endif
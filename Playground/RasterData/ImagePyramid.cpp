@@ -0,0 +1,346 @@
+#include "./ImagePyramid.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+template <typename T>
+ImagePyramid<T>::ImagePyramid() :
+	filter(ImageUtils::PyramidFilter::BOX),
+	pf(ColorSpace::PixelFormat::NONE),
+	channelsCount(0)
+{
+}
+
+/// <summary>
+/// Build pyramid of img
+/// </summary>
+/// <param name="img"></param>
+/// <param name="filter">downsampling filter</param>
+/// <param name="maxLevelsCount">max number of levels including level 0
+/// (0 - all levels down to 1x1)</param>
+/// <param name="parallel">compute large levels in parallel</param>
+template <typename T>
+ImagePyramid<T>::ImagePyramid(const Image2d<T> & img, ImageUtils::PyramidFilter filter,
+	size_t maxLevelsCount, bool parallel) :
+	filter(filter),
+	pf(img.GetPixelFormat()),
+	channelsCount(img.GetChannelsCount())
+{
+	if ((img.GetWidth() == 0) || (img.GetHeight() == 0))
+	{
+		MY_LOG_ERROR("Pyramid can not be created from empty image");
+		return;
+	}
+
+	if (img.GetLayout() == ImageUtils::DataLayout::PLANAR)
+	{
+		Image2d<T> tmp = img;
+		tmp.SetLayout(ImageUtils::DataLayout::INTERLEAVED);
+		this->Build(tmp.GetData().data(), tmp.GetDimension(), maxLevelsCount, parallel);
+	}
+	else
+	{
+		this->Build(img.GetData().data(), img.GetDimension(), maxLevelsCount, parallel);
+	}
+}
+
+/// <summary>
+/// Allocate all levels, copy base to level 0 and compute other levels
+/// </summary>
+/// <param name="base">interleaved input data</param>
+/// <param name="baseDim"></param>
+/// <param name="maxLevelsCount"></param>
+/// <param name="parallel"></param>
+template <typename T>
+void ImagePyramid<T>::Build(const T * base, const ImageDimension & baseDim,
+	size_t maxLevelsCount, bool parallel)
+{
+	const size_t c = this->channelsCount;
+	const size_t alignment = std::max<size_t>(1, ALIGNMENT_BYTES / sizeof(T));
+
+	//level sizes and aligned offsets
+	ImageDimension dim = baseDim;
+	size_t offset = 0;
+	while (true)
+	{
+		this->levels.push_back({ dim, offset });
+		offset += size_t(dim.w) * size_t(dim.h) * c;
+		offset = (offset + alignment - 1) / alignment * alignment;
+
+		if ((dim.w == 1) && (dim.h == 1))
+		{
+			break;
+		}
+		if ((maxLevelsCount != 0) && (this->levels.size() >= maxLevelsCount))
+		{
+			break;
+		}
+
+		dim = { std::max(1, dim.w / 2), std::max(1, dim.h / 2) };
+	}
+
+	this->data.resize(offset);
+	std::memcpy(this->data.data(), base, size_t(baseDim.w) * size_t(baseDim.h) * c * sizeof(T));
+
+	const size_t levelsCount = this->levels.size();
+
+	//large levels - whole level at once, rows in parallel
+	size_t first = 1;
+	if (parallel)
+	{
+		auto pool = MyUtils::ThreadPool::GetInstance();
+
+		for (; first < levelsCount; first++)
+		{
+			const ImageDimension & d = this->levels[first].dim;
+			if (size_t(d.w) * size_t(d.h) < PARALLEL_MIN_PIXELS)
+			{
+				break;
+			}
+
+			const size_t prevRowLen = size_t(this->levels[first - 1].dim.w) * c;
+			const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / prevRowLen);
+
+			pool->ParallelFor(0, size_t(d.h), grainRows, [&](size_t y0, size_t y1) {
+				std::vector<AccType> tmp(prevRowLen);
+				for (size_t y = y0; y < y1; y++)
+				{
+					this->DownsampleRow(first, int(y), tmp.data());
+				}
+			});
+		}
+	}
+
+	if (first >= levelsCount)
+	{
+		return;
+	}
+
+	//other levels - streamed, rows of the next levels are created
+	//as soon as their input rows are ready
+	std::vector<int> produced(levelsCount, 0);
+	produced[first - 1] = this->levels[first - 1].dim.h;
+
+	std::vector<AccType> tmp(size_t(this->levels[first - 1].dim.w) * c);
+
+	for (int y = 0; y < this->levels[first].dim.h; y++)
+	{
+		this->DownsampleRow(first, y, tmp.data());
+		produced[first]++;
+
+		for (size_t l = first + 1; l < levelsCount; l++)
+		{
+			while ((produced[l] < this->levels[l].dim.h) &&
+				(this->GetRowsNeeded(l, produced[l]) <= produced[l - 1]))
+			{
+				this->DownsampleRow(l, produced[l], tmp.data());
+				produced[l]++;
+			}
+		}
+	}
+}
+
+//=================================================================================================
+// Getters
+//=================================================================================================
+
+template <typename T>
+size_t ImagePyramid<T>::GetLevelsCount() const noexcept
+{
+	return this->levels.size();
+}
+
+template <typename T>
+ColorSpace::PixelFormat ImagePyramid<T>::GetPixelFormat() const noexcept
+{
+	return this->pf;
+}
+
+template <typename T>
+size_t ImagePyramid<T>::GetChannelsCount() const noexcept
+{
+	return this->channelsCount;
+}
+
+template <typename T>
+ImageUtils::PyramidFilter ImagePyramid<T>::GetFilter() const noexcept
+{
+	return this->filter;
+}
+
+/// <summary>
+/// Get size of level
+/// Returns 0 x 0 for invalid level
+/// </summary>
+/// <param name="level"></param>
+/// <returns></returns>
+template <typename T>
+ImageDimension ImagePyramid<T>::GetLevelDimension(size_t level) const
+{
+	if (level >= this->levels.size())
+	{
+		MY_LOG_ERROR("Invalid pyramid level %zu", level);
+		return { 0, 0 };
+	}
+
+	return this->levels[level].dim;
+}
+
+/// <summary>
+/// Create read-only view to level data
+/// View is valid while the pyramid exists
+/// </summary>
+/// <param name="level"></param>
+/// <returns></returns>
+template <typename T>
+Image2dView<const T> ImagePyramid<T>::GetLevelView(size_t level) const
+{
+	if (level >= this->levels.size())
+	{
+		MY_LOG_ERROR("Invalid pyramid level %zu", level);
+		return Image2dView<const T>();
+	}
+
+	const Level & l = this->levels[level];
+	return Image2dView<const T>(this->data.data() + l.offset, l.dim, this->pf,
+		this->channelsCount, ImageUtils::DataLayout::INTERLEAVED,
+		size_t(l.dim.w) * this->channelsCount, this->channelsCount, 1);
+}
+
+/// <summary>
+/// Create copy of level data as standalone image
+/// </summary>
+/// <param name="level"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> ImagePyramid<T>::CreateLevelImage(size_t level) const
+{
+	if (level >= this->levels.size())
+	{
+		MY_LOG_ERROR("Invalid pyramid level %zu", level);
+		return Image2d<T>();
+	}
+
+	return this->GetLevelView(level).CreateImage();
+}
+
+//=================================================================================================
+// Downsampling
+//=================================================================================================
+
+/// <summary>
+/// Get number of rows of the previous level that must be ready
+/// to create row y of level
+/// </summary>
+/// <param name="level"></param>
+/// <param name="y"></param>
+/// <returns></returns>
+template <typename T>
+int ImagePyramid<T>::GetRowsNeeded(size_t level, int y) const noexcept
+{
+	const int lastRow = (this->filter == ImageUtils::PyramidFilter::BOX) ? 2 * y + 1 : 2 * y + 2;
+	return std::min(lastRow, this->levels[level - 1].dim.h - 1) + 1;
+}
+
+/// <summary>
+/// Create row y of level from the previous level
+/// Rows are summed vertically to tmp first, columns of tmp are summed horizontally
+/// BOX: rows / columns 2y, 2y + 1 with weights 1, 1
+/// GAUSSIAN: rows / columns 2y - 2 ... 2y + 2 with weights 1, 4, 6, 4, 1
+/// </summary>
+/// <param name="level"></param>
+/// <param name="y"></param>
+/// <param name="tmp">buffer for row of the previous level</param>
+template <typename T>
+void ImagePyramid<T>::DownsampleRow(size_t level, int y, AccType * tmp)
+{
+	const size_t c = this->channelsCount;
+	const Level & src = this->levels[level - 1];
+	const Level & dst = this->levels[level];
+
+	const int srcW = src.dim.w;
+	const int srcH = src.dim.h;
+	const size_t srcRowLen = size_t(srcW) * c;
+
+	auto srcRow = [&](int r) -> const T * {
+		r = std::max(0, std::min(srcH - 1, r));
+		return this->data.data() + src.offset + size_t(r) * srcRowLen;
+	};
+
+	T * out = this->data.data() + dst.offset + size_t(y) * size_t(dst.dim.w) * c;
+
+	if (this->filter == ImageUtils::PyramidFilter::BOX)
+	{
+		const T * r0 = srcRow(2 * y);
+		const T * r1 = srcRow(2 * y + 1);
+		for (size_t i = 0; i < srcRowLen; i++)
+		{
+			tmp[i] = AccType(r0[i]) + AccType(r1[i]);
+		}
+
+		for (int x = 0; x < dst.dim.w; x++)
+		{
+			const AccType * a = tmp + size_t(std::min(2 * x, srcW - 1)) * c;
+			const AccType * b = tmp + size_t(std::min(2 * x + 1, srcW - 1)) * c;
+			for (size_t ch = 0; ch < c; ch++)
+			{
+				const AccType sum = a[ch] + b[ch];
+				if constexpr (std::is_same<T, uint8_t>::value)
+				{
+					out[ch] = static_cast<T>((sum + 2) >> 2);
+				}
+				else
+				{
+					out[ch] = sum * 0.25f;
+				}
+			}
+			out += c;
+		}
+		return;
+	}
+
+	const T * r0 = srcRow(2 * y - 2);
+	const T * r1 = srcRow(2 * y - 1);
+	const T * r2 = srcRow(2 * y);
+	const T * r3 = srcRow(2 * y + 1);
+	const T * r4 = srcRow(2 * y + 2);
+	for (size_t i = 0; i < srcRowLen; i++)
+	{
+		tmp[i] = AccType(r0[i]) + AccType(r4[i]) +
+			AccType(4) * (AccType(r1[i]) + AccType(r3[i])) + AccType(6) * AccType(r2[i]);
+	}
+
+	for (int x = 0; x < dst.dim.w; x++)
+	{
+		const AccType * p0 = tmp + size_t(std::max(0, 2 * x - 2)) * c;
+		const AccType * p1 = tmp + size_t(std::max(0, 2 * x - 1)) * c;
+		const AccType * p2 = tmp + size_t(std::min(2 * x, srcW - 1)) * c;
+		const AccType * p3 = tmp + size_t(std::min(2 * x + 1, srcW - 1)) * c;
+		const AccType * p4 = tmp + size_t(std::min(2 * x + 2, srcW - 1)) * c;
+		for (size_t ch = 0; ch < c; ch++)
+		{
+			const AccType sum = p0[ch] + p4[ch] + AccType(4) * (p1[ch] + p3[ch]) + AccType(6) * p2[ch];
+			if constexpr (std::is_same<T, uint8_t>::value)
+			{
+				out[ch] = static_cast<T>((sum + 128) >> 8);
+			}
+			else
+			{
+				out[ch] = sum * (1.0f / 256.0f);
+			}
+		}
+		out += c;
+	}
+}
+
+//=================================================================================================
+
+template class ImagePyramid<uint8_t>;
+template class ImagePyramid<float>;
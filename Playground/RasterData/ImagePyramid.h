@@ -0,0 +1,69 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "./Image2d.h"
+#include "./Image2dView.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Image pyramid (mipmap chain) of Image2d<uint8_t / float>
+/// Level 0 is copy of the input, each next level has half size
+/// (max(1, w / 2) x max(1, h / 2)) and is created from the previous one
+/// by ImageUtils::PyramidFilter. Values outside of level are clamped.
+///
+/// All levels are stored interleaved in one contiguous buffer,
+/// each level starts at 64-byte aligned offset.
+///
+/// Large levels are computed with rows in parallel on the shared ThreadPool.
+/// Remaining levels are streamed - each row is created as soon as all rows
+/// it needs are ready in the previous level, so they are still in cache.
+/// </summary>
+template <typename T>
+class ImagePyramid
+{
+public:
+	ImagePyramid();
+	ImagePyramid(const Image2d<T> & img, ImageUtils::PyramidFilter filter,
+		size_t maxLevelsCount = 0, bool parallel = true);
+
+	size_t GetLevelsCount() const noexcept;
+	ColorSpace::PixelFormat GetPixelFormat() const noexcept;
+	size_t GetChannelsCount() const noexcept;
+	ImageUtils::PyramidFilter GetFilter() const noexcept;
+
+	ImageDimension GetLevelDimension(size_t level) const;
+	Image2dView<const T> GetLevelView(size_t level) const;
+	Image2d<T> CreateLevelImage(size_t level) const;
+
+protected:
+	//sums of uint8_t values are exact in integers
+	typedef typename std::conditional<std::is_same<T, uint8_t>::value, uint32_t, float>::type AccType;
+
+	static const size_t PARALLEL_MIN_PIXELS = 512 * 512;
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+	static const size_t ALIGNMENT_BYTES = 64;
+
+	struct Level
+	{
+		ImageDimension dim;
+		size_t offset;		//offset of level data in values
+	};
+
+	ImageUtils::PyramidFilter filter;
+	ColorSpace::PixelFormat pf;
+	size_t channelsCount;
+
+	std::vector<Level> levels;
+	ImageBuffer<T> data;
+
+	void Build(const T * base, const ImageDimension & baseDim, size_t maxLevelsCount, bool parallel);
+	int GetRowsNeeded(size_t level, int y) const noexcept;
+	void DownsampleRow(size_t level, int y, AccType * tmp);
+};
+
+#endif
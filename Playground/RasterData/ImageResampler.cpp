@@ -0,0 +1,346 @@
+#include "./ImageResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Resize image to new size
+/// Output has the same format and layout as input
+/// </summary>
+/// <param name="img"></param>
+/// <param name="size">output size</param>
+/// <param name="mode">resampling filter</param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> ImageResampler::Resize(const Image2d<T> & img, const ImageDimension & size,
+	ImageUtils::ResampleMode mode)
+{
+	if ((size.w <= 0) || (size.h <= 0))
+	{
+		MY_LOG_ERROR("Invalid resize dimension %d x %d", size.w, size.h);
+		return Image2d<T>();
+	}
+
+	if ((img.GetWidth() == 0) || (img.GetHeight() == 0))
+	{
+		MY_LOG_ERROR("Empty image can not be resized");
+		return Image2d<T>();
+	}
+
+	Image2d<T> res(size.w, size.h, img.GetPixelFormat(), img.GetLayout(),
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	const AxisCoefficients cx = CreateCoefficients(img.GetWidth(), size.w, mode);
+	const AxisCoefficients cy = CreateCoefficients(img.GetHeight(), size.h, mode);
+
+	const size_t c = img.GetPlaneChannelsCount();
+
+	for (size_t p = 0; p < img.GetPlanesCount(); p++)
+	{
+		const T * src = img.GetPlaneStart(p);
+		T * dst = res.GetPlaneStart(p);
+
+		if (mode == ImageUtils::ResampleMode::NEAREST)
+		{
+			ResizePlaneNearest(src, dst, img.GetDimension(), size, c, cx, cy);
+		}
+		else
+		{
+			ResizePlane(src, dst, img.GetDimension(), size, c, cx, cy);
+		}
+	}
+
+	return res;
+}
+
+//=================================================================================================
+// Filter weights
+//=================================================================================================
+
+/// <summary>
+/// Lanczos kernel with 3 lobes
+/// </summary>
+/// <param name="x"></param>
+/// <returns></returns>
+double ImageResampler::Lanczos3(double x) noexcept
+{
+	static const double PI = 3.14159265358979323846;
+
+	x = std::abs(x);
+	if (x < 1e-8)
+	{
+		return 1.0;
+	}
+	if (x >= 3.0)
+	{
+		return 0.0;
+	}
+
+	const double px = PI * x;
+	return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+}
+
+/// <summary>
+/// Compute filter weights of single axis
+/// Weights of positions outside of input are moved to the border position,
+/// weights of each output position are normalized to sum 1.
+/// All output positions use the same number of taps (the largest needed),
+/// unused taps have zero weight. Taps never reach outside of input.
+/// </summary>
+/// <param name="inputSize"></param>
+/// <param name="outputSize"></param>
+/// <param name="mode"></param>
+/// <returns></returns>
+ImageResampler::AxisCoefficients ImageResampler::CreateCoefficients(int inputSize, int outputSize,
+	ImageUtils::ResampleMode mode)
+{
+	const double scale = double(inputSize) / double(outputSize);
+
+	//weights of input positions [first[i], first[i] + w[i].size()) for each output i
+	std::vector<int> first(outputSize);
+	std::vector<std::vector<double>> w(outputSize);
+
+	for (int i = 0; i < outputSize; i++)
+	{
+		const double center = (i + 0.5) * scale;
+
+		int j0 = 0;
+		std::vector<double> tmp;
+
+		switch (mode)
+		{
+		case ImageUtils::ResampleMode::NEAREST:
+			j0 = std::min(inputSize - 1, int(std::floor(center)));
+			tmp.push_back(1.0);
+			break;
+
+		case ImageUtils::ResampleMode::BILINEAR:
+		{
+			const double pos = center - 0.5;
+			j0 = int(std::floor(pos));
+			const double f = pos - j0;
+			tmp.push_back(1.0 - f);
+			tmp.push_back(f);
+			break;
+		}
+
+		case ImageUtils::ResampleMode::AREA:
+		{
+			//output pixel covers input interval [a, b)
+			const double a = i * scale;
+			const double b = (i + 1) * scale;
+			j0 = int(std::floor(a));
+			const int j1 = int(std::ceil(b));
+			for (int j = j0; j < j1; j++)
+			{
+				tmp.push_back(std::max(0.0, std::min(b, j + 1.0) - std::max(a, double(j))));
+			}
+			break;
+		}
+
+		case ImageUtils::ResampleMode::LANCZOS3:
+		{
+			//filter is stretched for downscale
+			const double filterScale = std::max(1.0, scale);
+			const double support = 3.0 * filterScale;
+			j0 = int(std::floor(center - support));
+			const int j1 = int(std::ceil(center + support));
+			for (int j = j0; j <= j1; j++)
+			{
+				tmp.push_back(Lanczos3((j + 0.5 - center) / filterScale));
+			}
+			break;
+		}
+		}
+
+		//clamp positions to input
+		const int lo = std::max(0, std::min(inputSize - 1, j0));
+		const int hi = std::max(0, std::min(inputSize - 1, j0 + int(tmp.size()) - 1));
+
+		std::vector<double> & wi = w[i];
+		wi.assign(size_t(hi - lo + 1), 0.0);
+		for (size_t k = 0; k < tmp.size(); k++)
+		{
+			const int j = std::max(lo, std::min(hi, j0 + int(k)));
+			wi[size_t(j - lo)] += tmp[k];
+		}
+
+		//remove zero weights at the ends
+		size_t b = 0;
+		size_t e = wi.size();
+		while ((e > b + 1) && (wi[e - 1] == 0.0)) e--;
+		while ((b + 1 < e) && (wi[b] == 0.0)) b++;
+		wi = std::vector<double>(wi.begin() + b, wi.begin() + e);
+		first[i] = lo + int(b);
+	}
+
+	AxisCoefficients res;
+	res.taps = 1;
+	for (const auto & wi : w)
+	{
+		res.taps = std::max(res.taps, wi.size());
+	}
+
+	res.starts.resize(outputSize);
+	res.weights.assign(size_t(outputSize) * res.taps, 0.0f);
+
+	for (int i = 0; i < outputSize; i++)
+	{
+		const std::vector<double> & wi = w[i];
+
+		double sum = 0.0;
+		for (double v : wi)
+		{
+			sum += v;
+		}
+		if (std::abs(sum) < 1e-12)
+		{
+			sum = 1.0;
+		}
+
+		//move window inside input, weights are shifted accordingly
+		const int start = std::max(0, std::min(first[i], inputSize - int(res.taps)));
+		res.starts[i] = int32_t(start);
+
+		float * dst = res.weights.data() + size_t(i) * res.taps + size_t(first[i] - start);
+		for (size_t k = 0; k < wi.size(); k++)
+		{
+			dst[k] = float(wi[k] / sum);
+		}
+	}
+
+	return res;
+}
+
+//=================================================================================================
+// Resize of single plane
+//=================================================================================================
+
+/// <summary>
+/// Resize single plane of interleaved data with nearest pixel
+/// Pixels are copied directly (each axis has single tap with weight 1)
+/// </summary>
+template <typename T>
+void ImageResampler::ResizePlaneNearest(const T * src, T * dst, const ImageDimension & srcSize,
+	const ImageDimension & dstSize, size_t channelsCount,
+	const AxisCoefficients & cx, const AxisCoefficients & cy)
+{
+	const size_t c = channelsCount;
+	const size_t srcRowLen = size_t(srcSize.w) * c;
+	const size_t dstRowLen = size_t(dstSize.w) * c;
+
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / dstRowLen);
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(dstSize.h), grainRows,
+		[&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; y++)
+		{
+			const T * in = src + size_t(cy.starts[y]) * srcRowLen;
+			T * out = dst + y * dstRowLen;
+
+			if ((y > y0) && (cy.starts[y] == cy.starts[y - 1]))
+			{
+				std::memcpy(out, out - dstRowLen, dstRowLen * sizeof(T));
+				continue;
+			}
+
+			for (int x = 0; x < dstSize.w; x++)
+			{
+				const T * px = in + size_t(cx.starts[x]) * c;
+				for (size_t ch = 0; ch < c; ch++)
+				{
+					out[ch] = px[ch];
+				}
+				out += c;
+			}
+		}
+	});
+}
+
+/// <summary>
+/// Resize single plane of interleaved data with filter weights
+/// 1. horizontal pass of all input rows to float buffer (rows in parallel)
+/// 2. vertical pass of output rows from the buffer (rows in parallel)
+/// </summary>
+template <typename T>
+void ImageResampler::ResizePlane(const T * src, T * dst, const ImageDimension & srcSize,
+	const ImageDimension & dstSize, size_t channelsCount,
+	const AxisCoefficients & cx, const AxisCoefficients & cy)
+{
+	const size_t c = channelsCount;
+	const size_t srcRowLen = size_t(srcSize.w) * c;
+	const size_t dstRowLen = size_t(dstSize.w) * c;
+
+	auto pool = MyUtils::ThreadPool::GetInstance();
+
+	//horizontally resampled input rows
+	ImageBuffer<float> tmp(size_t(srcSize.h) * dstRowLen);
+
+	const size_t grainRowsH = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (srcRowLen + dstRowLen));
+	pool->ParallelFor(0, size_t(srcSize.h), grainRowsH, [&](size_t y0, size_t y1) {
+		std::vector<float> srcRow;
+		if constexpr (std::is_same<T, float>::value == false)
+		{
+			srcRow.resize(srcRowLen);
+		}
+
+		for (size_t y = y0; y < y1; y++)
+		{
+			const float * in = nullptr;
+			if constexpr (std::is_same<T, float>::value)
+			{
+				in = src + y * srcRowLen;
+			}
+			else
+			{
+				ImageKernels::Convert(src + y * srcRowLen, srcRow.data(), srcRowLen);
+				in = srcRow.data();
+			}
+
+			ImageKernels::ResampleRow(in, size_t(srcSize.w), c,
+				cx.starts.data(), cx.weights.data(), cx.taps,
+				size_t(dstSize.w), tmp.data() + y * dstRowLen);
+		}
+	});
+
+	const size_t grainRowsV = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (dstRowLen * cy.taps));
+	pool->ParallelFor(0, size_t(dstSize.h), grainRowsV, [&](size_t y0, size_t y1) {
+		std::vector<float> outRow;
+		if constexpr (std::is_same<T, float>::value == false)
+		{
+			outRow.resize(dstRowLen);
+		}
+
+		for (size_t y = y0; y < y1; y++)
+		{
+			const float * first = tmp.data() + size_t(cy.starts[y]) * dstRowLen;
+			const float * weights = cy.weights.data() + y * cy.taps;
+
+			if constexpr (std::is_same<T, float>::value)
+			{
+				ImageKernels::ConvolveRow(first, dstRowLen, dstRowLen, weights, cy.taps,
+					dst + y * dstRowLen, false);
+			}
+			else
+			{
+				ImageKernels::ConvolveRow(first, dstRowLen, dstRowLen, weights, cy.taps,
+					outRow.data(), false);
+				ImageKernels::ConvertSaturated(outRow.data(), dst + y * dstRowLen, dstRowLen);
+			}
+		}
+	});
+}
+
+//=================================================================================================
+
+template Image2d<uint8_t> ImageResampler::Resize(const Image2d<uint8_t> & img,
+	const ImageDimension & size, ImageUtils::ResampleMode mode);
+template Image2d<float> ImageResampler::Resize(const Image2d<float> & img,
+	const ImageDimension & size, ImageUtils::ResampleMode mode);
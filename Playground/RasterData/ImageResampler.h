@@ -0,0 +1,63 @@
+#ifndef IMAGE_RESAMPLER_H
+#define IMAGE_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./Image2d.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Resize of Image2d<uint8_t / float> with ImageUtils::ResampleMode filter
+///
+/// Filter weights are precomputed once per axis: each output column (row) is
+/// weighted sum of fixed number of consecutive input columns (rows).
+/// Pixel centers are aligned ((x + 0.5) * scale), values outside of image are clamped.
+/// AREA and LANCZOS3 filters are widened by scale for downscale, so they do not alias.
+///
+/// Resize is separable: input rows are resampled horizontally to float buffer
+/// (SIMD ImageKernels::ResampleRow) and output rows are computed as weighted sum
+/// of buffer rows (SIMD ImageKernels::ConvolveRow). Both passes run over rows
+/// in parallel on the shared ThreadPool.
+/// NEAREST copies pixels directly without float conversion.
+///
+/// Each channel is resampled separately, uint8_t output is rounded and saturated.
+/// </summary>
+class ImageResampler
+{
+public:
+	template <typename T>
+	static Image2d<T> Resize(const Image2d<T> & img, const ImageDimension & size,
+		ImageUtils::ResampleMode mode);
+
+private:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+
+	/// <summary>
+	/// Filter weights of single axis
+	/// output i = sum_k input (starts[i] + k) * weights[i * taps + k]
+	/// </summary>
+	struct AxisCoefficients
+	{
+		size_t taps;
+		std::vector<int32_t> starts;
+		std::vector<float> weights;
+	};
+
+	static AxisCoefficients CreateCoefficients(int inputSize, int outputSize,
+		ImageUtils::ResampleMode mode);
+	static double Lanczos3(double x) noexcept;
+
+	template <typename T>
+	static void ResizePlaneNearest(const T * src, T * dst, const ImageDimension & srcSize,
+		const ImageDimension & dstSize, size_t channelsCount,
+		const AxisCoefficients & cx, const AxisCoefficients & cy);
+
+	template <typename T>
+	static void ResizePlane(const T * src, T * dst, const ImageDimension & srcSize,
+		const ImageDimension & dstSize, size_t channelsCount,
+		const AxisCoefficients & cx, const AxisCoefficients & cy);
+};
+
+#endif
@@ -0,0 +1,390 @@
+#include "./ImageTransform.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Create transformed copy of image
+/// Output has the same format and layout as input
+/// </summary>
+/// <param name="img"></param>
+/// <param name="t"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> ImageTransform::CreateTransformed(const Image2d<T> & img, ImageUtils::GeometricTransform t)
+{
+	const size_t w = size_t(img.GetWidth());
+	const size_t h = size_t(img.GetHeight());
+
+	if ((w == 0) || (h == 0))
+	{
+		return img;
+	}
+
+	const bool swapped = IsSizeSwapped(t);
+	Image2d<T> res(int(swapped ? h : w), int(swapped ? w : h), img.GetPixelFormat(), img.GetLayout(),
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	const size_t pixelBytes = sizeof(T) * img.GetPlaneChannelsCount();
+
+	for (size_t p = 0; p < img.GetPlanesCount(); p++)
+	{
+		const uint8_t * src = reinterpret_cast<const uint8_t *>(img.GetPlaneStart(p));
+		uint8_t * dst = reinterpret_cast<uint8_t *>(res.GetPlaneStart(p));
+
+		TransformPlane(src, dst, w, h, pixelBytes, t);
+	}
+
+	return res;
+}
+
+/// <summary>
+/// Transform image in place
+/// Square images and transforms that keep size do not allocate new data,
+/// other images are transformed to new buffer
+/// </summary>
+/// <param name="img"></param>
+/// <param name="t"></param>
+template <typename T>
+void ImageTransform::Apply(Image2d<T> & img, ImageUtils::GeometricTransform t)
+{
+	const size_t w = size_t(img.GetWidth());
+	const size_t h = size_t(img.GetHeight());
+
+	if ((w == 0) || (h == 0))
+	{
+		return;
+	}
+
+	if ((IsSizeSwapped(t)) && (w != h))
+	{
+		img = CreateTransformed(img, t);
+		return;
+	}
+
+	const size_t pixelBytes = sizeof(T) * img.GetPlaneChannelsCount();
+
+	for (size_t p = 0; p < img.GetPlanesCount(); p++)
+	{
+		uint8_t * data = reinterpret_cast<uint8_t *>(img.GetPlaneStart(p));
+		TransformPlaneInPlace(data, w, h, pixelBytes, t);
+	}
+}
+
+/// <summary>
+/// Test if transform swaps width and height
+/// </summary>
+/// <param name="t"></param>
+/// <returns></returns>
+bool ImageTransform::IsSizeSwapped(ImageUtils::GeometricTransform t) noexcept
+{
+	return (t == ImageUtils::GeometricTransform::ROTATE_90) ||
+		(t == ImageUtils::GeometricTransform::ROTATE_270) ||
+		(t == ImageUtils::GeometricTransform::TRANSPOSE);
+}
+
+/// <summary>
+/// Get tile size (in pixels) of tiled transpose
+/// Input and output tile together fit to L1 cache
+/// </summary>
+/// <param name="pixelBytes"></param>
+/// <returns></returns>
+size_t ImageTransform::GetTileSize(size_t pixelBytes) noexcept
+{
+	if (pixelBytes <= 4)
+	{
+		return 64;
+	}
+	if (pixelBytes <= 16)
+	{
+		return 32;
+	}
+	return 16;
+}
+
+//=================================================================================================
+// Plane transforms
+//=================================================================================================
+
+/// <summary>
+/// Transform single plane of w x h pixels to new buffer
+/// Rotation by 90 degrees is transpose of vertically flipped input,
+/// rotation by 270 degrees is transpose to vertically flipped output
+/// </summary>
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pixelBytes"></param>
+/// <param name="t"></param>
+void ImageTransform::TransformPlane(const uint8_t * src, uint8_t * dst, size_t w, size_t h,
+	size_t pixelBytes, ImageUtils::GeometricTransform t)
+{
+	const ptrdiff_t rowBytes = ptrdiff_t(w * pixelBytes);
+	const ptrdiff_t colBytes = ptrdiff_t(h * pixelBytes);
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / size_t(rowBytes));
+
+	switch (t)
+	{
+	case ImageUtils::GeometricTransform::FLIP_HORIZONTAL:
+		FlipHorizontal(src, dst, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::FLIP_VERTICAL:
+		MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+			for (size_t y = y0; y < y1; y++)
+			{
+				memcpy(dst + ptrdiff_t(y) * rowBytes, src + ptrdiff_t(h - 1 - y) * rowBytes, size_t(rowBytes));
+			}
+		});
+		return;
+
+	case ImageUtils::GeometricTransform::ROTATE_180:
+		MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+			for (size_t y = y0; y < y1; y++)
+			{
+				ImageKernels::ReversePixels(src + ptrdiff_t(h - 1 - y) * rowBytes, dst + ptrdiff_t(y) * rowBytes,
+					w, pixelBytes);
+			}
+		});
+		return;
+
+	case ImageUtils::GeometricTransform::TRANSPOSE:
+		Transpose(src, rowBytes, dst, colBytes, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::ROTATE_90:
+		Transpose(src + ptrdiff_t(h - 1) * rowBytes, -rowBytes, dst, colBytes, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::ROTATE_270:
+		Transpose(src, rowBytes, dst + ptrdiff_t(w - 1) * colBytes, -colBytes, w, h, pixelBytes);
+		return;
+	}
+}
+
+/// <summary>
+/// Transform single plane of w x h pixels in place
+/// Transforms that swap size are supported only for square plane (w == h),
+/// rotation is then transpose followed by horizontal (90) or vertical (270) flip
+/// </summary>
+/// <param name="data"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pixelBytes"></param>
+/// <param name="t"></param>
+void ImageTransform::TransformPlaneInPlace(uint8_t * data, size_t w, size_t h,
+	size_t pixelBytes, ImageUtils::GeometricTransform t)
+{
+	switch (t)
+	{
+	case ImageUtils::GeometricTransform::FLIP_HORIZONTAL:
+		FlipHorizontal(data, data, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::FLIP_VERTICAL:
+		FlipVerticalInPlace(data, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::ROTATE_180:
+		Rotate180InPlace(data, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::TRANSPOSE:
+		TransposeSquareInPlace(data, w, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::ROTATE_90:
+		TransposeSquareInPlace(data, w, pixelBytes);
+		FlipHorizontal(data, data, w, h, pixelBytes);
+		return;
+
+	case ImageUtils::GeometricTransform::ROTATE_270:
+		TransposeSquareInPlace(data, w, pixelBytes);
+		FlipVerticalInPlace(data, w, h, pixelBytes);
+		return;
+	}
+}
+
+//=================================================================================================
+// Transpose
+//=================================================================================================
+
+/// <summary>
+/// Tiled transpose of w x h pixels
+/// dst row x, pixel y = src row y, pixel x
+/// Each task transposes band of tile columns, so it writes consecutive output rows
+/// </summary>
+/// <param name="src"></param>
+/// <param name="srcStride">bytes between input rows (can be negative)</param>
+/// <param name="dst"></param>
+/// <param name="dstStride">bytes between output rows (can be negative)</param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pixelBytes"></param>
+void ImageTransform::Transpose(const uint8_t * src, ptrdiff_t srcStride, uint8_t * dst, ptrdiff_t dstStride,
+	size_t w, size_t h, size_t pixelBytes)
+{
+	const size_t tile = GetTileSize(pixelBytes);
+	const size_t tilesX = (w + tile - 1) / tile;
+	const size_t grainTiles = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (tile * h * pixelBytes));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, tilesX, grainTiles, [&](size_t t0, size_t t1) {
+		for (size_t tx = t0; tx < t1; tx++)
+		{
+			const size_t x = tx * tile;
+			const size_t tw = std::min(tile, w - x);
+
+			for (size_t y = 0; y < h; y += tile)
+			{
+				const size_t th = std::min(tile, h - y);
+				ImageKernels::TransposePixels(src + ptrdiff_t(y) * srcStride + x * pixelBytes, srcStride,
+					dst + ptrdiff_t(x) * dstStride + y * pixelBytes, dstStride, tw, th, pixelBytes);
+			}
+		}
+	});
+}
+
+/// <summary>
+/// In-place tiled transpose of n x n pixels
+/// Tile (i, j) is transposed to temporary buffer, tile (j, i) is transposed
+/// to place of tile (i, j) and buffer is copied to place of tile (j, i).
+/// Task of tile row i processes tiles (i, j >= i), so tasks do not share tiles
+/// </summary>
+/// <param name="data"></param>
+/// <param name="n"></param>
+/// <param name="pixelBytes"></param>
+void ImageTransform::TransposeSquareInPlace(uint8_t * data, size_t n, size_t pixelBytes)
+{
+	const size_t tile = GetTileSize(pixelBytes);
+	const size_t tilesCount = (n + tile - 1) / tile;
+	const ptrdiff_t stride = ptrdiff_t(n * pixelBytes);
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, tilesCount, 1, [&](size_t t0, size_t t1) {
+		std::vector<uint8_t> tmp(tile * tile * pixelBytes);
+
+		for (size_t i = t0; i < t1; i++)
+		{
+			const size_t pi = i * tile;
+			const size_t si = std::min(tile, n - pi);
+
+			for (size_t j = i; j < tilesCount; j++)
+			{
+				const size_t pj = j * tile;
+				const size_t sj = std::min(tile, n - pj);
+
+				uint8_t * a = data + ptrdiff_t(pi) * stride + pj * pixelBytes;	//si rows x sj pixels
+				uint8_t * b = data + ptrdiff_t(pj) * stride + pi * pixelBytes;	//sj rows x si pixels
+				const ptrdiff_t tmpStride = ptrdiff_t(si * pixelBytes);
+
+				ImageKernels::TransposePixels(a, stride, tmp.data(), tmpStride, sj, si, pixelBytes);
+				if (i != j)
+				{
+					ImageKernels::TransposePixels(b, stride, a, stride, si, sj, pixelBytes);
+				}
+
+				for (size_t y = 0; y < sj; y++)
+				{
+					memcpy(b + ptrdiff_t(y) * stride, tmp.data() + ptrdiff_t(y) * tmpStride, size_t(tmpStride));
+				}
+			}
+		}
+	});
+}
+
+//=================================================================================================
+// Flip
+//=================================================================================================
+
+/// <summary>
+/// Reverse pixels of each row
+/// (src can be the same as dst)
+/// </summary>
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pixelBytes"></param>
+void ImageTransform::FlipHorizontal(const uint8_t * src, uint8_t * dst, size_t w, size_t h, size_t pixelBytes)
+{
+	const size_t rowBytes = w * pixelBytes;
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / rowBytes);
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; y++)
+		{
+			ImageKernels::ReversePixels(src + y * rowBytes, dst + y * rowBytes, w, pixelBytes);
+		}
+	});
+}
+
+/// <summary>
+/// Swap rows y and h - 1 - y
+/// </summary>
+/// <param name="data"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pixelBytes"></param>
+void ImageTransform::FlipVerticalInPlace(uint8_t * data, size_t w, size_t h, size_t pixelBytes)
+{
+	const size_t rowBytes = w * pixelBytes;
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (2 * rowBytes));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h / 2, grainRows, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; y++)
+		{
+			uint8_t * top = data + y * rowBytes;
+			std::swap_ranges(top, top + rowBytes, data + (h - 1 - y) * rowBytes);
+		}
+	});
+}
+
+/// <summary>
+/// Rotate by 180 degrees in place
+/// Row y is reversed to temporary buffer, row h - 1 - y is reversed to row y
+/// and buffer is copied to row h - 1 - y. Middle row is reversed in place.
+/// </summary>
+/// <param name="data"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="pixelBytes"></param>
+void ImageTransform::Rotate180InPlace(uint8_t * data, size_t w, size_t h, size_t pixelBytes)
+{
+	const size_t rowBytes = w * pixelBytes;
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (2 * rowBytes));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, h / 2, grainRows, [&](size_t y0, size_t y1) {
+		std::vector<uint8_t> tmp(rowBytes);
+		for (size_t y = y0; y < y1; y++)
+		{
+			uint8_t * top = data + y * rowBytes;
+			uint8_t * bottom = data + (h - 1 - y) * rowBytes;
+
+			ImageKernels::ReversePixels(top, tmp.data(), w, pixelBytes);
+			ImageKernels::ReversePixels(bottom, top, w, pixelBytes);
+			memcpy(bottom, tmp.data(), rowBytes);
+		}
+	});
+
+	if (h % 2 == 1)
+	{
+		uint8_t * middle = data + (h / 2) * rowBytes;
+		ImageKernels::ReversePixels(middle, middle, w, pixelBytes);
+	}
+}
+
+//=================================================================================================
+
+template Image2d<uint8_t> ImageTransform::CreateTransformed(const Image2d<uint8_t> & img,
+	ImageUtils::GeometricTransform t);
+template Image2d<float> ImageTransform::CreateTransformed(const Image2d<float> & img,
+	ImageUtils::GeometricTransform t);
+
+template void ImageTransform::Apply(Image2d<uint8_t> & img, ImageUtils::GeometricTransform t);
+template void ImageTransform::Apply(Image2d<float> & img, ImageUtils::GeometricTransform t);
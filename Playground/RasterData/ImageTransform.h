@@ -0,0 +1,53 @@
+#ifndef IMAGE_TRANSFORM_H
+#define IMAGE_TRANSFORM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "./Image2d.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Flip, rotation by multiples of 90 degrees and transpose of Image2d<uint8_t / float>
+///
+/// Pixels are moved as opaque blocks of bytes (all channels of interleaved pixel at once,
+/// planar images plane by plane), so any channel count is supported.
+/// Transpose (and rotation by 90 / 270) is tiled: tiles of input are transposed with
+/// SIMD in-register micro-blocks (ImageKernels::TransposePixels), so both input and output
+/// stay in cache. Rotation is transpose with vertically flipped input or output (negative stride).
+/// Flips reverse rows with SIMD byte shuffles (ImageKernels::ReversePixels).
+///
+/// In-place transform of square image swaps tiles across the diagonal,
+/// non-square image is transposed to a new buffer.
+/// Rows / tile bands are processed in parallel on the shared ThreadPool.
+/// </summary>
+class ImageTransform
+{
+public:
+	template <typename T>
+	static Image2d<T> CreateTransformed(const Image2d<T> & img, ImageUtils::GeometricTransform t);
+
+	template <typename T>
+	static void Apply(Image2d<T> & img, ImageUtils::GeometricTransform t);
+
+	static bool IsSizeSwapped(ImageUtils::GeometricTransform t) noexcept;
+
+private:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+
+	static size_t GetTileSize(size_t pixelBytes) noexcept;
+
+	static void TransformPlane(const uint8_t * src, uint8_t * dst, size_t w, size_t h,
+		size_t pixelBytes, ImageUtils::GeometricTransform t);
+	static void TransformPlaneInPlace(uint8_t * data, size_t w, size_t h,
+		size_t pixelBytes, ImageUtils::GeometricTransform t);
+
+	static void Transpose(const uint8_t * src, ptrdiff_t srcStride, uint8_t * dst, ptrdiff_t dstStride,
+		size_t w, size_t h, size_t pixelBytes);
+	static void TransposeSquareInPlace(uint8_t * data, size_t n, size_t pixelBytes);
+	static void FlipHorizontal(const uint8_t * src, uint8_t * dst, size_t w, size_t h, size_t pixelBytes);
+	static void FlipVerticalInPlace(uint8_t * data, size_t w, size_t h, size_t pixelBytes);
+	static void Rotate180InPlace(uint8_t * data, size_t w, size_t h, size_t pixelBytes);
+};
+
+#endif
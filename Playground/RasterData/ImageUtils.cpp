@@ -10,9 +10,55 @@
 #include "../Utils/Logger.h"
 
 #include "./Image2d.h"
+#include "./Image2dFixed.h"
+#include "./LineRasterizer.h"
+#include "./ShapeRasterizer.h"
 
 
 
+//=================================================================================================
+// Borders
+//=================================================================================================
+
+/// <summary>
+/// Map index i from range (-inf, inf) to [0, n) based on border mode
+/// CLAMP - nearest edge value
+/// WRAP - periodic repetition
+/// ENLARGE - mirror without repeating edge ([-1] -> [0], [-2] -> [1], [n] -> [n - 1])
+/// ZERO - returns -1 for indices outside of range
+/// </summary>
+/// <param name="i"></param>
+/// <param name="n">range size (must be > 0)</param>
+/// <param name="border"></param>
+/// <returns></returns>
+int ImageUtils::MapBorderIndex(int i, int n, BorderMode border) noexcept
+{
+	if ((i >= 0) && (i < n))
+	{
+		return i;
+	}
+
+	if (border == BorderMode::WRAP)
+	{
+		i %= n;
+		return (i < 0) ? i + n : i;
+	}
+	else if (border == BorderMode::ENLARGE)
+	{
+		const int period = 2 * n;
+		i %= period;
+		i = (i < 0) ? i + period : i;
+		return (i < n) ? i : period - 1 - i;
+	}
+	else if (border == BorderMode::ZERO)
+	{
+		return -1;
+	}
+
+	//clamp
+	return (i < 0) ? 0 : n - 1;
+}
+
 //=================================================================================================
 // Drawing
 //==============================================================================================
@@ -28,29 +74,27 @@ std::array<uint8_t, 3> ImageUtils::CreateRandomColor()
 }
 
 /// <summary>
-/// Codes for Cohen-Sutherland
+/// Draw simple line (no anti-aliasing) to image with simple Bresenham algorithm
+/// Line if from: [x0, y0] -> [x1, y1] 
+/// If line is outside image bounds, only its part inside the image is drawn
 /// </summary>
-/// <param name="x"></param>
-/// <param name="y"></param>
-/// <returns></returns>
-int ImageUtils::ComputeOutCode(int x, int y, int w, int h)
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x0"></param>
+/// <param name="y0"></param>
+/// <param name="x1"></param>
+/// <param name="y1"></param>
+template <typename T>
+void ImageUtils::DrawLine(Image2d<T> & input, const T * value,
+	int x0, int y0, int x1, int y1)
 {
-	int code = INSIDE;
-
-	if (x < 0) code |= LEFT;
-	else if (x >= w) code |= RIGHT;
-
-	if (y < 0) code |= BOTTOM;
-	else if (y >= h) code |= TOP;
-
-	return code;
+	ImageUtils::DrawLine(input.CreateView(), value, x0, y0, x1, y1);
 }
 
-
 /// <summary>
-/// Draw simple line (no anti-aliasing) to image with simple Bresenham algorithm
-/// Line if from: [x0, y0] -> [x1, y1] 
-/// If line is outside image bounds, it is clamped with Cohen-Sutherland
+/// Draw simple line to image view
+/// Line coordinates are in view coordinates and line is clipped to the view
+/// (see LineRasterizer)
 /// </summary>
 /// <param name="input"></param>
 /// <param name="value"></param>
@@ -59,94 +103,57 @@ int ImageUtils::ComputeOutCode(int x, int y, int w, int h)
 /// <param name="x1"></param>
 /// <param name="y1"></param>
 template <typename T>
-void ImageUtils::DrawLine(Image2d<T> & input, const T * value,
+void ImageUtils::DrawLine(const Image2dView<T> & input, const T * value,
 	int x0, int y0, int x1, int y1)
 {
-	// compute outcodes for P0, P1, and whatever point lies outside the clip rectangle
-	int outcode0 = ImageUtils::ComputeOutCode(x0, y0, input.GetWidth(), input.GetHeight());
-	int outcode1 = ImageUtils::ComputeOutCode(x1, y1, input.GetWidth(), input.GetHeight());
-	bool accept = false;
-
-	double xmin = 0;
-	double xmax = input.GetWidth() - 1;
-
-	double ymin = 0;
-	double ymax = input.GetHeight() - 1;
-
-	while (true)
-	{
-		if (!(outcode0 | outcode1))
-		{
-			// Bitwise OR is 0. Trivially accept and get out of loop
-			accept = true;
-			break;
-		}
-		else if (outcode0 & outcode1)
-		{
-			// Bitwise AND is not 0. (implies both end points are in the same region outside the window). Reject and get out of loop
-			break;
-		}
-		else
-		{
-			// failed both tests, so calculate the line segment to clip
-			// from an outside point to an intersection with clip edge
-			double x = 0;
-			double y = 0;
-
-			// At least one endpoint is outside the clip rectangle; pick it.
-			int outcodeOut = outcode0 ? outcode0 : outcode1;
-
-			// Now find the intersection point;
-			// use formulas y = y0 + slope * (x - x0), x = x0 + (1 / slope) * (y - y0)
-			if (outcodeOut & TOP) {           // point is above the clip rectangle
-				x = x0 + (x1 - x0) * (ymax - y0) / (y1 - y0);
-				y = ymax;
-			}
-			else if (outcodeOut & BOTTOM) { // point is below the clip rectangle
-				x = x0 + (x1 - x0) * (ymin - y0) / (y1 - y0);
-				y = ymin;
-			}
-			else if (outcodeOut & RIGHT) {  // point is to the right of clip rectangle
-				y = y0 + (y1 - y0) * (xmax - x0) / (x1 - x0);
-				x = xmax;
-			}
-			else if (outcodeOut & LEFT) {   // point is to the left of clip rectangle
-				y = y0 + (y1 - y0) * (xmin - x0) / (x1 - x0);
-				x = xmin;
-			}
-
-			// Now we move outside point to intersection point to clip
-			// and get ready for next pass.
-			if (outcodeOut == outcode0)
-			{
-				x0 = static_cast<int>(x);
-				y0 = static_cast<int>(y);
-				outcode0 = ImageUtils::ComputeOutCode(x0, y0, input.GetWidth(), input.GetHeight());
-			}
-			else
-			{
-				x1 = static_cast<int>(x);
-				y1 = static_cast<int>(y);
-				outcode1 = ImageUtils::ComputeOutCode(x1, y1, input.GetWidth(), input.GetHeight());
-			}
-		}
-	}
-
-	if (accept == false)
-	{
-		return;
-	}
+	LineRasterizer::DrawLine(input, value, { x0, y0, x1, y1 });
+}
 
-	ImageUtils::ProcessLinePixels(x0, y0, x1, y1,
-		[&](int x, int y) {
+/// <summary>
+/// Draw simple line to image with fixed channels count
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x0"></param>
+/// <param name="y0"></param>
+/// <param name="x1"></param>
+/// <param name="y1"></param>
+template <typename T, size_t C>
+void ImageUtils::DrawLine(Image2dFixed<T, C> & input, const T * value,
+	int x0, int y0, int x1, int y1)
+{
+	LineRasterizer::DrawLine(input.CreateView(), value, { x0, y0, x1, y1 });
+}
 
-		auto * val = input.GetPixelStart(x, y);
-		for (size_t c = 0; c < input.GetChannelsCount(); c++)
-		{
-			val[c] = value[c];
-		}
+/// <summary>
+/// Draw batch of simple lines with the same value to image
+/// Lines are clipped to image and drawn in order.
+/// If parallel is set, large batches are drawn in parallel
+/// by horizontal bands of image (see LineRasterizer)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="lines"></param>
+/// <param name="parallel"></param>
+template <typename T>
+void ImageUtils::DrawLines(Image2d<T> & input, const T * value,
+	const std::vector<LineSegment> & lines, bool parallel)
+{
+	ImageUtils::DrawLines(input.CreateView(), value, lines, parallel);
+}
 
-	});
+/// <summary>
+/// Draw batch of simple lines with the same value to image view
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="lines"></param>
+/// <param name="parallel"></param>
+template <typename T>
+void ImageUtils::DrawLines(const Image2dView<T> & input, const T * value,
+	const std::vector<LineSegment> & lines, bool parallel)
+{
+	LineRasterizer::DrawLines(input, value, lines.data(), lines.size(), parallel);
 }
 
 /// <summary>
@@ -195,9 +202,420 @@ void ImageUtils::ProcessLinePixels(int x0, int y0, int x1, int y1,
 	}
 }
 
+/// <summary>
+/// Draw anti-aliased line (Xiaolin Wu) blended to image with opacity alpha
+/// Line is clipped to image (see LineRasterizer)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x0"></param>
+/// <param name="y0"></param>
+/// <param name="x1"></param>
+/// <param name="y1"></param>
+/// <param name="alpha">[0, 1]</param>
+template <typename T>
+void ImageUtils::DrawLineAntiAliased(Image2d<T> & input, const T * value,
+	int x0, int y0, int x1, int y1, float alpha)
+{
+	ImageUtils::DrawLineAntiAliased(input.CreateView(), value, x0, y0, x1, y1, alpha);
+}
+
+template <typename T>
+void ImageUtils::DrawLineAntiAliased(const Image2dView<T> & input, const T * value,
+	int x0, int y0, int x1, int y1, float alpha)
+{
+	const LineSegment line = { x0, y0, x1, y1 };
+	LineRasterizer::DrawLinesAntiAliased(input, value, &line, 1, alpha, false);
+}
+
+/// <summary>
+/// Draw batch of anti-aliased lines with the same value blended to image
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="lines"></param>
+/// <param name="alpha">[0, 1]</param>
+/// <param name="parallel"></param>
+template <typename T>
+void ImageUtils::DrawLinesAntiAliased(Image2d<T> & input, const T * value,
+	const std::vector<LineSegment> & lines, float alpha, bool parallel)
+{
+	ImageUtils::DrawLinesAntiAliased(input.CreateView(), value, lines, alpha, parallel);
+}
+
+template <typename T>
+void ImageUtils::DrawLinesAntiAliased(const Image2dView<T> & input, const T * value,
+	const std::vector<LineSegment> & lines, float alpha, bool parallel)
+{
+	LineRasterizer::DrawLinesAntiAliased(input, value, lines.data(), lines.size(), alpha, parallel);
+}
+
+/// <summary>
+/// Draw line with given thickness blended to image with opacity alpha
+/// Line is filled as single quad with square caps (see LineRasterizer)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x0"></param>
+/// <param name="y0"></param>
+/// <param name="x1"></param>
+/// <param name="y1"></param>
+/// <param name="thickness">in pixels</param>
+/// <param name="alpha">[0, 1]</param>
+template <typename T>
+void ImageUtils::DrawThickLine(Image2d<T> & input, const T * value,
+	int x0, int y0, int x1, int y1, float thickness, float alpha)
+{
+	ImageUtils::DrawThickLine(input.CreateView(), value, x0, y0, x1, y1, thickness, alpha);
+}
+
+template <typename T>
+void ImageUtils::DrawThickLine(const Image2dView<T> & input, const T * value,
+	int x0, int y0, int x1, int y1, float thickness, float alpha)
+{
+	const LineSegment line = { x0, y0, x1, y1 };
+	LineRasterizer::DrawThickLines(input, value, &line, 1, thickness, alpha, false);
+}
+
+/// <summary>
+/// Draw batch of thick lines with the same value blended to image
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="lines"></param>
+/// <param name="thickness">in pixels</param>
+/// <param name="alpha">[0, 1]</param>
+/// <param name="parallel"></param>
+template <typename T>
+void ImageUtils::DrawThickLines(Image2d<T> & input, const T * value,
+	const std::vector<LineSegment> & lines, float thickness, float alpha, bool parallel)
+{
+	ImageUtils::DrawThickLines(input.CreateView(), value, lines, thickness, alpha, parallel);
+}
+
+template <typename T>
+void ImageUtils::DrawThickLines(const Image2dView<T> & input, const T * value,
+	const std::vector<LineSegment> & lines, float thickness, float alpha, bool parallel)
+{
+	LineRasterizer::DrawThickLines(input, value, lines.data(), lines.size(), thickness, alpha, parallel);
+}
+
+//=================================================================================================
+// Filled shapes
+//=================================================================================================
+
+/// <summary>
+/// Fill rectangle with top left corner [x, y] and size [w, h]
+/// Part of rectangle outside of image is skipped (see ShapeRasterizer)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+template <typename T>
+void ImageUtils::FillRect(Image2d<T> & input, const T * value,
+	int x, int y, int w, int h)
+{
+	ShapeRasterizer::FillRect(input.CreateView(), value, x, y, w, h);
+}
+
+template <typename T>
+void ImageUtils::FillRect(const Image2dView<T> & input, const T * value,
+	int x, int y, int w, int h)
+{
+	ShapeRasterizer::FillRect(input, value, x, y, w, h);
+}
+
+/// <summary>
+/// Fill convex or concave polygon
+/// Pixels with center inside polygon are filled (see ShapeRasterizer)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="points"></param>
+/// <param name="rule"></param>
+template <typename T>
+void ImageUtils::FillPolygon(Image2d<T> & input, const T * value,
+	const std::vector<Pixel> & points, FillRule rule)
+{
+	ShapeRasterizer::FillPolygon(input.CreateView(), value, points, rule);
+}
+
+template <typename T>
+void ImageUtils::FillPolygon(const Image2dView<T> & input, const T * value,
+	const std::vector<Pixel> & points, FillRule rule)
+{
+	ShapeRasterizer::FillPolygon(input, value, points, rule);
+}
+
+/// <summary>
+/// Fill circle centered at pixel [cx, cy]
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="cx"></param>
+/// <param name="cy"></param>
+/// <param name="r"></param>
+template <typename T>
+void ImageUtils::FillCircle(Image2d<T> & input, const T * value,
+	int cx, int cy, int r)
+{
+	ShapeRasterizer::FillEllipse(input.CreateView(), value, cx, cy, r, r);
+}
+
+template <typename T>
+void ImageUtils::FillCircle(const Image2dView<T> & input, const T * value,
+	int cx, int cy, int r)
+{
+	ShapeRasterizer::FillEllipse(input, value, cx, cy, r, r);
+}
+
+/// <summary>
+/// Fill ellipse centered at pixel [cx, cy] with radii rx, ry
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="cx"></param>
+/// <param name="cy"></param>
+/// <param name="rx"></param>
+/// <param name="ry"></param>
+template <typename T>
+void ImageUtils::FillEllipse(Image2d<T> & input, const T * value,
+	int cx, int cy, int rx, int ry)
+{
+	ShapeRasterizer::FillEllipse(input.CreateView(), value, cx, cy, rx, ry);
+}
+
+template <typename T>
+void ImageUtils::FillEllipse(const Image2dView<T> & input, const T * value,
+	int cx, int cy, int rx, int ry)
+{
+	ShapeRasterizer::FillEllipse(input, value, cx, cy, rx, ry);
+}
+
+//=================================================================================================
+// Region fill
+//=================================================================================================
+
+/// <summary>
+/// Replace color of connected region containing pixel [x, y] with value
+/// (see FloodFill of view)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="connectivity"></param>
+/// <returns>number of filled pixels</returns>
+template <typename T>
+size_t ImageUtils::FloodFill(Image2d<T> & input, const T * value,
+	int x, int y, Connectivity connectivity)
+{
+	return ImageUtils::FloodFill(input.CreateView(), value, x, y, connectivity);
+}
+
+/// <summary>
+/// Replace color of connected region containing pixel [x, y] with value
+/// Region are all pixels connected to [x, y] with the same value
+/// of all channels as [x, y] has.
+/// 
+/// Scanline fill: each step fills the whole horizontal span and stores
+/// only the span on the stack, rows above and below are scanned
+/// for new spans later. Row of parent span is rescanned only
+/// where the new span overhangs it, so each pixel is tested only a few times
+/// and stack size is proportional to number of spans, not pixels.
+/// </summary>
+/// <param name="input"></param>
+/// <param name="value"></param>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="connectivity"></param>
+/// <returns>number of filled pixels</returns>
+template <typename T>
+size_t ImageUtils::FloodFill(const Image2dView<T> & input, const T * value,
+	int x, int y, Connectivity connectivity)
+{
+	const int w = input.GetWidth();
+	const int h = input.GetHeight();
+	if ((x < 0) || (y < 0) || (x >= w) || (y >= h))
+	{
+		return 0;
+	}
 
+	const size_t channelsCount = input.GetChannelsCount();
+	const size_t channelStride = input.GetChannelStride();
+	const size_t pixelStride = input.GetPixelStride();
 
+	std::vector<T> seedValue(channelsCount);
+	const T * seedPx = input.GetPixelStart(x, y);
+
+	bool isSame = true;
+	for (size_t c = 0; c < channelsCount; c++)
+	{
+		seedValue[c] = seedPx[c * channelStride];
+		isSame = isSame && (seedValue[c] == value[c]);
+	}
+
+	if (isSame)
+	{
+		//filled pixels would stay inside region
+		return 0;
+	}
+
+	auto isInside = [&](const T * px) -> bool {
+		for (size_t c = 0; c < channelsCount; c++)
+		{
+			if (px[c * channelStride] != seedValue[c])
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	//find maximal span [l, r] of region pixels containing xs on row and fill it
+	auto fillSpan = [&](T * row, int xs, int & l, int & r) {
+		l = xs;
+		while ((l > 0) && (isInside(row + size_t(l - 1) * pixelStride)))
+		{
+			l--;
+		}
+
+		r = xs;
+		while ((r < w - 1) && (isInside(row + size_t(r + 1) * pixelStride)))
+		{
+			r++;
+		}
+
+		for (int i = l; i <= r; i++)
+		{
+			T * px = row + size_t(i) * pixelStride;
+			for (size_t c = 0; c < channelsCount; c++)
+			{
+				px[c * channelStride] = value[c];
+			}
+		}
+	};
+
+	//row y to be scanned next to filled span [xl, xr] of row y - dy
+	struct Seed
+	{
+		int y;
+		int xl;
+		int xr;
+		int dy;
+	};
+
+	std::stack<Seed> seeds;
+	auto pushSeed = [&](int sy, int xl, int xr, int dy) {
+		if ((sy >= 0) && (sy < h))
+		{
+			seeds.push({ sy, xl, xr, dy });
+		}
+	};
+
+	//diagonal neighbors extend scanned range of next row by one pixel
+	const int ext = (connectivity == Connectivity::EIGHT) ? 1 : 0;
+
+	int l = 0;
+	int r = 0;
+	fillSpan(input.GetRowStart(y), x, l, r);
+	size_t filledCount = size_t(r - l + 1);
+
+	pushSeed(y + 1, l, r, 1);
+	pushSeed(y - 1, l, r, -1);
+
+	while (seeds.empty() == false)
+	{
+		const Seed s = seeds.top();
+		seeds.pop();
+
+		T * row = input.GetRowStart(s.y);
+		const int xEnd = std::min(s.xr + ext, w - 1);
+
+		for (int i = std::max(s.xl - ext, 0); i <= xEnd; i++)
+		{
+			if (isInside(row + size_t(i) * pixelStride) == false)
+			{
+				continue;
+			}
+
+			fillSpan(row, i, l, r);
+			filledCount += size_t(r - l + 1);
+
+			pushSeed(s.y + s.dy, l, r, s.dy);
+
+			//span overhangs parent span - region may continue back in the parent row
+			if (l < s.xl)
+			{
+				pushSeed(s.y - s.dy, l, s.xl - 1, -s.dy);
+			}
+			if (r > s.xr)
+			{
+				pushSeed(s.y - s.dy, s.xr + 1, r, -s.dy);
+			}
+
+			//pixel r + 1 is not inside
+			i = r + 1;
+		}
+	}
+
+	return filledCount;
+}
+
+//=================================================================================================
 
 template void ImageUtils::DrawLine(Image2d<float> & input, const float * value, int x0, int y0, int x1, int y1);
 template void ImageUtils::DrawLine(Image2d<uint8_t> & input, const uint8_t * value, int x0, int y0, int x1, int y1);
-
+template void ImageUtils::DrawLine(const Image2dView<float> & input, const float * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(const Image2dView<uint8_t> & input, const uint8_t * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLines(Image2d<float> & input, const float * value, const std::vector<LineSegment> & lines, bool parallel);
+template void ImageUtils::DrawLines(Image2d<uint8_t> & input, const uint8_t * value, const std::vector<LineSegment> & lines, bool parallel);
+template void ImageUtils::DrawLines(const Image2dView<float> & input, const float * value, const std::vector<LineSegment> & lines, bool parallel);
+template void ImageUtils::DrawLines(const Image2dView<uint8_t> & input, const uint8_t * value, const std::vector<LineSegment> & lines, bool parallel);
+template void ImageUtils::DrawLineAntiAliased(Image2d<float> & input, const float * value, int x0, int y0, int x1, int y1, float alpha);
+template void ImageUtils::DrawLineAntiAliased(const Image2dView<float> & input, const float * value, int x0, int y0, int x1, int y1, float alpha);
+template void ImageUtils::DrawLineAntiAliased(Image2d<uint8_t> & input, const uint8_t * value, int x0, int y0, int x1, int y1, float alpha);
+template void ImageUtils::DrawLineAntiAliased(const Image2dView<uint8_t> & input, const uint8_t * value, int x0, int y0, int x1, int y1, float alpha);
+template void ImageUtils::DrawLinesAntiAliased(Image2d<float> & input, const float * value, const std::vector<LineSegment> & lines, float alpha, bool parallel);
+template void ImageUtils::DrawLinesAntiAliased(const Image2dView<float> & input, const float * value, const std::vector<LineSegment> & lines, float alpha, bool parallel);
+template void ImageUtils::DrawLinesAntiAliased(Image2d<uint8_t> & input, const uint8_t * value, const std::vector<LineSegment> & lines, float alpha, bool parallel);
+template void ImageUtils::DrawLinesAntiAliased(const Image2dView<uint8_t> & input, const uint8_t * value, const std::vector<LineSegment> & lines, float alpha, bool parallel);
+template void ImageUtils::DrawThickLine(Image2d<float> & input, const float * value, int x0, int y0, int x1, int y1, float thickness, float alpha);
+template void ImageUtils::DrawThickLine(const Image2dView<float> & input, const float * value, int x0, int y0, int x1, int y1, float thickness, float alpha);
+template void ImageUtils::DrawThickLine(Image2d<uint8_t> & input, const uint8_t * value, int x0, int y0, int x1, int y1, float thickness, float alpha);
+template void ImageUtils::DrawThickLine(const Image2dView<uint8_t> & input, const uint8_t * value, int x0, int y0, int x1, int y1, float thickness, float alpha);
+template void ImageUtils::DrawThickLines(Image2d<float> & input, const float * value, const std::vector<LineSegment> & lines, float thickness, float alpha, bool parallel);
+template void ImageUtils::DrawThickLines(const Image2dView<float> & input, const float * value, const std::vector<LineSegment> & lines, float thickness, float alpha, bool parallel);
+template void ImageUtils::DrawThickLines(Image2d<uint8_t> & input, const uint8_t * value, const std::vector<LineSegment> & lines, float thickness, float alpha, bool parallel);
+template void ImageUtils::DrawThickLines(const Image2dView<uint8_t> & input, const uint8_t * value, const std::vector<LineSegment> & lines, float thickness, float alpha, bool parallel);
+template void ImageUtils::FillRect(Image2d<float> & input, const float * value, int x, int y, int w, int h);
+template void ImageUtils::FillRect(const Image2dView<float> & input, const float * value, int x, int y, int w, int h);
+template void ImageUtils::FillRect(Image2d<uint8_t> & input, const uint8_t * value, int x, int y, int w, int h);
+template void ImageUtils::FillRect(const Image2dView<uint8_t> & input, const uint8_t * value, int x, int y, int w, int h);
+template void ImageUtils::FillPolygon(Image2d<float> & input, const float * value, const std::vector<Pixel> & points, FillRule rule);
+template void ImageUtils::FillPolygon(const Image2dView<float> & input, const float * value, const std::vector<Pixel> & points, FillRule rule);
+template void ImageUtils::FillPolygon(Image2d<uint8_t> & input, const uint8_t * value, const std::vector<Pixel> & points, FillRule rule);
+template void ImageUtils::FillPolygon(const Image2dView<uint8_t> & input, const uint8_t * value, const std::vector<Pixel> & points, FillRule rule);
+template void ImageUtils::FillCircle(Image2d<float> & input, const float * value, int cx, int cy, int r);
+template void ImageUtils::FillCircle(const Image2dView<float> & input, const float * value, int cx, int cy, int r);
+template void ImageUtils::FillCircle(Image2d<uint8_t> & input, const uint8_t * value, int cx, int cy, int r);
+template void ImageUtils::FillCircle(const Image2dView<uint8_t> & input, const uint8_t * value, int cx, int cy, int r);
+template void ImageUtils::FillEllipse(Image2d<float> & input, const float * value, int cx, int cy, int rx, int ry);
+template void ImageUtils::FillEllipse(const Image2dView<float> & input, const float * value, int cx, int cy, int rx, int ry);
+template void ImageUtils::FillEllipse(Image2d<uint8_t> & input, const uint8_t * value, int cx, int cy, int rx, int ry);
+template void ImageUtils::FillEllipse(const Image2dView<uint8_t> & input, const uint8_t * value, int cx, int cy, int rx, int ry);
+template size_t ImageUtils::FloodFill(Image2d<float> & input, const float * value, int x, int y, Connectivity connectivity);
+template size_t ImageUtils::FloodFill(const Image2dView<float> & input, const float * value, int x, int y, Connectivity connectivity);
+template size_t ImageUtils::FloodFill(Image2d<uint8_t> & input, const uint8_t * value, int x, int y, Connectivity connectivity);
+template size_t ImageUtils::FloodFill(const Image2dView<uint8_t> & input, const uint8_t * value, int x, int y, Connectivity connectivity);
+template void ImageUtils::DrawLine(Image2dFixed<uint8_t, 1> & input, const uint8_t * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<uint8_t, 2> & input, const uint8_t * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<uint8_t, 3> & input, const uint8_t * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<uint8_t, 4> & input, const uint8_t * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<float, 1> & input, const float * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<float, 2> & input, const float * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<float, 3> & input, const float * value, int x0, int y0, int x1, int y1);
+template void ImageUtils::DrawLine(Image2dFixed<float, 4> & input, const float * value, int x0, int y0, int x1, int y1);
@@ -4,12 +4,18 @@
 template <typename T>
 class Image2d;
 
+template <typename T>
+class Image2dView;
+
 #include <stdint.h>
 #include <vector>
 #include <list>
 #include <array>
 #include <functional>
 
+template <typename T, size_t C>
+class Image2dFixed;
+
 //=========================================================================
 
 /// <summary>
@@ -70,6 +76,121 @@ public:
 		ZERO = 3	//border is set to 0
 	};
 
+	/// <summary>
+	/// Memory layout of image channels
+	/// INTERLEAVED - RGBRGBRGB...
+	/// PLANAR - RRR...GGG...BBB... (each channel is stored contiguously)
+	/// </summary>
+	enum class DataLayout
+	{
+		INTERLEAVED = 0,
+		PLANAR = 1
+	};
+
+	/// <summary>
+	/// Initialization of newly allocated image data
+	/// ZERO - data are filled with 0
+	/// UNINITIALIZED - data are not initialized, use if all data will be overwritten
+	/// </summary>
+	enum class InitMode
+	{
+		ZERO = 0,
+		UNINITIALIZED = 1
+	};
+
+	/// <summary>
+	/// Resampling filter used for image resize
+	/// NEAREST - nearest pixel
+	/// BILINEAR - linear interpolation of 2x2 nearest pixels
+	/// AREA - mean of pixels covered by output pixel (box filter)
+	/// LANCZOS3 - windowed sinc with 3 lobes (widened for downscale)
+	/// </summary>
+	enum class ResampleMode
+	{
+		NEAREST = 0,
+		BILINEAR = 1,
+		AREA = 2,
+		LANCZOS3 = 3
+	};
+
+	/// <summary>
+	/// Filter used for 2x downsampling of image pyramid levels
+	/// BOX - mean of 2x2 pixels
+	/// GAUSSIAN - separable 5x5 binomial kernel [1 4 6 4 1] / 16
+	/// </summary>
+	enum class PyramidFilter
+	{
+		BOX = 0,
+		GAUSSIAN = 1
+	};
+
+	/// <summary>
+	/// Geometric transform without resampling
+	/// FLIP_HORIZONTAL - mirror left / right
+	/// FLIP_VERTICAL - mirror top / bottom
+	/// ROTATE_90, ROTATE_270 - clockwise rotation, width and height are swapped
+	/// TRANSPOSE - mirror along main diagonal, width and height are swapped
+	/// </summary>
+	enum class GeometricTransform
+	{
+		FLIP_HORIZONTAL = 0,
+		FLIP_VERTICAL = 1,
+		ROTATE_90 = 2,
+		ROTATE_180 = 3,
+		ROTATE_270 = 4,
+		TRANSPOSE = 5
+	};
+
+	/// <summary>
+	/// Morphological operation with structuring element
+	/// ERODE - minimum over element
+	/// DILATE - maximum over element
+	/// OPEN - erode followed by dilate (removes bright details smaller than element)
+	/// CLOSE - dilate followed by erode (removes dark details smaller than element)
+	/// GRADIENT - difference of dilate and erode
+	/// </summary>
+	enum class MorphologyOperation
+	{
+		ERODE = 0,
+		DILATE = 1,
+		OPEN = 2,
+		CLOSE = 3,
+		GRADIENT = 4
+	};
+
+	/// <summary>
+	/// Shape of structuring element with radii rx, ry centered at processed pixel
+	/// RECTANGLE - (2 * rx + 1) x (2 * ry + 1) rectangle
+	/// CROSS - horizontal line of 2 * rx + 1 pixels and vertical line of 2 * ry + 1 pixels
+	/// </summary>
+	enum class StructuringElement
+	{
+		RECTANGLE = 0,
+		CROSS = 1
+	};
+
+	/// <summary>
+	/// Rule for inside of self-intersecting polygons
+	/// EVEN_ODD - point is inside if ray from it crosses odd number of edges
+	/// NON_ZERO - point is inside if winding number of polygon around it is not zero
+	/// </summary>
+	enum class FillRule
+	{
+		EVEN_ODD = 0,
+		NON_ZERO = 1
+	};
+
+	/// <summary>
+	/// Pixel neighborhood of region algorithms
+	/// FOUR - left, right, top and bottom neighbor
+	/// EIGHT - also diagonal neighbors
+	/// </summary>
+	enum class Connectivity
+	{
+		FOUR = 4,
+		EIGHT = 8
+	};
+
 	struct Pixel 
 	{
 		int x;
@@ -79,12 +200,94 @@ public:
 		Pixel(int x, int y) : x(x), y(y) {}
 	};
 
+	/// <summary>
+	/// Line segment [x0, y0] -> [x1, y1] (both end points included)
+	/// </summary>
+	struct LineSegment
+	{
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+	};
+
+
+	static int MapBorderIndex(int i, int n, BorderMode border) noexcept;
 
 	static std::array<uint8_t, 3> CreateRandomColor();
 
 	template <typename T>
 	static void DrawLine(Image2d<T> & input, const T * value,
 		int x0, int y0, int x1, int y1);
+	template <typename T>
+	static void DrawLine(const Image2dView<T> & input, const T * value,
+		int x0, int y0, int x1, int y1);
+	template <typename T, size_t C>
+	static void DrawLine(Image2dFixed<T, C> & input, const T * value,
+		int x0, int y0, int x1, int y1);
+
+	template <typename T>
+	static void DrawLines(Image2d<T> & input, const T * value,
+		const std::vector<LineSegment> & lines, bool parallel = false);
+	template <typename T>
+	static void DrawLines(const Image2dView<T> & input, const T * value,
+		const std::vector<LineSegment> & lines, bool parallel = false);
+	template <typename T>
+	static void DrawLineAntiAliased(Image2d<T> & input, const T * value,
+		int x0, int y0, int x1, int y1, float alpha = 1.0f);
+	template <typename T>
+	static void DrawLineAntiAliased(const Image2dView<T> & input, const T * value,
+		int x0, int y0, int x1, int y1, float alpha = 1.0f);
+	template <typename T>
+	static void DrawLinesAntiAliased(Image2d<T> & input, const T * value,
+		const std::vector<LineSegment> & lines, float alpha = 1.0f, bool parallel = false);
+	template <typename T>
+	static void DrawLinesAntiAliased(const Image2dView<T> & input, const T * value,
+		const std::vector<LineSegment> & lines, float alpha = 1.0f, bool parallel = false);
+	template <typename T>
+	static void DrawThickLine(Image2d<T> & input, const T * value,
+		int x0, int y0, int x1, int y1, float thickness, float alpha = 1.0f);
+	template <typename T>
+	static void DrawThickLine(const Image2dView<T> & input, const T * value,
+		int x0, int y0, int x1, int y1, float thickness, float alpha = 1.0f);
+	template <typename T>
+	static void DrawThickLines(Image2d<T> & input, const T * value,
+		const std::vector<LineSegment> & lines, float thickness, float alpha = 1.0f, bool parallel = false);
+	template <typename T>
+	static void DrawThickLines(const Image2dView<T> & input, const T * value,
+		const std::vector<LineSegment> & lines, float thickness, float alpha = 1.0f, bool parallel = false);
+
+	template <typename T>
+	static void FillRect(Image2d<T> & input, const T * value,
+		int x, int y, int w, int h);
+	template <typename T>
+	static void FillRect(const Image2dView<T> & input, const T * value,
+		int x, int y, int w, int h);
+	template <typename T>
+	static void FillPolygon(Image2d<T> & input, const T * value,
+		const std::vector<Pixel> & points, FillRule rule = FillRule::EVEN_ODD);
+	template <typename T>
+	static void FillPolygon(const Image2dView<T> & input, const T * value,
+		const std::vector<Pixel> & points, FillRule rule = FillRule::EVEN_ODD);
+	template <typename T>
+	static void FillCircle(Image2d<T> & input, const T * value,
+		int cx, int cy, int r);
+	template <typename T>
+	static void FillCircle(const Image2dView<T> & input, const T * value,
+		int cx, int cy, int r);
+	template <typename T>
+	static void FillEllipse(Image2d<T> & input, const T * value,
+		int cx, int cy, int rx, int ry);
+	template <typename T>
+	static void FillEllipse(const Image2dView<T> & input, const T * value,
+		int cx, int cy, int rx, int ry);
+
+	template <typename T>
+	static size_t FloodFill(Image2d<T> & input, const T * value,
+		int x, int y, Connectivity connectivity = Connectivity::FOUR);
+	template <typename T>
+	static size_t FloodFill(const Image2dView<T> & input, const T * value,
+		int x, int y, Connectivity connectivity = Connectivity::FOUR);
 	
 	static void ProcessLinePixels(int x0, int y0, int x1, int y1,
 		std::function<void(int x, int y)> pixelCallback);
@@ -96,15 +299,7 @@ public:
 
 	
 private:
-	static const int INSIDE = 0; // 0000
-	static const int LEFT = 1;   // 0001
-	static const int RIGHT = 2;  // 0010
-	static const int BOTTOM = 4; // 0100
-	static const int TOP = 8;    // 1000
-
 	static const float INF;// = 1E20;
-
-	static int ComputeOutCode(int x, int y, int w, int h);
 	
 };
 
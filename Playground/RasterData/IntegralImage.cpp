@@ -0,0 +1,379 @@
+#include "./IntegralImage.h"
+
+#include <algorithm>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+template <typename T>
+IntegralImage<T>::IntegralImage() :
+	dim({ 0, 0 }),
+	pf(ColorSpace::PixelFormat::NONE),
+	channelsCount(0)
+{
+}
+
+/// <summary>
+/// Build integral image of img
+/// </summary>
+/// <param name="img"></param>
+/// <param name="withSquares">build also sums of squared values (needed for variance)</param>
+template <typename T>
+IntegralImage<T>::IntegralImage(const Image2d<T> & img, bool withSquares) :
+	dim(img.GetDimension()),
+	pf(img.GetPixelFormat()),
+	channelsCount(img.GetChannelsCount())
+{
+	if (img.GetLayout() == ImageUtils::DataLayout::PLANAR)
+	{
+		Image2d<T> tmp = img;
+		tmp.SetLayout(ImageUtils::DataLayout::INTERLEAVED);
+		this->Build(tmp.GetData().data(), (withSquares) ? &this->squares : nullptr);
+	}
+	else
+	{
+		this->Build(img.GetData().data(), (withSquares) ? &this->squares : nullptr);
+	}
+}
+
+/// <summary>
+/// Compute sums from interleaved data
+/// 1. prefix sum of each row (rows in parallel)
+/// 2. add previous row to each row (column blocks in parallel)
+/// </summary>
+/// <param name="data"></param>
+/// <param name="squaresPtr">output for sums of squares, can be nullptr</param>
+template <typename T>
+void IntegralImage<T>::Build(const T * data, ImageBuffer<SumType> * squaresPtr)
+{
+	const size_t w = size_t(this->dim.w);
+	const size_t h = size_t(this->dim.h);
+	const size_t c = this->channelsCount;
+	const size_t rowLen = (w + 1) * c;
+
+	//data are not initialized, all values except the first row and column are computed
+	this->sums.resize((h + 1) * rowLen);
+	if (squaresPtr != nullptr)
+	{
+		squaresPtr->resize((h + 1) * rowLen);
+	}
+
+	SumType * s = this->sums.data();
+	SumType * sq = (squaresPtr != nullptr) ? squaresPtr->data() : nullptr;
+
+	for (size_t y = 0; y <= h; y++)
+	{
+		const size_t len = (y == 0) ? rowLen : c;
+		std::fill(s + y * rowLen, s + y * rowLen + len, SumType(0));
+		if (sq != nullptr)
+		{
+			std::fill(sq + y * rowLen, sq + y * rowLen + len, SumType(0));
+		}
+	}
+
+	if ((w == 0) || (h == 0) || (c == 0))
+	{
+		return;
+	}
+
+	auto pool = MyUtils::ThreadPool::GetInstance();
+
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / (w * c));
+	pool->ParallelFor(0, h, grainRows, [&](size_t y0, size_t y1) {
+		for (size_t y = y0; y < y1; y++)
+		{
+			const size_t offset = (y + 1) * rowLen + c;
+			ImageKernels::PrefixSum(data + y * w * c, w, c, s + offset,
+				(sq != nullptr) ? sq + offset : nullptr);
+		}
+	});
+
+	pool->ParallelFor(0, rowLen, COLUMN_BLOCK_SIZE, [&](size_t i0, size_t i1) {
+		for (size_t y = 2; y <= h; y++)
+		{
+			ImageKernels::Accumulate(s + (y - 1) * rowLen + i0, s + y * rowLen + i0, i1 - i0);
+			if (sq != nullptr)
+			{
+				ImageKernels::Accumulate(sq + (y - 1) * rowLen + i0, sq + y * rowLen + i0, i1 - i0);
+			}
+		}
+	});
+}
+
+//=================================================================================================
+// Getters
+//=================================================================================================
+
+template <typename T>
+int IntegralImage<T>::GetWidth() const noexcept
+{
+	return this->dim.w;
+}
+
+template <typename T>
+int IntegralImage<T>::GetHeight() const noexcept
+{
+	return this->dim.h;
+}
+
+template <typename T>
+size_t IntegralImage<T>::GetChannelsCount() const noexcept
+{
+	return this->channelsCount;
+}
+
+template <typename T>
+bool IntegralImage<T>::HasSquares() const noexcept
+{
+	return (this->squares.empty() == false);
+}
+
+//=================================================================================================
+// Rectangle queries
+//=================================================================================================
+
+/// <summary>
+/// Clip rectangle [x0, x1) x [y0, y1) to image
+/// Returns false if clipped rectangle is empty
+/// </summary>
+template <typename T>
+bool IntegralImage<T>::ClipRect(int & x0, int & y0, int & x1, int & y1) const noexcept
+{
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, this->dim.w);
+	y1 = std::min(y1, this->dim.h);
+
+	return (x0 < x1) && (y0 < y1);
+}
+
+template <typename T>
+typename IntegralImage<T>::SumType IntegralImage<T>::GetRectSum(const ImageBuffer<SumType> & table,
+	int x0, int y0, int x1, int y1, size_t channelIndex) const noexcept
+{
+	const size_t rowLen = (size_t(this->dim.w) + 1) * this->channelsCount;
+	const SumType * r0 = table.data() + size_t(y0) * rowLen + channelIndex;
+	const SumType * r1 = table.data() + size_t(y1) * rowLen + channelIndex;
+
+	const size_t i0 = size_t(x0) * this->channelsCount;
+	const size_t i1 = size_t(x1) * this->channelsCount;
+
+	return r1[i1] - r1[i0] - r0[i1] + r0[i0];
+}
+
+/// <summary>
+/// Get sum of channel values in rectangle
+/// Rectangle is clipped to image
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+typename IntegralImage<T>::SumType IntegralImage<T>::GetSum(int x, int y, int w, int h,
+	size_t channelIndex) const noexcept
+{
+	int x0 = x;
+	int y0 = y;
+	int x1 = x + w;
+	int y1 = y + h;
+	if (this->ClipRect(x0, y0, x1, y1) == false)
+	{
+		return SumType(0);
+	}
+
+	return this->GetRectSum(this->sums, x0, y0, x1, y1, channelIndex);
+}
+
+/// <summary>
+/// Get sum of squared channel values in rectangle
+/// Rectangle is clipped to image
+/// Integral image must be created with squares
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+typename IntegralImage<T>::SumType IntegralImage<T>::GetSquaresSum(int x, int y, int w, int h,
+	size_t channelIndex) const
+{
+	if (this->HasSquares() == false)
+	{
+		MY_LOG_ERROR("Integral image was created without squares");
+		return SumType(0);
+	}
+
+	int x0 = x;
+	int y0 = y;
+	int x1 = x + w;
+	int y1 = y + h;
+	if (this->ClipRect(x0, y0, x1, y1) == false)
+	{
+		return SumType(0);
+	}
+
+	return this->GetRectSum(this->squares, x0, y0, x1, y1, channelIndex);
+}
+
+/// <summary>
+/// Get mean of channel values in rectangle
+/// Rectangle is clipped to image, mean of empty rectangle is 0
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+double IntegralImage<T>::GetMean(int x, int y, int w, int h, size_t channelIndex) const noexcept
+{
+	int x0 = x;
+	int y0 = y;
+	int x1 = x + w;
+	int y1 = y + h;
+	if (this->ClipRect(x0, y0, x1, y1) == false)
+	{
+		return 0.0;
+	}
+
+	const double area = double(x1 - x0) * double(y1 - y0);
+	return double(this->GetRectSum(this->sums, x0, y0, x1, y1, channelIndex)) / area;
+}
+
+/// <summary>
+/// Get variance of channel values in rectangle
+/// Rectangle is clipped to image, variance of empty rectangle is 0
+/// Integral image must be created with squares
+/// </summary>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+template <typename T>
+double IntegralImage<T>::GetVariance(int x, int y, int w, int h, size_t channelIndex) const
+{
+	if (this->HasSquares() == false)
+	{
+		MY_LOG_ERROR("Integral image was created without squares");
+		return 0.0;
+	}
+
+	int x0 = x;
+	int y0 = y;
+	int x1 = x + w;
+	int y1 = y + h;
+	if (this->ClipRect(x0, y0, x1, y1) == false)
+	{
+		return 0.0;
+	}
+
+	const double area = double(x1 - x0) * double(y1 - y0);
+	const double mean = double(this->GetRectSum(this->sums, x0, y0, x1, y1, channelIndex)) / area;
+	const double meanSq = double(this->GetRectSum(this->squares, x0, y0, x1, y1, channelIndex)) / area;
+
+	return std::max(0.0, meanSq - mean * mean);
+}
+
+//=================================================================================================
+// Filters
+//=================================================================================================
+
+/// <summary>
+/// Create image filtered with box (mean) filter of size
+/// (2 * radiusX + 1) x (2 * radiusY + 1)
+/// Window is clipped at image borders and mean is computed from pixels inside.
+/// Cost does not depend on radius.
+/// Output is interleaved, uint8_t values are rounded
+/// </summary>
+/// <param name="radiusX"></param>
+/// <param name="radiusY"></param>
+/// <returns></returns>
+template <typename T>
+Image2d<T> IntegralImage<T>::CreateBoxFiltered(int radiusX, int radiusY) const
+{
+	if ((radiusX < 0) || (radiusY < 0))
+	{
+		MY_LOG_ERROR("Box filter radius must not be negative");
+		return Image2d<T>();
+	}
+
+	const int w = this->dim.w;
+	const int h = this->dim.h;
+	const size_t c = this->channelsCount;
+	const size_t rowLen = (size_t(w) + 1) * c;
+
+	Image2d<T> res(w, h, this->pf, ImageUtils::DataLayout::INTERLEAVED,
+		ImageUtils::InitMode::UNINITIALIZED);
+	T * dst = res.GetData().data();
+
+	//window columns and inverse widths are same for all rows
+	std::vector<size_t> columnStart(w);
+	std::vector<size_t> columnEnd(w);
+	std::vector<double> invWidth(w);
+	for (int x = 0; x < w; x++)
+	{
+		const int x0 = std::max(0, x - radiusX);
+		const int x1 = std::min(w, x + radiusX + 1);
+		columnStart[x] = size_t(x0) * c;
+		columnEnd[x] = size_t(x1) * c;
+		invWidth[x] = 1.0 / double(x1 - x0);
+	}
+
+	const size_t grainRows = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / std::max<size_t>(1, size_t(w) * c));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(0, size_t(h), grainRows, [&](size_t yStart, size_t yEnd) {
+		for (int y = int(yStart); y < int(yEnd); y++)
+		{
+			const int y0 = std::max(0, y - radiusY);
+			const int y1 = std::min(h, y + radiusY + 1);
+			const SumType * r0 = this->sums.data() + size_t(y0) * rowLen;
+			const SumType * r1 = this->sums.data() + size_t(y1) * rowLen;
+			const double invHeight = 1.0 / double(y1 - y0);
+
+			T * out = dst + size_t(y) * size_t(w) * c;
+
+			for (int x = 0; x < w; x++)
+			{
+				const size_t i0 = columnStart[x];
+				const size_t i1 = columnEnd[x];
+				const double invArea = invWidth[x] * invHeight;
+
+				for (size_t ch = 0; ch < c; ch++)
+				{
+					const double mean = double(r1[i1 + ch] - r1[i0 + ch] - r0[i1 + ch] + r0[i0 + ch]) * invArea;
+					if constexpr (std::is_same<T, uint8_t>::value)
+					{
+						out[ch] = static_cast<T>(mean + 0.5);
+					}
+					else
+					{
+						out[ch] = static_cast<T>(mean);
+					}
+				}
+
+				out += c;
+			}
+		}
+	});
+
+	return res;
+}
+
+//=================================================================================================
+
+template class IntegralImage<uint8_t>;
+template class IntegralImage<float>;
@@ -0,0 +1,59 @@
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "./Image2d.h"
+
+/// <summary>
+/// Integral image (summed-area table) of Image2d<uint8_t / float>
+/// Each channel is summed separately, optionally with sum of squared values.
+/// Sum, mean and variance of any rectangle is computed in O(1)
+///
+/// Sums have size (w + 1) x (h + 1) with zero first row and column,
+/// sums[y][x] = sum of all pixels [0, x) x [0, y)
+/// uint8_t images use exact uint64_t sums, float images use double sums
+///
+/// Table is built in two parallel passes on the shared ThreadPool:
+/// SIMD prefix sum of each row and SIMD accumulation of rows in column blocks
+/// </summary>
+template <typename T>
+class IntegralImage
+{
+public:
+	typedef typename std::conditional<std::is_same<T, uint8_t>::value, uint64_t, double>::type SumType;
+
+	IntegralImage();
+	IntegralImage(const Image2d<T> & img, bool withSquares = false);
+
+	int GetWidth() const noexcept;
+	int GetHeight() const noexcept;
+	size_t GetChannelsCount() const noexcept;
+	bool HasSquares() const noexcept;
+
+	SumType GetSum(int x, int y, int w, int h, size_t channelIndex) const noexcept;
+	SumType GetSquaresSum(int x, int y, int w, int h, size_t channelIndex) const;
+	double GetMean(int x, int y, int w, int h, size_t channelIndex) const noexcept;
+	double GetVariance(int x, int y, int w, int h, size_t channelIndex) const;
+
+	Image2d<T> CreateBoxFiltered(int radiusX, int radiusY) const;
+
+protected:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+	static const size_t COLUMN_BLOCK_SIZE = 1024;
+
+	ImageDimension dim;
+	ColorSpace::PixelFormat pf;
+	size_t channelsCount;
+
+	ImageBuffer<SumType> sums;
+	ImageBuffer<SumType> squares;
+
+	void Build(const T * data, ImageBuffer<SumType> * squaresPtr);
+	bool ClipRect(int & x0, int & y0, int & x1, int & y1) const noexcept;
+	SumType GetRectSum(const ImageBuffer<SumType> & table,
+		int x0, int y0, int x1, int y1, size_t channelIndex) const noexcept;
+};
+
+#endif
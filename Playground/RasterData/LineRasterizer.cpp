@@ -0,0 +1,895 @@
+#include "./LineRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// round(x / 255), exact for x in [0, 255 * 255]
+/// </summary>
+static inline uint32_t Div255(uint32_t x)
+{
+	return ((x + 128) * 257) >> 16;
+}
+
+/// <summary>
+/// Draw single line clipped to the image view
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels</param>
+/// <param name="line"></param>
+template <typename T>
+void LineRasterizer::DrawLine(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment & line)
+{
+	DrawLines(img, value, &line, 1, false);
+}
+
+/// <summary>
+/// Draw batch of lines clipped to the image view
+/// If parallel is set, large batches are split to horizontal bands of image
+/// drawn on the shared ThreadPool
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels, same for all lines</param>
+/// <param name="lines"></param>
+/// <param name="linesCount"></param>
+/// <param name="parallel"></param>
+template <typename T>
+void LineRasterizer::DrawLines(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, bool parallel)
+{
+	ProcessInBands(img.GetWidth(), img.GetHeight(), lines, linesCount, 0, parallel,
+		[&](const uint32_t * indices, size_t count, const ClipRect & rect) {
+		DispatchChannels(img.GetChannelsCount(), [&](auto channels) {
+			for (size_t i = 0; i < count; i++)
+			{
+				RasterizeLine<T, decltype(channels)::value>(img, value,
+					lines[(indices) ? indices[i] : i], rect);
+			}
+		});
+	});
+}
+
+/// <summary>
+/// Draw batch of anti-aliased lines blended to the image view
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels, same for all lines</param>
+/// <param name="lines"></param>
+/// <param name="linesCount"></param>
+/// <param name="alpha">opacity [0, 1]</param>
+/// <param name="parallel"></param>
+template <typename T>
+void LineRasterizer::DrawLinesAntiAliased(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, float alpha, bool parallel)
+{
+	const Weight<T> alphaWeight = GetAlphaWeight<T>(alpha);
+	if (alphaWeight == 0)
+	{
+		return;
+	}
+
+	//second pixel across the line is 1 pixel from the ideal line
+	ProcessInBands(img.GetWidth(), img.GetHeight(), lines, linesCount, 1, parallel,
+		[&](const uint32_t * indices, size_t count, const ClipRect & rect) {
+		DispatchChannels(img.GetChannelsCount(), [&](auto channels) {
+			for (size_t i = 0; i < count; i++)
+			{
+				RasterizeLineAntiAliased<T, decltype(channels)::value>(img, value,
+					lines[(indices) ? indices[i] : i], rect, alphaWeight);
+			}
+		});
+	});
+}
+
+/// <summary>
+/// Draw batch of thick lines blended to the image view
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels, same for all lines</param>
+/// <param name="lines"></param>
+/// <param name="linesCount"></param>
+/// <param name="thickness">line width in pixels</param>
+/// <param name="alpha">opacity [0, 1]</param>
+/// <param name="parallel"></param>
+template <typename T>
+void LineRasterizer::DrawThickLines(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, float thickness, float alpha, bool parallel)
+{
+	const Weight<T> alphaWeight = GetAlphaWeight<T>(alpha);
+	if ((alphaWeight == 0) || (thickness <= 0.0f))
+	{
+		return;
+	}
+
+	//quad with square caps is inside bounding box of line enlarged by half of thickness
+	const int margin = int(std::ceil(thickness * 0.5f)) + 1;
+
+	ProcessInBands(img.GetWidth(), img.GetHeight(), lines, linesCount, margin, parallel,
+		[&](const uint32_t * indices, size_t count, const ClipRect & rect) {
+		DispatchChannels(img.GetChannelsCount(), [&](auto channels) {
+			for (size_t i = 0; i < count; i++)
+			{
+				RasterizeThickLine<T, decltype(channels)::value>(img, value,
+					lines[(indices) ? indices[i] : i], rect, double(thickness), alphaWeight);
+			}
+		});
+	});
+}
+
+/// <summary>
+/// Call drawInRect(indices, count, rect) for lines clipped to rect
+/// If parallel is set and batch is large, lines are binned to horizontal bands
+/// of image by their bounding box enlarged by margin and bands are processed
+/// on the shared ThreadPool (counting sort keeps input order in each band).
+/// Otherwise drawInRect is called once with indices nullptr (all lines) and whole image
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="lines"></param>
+/// <param name="linesCount"></param>
+/// <param name="margin">pixels drawn outside of line bounding box</param>
+/// <param name="parallel"></param>
+/// <param name="drawInRect"></param>
+template <typename Func>
+void LineRasterizer::ProcessInBands(int w, int h, const ImageUtils::LineSegment * lines, size_t linesCount,
+	int margin, bool parallel, Func && drawInRect)
+{
+	if ((w <= 0) || (h <= 0) || (linesCount == 0))
+	{
+		return;
+	}
+
+	auto pool = MyUtils::ThreadPool::GetInstance();
+	const size_t bandsCount = size_t((h + PARALLEL_BAND_ROWS - 1) / PARALLEL_BAND_ROWS);
+
+	if ((parallel == false) || (linesCount < PARALLEL_MIN_LINES) ||
+		(bandsCount < 2) || (pool->GetThreadsCount() < 2) || (linesCount > UINT32_MAX))
+	{
+		const ClipRect rect = { 0, 0, w - 1, h - 1 };
+		drawInRect(nullptr, linesCount, rect);
+		return;
+	}
+
+	std::vector<size_t> offsets(bandsCount + 1, 0);
+	std::vector<std::pair<int, int>> bandRanges(linesCount, { 0, -1 });
+
+	for (size_t i = 0; i < linesCount; i++)
+	{
+		const ImageUtils::LineSegment & l = lines[i];
+		const int64_t xMin = int64_t(std::min(l.x0, l.x1)) - margin;
+		const int64_t xMax = int64_t(std::max(l.x0, l.x1)) + margin;
+		const int64_t yMin = int64_t(std::min(l.y0, l.y1)) - margin;
+		const int64_t yMax = int64_t(std::max(l.y0, l.y1)) + margin;
+
+		if ((xMax < 0) || (xMin >= w) || (yMax < 0) || (yMin >= h))
+		{
+			continue;
+		}
+
+		const int b0 = int(std::max<int64_t>(0, yMin)) / PARALLEL_BAND_ROWS;
+		const int b1 = int(std::min<int64_t>(h - 1, yMax)) / PARALLEL_BAND_ROWS;
+		bandRanges[i] = { b0, b1 };
+
+		for (int b = b0; b <= b1; b++)
+		{
+			offsets[size_t(b) + 1]++;
+		}
+	}
+
+	for (size_t b = 0; b < bandsCount; b++)
+	{
+		offsets[b + 1] += offsets[b];
+	}
+
+	std::vector<uint32_t> indices(offsets[bandsCount]);
+	std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+
+	for (size_t i = 0; i < linesCount; i++)
+	{
+		for (int b = bandRanges[i].first; b <= bandRanges[i].second; b++)
+		{
+			indices[pos[size_t(b)]++] = uint32_t(i);
+		}
+	}
+
+	pool->ParallelFor(0, bandsCount, 1, [&](size_t b0, size_t b1) {
+		for (size_t b = b0; b < b1; b++)
+		{
+			const int yMin = int(b) * PARALLEL_BAND_ROWS;
+			const ClipRect rect = { 0, yMin, w - 1, std::min(h, yMin + PARALLEL_BAND_ROWS) - 1 };
+
+			drawInRect(indices.data() + offsets[b], offsets[b + 1] - offsets[b], rect);
+		}
+	});
+}
+
+/// <summary>
+/// Call func(std::integral_constant<size_t, C>) with C = channelsCount for 1 - 4 channels
+/// and C = 0 (channels count known only at runtime) otherwise
+/// </summary>
+/// <param name="channelsCount"></param>
+/// <param name="func"></param>
+template <typename Func>
+void LineRasterizer::DispatchChannels(size_t channelsCount, Func && func)
+{
+	switch (channelsCount)
+	{
+	case 1: func(std::integral_constant<size_t, 1>()); break;
+	case 2: func(std::integral_constant<size_t, 2>()); break;
+	case 3: func(std::integral_constant<size_t, 3>()); break;
+	case 4: func(std::integral_constant<size_t, 4>()); break;
+	default: func(std::integral_constant<size_t, 0>()); break;
+	}
+}
+
+/// <summary>
+/// Rasterize single line clipped to rectangle
+/// Runs of pixels are written as horizontal (x-major line)
+/// or vertical (y-major line) spans
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value"></param>
+/// <param name="line"></param>
+/// <param name="rect"></param>
+template <typename T, size_t C>
+void LineRasterizer::RasterizeLine(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment & line, const ClipRect & rect)
+{
+	const size_t channelsCount = img.GetChannelsCount();
+	const size_t channelStride = img.GetChannelStride();
+	const ptrdiff_t pixelStride = ptrdiff_t(img.GetPixelStride());
+	const ptrdiff_t rowStride = ptrdiff_t(img.GetRowStride());
+
+	const int64_t dx = std::abs(int64_t(line.x1) - line.x0);
+	const int64_t dy = std::abs(int64_t(line.y1) - line.y0);
+	const int sx = (line.x0 < line.x1) ? 1 : -1;
+	const int sy = (line.y0 < line.y1) ? 1 : -1;
+
+	if ((dx == 0) && (dy == 0))
+	{
+		if ((line.x0 >= rect.xMin) && (line.x0 <= rect.xMax) &&
+			(line.y0 >= rect.yMin) && (line.y0 <= rect.yMax))
+		{
+			FillSpan<T, C>(img.GetPixelStart(line.x0, line.y0), 0, 1, value, channelsCount, channelStride);
+		}
+		return;
+	}
+
+	const bool inside = (std::min(line.x0, line.x1) >= rect.xMin) && (std::max(line.x0, line.x1) <= rect.xMax) &&
+		(std::min(line.y0, line.y1) >= rect.yMin) && (std::max(line.y0, line.y1) <= rect.yMax);
+
+	int64_t first = 0;
+	int64_t last = 0;
+
+	if (dx >= dy)
+	{
+		//x-major - x moves every step, horizontal spans
+		last = dx;
+		if ((inside == false) && (ClipSteps(line.x0, sx, line.y0, sy, dx, dy,
+			rect.xMin, rect.xMax, rect.yMin, rect.yMax, first, last) == false))
+		{
+			return;
+		}
+
+		//products may exceed 64 bits for far away endpoints, err itself is small,
+		//so it is computed modulo 2^64
+		const int64_t k = (first == 0) ? 0 : FloorMulAddDiv(2 * first, dy, dx - 1, 2 * dx);
+		int64_t err = int64_t(uint64_t(dx) - uint64_t(dy) - uint64_t(first) * uint64_t(dy) + uint64_t(k) * uint64_t(dx));
+
+		const ptrdiff_t majorStep = sx * pixelStride;
+		const ptrdiff_t minorStep = sy * rowStride;
+		T * px = img.GetPixelStart(int(line.x0 + sx * first), int(line.y0 + sy * k));
+		T * runStart = px;
+		size_t runLength = 1;
+
+		for (int64_t i = first; i < last; i++)
+		{
+			const int64_t e2 = 2 * err;
+			err -= dy;
+			if (e2 < dx)
+			{
+				err += dx;
+				FillSpan<T, C>((sx > 0) ? runStart : px, pixelStride, runLength,
+					value, channelsCount, channelStride);
+				px += minorStep;
+				runStart = px + majorStep;
+				runLength = 0;
+			}
+			px += majorStep;
+			runLength++;
+		}
+
+		FillSpan<T, C>((sx > 0) ? runStart : px, pixelStride, runLength,
+			value, channelsCount, channelStride);
+	}
+	else
+	{
+		//y-major - y moves every step, vertical spans
+		last = dy;
+		if ((inside == false) && (ClipSteps(line.y0, sy, line.x0, sx, dy, dx,
+			rect.yMin, rect.yMax, rect.xMin, rect.xMax, first, last) == false))
+		{
+			return;
+		}
+
+		const int64_t m = (first == 0) ? 0 : FloorMulAddDiv(2 * first, dx, dy - 1, 2 * dy);
+		int64_t err = int64_t(uint64_t(dx) - uint64_t(dy) + uint64_t(first) * uint64_t(dx) - uint64_t(m) * uint64_t(dy));
+
+		const ptrdiff_t majorStep = sy * rowStride;
+		const ptrdiff_t minorStep = sx * pixelStride;
+		T * px = img.GetPixelStart(int(line.x0 + sx * m), int(line.y0 + sy * first));
+		T * runStart = px;
+		size_t runLength = 1;
+
+		for (int64_t i = first; i < last; i++)
+		{
+			const int64_t e2 = 2 * err;
+			err += dx;
+			if (e2 > -dy)
+			{
+				err -= dy;
+				FillSpan<T, C>((sy > 0) ? runStart : px, rowStride, runLength,
+					value, channelsCount, channelStride);
+				px += minorStep;
+				runStart = px + majorStep;
+				runLength = 0;
+			}
+			px += majorStep;
+			runLength++;
+		}
+
+		FillSpan<T, C>((sy > 0) ? runStart : px, rowStride, runLength,
+			value, channelsCount, channelStride);
+	}
+}
+
+/// <summary>
+/// Rasterize single anti-aliased line clipped to rectangle (Xiaolin Wu)
+/// For each major axis step, two pixels around the ideal line are blended
+/// with weights from fractional part of minor coordinate
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value"></param>
+/// <param name="line"></param>
+/// <param name="rect"></param>
+/// <param name="alpha"></param>
+template <typename T, size_t C>
+void LineRasterizer::RasterizeLineAntiAliased(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment & line, const ClipRect & rect, Weight<T> alpha)
+{
+	const size_t channelsCount = img.GetChannelsCount();
+	const size_t channelStride = img.GetChannelStride();
+
+	const int64_t dx = std::abs(int64_t(line.x1) - line.x0);
+	const int64_t dy = std::abs(int64_t(line.y1) - line.y0);
+	const bool xMajor = (dx >= dy);
+
+	//major axis always goes from lower to higher coordinate
+	const bool swapEnds = (xMajor) ? (line.x0 > line.x1) : (line.y0 > line.y1);
+	const int64_t major0 = (xMajor) ? ((swapEnds) ? line.x1 : line.x0) : ((swapEnds) ? line.y1 : line.y0);
+	const int64_t minor0 = (xMajor) ? ((swapEnds) ? line.y1 : line.y0) : ((swapEnds) ? line.x1 : line.x0);
+	const int64_t minor1 = (xMajor) ? ((swapEnds) ? line.y0 : line.y1) : ((swapEnds) ? line.x0 : line.x1);
+	const int64_t dMajor = (xMajor) ? dx : dy;
+
+	const int majorMin = (xMajor) ? rect.xMin : rect.yMin;
+	const int majorMax = (xMajor) ? rect.xMax : rect.yMax;
+	const int minorMin = (xMajor) ? rect.yMin : rect.xMin;
+	const int minorMax = (xMajor) ? rect.yMax : rect.xMax;
+
+	int64_t first = std::max<int64_t>(0, majorMin - major0);
+	int64_t last = std::min<int64_t>(dMajor, majorMax - major0);
+
+	//minor coordinate in 32.32 fixed point (truncated towards zero)
+	//|minor1 - minor0| may be up to 2^32, so the product is computed without overflow
+	const int64_t FIXED_ONE = int64_t(1) << 32;
+	const int64_t gradient = (dMajor == 0) ? 0 : (minor1 >= minor0) ?
+		FloorMulAddDiv(minor1 - minor0, FIXED_ONE, 0, dMajor) :
+		-FloorMulAddDiv(minor0 - minor1, FIXED_ONE, 0, dMajor);
+
+	//steps where pixels [floor(minor), floor(minor) + 1] can be inside (conservative, exact test is per pixel)
+	if (gradient == 0)
+	{
+		if ((minor0 < minorMin - 1) || (minor0 > minorMax))
+		{
+			return;
+		}
+	}
+	else
+	{
+		//clamped in double, steps may be outside of int64_t range for small gradient
+		const double g = double(minor1 - minor0) / double(dMajor);
+		const double i0 = (double(minorMin - 1) - double(minor0)) / g;
+		const double i1 = (double(minorMax + 1) - double(minor0)) / g;
+		const double stepFirst = std::max(double(first), std::floor(std::min(i0, i1)) - 1.0);
+		const double stepLast = std::min(double(last), std::ceil(std::max(i0, i1)) + 1.0);
+		if (!(stepFirst <= stepLast))
+		{
+			return;
+		}
+
+		first = int64_t(stepFirst);
+		last = int64_t(stepLast);
+	}
+
+	if (first > last)
+	{
+		return;
+	}
+
+	//minor0 + first * gradient is near the clip rectangle, but the product itself
+	//may exceed 64 bits - split it to integer part and fraction
+	const int64_t whole = FloorMulAddDiv(first, gradient, 0, FIXED_ONE);
+	const uint64_t fraction0 = uint64_t(first) * uint64_t(gradient) - (uint64_t(whole) << 32);
+	int64_t minor = (minor0 + whole) * FIXED_ONE + int64_t(fraction0);
+
+	for (int64_t i = first; i <= last; i++)
+	{
+		const int64_t m0 = minor >> 32;
+		const uint32_t fraction = uint32_t(minor & 0xFFFFFFFF);
+		const int major = int(major0 + i);
+
+		//pixel m0 gets coverage 1 - fraction, pixel m0 + 1 gets fraction
+		if ((m0 >= minorMin) && (m0 <= minorMax))
+		{
+			const Weight<T> wt = GetCoverageWeight<T>(~fraction, alpha);
+			if (wt > 0)
+			{
+				T * px = (xMajor) ? img.GetPixelStart(major, int(m0)) : img.GetPixelStart(int(m0), major);
+				BlendSpan<T, C>(px, 0, 1, value, channelsCount, channelStride, wt);
+			}
+		}
+
+		if ((m0 + 1 >= minorMin) && (m0 + 1 <= minorMax))
+		{
+			const Weight<T> wt = GetCoverageWeight<T>(fraction, alpha);
+			if (wt > 0)
+			{
+				T * px = (xMajor) ? img.GetPixelStart(major, int(m0 + 1)) : img.GetPixelStart(int(m0 + 1), major);
+				BlendSpan<T, C>(px, 0, 1, value, channelsCount, channelStride, wt);
+			}
+		}
+
+		minor += gradient;
+	}
+}
+
+/// <summary>
+/// Rasterize single thick line clipped to rectangle
+/// Line is convex quad with square caps, each row of the quad is single span.
+/// Pixel is inside if its center [x, y] is in the quad (top / left edges included)
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value"></param>
+/// <param name="line"></param>
+/// <param name="rect"></param>
+/// <param name="thickness"></param>
+/// <param name="alpha"></param>
+template <typename T, size_t C>
+void LineRasterizer::RasterizeThickLine(const Image2dView<T> & img, const T * value,
+	const ImageUtils::LineSegment & line, const ClipRect & rect, double thickness, Weight<T> alpha)
+{
+	const size_t channelsCount = img.GetChannelsCount();
+	const size_t channelStride = img.GetChannelStride();
+	const ptrdiff_t pixelStride = ptrdiff_t(img.GetPixelStride());
+
+	const double dx = double(line.x1) - line.x0;
+	const double dy = double(line.y1) - line.y0;
+	const double len = std::sqrt(dx * dx + dy * dy);
+	const double half = thickness * 0.5;
+
+	//direction (any for single point) and normal scaled by half of thickness
+	const double ux = (len > 0.0) ? dx / len * half : half;
+	const double uy = (len > 0.0) ? dy / len * half : 0.0;
+
+	const double qx[4] = {
+		line.x0 - ux - uy, line.x1 + ux - uy, line.x1 + ux + uy, line.x0 - ux + uy
+	};
+	const double qy[4] = {
+		line.y0 - uy + ux, line.y1 + uy + ux, line.y1 + uy - ux, line.y0 - uy - ux
+	};
+
+	const double top = std::min(std::min(qy[0], qy[1]), std::min(qy[2], qy[3]));
+	const double bottom = std::max(std::max(qy[0], qy[1]), std::max(qy[2], qy[3]));
+
+	//clamped in double, quad may be outside of int range
+	const double rowFirst = std::max(std::ceil(top), double(rect.yMin));
+	const double rowLast = std::min(std::ceil(bottom) - 1.0, double(rect.yMax));
+	if (!(rowFirst <= rowLast))
+	{
+		return;
+	}
+
+	const int y0 = int(rowFirst);
+	const int y1 = int(rowLast);
+
+	const Weight<T> opaque = GetAlphaWeight<T>(1.0f);
+
+	//non-horizontal edges [yTop, yBottom) with x at yTop and dx / dy
+	double edgeTop[4];
+	double edgeBottom[4];
+	double edgeX[4];
+	double edgeSlope[4];
+	size_t edgesCount = 0;
+
+	for (size_t e = 0; e < 4; e++)
+	{
+		const size_t n = (e + 1) % 4;
+		if (qy[e] == qy[n])
+		{
+			continue;
+		}
+
+		const size_t t = (qy[e] < qy[n]) ? e : n;
+		const size_t b = (qy[e] < qy[n]) ? n : e;
+		edgeTop[edgesCount] = qy[t];
+		edgeBottom[edgesCount] = qy[b];
+		edgeX[edgesCount] = qx[t];
+		edgeSlope[edgesCount] = (qx[b] - qx[t]) / (qy[b] - qy[t]);
+		edgesCount++;
+	}
+
+	for (int y = y0; y <= y1; y++)
+	{
+		//rows [top, bottom) of each edge
+		double left = std::numeric_limits<double>::max();
+		double right = std::numeric_limits<double>::lowest();
+
+		for (size_t e = 0; e < edgesCount; e++)
+		{
+			if ((y < edgeTop[e]) || (y >= edgeBottom[e]))
+			{
+				continue;
+			}
+
+			const double x = edgeX[e] + (y - edgeTop[e]) * edgeSlope[e];
+			left = std::min(left, x);
+			right = std::max(right, x);
+		}
+
+		//no edge spans this row (rounding of far away quad)
+		if (!(left <= right))
+		{
+			continue;
+		}
+
+		//pixels [ceil(left), ceil(right) - 1]
+		const double spanFirst = std::max(std::ceil(left), double(rect.xMin));
+		const double spanLast = std::min(std::ceil(right) - 1.0, double(rect.xMax));
+		if (!(spanFirst <= spanLast))
+		{
+			continue;
+		}
+
+		const int x0 = int(spanFirst);
+		const int x1 = int(spanLast);
+
+		T * start = img.GetPixelStart(x0, y);
+		if (alpha == opaque)
+		{
+			FillSpan<T, C>(start, pixelStride, size_t(x1 - x0 + 1), value, channelsCount, channelStride);
+		}
+		else
+		{
+			BlendSpan<T, C>(start, pixelStride, size_t(x1 - x0 + 1), value, channelsCount, channelStride, alpha);
+		}
+	}
+}
+
+/// <summary>
+/// Write value to count pixels starting at start, step apart
+/// C is channels count, 0 for channels count known only at runtime
+/// </summary>
+/// <param name="start"></param>
+/// <param name="step"></param>
+/// <param name="count"></param>
+/// <param name="value"></param>
+/// <param name="channelsCount"></param>
+/// <param name="channelStride"></param>
+template <typename T, size_t C>
+void LineRasterizer::FillSpan(T * start, ptrdiff_t step, size_t count,
+	const T * value, size_t channelsCount, size_t channelStride)
+{
+	if constexpr (C > 0)
+	{
+		if (channelStride == 1)
+		{
+			//interleaved - whole pixel is written at once
+			T pixel[C];
+			memcpy(pixel, value, sizeof(pixel));
+
+			if ((C == 1) && (step == 1))
+			{
+				std::fill(start, start + count, pixel[0]);
+				return;
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				memcpy(start + ptrdiff_t(i) * step, pixel, sizeof(pixel));
+			}
+			return;
+		}
+	}
+
+	const size_t cc = (C == 0) ? channelsCount : C;
+
+	for (size_t c = 0; c < cc; c++)
+	{
+		const T v = value[c];
+		T * px = start + c * channelStride;
+		for (size_t i = 0; i < count; i++)
+		{
+			px[ptrdiff_t(i) * step] = v;
+		}
+	}
+}
+
+/// <summary>
+/// Blend value to count pixels starting at start, step apart
+/// d = d + (v - d) * weight
+/// </summary>
+/// <param name="start"></param>
+/// <param name="step"></param>
+/// <param name="count"></param>
+/// <param name="value"></param>
+/// <param name="channelsCount"></param>
+/// <param name="channelStride"></param>
+/// <param name="weight"></param>
+template <typename T, size_t C>
+void LineRasterizer::BlendSpan(T * start, ptrdiff_t step, size_t count,
+	const T * value, size_t channelsCount, size_t channelStride, Weight<T> weight)
+{
+	if constexpr ((std::is_same<T, uint8_t>::value) && (C > 0))
+	{
+		//d = round((d * (255 - w) + v * w) / 255), v * w is the same for whole span
+		uint32_t vw[C];
+		for (size_t c = 0; c < C; c++)
+		{
+			vw[c] = value[c] * weight;
+		}
+
+		const uint32_t iw = 255 - weight;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint8_t * px = start + ptrdiff_t(i) * step;
+			for (size_t c = 0; c < C; c++)
+			{
+				px[c * channelStride] = static_cast<uint8_t>(Div255(px[c * channelStride] * iw + vw[c]));
+			}
+		}
+		return;
+	}
+
+	const size_t cc = (C == 0) ? channelsCount : C;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		T * px = start + ptrdiff_t(i) * step;
+		for (size_t c = 0; c < cc; c++)
+		{
+			T & d = px[c * channelStride];
+			if constexpr (std::is_same<T, uint8_t>::value)
+			{
+				d = static_cast<uint8_t>(Div255(d * (255 - weight) + value[c] * weight));
+			}
+			else
+			{
+				d += (value[c] - d) * weight;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Convert opacity [0, 1] to blend weight
+/// </summary>
+/// <param name="alpha"></param>
+/// <returns></returns>
+template <typename T>
+LineRasterizer::Weight<T> LineRasterizer::GetAlphaWeight(float alpha) noexcept
+{
+	alpha = std::min(std::max(alpha, 0.0f), 1.0f);
+	if constexpr (std::is_same<T, uint8_t>::value)
+	{
+		return uint32_t(alpha * 255.0f + 0.5f);
+	}
+	else
+	{
+		return alpha;
+	}
+}
+
+/// <summary>
+/// Get blend weight of pixel with coverage fraction / 2^32 and given alpha weight
+/// </summary>
+/// <param name="fraction"></param>
+/// <param name="alpha"></param>
+/// <returns></returns>
+template <typename T>
+LineRasterizer::Weight<T> LineRasterizer::GetCoverageWeight(uint32_t fraction, Weight<T> alpha) noexcept
+{
+	if constexpr (std::is_same<T, uint8_t>::value)
+	{
+		return Div255((fraction >> 24) * alpha);
+	}
+	else
+	{
+		return float(fraction * (1.0 / 4294967296.0)) * alpha;
+	}
+}
+
+/// <summary>
+/// Compute range of major axis steps [first, last] of line inside clip rectangle
+/// Pixel of step i in [0, dMajor] is
+/// major = majorStart + majorSign * i,
+/// minor = minorStart + minorSign * k(i), k(i) = floor((2 * i * dMinor + dMajor - 1) / (2 * dMajor))
+/// k(i) is non-decreasing, so pixels inside rectangle form single range of steps.
+/// Returns false if no pixel is inside
+/// </summary>
+/// <param name="majorStart"></param>
+/// <param name="majorSign"></param>
+/// <param name="minorStart"></param>
+/// <param name="minorSign"></param>
+/// <param name="dMajor">must be > 0</param>
+/// <param name="dMinor">must be in [0, dMajor]</param>
+/// <param name="majorMin"></param>
+/// <param name="majorMax"></param>
+/// <param name="minorMin"></param>
+/// <param name="minorMax"></param>
+/// <param name="first"></param>
+/// <param name="last"></param>
+/// <returns></returns>
+bool LineRasterizer::ClipSteps(int64_t majorStart, int majorSign, int64_t minorStart, int minorSign,
+	int64_t dMajor, int64_t dMinor, int majorMin, int majorMax, int minorMin, int minorMax,
+	int64_t & first, int64_t & last)
+{
+	first = 0;
+	last = dMajor;
+
+	//major axis
+	if (majorSign > 0)
+	{
+		first = std::max<int64_t>(first, majorMin - majorStart);
+		last = std::min<int64_t>(last, majorMax - majorStart);
+	}
+	else
+	{
+		first = std::max<int64_t>(first, majorStart - majorMax);
+		last = std::min<int64_t>(last, majorStart - majorMin);
+	}
+
+	//minor axis - range of k(i)
+	//(k(i) is in [0, dMinor])
+	const int64_t kMin = std::max<int64_t>(0,
+		(minorSign > 0) ? minorMin - minorStart : minorStart - minorMax);
+	const int64_t kMax = std::min<int64_t>(dMinor,
+		(minorSign > 0) ? minorMax - minorStart : minorStart - minorMin);
+
+	if (kMin > kMax)
+	{
+		return false;
+	}
+
+	if (dMinor > 0)
+	{
+		//k(i) >= kMin <=> 2 * i * dMinor >= (2 * kMin - 1) * dMajor + 1
+		//k(i) <= kMax <=> 2 * i * dMinor <= (2 * kMax + 1) * dMajor
+		first = std::max(first, CeilMulAddDiv(2 * kMin - 1, dMajor, 1, 2 * dMinor));
+		last = std::min(last, FloorMulAddDiv(2 * kMax + 1, dMajor, 0, 2 * dMinor));
+	}
+
+	return (first <= last);
+}
+
+/// <summary>
+/// floor((a * b + add) / c) without overflow of a * b
+/// Line coordinates span up to 2^32, so products of two distances need up to 66 bits.
+/// Small products are computed directly, others in 128-bit two's complement
+/// (hi:lo) with division by shift-subtract.
+/// Result must fit to int64_t.
+/// </summary>
+/// <param name="a">|a| < 2^62</param>
+/// <param name="b">|b| < 2^62</param>
+/// <param name="add"></param>
+/// <param name="c">must be > 0 and < 2^62</param>
+/// <returns></returns>
+int64_t LineRasterizer::FloorMulAddDiv(int64_t a, int64_t b, int64_t add, int64_t c) noexcept
+{
+	const int64_t LIMIT = int64_t(1) << 30;
+	if ((a > -LIMIT) && (a < LIMIT) && (b > -LIMIT) && (b < LIMIT) && (add > -LIMIT) && (add < LIMIT))
+	{
+		const int64_t n = a * b + add;
+		const int64_t q = n / c;
+		return ((n % c != 0) && (n < 0)) ? q - 1 : q;
+	}
+
+	const uint64_t MASK = 0xFFFFFFFF;
+	const bool negative = ((a < 0) != (b < 0));
+	const uint64_t ua = (a < 0) ? uint64_t(0) - uint64_t(a) : uint64_t(a);
+	const uint64_t ub = (b < 0) ? uint64_t(0) - uint64_t(b) : uint64_t(b);
+
+	//|a| * |b|
+	const uint64_t ll = (ua & MASK) * (ub & MASK);
+	const uint64_t lh = (ua & MASK) * (ub >> 32);
+	const uint64_t hl = (ua >> 32) * (ub & MASK);
+	const uint64_t hh = (ua >> 32) * (ub >> 32);
+	const uint64_t mid = (ll >> 32) + (lh & MASK) + (hl & MASK);
+
+	uint64_t lo = (mid << 32) | (ll & MASK);
+	uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+	if (negative)
+	{
+		lo = ~lo + 1;
+		hi = ~hi + ((lo == 0) ? 1 : 0);
+	}
+
+	//+ add (sign extended)
+	const uint64_t sum = lo + uint64_t(add);
+	hi += ((sum < lo) ? 1 : 0) + ((add < 0) ? ~uint64_t(0) : 0);
+	lo = sum;
+
+	//floor of negative n is -ceil(|n| / c)
+	const bool negativeSum = ((hi >> 63) != 0);
+	if (negativeSum)
+	{
+		lo = ~lo + 1;
+		hi = ~hi + ((lo == 0) ? 1 : 0);
+	}
+
+	//quotient fits to 64 bits, so hi < c
+	const uint64_t uc = uint64_t(c);
+	uint64_t r = hi;
+	uint64_t q = 0;
+	for (int i = 63; i >= 0; i--)
+	{
+		r = (r << 1) | ((lo >> i) & 1);
+		q <<= 1;
+		if (r >= uc)
+		{
+			r -= uc;
+			q |= 1;
+		}
+	}
+
+	if (negativeSum)
+	{
+		return -int64_t(q) - ((r != 0) ? 1 : 0);
+	}
+	return int64_t(q);
+}
+
+/// <summary>
+/// ceil((a * b + add) / c) without overflow of a * b
+/// </summary>
+int64_t LineRasterizer::CeilMulAddDiv(int64_t a, int64_t b, int64_t add, int64_t c) noexcept
+{
+	return -FloorMulAddDiv(-a, b, -add, c);
+}
+
+//=================================================================================================
+
+template void LineRasterizer::DrawLine(const Image2dView<uint8_t> & img, const uint8_t * value,
+	const ImageUtils::LineSegment & line);
+template void LineRasterizer::DrawLine(const Image2dView<float> & img, const float * value,
+	const ImageUtils::LineSegment & line);
+
+template void LineRasterizer::DrawLines(const Image2dView<uint8_t> & img, const uint8_t * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, bool parallel);
+template void LineRasterizer::DrawLines(const Image2dView<float> & img, const float * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, bool parallel);
+
+template void LineRasterizer::DrawLinesAntiAliased(const Image2dView<uint8_t> & img, const uint8_t * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, float alpha, bool parallel);
+template void LineRasterizer::DrawLinesAntiAliased(const Image2dView<float> & img, const float * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, float alpha, bool parallel);
+
+template void LineRasterizer::DrawThickLines(const Image2dView<uint8_t> & img, const uint8_t * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, float thickness, float alpha, bool parallel);
+template void LineRasterizer::DrawThickLines(const Image2dView<float> & img, const float * value,
+	const ImageUtils::LineSegment * lines, size_t linesCount, float thickness, float alpha, bool parallel);
@@ -0,0 +1,121 @@
+#ifndef LINE_RASTERIZER_H
+#define LINE_RASTERIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "./Image2dView.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Span based Bresenham rasterizer of simple (not anti-aliased) lines
+///
+/// Pixels of the line are given in closed form: for major axis step i,
+/// minor axis offset is round(i * dMinor / dMajor) (half rounded down),
+/// which is the same pixel set as ImageUtils::ProcessLinePixels.
+/// Clipping is done on this form in integer arithmetic - range of major axis steps
+/// inside the clip rectangle is computed and rasterization starts there with the exact
+/// error term. Clipped line is therefore the part of the unclipped line inside the image
+/// and lines clipped to neighbouring bands join without seams.
+///
+/// Rasterization runs per octant: runs of pixels with the same minor coordinate
+/// are written as whole horizontal (x-major) or vertical (y-major) spans
+/// with channel count known at compile time.
+///
+/// Line end points must be in range (-2^30, 2^30).
+///
+/// Anti-aliased lines (Xiaolin Wu) write two pixels across the line per major axis step
+/// with coverage from 32.32 fixed point minor coordinate.
+/// Thick lines are convex quads (square caps extended by half of thickness,
+/// so thickness 1 axis-aligned lines cover the same pixels as simple lines)
+/// filled with spans, pixels are sampled at their centers.
+/// Both are blended into image: d = d + (v - d) * coverage * alpha,
+/// uint8_t with rounded integer weights 0 - 255.
+///
+/// Batches can be split to horizontal bands of the image processed in parallel.
+/// Segments are binned to bands in input order, so the result is the same
+/// as serial drawing (later segments overwrite earlier).
+/// </summary>
+class LineRasterizer
+{
+public:
+	template <typename T>
+	static void DrawLine(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment & line);
+
+	template <typename T>
+	static void DrawLines(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment * lines, size_t linesCount, bool parallel);
+
+	template <typename T>
+	static void DrawLinesAntiAliased(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment * lines, size_t linesCount, float alpha, bool parallel);
+
+	template <typename T>
+	static void DrawThickLines(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment * lines, size_t linesCount, float thickness, float alpha, bool parallel);
+
+private:
+	static const int PARALLEL_BAND_ROWS = 64;
+	static const size_t PARALLEL_MIN_LINES = 256;
+
+	/// <summary>
+	/// Clip rectangle [xMin, xMax] x [yMin, yMax] (inclusive)
+	/// </summary>
+	struct ClipRect
+	{
+		int xMin;
+		int yMin;
+		int xMax;
+		int yMax;
+	};
+
+	/// <summary>
+	/// Blend weight - 0 - 255 for uint8_t, 0 - 1 for float
+	/// </summary>
+	template <typename T>
+	using Weight = typename std::conditional<std::is_same<T, uint8_t>::value, uint32_t, float>::type;
+
+	template <typename Func>
+	static void ProcessInBands(int w, int h, const ImageUtils::LineSegment * lines, size_t linesCount,
+		int margin, bool parallel, Func && drawInRect);
+
+	template <typename Func>
+	static void DispatchChannels(size_t channelsCount, Func && func);
+
+	template <typename T, size_t C>
+	static void RasterizeLine(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment & line, const ClipRect & rect);
+
+	template <typename T, size_t C>
+	static void RasterizeLineAntiAliased(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment & line, const ClipRect & rect, Weight<T> alpha);
+
+	template <typename T, size_t C>
+	static void RasterizeThickLine(const Image2dView<T> & img, const T * value,
+		const ImageUtils::LineSegment & line, const ClipRect & rect, double thickness, Weight<T> alpha);
+
+	template <typename T, size_t C>
+	static void FillSpan(T * start, ptrdiff_t step, size_t count,
+		const T * value, size_t channelsCount, size_t channelStride);
+
+	template <typename T, size_t C>
+	static void BlendSpan(T * start, ptrdiff_t step, size_t count,
+		const T * value, size_t channelsCount, size_t channelStride, Weight<T> weight);
+
+	template <typename T>
+	static Weight<T> GetAlphaWeight(float alpha) noexcept;
+	template <typename T>
+	static Weight<T> GetCoverageWeight(uint32_t fraction, Weight<T> alpha) noexcept;
+
+	static bool ClipSteps(int64_t majorStart, int majorSign, int64_t minorStart, int minorSign,
+		int64_t dMajor, int64_t dMinor, int majorMin, int majorMax, int minorMin, int minorMax,
+		int64_t & first, int64_t & last);
+
+	static int64_t FloorMulAddDiv(int64_t a, int64_t b, int64_t add, int64_t c) noexcept;
+	static int64_t CeilMulAddDiv(int64_t a, int64_t b, int64_t add, int64_t c) noexcept;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "./LookupTable.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+/// <summary>
+/// Create identity table
+/// </summary>
+LookupTable::LookupTable() :
+	LookupTable(CreateIdentity())
+{
+}
+
+/// <summary>
+/// Create table used for all channels
+/// </summary>
+/// <param name="table"></param>
+LookupTable::LookupTable(const Table & table) :
+	tables({ table })
+{
+}
+
+/// <summary>
+/// Create table for each channel
+/// Number of tables must match number of channels of image
+/// </summary>
+/// <param name="channelTables"></param>
+LookupTable::LookupTable(const std::vector<Table> & channelTables) :
+	tables(channelTables)
+{
+	if (this->tables.empty())
+	{
+		MY_LOG_ERROR("Lookup table has no channel tables, identity is used");
+		*this = CreateIdentity();
+	}
+}
+
+LookupTable LookupTable::CreateIdentity()
+{
+	Table t;
+	for (size_t i = 0; i < t.size(); i++)
+	{
+		t[i] = uint8_t(i);
+	}
+	return LookupTable(t);
+}
+
+LookupTable LookupTable::CreateInvert()
+{
+	Table t;
+	for (size_t i = 0; i < t.size(); i++)
+	{
+		t[i] = uint8_t(255 - i);
+	}
+	return LookupTable(t);
+}
+
+/// <summary>
+/// Create gamma curve
+/// out = 255 * (in / 255) ^ gamma
+/// </summary>
+/// <param name="gamma"></param>
+/// <returns></returns>
+LookupTable LookupTable::CreateGamma(double gamma)
+{
+	return CreateFromFunction([gamma](double v) {
+		return 255.0 * std::pow(v / 255.0, gamma);
+	});
+}
+
+/// <summary>
+/// Create threshold
+/// out = (in >= threshold) ? high : low
+/// </summary>
+/// <param name="threshold"></param>
+/// <param name="low"></param>
+/// <param name="high"></param>
+/// <returns></returns>
+LookupTable LookupTable::CreateThreshold(uint8_t threshold, uint8_t low, uint8_t high)
+{
+	Table t;
+	for (size_t i = 0; i < t.size(); i++)
+	{
+		t[i] = (i >= threshold) ? high : low;
+	}
+	return LookupTable(t);
+}
+
+/// <summary>
+/// Create levels adjustment
+/// Input range [inBlack, inWhite] is mapped to [0, 1] (values outside are clamped),
+/// raised to 1 / gamma and mapped to output range [outBlack, outWhite]
+/// </summary>
+/// <param name="inBlack"></param>
+/// <param name="inWhite"></param>
+/// <param name="gamma">midtones gamma (1 - no change, > 1 - brighter)</param>
+/// <param name="outBlack"></param>
+/// <param name="outWhite"></param>
+/// <returns></returns>
+LookupTable LookupTable::CreateLevels(uint8_t inBlack, uint8_t inWhite, double gamma,
+	uint8_t outBlack, uint8_t outWhite)
+{
+	if ((inWhite <= inBlack) || (gamma <= 0.0))
+	{
+		MY_LOG_ERROR("Invalid levels input range or gamma, identity is used");
+		return CreateIdentity();
+	}
+
+	const double range = double(inWhite - inBlack);
+	const double invGamma = 1.0 / gamma;
+
+	return CreateFromFunction([&](double v) {
+		const double x = std::min(1.0, std::max(0.0, (v - inBlack) / range));
+		return outBlack + (double(outWhite) - double(outBlack)) * std::pow(x, invGamma);
+	});
+}
+
+/// <summary>
+/// Compose tables to one
+/// Result is the same as applying luts[0], luts[1], ... one after another
+/// </summary>
+/// <param name="luts"></param>
+/// <returns></returns>
+LookupTable LookupTable::Compose(const std::vector<LookupTable> & luts)
+{
+	LookupTable res;
+	for (const auto & lut : luts)
+	{
+		res = res.Then(lut);
+	}
+	return res;
+}
+
+//=================================================================================================
+// Getters
+//=================================================================================================
+
+bool LookupTable::IsPerChannel() const noexcept
+{
+	return (this->tables.size() > 1);
+}
+
+size_t LookupTable::GetTablesCount() const noexcept
+{
+	return this->tables.size();
+}
+
+/// <summary>
+/// Get table of channel
+/// Single table is returned for any channel
+/// </summary>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+const LookupTable::Table & LookupTable::GetTable(size_t channelIndex) const noexcept
+{
+	return this->tables[(this->tables.size() == 1) ? 0 : channelIndex];
+}
+
+uint8_t LookupTable::GetValue(size_t channelIndex, uint8_t value) const noexcept
+{
+	return this->GetTable(channelIndex)[value];
+}
+
+bool LookupTable::HasSameTables() const noexcept
+{
+	for (size_t i = 1; i < this->tables.size(); i++)
+	{
+		if (this->tables[i] != this->tables[0])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//=================================================================================================
+// Composition
+//=================================================================================================
+
+/// <summary>
+/// Compose with next table
+/// result[v] = next[this[v]] for each channel
+/// Single table is combined with each channel table of the other one,
+/// per-channel tables must have the same number of channels
+/// </summary>
+/// <param name="next"></param>
+/// <returns></returns>
+LookupTable LookupTable::Then(const LookupTable & next) const
+{
+	const size_t count = std::max(this->tables.size(), next.tables.size());
+	if ((this->IsPerChannel()) && (next.IsPerChannel()) && (this->tables.size() != next.tables.size()))
+	{
+		MY_LOG_ERROR("Lookup tables with different number of channels can not be composed");
+		return *this;
+	}
+
+	std::vector<Table> res(count);
+	for (size_t ch = 0; ch < count; ch++)
+	{
+		const Table & first = this->GetTable(ch);
+		const Table & second = next.GetTable(ch);
+		for (size_t i = 0; i < first.size(); i++)
+		{
+			res[ch][i] = second[first[i]];
+		}
+	}
+
+	return LookupTable(res);
+}
+
+//=================================================================================================
+// Apply
+//=================================================================================================
+
+/// <summary>
+/// Apply table in place
+/// Per-channel table must have the same number of tables as image channels
+/// </summary>
+/// <param name="img"></param>
+void LookupTable::Apply(Image2d<uint8_t> & img) const
+{
+	if ((this->IsPerChannel()) && (this->tables.size() != img.GetChannelsCount()))
+	{
+		MY_LOG_ERROR("Lookup table has %zu channel tables, image has %zu channels",
+			this->tables.size(), img.GetChannelsCount());
+		return;
+	}
+
+	uint8_t * data = img.GetData().data();
+	this->ApplyTo(data, data, img.GetPixelsCount(), img.GetChannelsCount(), img.GetLayout());
+}
+
+/// <summary>
+/// Create copy of image with applied table
+/// </summary>
+/// <param name="img"></param>
+/// <returns></returns>
+Image2d<uint8_t> LookupTable::CreateApplied(const Image2d<uint8_t> & img) const
+{
+	if ((this->IsPerChannel()) && (this->tables.size() != img.GetChannelsCount()))
+	{
+		MY_LOG_ERROR("Lookup table has %zu channel tables, image has %zu channels",
+			this->tables.size(), img.GetChannelsCount());
+		return Image2d<uint8_t>();
+	}
+
+	Image2d<uint8_t> res(img.GetWidth(), img.GetHeight(), img.GetPixelFormat(), img.GetLayout(),
+		ImageUtils::InitMode::UNINITIALIZED);
+
+	this->ApplyTo(img.GetData().data(), res.GetData().data(), img.GetPixelsCount(),
+		img.GetChannelsCount(), img.GetLayout());
+
+	return res;
+}
+
+/// <summary>
+/// Apply tables to image data
+/// Single table (or all tables equal) - one SIMD pass over all values
+/// Planar data - SIMD pass over each plane with its table
+/// Interleaved data with different tables - per-channel pass
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output">can be the same as input</param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="layout"></param>
+void LookupTable::ApplyTo(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+	size_t channelsCount, ImageUtils::DataLayout layout) const
+{
+	auto pool = MyUtils::ThreadPool::GetInstance();
+
+	if ((this->HasSameTables()) || (channelsCount == 1))
+	{
+		const uint8_t * table = this->tables[0].data();
+		pool->ParallelFor(0, pixelsCount * channelsCount, PARALLEL_MIN_TASK_SIZE, [&](size_t i0, size_t i1) {
+			ImageKernels::ApplyLut(input + i0, output + i0, i1 - i0, table);
+		});
+		return;
+	}
+
+	if (layout == ImageUtils::DataLayout::PLANAR)
+	{
+		for (size_t ch = 0; ch < channelsCount; ch++)
+		{
+			const uint8_t * table = this->tables[ch].data();
+			const size_t offset = ch * pixelsCount;
+			pool->ParallelFor(0, pixelsCount, PARALLEL_MIN_TASK_SIZE, [&](size_t i0, size_t i1) {
+				ImageKernels::ApplyLut(input + offset + i0, output + offset + i0, i1 - i0, table);
+			});
+		}
+		return;
+	}
+
+	//tables stored one after another for the kernel
+	std::vector<uint8_t> packed(channelsCount * 256);
+	for (size_t ch = 0; ch < channelsCount; ch++)
+	{
+		std::copy(this->tables[ch].begin(), this->tables[ch].end(), packed.begin() + ch * 256);
+	}
+
+	const size_t grainPixels = std::max<size_t>(1, PARALLEL_MIN_TASK_SIZE / channelsCount);
+	pool->ParallelFor(0, pixelsCount, grainPixels, [&](size_t i0, size_t i1) {
+		ImageKernels::ApplyLut(input + i0 * channelsCount, output + i0 * channelsCount, i1 - i0,
+			channelsCount, packed.data());
+	});
+}
@@ -0,0 +1,77 @@
+#ifndef LOOKUP_TABLE_H
+#define LOOKUP_TABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./Image2d.h"
+
+/// <summary>
+/// Value remap of Image2d<uint8_t> with 256-entry tables
+/// LookupTable has either one table used for all channels or one table per channel.
+///
+/// Several tables can be composed to one (Then / Compose), so the chain
+/// of adjustments costs single pass over image.
+/// Single table is applied with SIMD byte shuffles (ImageKernels::ApplyLut),
+/// data are processed in parallel on the shared ThreadPool.
+/// </summary>
+class LookupTable
+{
+public:
+	typedef std::array<uint8_t, 256> Table;
+
+	LookupTable();
+	explicit LookupTable(const Table & table);
+	explicit LookupTable(const std::vector<Table> & channelTables);
+
+	static LookupTable CreateIdentity();
+	static LookupTable CreateInvert();
+	static LookupTable CreateGamma(double gamma);
+	static LookupTable CreateThreshold(uint8_t threshold, uint8_t low = 0, uint8_t high = 255);
+	static LookupTable CreateLevels(uint8_t inBlack, uint8_t inWhite, double gamma,
+		uint8_t outBlack = 0, uint8_t outWhite = 255);
+	static LookupTable Compose(const std::vector<LookupTable> & luts);
+
+	template <typename Func>
+	static LookupTable CreateFromFunction(Func && func);
+
+	bool IsPerChannel() const noexcept;
+	size_t GetTablesCount() const noexcept;
+	const Table & GetTable(size_t channelIndex) const noexcept;
+	uint8_t GetValue(size_t channelIndex, uint8_t value) const noexcept;
+
+	LookupTable Then(const LookupTable & next) const;
+
+	void Apply(Image2d<uint8_t> & img) const;
+	Image2d<uint8_t> CreateApplied(const Image2d<uint8_t> & img) const;
+
+protected:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 256 * 1024;
+
+	std::vector<Table> tables;
+
+	bool HasSameTables() const noexcept;
+	void ApplyTo(const uint8_t * input, uint8_t * output, size_t pixelsCount, size_t channelsCount,
+		ImageUtils::DataLayout layout) const;
+};
+
+/// <summary>
+/// Create single table from function
+/// table[i] = func(i), result is clamped to [0, 255] and rounded
+/// </summary>
+/// <param name="func">callable (double value) -> double</param>
+/// <returns></returns>
+template <typename Func>
+LookupTable LookupTable::CreateFromFunction(Func && func)
+{
+	Table t;
+	for (size_t i = 0; i < t.size(); i++)
+	{
+		t[i] = ImageUtils::clamp_cast<uint8_t>(double(func(double(i))) + 0.5);
+	}
+	return LookupTable(t);
+}
+
+#endif
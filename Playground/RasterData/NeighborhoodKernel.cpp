@@ -0,0 +1,239 @@
+#include "./NeighborhoodKernel.h"
+
+#include <cmath>
+#include <utility>
+
+#include "../Utils/Logger.h"
+
+//=================================================================================================
+// static factories
+//=================================================================================================
+
+/// <summary>
+/// Create normalized box (mean) kernel
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <returns></returns>
+NeighborhoodKernel NeighborhoodKernel::CreateBox(int w, int h)
+{
+	if ((w <= 0) || (h <= 0))
+	{
+		MY_LOG_ERROR("Kernel size must be positive");
+		return NeighborhoodKernel(0, 0, {});
+	}
+
+	return NeighborhoodKernel(std::vector<float>(w, 1.0f / w), std::vector<float>(h, 1.0f / h));
+}
+
+/// <summary>
+/// Create normalized Gaussian kernel with size 2 * radius + 1
+/// </summary>
+/// <param name="sigma"></param>
+/// <param name="radius">0 - radius is computed from sigma (3 * sigma)</param>
+/// <returns></returns>
+NeighborhoodKernel NeighborhoodKernel::CreateGaussian(float sigma, int radius)
+{
+	if (sigma <= 0.0f)
+	{
+		MY_LOG_ERROR("Gaussian sigma must be positive");
+		return NeighborhoodKernel(0, 0, {});
+	}
+
+	if (radius <= 0)
+	{
+		radius = static_cast<int>(std::ceil(3.0f * sigma));
+	}
+
+	std::vector<float> g(2 * radius + 1);
+
+	double sum = 0;
+	for (int i = -radius; i <= radius; i++)
+	{
+		double v = std::exp(-(i * i) / (2.0 * sigma * sigma));
+		g[i + radius] = static_cast<float>(v);
+		sum += v;
+	}
+
+	for (auto & v : g)
+	{
+		v = static_cast<float>(v / sum);
+	}
+
+	return NeighborhoodKernel(g, g);
+}
+
+/// <summary>
+/// Create 3x3 Sobel kernel for horizontal derivative
+/// </summary>
+/// <returns></returns>
+NeighborhoodKernel NeighborhoodKernel::CreateSobelX()
+{
+	return NeighborhoodKernel({ -1.0f, 0.0f, 1.0f }, { 1.0f, 2.0f, 1.0f });
+}
+
+/// <summary>
+/// Create 3x3 Sobel kernel for vertical derivative
+/// </summary>
+/// <returns></returns>
+NeighborhoodKernel NeighborhoodKernel::CreateSobelY()
+{
+	return NeighborhoodKernel({ 1.0f, 2.0f, 1.0f }, { -1.0f, 0.0f, 1.0f });
+}
+
+//=================================================================================================
+// ctors
+//=================================================================================================
+
+/// <summary>
+/// Create kernel w x h with anchor in the center
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="values">w * h values, row by row</param>
+NeighborhoodKernel::NeighborhoodKernel(int w, int h, const std::vector<float> & values) :
+	NeighborhoodKernel(w, h, values, w / 2, h / 2)
+{
+}
+
+/// <summary>
+/// Create kernel w x h with given anchor
+/// </summary>
+/// <param name="w"></param>
+/// <param name="h"></param>
+/// <param name="values">w * h values, row by row</param>
+/// <param name="anchorX"></param>
+/// <param name="anchorY"></param>
+NeighborhoodKernel::NeighborhoodKernel(int w, int h, const std::vector<float> & values,
+	int anchorX, int anchorY) :
+	w(w),
+	h(h),
+	anchorX(anchorX),
+	anchorY(anchorY),
+	values(values)
+{
+	if ((w < 0) || (h < 0) || (values.size() != size_t(w) * size_t(h)))
+	{
+		MY_LOG_ERROR("Kernel values do not match its size");
+		this->w = 0;
+		this->h = 0;
+		this->values.clear();
+		return;
+	}
+
+	this->DetectSeparable();
+}
+
+/// <summary>
+/// Create separable kernel from its horizontal and vertical part
+/// Anchor is in the center
+/// </summary>
+/// <param name="rowValues">horizontal part (kernel width)</param>
+/// <param name="columnValues">vertical part (kernel height)</param>
+NeighborhoodKernel::NeighborhoodKernel(const std::vector<float> & rowValues,
+	const std::vector<float> & columnValues) :
+	w(static_cast<int>(rowValues.size())),
+	h(static_cast<int>(columnValues.size())),
+	anchorX(static_cast<int>(rowValues.size()) / 2),
+	anchorY(static_cast<int>(columnValues.size()) / 2),
+	rowValues(rowValues),
+	columnValues(columnValues)
+{
+	this->values.resize(rowValues.size() * columnValues.size());
+	for (int y = 0; y < this->h; y++)
+	{
+		for (int x = 0; x < this->w; x++)
+		{
+			this->values[size_t(y) * size_t(this->w) + x] = columnValues[y] * rowValues[x];
+		}
+	}
+}
+
+//=================================================================================================
+// Methods
+//=================================================================================================
+
+/// <summary>
+/// Kernel is valid if it is not empty and anchor is inside
+/// </summary>
+/// <returns></returns>
+bool NeighborhoodKernel::IsValid() const noexcept
+{
+	return (this->w > 0) && (this->h > 0) &&
+		(this->anchorX >= 0) && (this->anchorX < this->w) &&
+		(this->anchorY >= 0) && (this->anchorY < this->h) &&
+		(this->values.size() == size_t(this->w) * size_t(this->h));
+}
+
+bool NeighborhoodKernel::IsSeparable() const noexcept
+{
+	return (this->rowValues.empty() == false) && (this->columnValues.empty() == false);
+}
+
+float NeighborhoodKernel::GetValue(int x, int y) const noexcept
+{
+	return this->values[size_t(y) * size_t(this->w) + x];
+}
+
+/// <summary>
+/// Check if kernel has rank 1 and if so, fill rowValues and columnValues
+/// Row and column through the largest value are used as factors
+/// and all values are checked against their product
+/// </summary>
+void NeighborhoodKernel::DetectSeparable()
+{
+	this->rowValues.clear();
+	this->columnValues.clear();
+
+	if (this->values.empty())
+	{
+		return;
+	}
+
+	size_t pivot = 0;
+	for (size_t i = 1; i < this->values.size(); i++)
+	{
+		if (std::fabs(this->values[i]) > std::fabs(this->values[pivot]))
+		{
+			pivot = i;
+		}
+	}
+
+	const float pivotValue = this->values[pivot];
+	if (pivotValue == 0.0f)
+	{
+		//all zeros
+		this->rowValues.assign(this->w, 0.0f);
+		this->columnValues.assign(this->h, 0.0f);
+		return;
+	}
+
+	const int px = static_cast<int>(pivot % size_t(this->w));
+	const int py = static_cast<int>(pivot / size_t(this->w));
+
+	std::vector<float> row(this->w);
+	std::vector<float> column(this->h);
+	for (int x = 0; x < this->w; x++)
+	{
+		row[x] = this->GetValue(x, py) / pivotValue;
+	}
+	for (int y = 0; y < this->h; y++)
+	{
+		column[y] = this->GetValue(px, y);
+	}
+
+	const float eps = 1e-5f * std::fabs(pivotValue);
+	for (int y = 0; y < this->h; y++)
+	{
+		for (int x = 0; x < this->w; x++)
+		{
+			if (std::fabs(this->GetValue(x, y) - column[y] * row[x]) > eps)
+			{
+				return;
+			}
+		}
+	}
+
+	this->rowValues = std::move(row);
+	this->columnValues = std::move(column);
+}
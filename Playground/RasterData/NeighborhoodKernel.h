@@ -0,0 +1,44 @@
+#ifndef NEIGHBORHOOD_KERNEL_H
+#define NEIGHBORHOOD_KERNEL_H
+
+#include <vector>
+
+/// <summary>
+/// Weights of pixel neighborhood used for convolution
+/// Values are stored row by row (w x h)
+/// Anchor is the position of the processed pixel inside the kernel
+/// (center by default)
+///
+/// If kernel is separable (values[y][x] = columnValues[y] * rowValues[x]),
+/// rowValues and columnValues are filled. Separability is detected
+/// automatically when kernel is created.
+/// </summary>
+struct NeighborhoodKernel
+{
+	int w;
+	int h;
+	int anchorX;
+	int anchorY;
+	std::vector<float> values;
+
+	std::vector<float> rowValues;
+	std::vector<float> columnValues;
+
+	static NeighborhoodKernel CreateBox(int w, int h);
+	static NeighborhoodKernel CreateGaussian(float sigma, int radius = 0);
+	static NeighborhoodKernel CreateSobelX();
+	static NeighborhoodKernel CreateSobelY();
+
+	NeighborhoodKernel(int w, int h, const std::vector<float> & values);
+	NeighborhoodKernel(int w, int h, const std::vector<float> & values, int anchorX, int anchorY);
+	NeighborhoodKernel(const std::vector<float> & rowValues, const std::vector<float> & columnValues);
+
+	bool IsValid() const noexcept;
+	bool IsSeparable() const noexcept;
+	float GetValue(int x, int y) const noexcept;
+
+protected:
+	void DetectSeparable();
+};
+
+#endif
@@ -0,0 +1,322 @@
+#include "./ShapeRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Simd/ImageKernels.h"
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+/// <summary>
+/// Fill rectangle [x, x + w) x [y, y + h) clipped to image
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels</param>
+/// <param name="x"></param>
+/// <param name="y"></param>
+/// <param name="w"></param>
+/// <param name="h"></param>
+template <typename T>
+void ShapeRasterizer::FillRect(const Image2dView<T> & img, const T * value,
+	int x, int y, int w, int h)
+{
+	if ((w <= 0) || (h <= 0))
+	{
+		return;
+	}
+
+	const int x0 = std::max(x, 0);
+	const int y0 = std::max(y, 0);
+	const int x1 = int(std::min<int64_t>(int64_t(x) + w, img.GetWidth())) - 1;
+	const int y1 = int(std::min<int64_t>(int64_t(y) + h, img.GetHeight())) - 1;
+
+	if ((x0 > x1) || (y0 > y1))
+	{
+		return;
+	}
+
+	const size_t grainRows = GetParallelGrainRows(size_t(x1 - x0 + 1) * img.GetChannelsCount() * sizeof(T));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(size_t(y0), size_t(y1) + 1, grainRows,
+		[&](size_t r0, size_t r1) {
+		for (size_t r = r0; r < r1; r++)
+		{
+			FillSpan(img, value, int(r), x0, x1);
+		}
+	});
+}
+
+/// <summary>
+/// Fill convex or concave (also self-intersecting) polygon clipped to image
+/// Pixel is filled if its center is inside polygon with given fill rule
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels</param>
+/// <param name="points">polygon vertices, last vertex is connected to the first one</param>
+/// <param name="rule"></param>
+template <typename T>
+void ShapeRasterizer::FillPolygon(const Image2dView<T> & img, const T * value,
+	const std::vector<ImageUtils::Pixel> & points, ImageUtils::FillRule rule)
+{
+	const int w = img.GetWidth();
+	const int h = img.GetHeight();
+
+	if ((points.size() < 3) || (w <= 0) || (h <= 0))
+	{
+		return;
+	}
+
+	//edge table - non-horizontal edges clipped to image rows, sorted by first scanline
+	//scanline y is sampled at y + 0.5, so edge [top, bottom) covers scanlines [top.y, bottom.y - 1]
+	std::vector<Edge> edges;
+	edges.reserve(points.size());
+
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		const ImageUtils::Pixel & p = points[i];
+		const ImageUtils::Pixel & q = points[(i + 1) % points.size()];
+		if (p.y == q.y)
+		{
+			continue;
+		}
+
+		const ImageUtils::Pixel & top = (p.y < q.y) ? p : q;
+		const ImageUtils::Pixel & bottom = (p.y < q.y) ? q : p;
+
+		Edge e;
+		e.yStart = std::max(top.y, 0);
+		e.yEnd = std::min(bottom.y - 1, h - 1);
+		e.x0 = top.x;
+		e.y0 = top.y;
+		e.dx = int64_t(bottom.x) - top.x;
+		e.dy = int64_t(bottom.y) - top.y;
+		e.winding = (p.y < q.y) ? 1 : -1;
+
+		if (e.yStart <= e.yEnd)
+		{
+			edges.push_back(e);
+		}
+	}
+
+	if (edges.empty())
+	{
+		return;
+	}
+
+	std::sort(edges.begin(), edges.end(), [](const Edge & a, const Edge & b) {
+		return a.yStart < b.yStart;
+	});
+
+	//active edge table
+	std::vector<const Edge *> active;
+	std::vector<Crossing> crossings;
+	size_t next = 0;
+
+	int y = edges[0].yStart;
+	while ((next < edges.size()) || (active.empty() == false))
+	{
+		if (active.empty())
+		{
+			y = std::max(y, edges[next].yStart);
+		}
+
+		while ((next < edges.size()) && (edges[next].yStart <= y))
+		{
+			active.push_back(&edges[next]);
+			next++;
+		}
+
+		//intersection with scanline y + 0.5 is xi = x0 + (2 * (y - y0) + 1) * dx / (2 * dy),
+		//first pixel with center right of it is ceil(xi - 0.5) (exact integer arithmetic)
+		crossings.clear();
+		for (const Edge * e : active)
+		{
+			const int64_t num = (2 * e->x0 - 1) * e->dy + (2 * (y - e->y0) + 1) * e->dx;
+			const int64_t x = std::clamp<int64_t>(CeilDiv(num, 2 * e->dy), 0, w);
+			crossings.push_back({ x, e->winding });
+		}
+
+		std::sort(crossings.begin(), crossings.end(), [](const Crossing & a, const Crossing & b) {
+			return a.x < b.x;
+		});
+
+		//pixels [xa, xb) between crossings
+		int winding = 0;
+		for (size_t i = 0; i + 1 < crossings.size(); i++)
+		{
+			bool inside = false;
+			if (rule == ImageUtils::FillRule::EVEN_ODD)
+			{
+				inside = (i % 2 == 0);
+			}
+			else
+			{
+				winding += crossings[i].winding;
+				inside = (winding != 0);
+			}
+
+			if ((inside) && (crossings[i].x < crossings[i + 1].x))
+			{
+				FillSpan(img, value, y, int(crossings[i].x), int(crossings[i + 1].x) - 1);
+			}
+		}
+
+		active.erase(std::remove_if(active.begin(), active.end(), [y](const Edge * e) {
+			return e->yEnd <= y;
+		}), active.end());
+
+		y++;
+	}
+}
+
+/// <summary>
+/// Fill ellipse with axes parallel to image axes clipped to image
+/// Circle is ellipse with rx = ry
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value">value of all channels</param>
+/// <param name="cx">center</param>
+/// <param name="cy">center</param>
+/// <param name="rx">horizontal radius</param>
+/// <param name="ry">vertical radius</param>
+template <typename T>
+void ShapeRasterizer::FillEllipse(const Image2dView<T> & img, const T * value,
+	int cx, int cy, int rx, int ry)
+{
+	if ((rx < 0) || (ry < 0))
+	{
+		MY_LOG_ERROR("Ellipse radius must not be negative (%d, %d)", rx, ry);
+		return;
+	}
+
+	const int w = img.GetWidth();
+	const int y0 = int(std::max<int64_t>(int64_t(cy) - ry, 0));
+	const int y1 = int(std::min<int64_t>(int64_t(cy) + ry, img.GetHeight() - 1));
+
+	if ((y0 > y1) || (w <= 0))
+	{
+		return;
+	}
+
+	const size_t grainRows = GetParallelGrainRows(size_t(std::min(2 * int64_t(rx) + 1, int64_t(w))) *
+		img.GetChannelsCount() * sizeof(T));
+
+	MyUtils::ThreadPool::GetInstance()->ParallelFor(size_t(y0), size_t(y1) + 1, grainRows,
+		[&](size_t r0, size_t r1) {
+		for (size_t r = r0; r < r1; r++)
+		{
+			const int64_t halfWidth = GetEllipseHalfWidth(int64_t(r) - cy, rx, ry);
+			const int64_t xa = std::max<int64_t>(cx - halfWidth, 0);
+			const int64_t xb = std::min<int64_t>(cx + halfWidth, w - 1);
+			if (xa <= xb)
+			{
+				FillSpan(img, value, int(r), int(xa), int(xb));
+			}
+		}
+	});
+}
+
+/// <summary>
+/// Fill pixels [x0, x1] of row y (must be inside image)
+/// </summary>
+/// <param name="img"></param>
+/// <param name="value"></param>
+/// <param name="y"></param>
+/// <param name="x0"></param>
+/// <param name="x1"></param>
+template <typename T>
+void ShapeRasterizer::FillSpan(const Image2dView<T> & img, const T * value, int y, int x0, int x1)
+{
+	const size_t count = size_t(x1 - x0 + 1);
+	const size_t channelsCount = img.GetChannelsCount();
+	T * start = img.GetPixelStart(x0, y);
+
+	if (channelsCount == 1)
+	{
+		ImageKernels::Fill(start, count, value[0]);
+	}
+	else if (img.GetPixelStride() == channelsCount)
+	{
+		//interleaved
+		ImageKernels::FillPixels(reinterpret_cast<uint8_t *>(start), count,
+			reinterpret_cast<const uint8_t *>(value), channelsCount * sizeof(T));
+	}
+	else
+	{
+		//planar - each channel is contiguous
+		for (size_t c = 0; c < channelsCount; c++)
+		{
+			ImageKernels::Fill(start + c * img.GetChannelStride(), count, value[c]);
+		}
+	}
+}
+
+size_t ShapeRasterizer::GetParallelGrainRows(size_t spanBytes)
+{
+	return std::max<size_t>(1, size_t(PARALLEL_MIN_TASK_SIZE) / std::max<size_t>(1, spanBytes));
+}
+
+/// <summary>
+/// Get largest dx with (dx / rx)^2 + (dy / ry)^2 <= 1, -1 if there is none
+/// Estimate from sqrt is corrected with exact integer test
+/// (for radii where squares product fits to int64)
+/// </summary>
+/// <param name="dy"></param>
+/// <param name="rx"></param>
+/// <param name="ry"></param>
+/// <returns></returns>
+int64_t ShapeRasterizer::GetEllipseHalfWidth(int64_t dy, int64_t rx, int64_t ry)
+{
+	if (ry == 0)
+	{
+		return (dy == 0) ? rx : -1;
+	}
+
+	const double t = 1.0 - (double(dy) / ry) * (double(dy) / ry);
+	if (t < 0.0)
+	{
+		return -1;
+	}
+
+	int64_t d = int64_t(std::floor(rx * std::sqrt(t)));
+
+	//d^2 * ry^2 <= rx^2 * (ry^2 - dy^2)
+	if ((rx < 32768) && (ry < 32768))
+	{
+		const int64_t limit = rx * rx * (ry * ry - dy * dy);
+		while ((d > 0) && (d * d * ry * ry > limit))
+		{
+			d--;
+		}
+		while ((d + 1) * (d + 1) * ry * ry <= limit)
+		{
+			d++;
+		}
+	}
+
+	return d;
+}
+
+int64_t ShapeRasterizer::CeilDiv(int64_t a, int64_t b) noexcept
+{
+	int64_t q = a / b;
+	return ((a % b != 0) && ((a < 0) == (b < 0))) ? q + 1 : q;
+}
+
+//=================================================================================================
+
+template void ShapeRasterizer::FillRect(const Image2dView<uint8_t> & img, const uint8_t * value,
+	int x, int y, int w, int h);
+template void ShapeRasterizer::FillRect(const Image2dView<float> & img, const float * value,
+	int x, int y, int w, int h);
+
+template void ShapeRasterizer::FillPolygon(const Image2dView<uint8_t> & img, const uint8_t * value,
+	const std::vector<ImageUtils::Pixel> & points, ImageUtils::FillRule rule);
+template void ShapeRasterizer::FillPolygon(const Image2dView<float> & img, const float * value,
+	const std::vector<ImageUtils::Pixel> & points, ImageUtils::FillRule rule);
+
+template void ShapeRasterizer::FillEllipse(const Image2dView<uint8_t> & img, const uint8_t * value,
+	int cx, int cy, int rx, int ry);
+template void ShapeRasterizer::FillEllipse(const Image2dView<float> & img, const float * value,
+	int cx, int cy, int rx, int ry);
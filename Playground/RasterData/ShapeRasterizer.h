@@ -0,0 +1,75 @@
+#ifndef SHAPE_RASTERIZER_H
+#define SHAPE_RASTERIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./Image2dView.h"
+#include "./ImageUtils.h"
+
+/// <summary>
+/// Scanline rasterizer of filled shapes (no anti-aliasing)
+///
+/// Shapes are converted to horizontal spans clipped to the image,
+/// spans are written with SIMD pixel fills (ImageKernels::FillPixels)
+/// for any channels count, planar images are filled plane by plane.
+///
+/// Rectangle covers pixels [x, x + w) x [y, y + h).
+/// Polygon is sampled at pixel centers [x + 0.5, y + 0.5] with active edge table,
+/// so polygons sharing an edge do not overlap and do not leave gaps
+/// (edge intersections are exact in integer arithmetic, vertices must be in range (-2^30, 2^30)).
+/// Ellipse is centered at pixel [cx, cy] and covers pixels
+/// with (dx / rx)^2 + (dy / ry)^2 <= 1 (exact integer test).
+/// </summary>
+class ShapeRasterizer
+{
+public:
+	template <typename T>
+	static void FillRect(const Image2dView<T> & img, const T * value,
+		int x, int y, int w, int h);
+
+	template <typename T>
+	static void FillPolygon(const Image2dView<T> & img, const T * value,
+		const std::vector<ImageUtils::Pixel> & points, ImageUtils::FillRule rule);
+
+	template <typename T>
+	static void FillEllipse(const Image2dView<T> & img, const T * value,
+		int cx, int cy, int rx, int ry);
+
+private:
+	static const size_t PARALLEL_MIN_TASK_SIZE = 64 * 1024;
+
+	/// <summary>
+	/// Polygon edge oriented from top to bottom
+	/// </summary>
+	struct Edge
+	{
+		int yStart;		//first scanline
+		int yEnd;		//last scanline
+		int64_t x0;		//top vertex
+		int64_t y0;
+		int64_t dx;
+		int64_t dy;		//> 0
+		int winding;	//+1 for edge going down, -1 for edge going up
+	};
+
+	/// <summary>
+	/// Intersection of edge with scanline
+	/// x is the first pixel with center right of intersection
+	/// </summary>
+	struct Crossing
+	{
+		int64_t x;
+		int winding;
+	};
+
+	template <typename T>
+	static void FillSpan(const Image2dView<T> & img, const T * value, int y, int x0, int x1);
+
+	static size_t GetParallelGrainRows(size_t spanBytes);
+	static int64_t GetEllipseHalfWidth(int64_t dy, int64_t rx, int64_t ry);
+	static int64_t CeilDiv(int64_t a, int64_t b) noexcept;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "./CpuFeatures.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#	include <intrin.h>
+#	define HAVE_CPUID 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#	include <cpuid.h>
+#	define HAVE_CPUID 1
+#endif
+
+#ifdef HAVE_CPUID
+
+/// <summary>
+/// Run CPUID instruction
+/// regs = { eax, ebx, ecx, edx }
+/// </summary>
+/// <param name="leaf"></param>
+/// <param name="subleaf"></param>
+/// <param name="regs"></param>
+static void RunCpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	int tmp[4];
+	__cpuidex(tmp, static_cast<int>(leaf), static_cast<int>(subleaf));
+	for (int i = 0; i < 4; i++)
+	{
+		regs[i] = static_cast<unsigned int>(tmp[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/// <summary>
+/// Read XCR0 register - which register states are enabled by OS
+/// Must be called only if OSXSAVE is set
+/// </summary>
+/// <returns></returns>
+static uint64_t ReadXcr0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	//inline asm, so the file does not need to be compiled with -mxsave
+	uint32_t eax = 0;
+	uint32_t edx = 0;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+#endif
+
+//=================================================================================================
+
+/// <summary>
+/// Get best instruction set level supported by CPU and OS
+/// Detection runs only once
+/// </summary>
+/// <returns></returns>
+CpuFeatures::IsaLevel CpuFeatures::GetSupportedIsaLevel()
+{
+	static const IsaLevel level = CpuFeatures::DetectIsaLevel();
+	return level;
+}
+
+CpuFeatures::IsaLevel CpuFeatures::DetectIsaLevel()
+{
+#ifdef HAVE_CPUID
+	const uint64_t XCR0_SSE_AVX = 0x06;	//XMM + YMM state
+	const uint64_t XCR0_AVX512 = 0xE0;	//opmask + ZMM state
+
+	unsigned int regs[4] = { 0, 0, 0, 0 };
+
+	RunCpuid(0, 0, regs);
+	const unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 1)
+	{
+		return IsaLevel::SCALAR;
+	}
+
+	RunCpuid(1, 0, regs);
+	const bool sse41 = (regs[2] & (1u << 19)) != 0;
+	const bool osxsave = (regs[2] & (1u << 27)) != 0;
+	const bool avx = (regs[2] & (1u << 28)) != 0;
+
+	if (sse41 == false)
+	{
+		return IsaLevel::SCALAR;
+	}
+
+	if ((osxsave == false) || (avx == false) || (maxLeaf < 7))
+	{
+		return IsaLevel::SSE41;
+	}
+
+	const uint64_t xcr0 = ReadXcr0();
+	if ((xcr0 & XCR0_SSE_AVX) != XCR0_SSE_AVX)
+	{
+		return IsaLevel::SSE41;
+	}
+
+	RunCpuid(7, 0, regs);
+	const bool avx2 = (regs[1] & (1u << 5)) != 0;
+	const bool avx512f = (regs[1] & (1u << 16)) != 0;
+	const bool avx512bw = (regs[1] & (1u << 30)) != 0;
+	const bool avx512vl = (regs[1] & (1u << 31)) != 0;
+
+	if (avx2 == false)
+	{
+		return IsaLevel::SSE41;
+	}
+
+	if ((avx512f) && (avx512bw) && (avx512vl) && ((xcr0 & XCR0_AVX512) == XCR0_AVX512))
+	{
+		return IsaLevel::AVX512;
+	}
+
+	return IsaLevel::AVX2;
+#else
+	return IsaLevel::SCALAR;
+#endif
+}
+
+/// <summary>
+/// Get printable name of instruction set level
+/// </summary>
+/// <param name="level"></param>
+/// <returns></returns>
+const char * CpuFeatures::GetIsaLevelName(IsaLevel level)
+{
+	switch (level)
+	{
+	case IsaLevel::SCALAR: return "scalar";
+	case IsaLevel::SSE41: return "sse41";
+	case IsaLevel::AVX2: return "avx2";
+	case IsaLevel::AVX512: return "avx512";
+	default: return "unknown";
+	}
+}
+
+/// <summary>
+/// Parse instruction set level from its name
+/// (names are same as returned by GetIsaLevelName)
+/// Returns false if name is not known
+/// </summary>
+/// <param name="name"></param>
+/// <param name="level"></param>
+/// <returns></returns>
+bool CpuFeatures::ParseIsaLevel(const char * name, IsaLevel & level)
+{
+	if (name == nullptr)
+	{
+		return false;
+	}
+
+	const IsaLevel levels[4] = { IsaLevel::SCALAR, IsaLevel::SSE41, IsaLevel::AVX2, IsaLevel::AVX512 };
+	for (IsaLevel l : levels)
+	{
+		if (strcmp(name, CpuFeatures::GetIsaLevelName(l)) == 0)
+		{
+			level = l;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,30 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+/// <summary>
+/// Runtime detection of CPU instruction sets
+/// CPUID is queried only once, result is cached
+/// </summary>
+class CpuFeatures
+{
+public:
+
+	//values must match ISA_LEVEL_* in SimdUtils.h
+	enum class IsaLevel
+	{
+		SCALAR = 0,
+		SSE41 = 1,
+		AVX2 = 2,
+		AVX512 = 3	//AVX-512 F + BW + VL
+	};
+
+	static IsaLevel GetSupportedIsaLevel();
+
+	static const char * GetIsaLevelName(IsaLevel level);
+	static bool ParseIsaLevel(const char * name, IsaLevel & level);
+
+private:
+	static IsaLevel DetectIsaLevel();
+};
+
+#endif
@@ -0,0 +1,620 @@
+#include "./ImageKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "./ImageKernelsTable.h"
+
+#include "../Utils/Logger.h"
+
+//=================================================================================================
+// Dispatch
+//=================================================================================================
+
+static std::atomic<const ImageKernelsTable *> activeTable(nullptr);
+static std::atomic<int> activeLevel(static_cast<int>(CpuFeatures::IsaLevel::SCALAR));
+
+/// <summary>
+/// Force kernels of given instruction set level
+/// If level is not supported by CPU (or not compiled),
+/// best available lower level is used
+/// Returns level that is really used
+///
+/// Should not be called while kernels are running in other threads
+/// </summary>
+/// <param name="level"></param>
+/// <returns></returns>
+CpuFeatures::IsaLevel ImageKernels::ForceIsaLevel(CpuFeatures::IsaLevel level)
+{
+	CpuFeatures::IsaLevel used = level;
+	const ImageKernelsTable * table = ImageKernels::SelectTable(used);
+
+	if (used != level)
+	{
+		MY_LOG_WARNING("ISA level %s is not available, using %s",
+			CpuFeatures::GetIsaLevelName(level), CpuFeatures::GetIsaLevelName(used));
+	}
+
+	activeLevel.store(static_cast<int>(used));
+	activeTable.store(table, std::memory_order_release);
+
+	return used;
+}
+
+/// <summary>
+/// Reset instruction set level to default
+/// (best supported or from PLAYGROUND_ISA environment variable)
+/// </summary>
+void ImageKernels::ResetIsaLevel()
+{
+	activeTable.store(nullptr, std::memory_order_release);
+}
+
+/// <summary>
+/// Get instruction set level of currently used kernels
+/// </summary>
+/// <returns></returns>
+CpuFeatures::IsaLevel ImageKernels::GetIsaLevel()
+{
+	ImageKernels::GetActiveTable();
+	return static_cast<CpuFeatures::IsaLevel>(activeLevel.load());
+}
+
+const ImageKernelsTable * ImageKernels::GetActiveTable()
+{
+	const ImageKernelsTable * table = activeTable.load(std::memory_order_acquire);
+	if (table == nullptr)
+	{
+		table = ImageKernels::CreateDefaultTable();
+	}
+	return table;
+}
+
+/// <summary>
+/// Select default kernels
+/// - best supported level, can be lowered with PLAYGROUND_ISA environment variable
+///
+/// Default is resolved only once (environment is parsed and reported on the first call),
+/// later calls (e.g. after ResetIsaLevel) only activate it again
+/// </summary>
+/// <returns></returns>
+const ImageKernelsTable * ImageKernels::CreateDefaultTable()
+{
+	static const std::pair<const ImageKernelsTable *, CpuFeatures::IsaLevel> defaultTable = []() {
+		CpuFeatures::IsaLevel level = CpuFeatures::GetSupportedIsaLevel();
+
+		const char * env = std::getenv("PLAYGROUND_ISA");
+		if ((env != nullptr) && (env[0] != 0))
+		{
+			if (CpuFeatures::ParseIsaLevel(env, level) == false)
+			{
+				MY_LOG_ERROR("Unknown PLAYGROUND_ISA value %s", env);
+				level = CpuFeatures::GetSupportedIsaLevel();
+			}
+		}
+
+		CpuFeatures::IsaLevel used = level;
+		const ImageKernelsTable * table = ImageKernels::SelectTable(used);
+
+		if (used != level)
+		{
+			MY_LOG_WARNING("ISA level %s is not available, using %s",
+				CpuFeatures::GetIsaLevelName(level), CpuFeatures::GetIsaLevelName(used));
+		}
+
+		return std::make_pair(table, used);
+	}();
+
+	activeLevel.store(static_cast<int>(defaultTable.second));
+	activeTable.store(defaultTable.first, std::memory_order_release);
+
+	return defaultTable.first;
+}
+
+/// <summary>
+/// Get kernel table for level
+/// Level is lowered if it is not supported by CPU or SIMD is disabled
+/// </summary>
+/// <param name="level"></param>
+/// <returns></returns>
+const ImageKernelsTable * ImageKernels::SelectTable(CpuFeatures::IsaLevel & level)
+{
+	const CpuFeatures::IsaLevel supported = CpuFeatures::GetSupportedIsaLevel();
+	if (static_cast<int>(level) > static_cast<int>(supported))
+	{
+		level = supported;
+	}
+
+#ifdef ENABLE_SIMD
+	switch (level)
+	{
+	case CpuFeatures::IsaLevel::AVX512: return ImageKernelsAVX512::GetTable();
+	case CpuFeatures::IsaLevel::AVX2: return ImageKernelsAVX2::GetTable();
+	case CpuFeatures::IsaLevel::SSE41: return ImageKernelsSSE41::GetTable();
+	default: break;
+	}
+#endif
+
+	level = CpuFeatures::IsaLevel::SCALAR;
+	return ImageKernelsScalar::GetTable();
+}
+
+//=================================================================================================
+// Kernels
+//=================================================================================================
+
+void ImageKernels::FindMinMax(const float * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex, float & min, float & max)
+{
+	ImageKernels::GetActiveTable()->findMinMaxF32(data, pixelsCount, channelsCount, channelIndex, min, max);
+}
+
+void ImageKernels::FindMinMax(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex, uint8_t & min, uint8_t & max)
+{
+	ImageKernels::GetActiveTable()->findMinMaxU8(data, pixelsCount, channelsCount, channelIndex, min, max);
+}
+
+double ImageKernels::Sum(const float * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex)
+{
+	return ImageKernels::GetActiveTable()->sumF32(data, pixelsCount, channelsCount, channelIndex);
+}
+
+uint64_t ImageKernels::Sum(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex)
+{
+	return ImageKernels::GetActiveTable()->sumU8(data, pixelsCount, channelsCount, channelIndex);
+}
+
+void ImageKernels::Abs(float * data, size_t count)
+{
+	ImageKernels::GetActiveTable()->absF32(data, count);
+}
+
+void ImageKernels::Fill(float * data, size_t count, float value)
+{
+	ImageKernels::GetActiveTable()->fillF32(data, count, value);
+}
+
+void ImageKernels::Fill(uint8_t * data, size_t count, uint8_t value)
+{
+	ImageKernels::GetActiveTable()->fillU8(data, count, value);
+}
+
+void ImageKernels::FillPixels(uint8_t * data, size_t pixelsCount, const uint8_t * pixel, size_t pixelBytes)
+{
+	ImageKernels::GetActiveTable()->fillPixels(data, pixelsCount, pixel, pixelBytes);
+}
+
+void ImageKernels::Convert(const uint8_t * input, float * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->convertU8ToF32(input, output, count);
+}
+
+void ImageKernels::Convert(const float * input, uint8_t * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->convertF32ToU8(input, output, count);
+}
+
+/// <summary>
+/// Convert float to uint8_t with rounding
+/// Values outside of [0, 255] are saturated
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+void ImageKernels::ConvertSaturated(const float * input, uint8_t * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->convertF32ToU8Saturated(input, output, count);
+}
+
+/// <summary>
+/// Weighted sum of shifted input
+/// output[i] = sum_k input[i + k * step] * weights[k]
+/// (if accumulate is true, sum is added to output)
+/// Input must have count + (weightsCount - 1) * step values
+/// </summary>
+/// <param name="input"></param>
+/// <param name="count"></param>
+/// <param name="step"></param>
+/// <param name="weights"></param>
+/// <param name="weightsCount"></param>
+/// <param name="output"></param>
+/// <param name="accumulate"></param>
+void ImageKernels::ConvolveRow(const float * input, size_t count, size_t step,
+	const float * weights, size_t weightsCount, float * output, bool accumulate)
+{
+	ImageKernels::GetActiveTable()->convolveRowF32(input, count, step, weights, weightsCount, output, accumulate);
+}
+
+/// <summary>
+/// Resample interleaved row
+/// Output pixel x is weighted sum of input pixels [starts[x], starts[x] + taps)
+/// with weights [x * taps, (x + 1) * taps)
+/// All used input pixels must be inside input
+/// </summary>
+/// <param name="input"></param>
+/// <param name="inputPixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="starts"></param>
+/// <param name="weights"></param>
+/// <param name="taps"></param>
+/// <param name="outputPixelsCount"></param>
+/// <param name="output"></param>
+void ImageKernels::ResampleRow(const float * input, size_t inputPixelsCount, size_t channelsCount,
+	const int32_t * starts, const float * weights, size_t taps,
+	size_t outputPixelsCount, float * output)
+{
+	ImageKernels::GetActiveTable()->resampleRowF32(input, inputPixelsCount, channelsCount,
+		starts, weights, taps, outputPixelsCount, output);
+}
+
+/// <summary>
+/// Map values with 256-entry table
+/// output[i] = table[input[i]]
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output">can be the same as input</param>
+/// <param name="count"></param>
+/// <param name="table"></param>
+void ImageKernels::ApplyLut(const uint8_t * input, uint8_t * output, size_t count, const uint8_t * table)
+{
+	ImageKernels::GetActiveTable()->applyLutU8(input, output, count, table);
+}
+
+/// <summary>
+/// Map interleaved values with 256-entry table of each channel
+/// output[i * c + ch] = tables[ch * 256 + input[i * c + ch]]
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output">can be the same as input</param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="tables">channelsCount tables of 256 values</param>
+void ImageKernels::ApplyLut(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+	size_t channelsCount, const uint8_t * tables)
+{
+	ImageKernels::GetActiveTable()->applyLutChannelsU8(input, output, pixelsCount, channelsCount, tables);
+}
+
+/// <summary>
+/// Running sum of interleaved row, each channel separately
+/// sums[i] = sums[i - channelsCount] + input[i]
+/// If squares is not nullptr, running sum of squared values is computed as well
+/// </summary>
+/// <param name="input"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="sums"></param>
+/// <param name="squares"></param>
+void ImageKernels::PrefixSum(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+	uint64_t * sums, uint64_t * squares)
+{
+	ImageKernels::GetActiveTable()->prefixSumU8(input, pixelsCount, channelsCount, sums, squares);
+}
+
+void ImageKernels::PrefixSum(const float * input, size_t pixelsCount, size_t channelsCount,
+	double * sums, double * squares)
+{
+	ImageKernels::GetActiveTable()->prefixSumF32(input, pixelsCount, channelsCount, sums, squares);
+}
+
+/// <summary>
+/// Add input to output (output[i] += input[i])
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+void ImageKernels::Accumulate(const uint64_t * input, uint64_t * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->accumulateU64(input, output, count);
+}
+
+void ImageKernels::Accumulate(const double * input, double * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->accumulateF64(input, output, count);
+}
+
+/// <summary>
+/// Element-wise minimum (output[i] = min(a[i], b[i]))
+/// Output can be the same as one of inputs
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+void ImageKernels::Min(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->minU8(a, b, output, count);
+}
+
+void ImageKernels::Min(const float * a, const float * b, float * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->minF32(a, b, output, count);
+}
+
+/// <summary>
+/// Element-wise maximum (output[i] = max(a[i], b[i]))
+/// Output can be the same as one of inputs
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+void ImageKernels::Max(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->maxU8(a, b, output, count);
+}
+
+void ImageKernels::Max(const float * a, const float * b, float * output, size_t count)
+{
+	ImageKernels::GetActiveTable()->maxF32(a, b, output, count);
+}
+
+/// <summary>
+/// Rearrange bytes of each pixel
+/// Output can be same as input if output pixel is not larger than input pixel
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="shuffle"></param>
+void ImageKernels::ShufflePixels(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+	const PixelShuffle & shuffle)
+{
+	ImageKernels::GetActiveTable()->shufflePixels(input, output, pixelsCount, shuffle);
+}
+
+void ImageKernels::SwapChannels(float * data, size_t pixelsCount, size_t channelsCount,
+	size_t c0, size_t c1)
+{
+	ImageKernels::SwapChannelsImpl(data, pixelsCount, channelsCount, c0, c1);
+}
+
+void ImageKernels::SwapChannels(uint8_t * data, size_t pixelsCount, size_t channelsCount,
+	size_t c0, size_t c1)
+{
+	ImageKernels::SwapChannelsImpl(data, pixelsCount, channelsCount, c0, c1);
+}
+
+/// <summary>
+/// Swap two channels of interleaved data in-place
+/// Pixels up to 16 bytes are processed as byte shuffle
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="c0"></param>
+/// <param name="c1"></param>
+template <typename T>
+void ImageKernels::SwapChannelsImpl(T * data, size_t pixelsCount, size_t channelsCount,
+	size_t c0, size_t c1)
+{
+	if (c0 == c1)
+	{
+		return;
+	}
+
+	const size_t pixelBytes = channelsCount * sizeof(T);
+
+	if (pixelBytes <= PixelShuffle::MAX_PIXEL_BYTES)
+	{
+		PixelShuffle shuffle;
+		shuffle.inputPixelBytes = pixelBytes;
+		shuffle.outputPixelBytes = pixelBytes;
+		for (size_t b = 0; b < PixelShuffle::MAX_PIXEL_BYTES; b++)
+		{
+			shuffle.source[b] = PixelShuffle::KEEP;
+		}
+
+		for (size_t b = 0; b < sizeof(T); b++)
+		{
+			shuffle.source[c0 * sizeof(T) + b] = static_cast<int8_t>(c1 * sizeof(T) + b);
+			shuffle.source[c1 * sizeof(T) + b] = static_cast<int8_t>(c0 * sizeof(T) + b);
+		}
+
+		uint8_t * bytes = reinterpret_cast<uint8_t *>(data);
+		ImageKernels::GetActiveTable()->shufflePixels(bytes, bytes, pixelsCount, shuffle);
+		return;
+	}
+
+	for (size_t i = 0; i < pixelsCount * channelsCount; i += channelsCount)
+	{
+		std::swap(data[i + c0], data[i + c1]);
+	}
+}
+
+void ImageKernels::ShuffleChannels(const float * input, size_t inputChannelsCount, float * output,
+	size_t outputChannelsCount, size_t pixelsCount, const int * sources, float constant)
+{
+	ImageKernels::ShuffleChannelsImpl(input, inputChannelsCount, output, outputChannelsCount,
+		pixelsCount, sources, constant);
+}
+
+void ImageKernels::ShuffleChannels(const uint8_t * input, size_t inputChannelsCount, uint8_t * output,
+	size_t outputChannelsCount, size_t pixelsCount, const int * sources, uint8_t constant)
+{
+	ImageKernels::ShuffleChannelsImpl(input, inputChannelsCount, output, outputChannelsCount,
+		pixelsCount, sources, constant);
+}
+
+/// <summary>
+/// Create interleaved pixels from channels of interleaved input
+/// output channel c = input channel sources[c], or constant if sources[c] < 0
+/// (e.g. RGB -> BGRA: sources { 2, 1, 0, -1 }, constant 255)
+///
+/// Pixels up to 16 bytes are processed as byte shuffle.
+/// Output can be same as input if output pixel is not larger than input pixel
+/// </summary>
+/// <param name="input"></param>
+/// <param name="inputChannelsCount"></param>
+/// <param name="output"></param>
+/// <param name="outputChannelsCount"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="sources">input channel for each output channel</param>
+/// <param name="constant"></param>
+template <typename T>
+void ImageKernels::ShuffleChannelsImpl(const T * input, size_t inputChannelsCount, T * output,
+	size_t outputChannelsCount, size_t pixelsCount, const int * sources, T constant)
+{
+	const size_t inBytes = inputChannelsCount * sizeof(T);
+	const size_t outBytes = outputChannelsCount * sizeof(T);
+
+	if ((inBytes <= PixelShuffle::MAX_PIXEL_BYTES) && (outBytes <= PixelShuffle::MAX_PIXEL_BYTES))
+	{
+		PixelShuffle shuffle;
+		shuffle.inputPixelBytes = inBytes;
+		shuffle.outputPixelBytes = outBytes;
+
+		uint8_t constantBytes[sizeof(T)];
+		memcpy(constantBytes, &constant, sizeof(T));
+
+		for (size_t c = 0; c < outputChannelsCount; c++)
+		{
+			for (size_t b = 0; b < sizeof(T); b++)
+			{
+				const size_t outByte = c * sizeof(T) + b;
+				shuffle.constant[outByte] = constantBytes[b];
+				shuffle.source[outByte] = (sources[c] < 0) ? PixelShuffle::CONSTANT :
+					static_cast<int8_t>(size_t(sources[c]) * sizeof(T) + b);
+			}
+		}
+
+		ImageKernels::GetActiveTable()->shufflePixels(reinterpret_cast<const uint8_t *>(input),
+			reinterpret_cast<uint8_t *>(output), pixelsCount, shuffle);
+		return;
+	}
+
+	//input pixel is copied first, so output can be the same as input
+	std::vector<T> px(inputChannelsCount);
+	for (size_t i = 0; i < pixelsCount; i++)
+	{
+		std::copy(input + i * inputChannelsCount, input + (i + 1) * inputChannelsCount, px.begin());
+
+		T * out = output + i * outputChannelsCount;
+		for (size_t c = 0; c < outputChannelsCount; c++)
+		{
+			out[c] = (sources[c] < 0) ? constant : px[size_t(sources[c])];
+		}
+	}
+}
+
+/// <summary>
+/// Unpack bit-packed indices (MSB first, as in PNG) to one byte per index
+/// </summary>
+/// <param name="packed"></param>
+/// <param name="count">number of indices</param>
+/// <param name="bitDepth">1, 2, 4 or 8</param>
+/// <param name="indices"></param>
+void ImageKernels::UnpackIndices(const uint8_t * packed, size_t count, unsigned int bitDepth,
+	uint8_t * indices)
+{
+	ImageKernels::GetActiveTable()->unpackIndices(packed, count, bitDepth, indices);
+}
+
+/// <summary>
+/// Write palette colors for indices to output
+/// Palette has paletteSize entries with channelsCount bytes each (1 - 4)
+/// and all indices must be smaller than paletteSize
+/// </summary>
+/// <param name="indices"></param>
+/// <param name="count"></param>
+/// <param name="palette"></param>
+/// <param name="paletteSize"></param>
+/// <param name="channelsCount"></param>
+/// <param name="output"></param>
+void ImageKernels::ExpandPalette(const uint8_t * indices, size_t count, const uint8_t * palette,
+	size_t paletteSize, size_t channelsCount, uint8_t * output)
+{
+	ImageKernels::GetActiveTable()->expandPalette(indices, count, palette, paletteSize, channelsCount, output);
+}
+
+/// <summary>
+/// Convert interleaved data to planar
+/// (output has channelsCount planes with pixelsCount values each)
+/// Input and output must not overlap
+/// </summary>
+/// <param name="input"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="output"></param>
+void ImageKernels::Deinterleave(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+	uint8_t * output)
+{
+	ImageKernels::GetActiveTable()->deinterleaveU8(input, pixelsCount, channelsCount, output);
+}
+
+void ImageKernels::Deinterleave(const float * input, size_t pixelsCount, size_t channelsCount,
+	float * output)
+{
+	ImageKernels::GetActiveTable()->deinterleaveF32(input, pixelsCount, channelsCount, output);
+}
+
+/// <summary>
+/// Convert planar data to interleaved
+/// (input has channelsCount planes with pixelsCount values each)
+/// Input and output must not overlap
+/// </summary>
+/// <param name="input"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="output"></param>
+void ImageKernels::Interleave(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+	uint8_t * output)
+{
+	ImageKernels::GetActiveTable()->interleaveU8(input, pixelsCount, channelsCount, output);
+}
+
+void ImageKernels::Interleave(const float * input, size_t pixelsCount, size_t channelsCount,
+	float * output)
+{
+	ImageKernels::GetActiveTable()->interleaveF32(input, pixelsCount, channelsCount, output);
+}
+
+void ImageKernels::PremultiplyAlpha(uint8_t * data, size_t pixelsCount)
+{
+	ImageKernels::GetActiveTable()->premultiplyAlphaU8(data, pixelsCount);
+}
+
+void ImageKernels::PremultiplyAlpha(float * data, size_t pixelsCount)
+{
+	ImageKernels::GetActiveTable()->premultiplyAlphaF32(data, pixelsCount);
+}
+
+void ImageKernels::UnpremultiplyAlpha(uint8_t * data, size_t pixelsCount)
+{
+	ImageKernels::GetActiveTable()->unpremultiplyAlphaU8(data, pixelsCount);
+}
+
+void ImageKernels::UnpremultiplyAlpha(float * data, size_t pixelsCount)
+{
+	ImageKernels::GetActiveTable()->unpremultiplyAlphaF32(data, pixelsCount);
+}
+
+void ImageKernels::BlendOver(const uint8_t * src, uint8_t * dst, size_t pixelsCount, size_t dstChannelsCount)
+{
+	ImageKernels::GetActiveTable()->blendOverU8(src, dst, pixelsCount, dstChannelsCount);
+}
+
+void ImageKernels::BlendOver(const float * src, float * dst, size_t pixelsCount, size_t dstChannelsCount)
+{
+	ImageKernels::GetActiveTable()->blendOverF32(src, dst, pixelsCount, dstChannelsCount);
+}
+
+void ImageKernels::TransposePixels(const uint8_t * input, ptrdiff_t inputStride, uint8_t * output,
+	ptrdiff_t outputStride, size_t width, size_t height, size_t pixelBytes)
+{
+	ImageKernels::GetActiveTable()->transposePixels(input, inputStride, output, outputStride,
+		width, height, pixelBytes);
+}
+
+void ImageKernels::ReversePixels(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+	size_t pixelBytes)
+{
+	ImageKernels::GetActiveTable()->reversePixels(input, output, pixelsCount, pixelBytes);
+}
@@ -0,0 +1,142 @@
+#ifndef IMAGE_KERNELS_H
+#define IMAGE_KERNELS_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "./CpuFeatures.h"
+
+struct ImageKernelsTable;
+
+/// <summary>
+/// Low-level kernels for hot Image2d / ImageLoader loops
+/// Kernels work directly on raw interleaved data
+///
+/// Each kernel is compiled for several instruction sets
+/// (scalar, SSE4.1, AVX2, AVX-512 - SIMD versions only if ENABLE_SIMD is defined)
+/// CPU is checked once at the first call and the best supported version is used.
+/// Level can be forced with ForceIsaLevel or with PLAYGROUND_ISA environment variable
+/// (scalar, sse41, avx2, avx512)
+/// </summary>
+class ImageKernels
+{
+public:
+
+	/// <summary>
+	/// Description of per-pixel byte shuffle
+	/// output[b] = input[source[b]] for each byte b of output pixel
+	/// Bytes with source KEEP are not modified,
+	/// bytes with source CONSTANT are set to constant[b]
+	/// </summary>
+	struct PixelShuffle
+	{
+		static const int8_t KEEP = -1;
+		static const int8_t CONSTANT = -2;
+		static const size_t MAX_PIXEL_BYTES = 16;
+
+		size_t inputPixelBytes;
+		size_t outputPixelBytes;
+		int8_t source[MAX_PIXEL_BYTES];
+		uint8_t constant[MAX_PIXEL_BYTES];
+	};
+
+	static CpuFeatures::IsaLevel ForceIsaLevel(CpuFeatures::IsaLevel level);
+	static void ResetIsaLevel();
+	static CpuFeatures::IsaLevel GetIsaLevel();
+
+	static void FindMinMax(const float * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex, float & min, float & max);
+	static void FindMinMax(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex, uint8_t & min, uint8_t & max);
+
+	static double Sum(const float * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex);
+	static uint64_t Sum(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex);
+
+	static void Abs(float * data, size_t count);
+
+	static void Fill(float * data, size_t count, float value);
+	static void Fill(uint8_t * data, size_t count, uint8_t value);
+	static void FillPixels(uint8_t * data, size_t pixelsCount, const uint8_t * pixel, size_t pixelBytes);
+
+	static void Convert(const uint8_t * input, float * output, size_t count);
+	static void Convert(const float * input, uint8_t * output, size_t count);
+	static void ConvertSaturated(const float * input, uint8_t * output, size_t count);
+
+	static void ConvolveRow(const float * input, size_t count, size_t step,
+		const float * weights, size_t weightsCount, float * output, bool accumulate);
+	static void ResampleRow(const float * input, size_t inputPixelsCount, size_t channelsCount,
+		const int32_t * starts, const float * weights, size_t taps,
+		size_t outputPixelsCount, float * output);
+
+	static void ApplyLut(const uint8_t * input, uint8_t * output, size_t count, const uint8_t * table);
+	static void ApplyLut(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+		size_t channelsCount, const uint8_t * tables);
+
+	static void PrefixSum(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+		uint64_t * sums, uint64_t * squares);
+	static void PrefixSum(const float * input, size_t pixelsCount, size_t channelsCount,
+		double * sums, double * squares);
+	static void Accumulate(const uint64_t * input, uint64_t * output, size_t count);
+	static void Accumulate(const double * input, double * output, size_t count);
+
+	static void Min(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count);
+	static void Min(const float * a, const float * b, float * output, size_t count);
+	static void Max(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count);
+	static void Max(const float * a, const float * b, float * output, size_t count);
+
+	static void ShufflePixels(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+		const PixelShuffle & shuffle);
+
+	static void SwapChannels(float * data, size_t pixelsCount, size_t channelsCount,
+		size_t c0, size_t c1);
+	static void SwapChannels(uint8_t * data, size_t pixelsCount, size_t channelsCount,
+		size_t c0, size_t c1);
+
+	static void ShuffleChannels(const float * input, size_t inputChannelsCount, float * output,
+		size_t outputChannelsCount, size_t pixelsCount, const int * sources, float constant);
+	static void ShuffleChannels(const uint8_t * input, size_t inputChannelsCount, uint8_t * output,
+		size_t outputChannelsCount, size_t pixelsCount, const int * sources, uint8_t constant);
+
+	static void UnpackIndices(const uint8_t * packed, size_t count, unsigned int bitDepth,
+		uint8_t * indices);
+	static void ExpandPalette(const uint8_t * indices, size_t count, const uint8_t * palette,
+		size_t paletteSize, size_t channelsCount, uint8_t * output);
+
+	static void Deinterleave(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+		uint8_t * output);
+	static void Deinterleave(const float * input, size_t pixelsCount, size_t channelsCount,
+		float * output);
+	static void Interleave(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+		uint8_t * output);
+	static void Interleave(const float * input, size_t pixelsCount, size_t channelsCount,
+		float * output);
+
+	static void PremultiplyAlpha(uint8_t * data, size_t pixelsCount);
+	static void PremultiplyAlpha(float * data, size_t pixelsCount);
+	static void UnpremultiplyAlpha(uint8_t * data, size_t pixelsCount);
+	static void UnpremultiplyAlpha(float * data, size_t pixelsCount);
+	static void BlendOver(const uint8_t * src, uint8_t * dst, size_t pixelsCount, size_t dstChannelsCount);
+	static void BlendOver(const float * src, float * dst, size_t pixelsCount, size_t dstChannelsCount);
+
+	static void TransposePixels(const uint8_t * input, ptrdiff_t inputStride, uint8_t * output,
+		ptrdiff_t outputStride, size_t width, size_t height, size_t pixelBytes);
+	static void ReversePixels(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+		size_t pixelBytes);
+
+private:
+	static const ImageKernelsTable * GetActiveTable();
+	static const ImageKernelsTable * SelectTable(CpuFeatures::IsaLevel & level);
+	static const ImageKernelsTable * CreateDefaultTable();
+
+	template <typename T>
+	static void SwapChannelsImpl(T * data, size_t pixelsCount, size_t channelsCount,
+		size_t c0, size_t c1);
+
+	template <typename T>
+	static void ShuffleChannelsImpl(const T * input, size_t inputChannelsCount, T * output,
+		size_t outputChannelsCount, size_t pixelsCount, const int * sources, T constant);
+};
+
+#endif
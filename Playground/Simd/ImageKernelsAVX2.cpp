@@ -0,0 +1,11 @@
+//AVX2 version of image kernels
+//(compiled with AVX2 enabled, used only if CPU supports it)
+
+#if !defined(__AVX2__)
+#	error ImageKernelsAVX2.cpp must be compiled with AVX2 enabled
+#endif
+
+#define KERNELS_ISA_LEVEL ISA_LEVEL_AVX2
+#define KERNELS_NAMESPACE ImageKernelsAVX2
+
+#include "./ImageKernelsImpl.h"
@@ -0,0 +1,11 @@
+//AVX-512 version of image kernels
+//(compiled with AVX-512 F + BW + VL enabled, used only if CPU supports it)
+
+#if !defined(__AVX512F__) || !defined(__AVX512BW__) || !defined(__AVX512VL__)
+#	error ImageKernelsAVX512.cpp must be compiled with AVX-512 F + BW + VL enabled
+#endif
+
+#define KERNELS_ISA_LEVEL ISA_LEVEL_AVX512
+#define KERNELS_NAMESPACE ImageKernelsAVX512
+
+#include "./ImageKernelsImpl.h"
@@ -0,0 +1,3314 @@
+//=================================================================================================
+// Image kernels implementation
+//
+// No include guard - this file is compiled once per instruction set.
+// Translation unit must define:
+//	KERNELS_ISA_LEVEL - one of ISA_LEVEL_* from SimdUtils.h
+//	KERNELS_NAMESPACE - unique namespace for the instruction set
+//
+// Code inside must not call inline / template functions from std headers
+// (std::min, std::abs, ...). They would be emitted in every kernel translation unit
+// compiled with different instruction sets and linker may pick any of them.
+// Use local helpers or C library functions instead.
+//=================================================================================================
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+#include "./SimdUtils.h"
+#include "./ImageKernelsTable.h"
+
+namespace KERNELS_NAMESPACE
+{
+
+//=================================================================================================
+// Helpers
+//=================================================================================================
+
+template <typename T>
+static inline T MinValue(T a, T b)
+{
+	return (b < a) ? b : a;
+}
+
+template <typename T>
+static inline T MaxValue(T a, T b)
+{
+	return (a < b) ? b : a;
+}
+
+static inline size_t Gcd(size_t a, size_t b)
+{
+	while (b != 0)
+	{
+		size_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+//=================================================================================================
+// Lane patterns
+//=================================================================================================
+
+//Interleaved data with channelsCount channels loaded to SIMD registers
+//repeat their channel layout after K registers, where K = c / gcd(c, lanes)
+//e.g. RGB float with 8 lanes => 3 registers (24 values = 8 pixels)
+//Each lane then always holds the same channel and per-lane results can be
+//reduced at the end by selecting lanes with the required channel
+
+#if defined(HAVE_SSE41)
+
+static const size_t MAX_PATTERN_CHANNELS = 8;
+static const size_t MAX_PATTERN_LENGTH = 7;
+
+#if defined(HAVE_AVX512)
+static const size_t F32_LANES = MM512_ELEMENT_COUNT;
+static const size_t U8_LANES = MM512_BYTE_COUNT;
+#elif defined(HAVE_AVX2)
+static const size_t F32_LANES = MM256_ELEMENT_COUNT;
+static const size_t U8_LANES = MM256_BYTE_COUNT;
+#else
+static const size_t F32_LANES = MM128_ELEMENT_COUNT;
+static const size_t U8_LANES = MM128_BYTE_COUNT;
+#endif
+
+/// <summary>
+/// Get number of SIMD registers after which
+/// channel layout of interleaved data repeats
+/// </summary>
+/// <param name="channelsCount"></param>
+/// <param name="lanesCount"></param>
+/// <returns></returns>
+static size_t GetPatternLength(size_t channelsCount, size_t lanesCount)
+{
+	return channelsCount / Gcd(channelsCount, lanesCount);
+}
+
+/// <summary>
+/// Run Kernel with pattern length known at compile time,
+/// so the per-register accumulators can stay in registers
+/// Returns number of processed values (0 if pattern is not supported)
+/// </summary>
+template <template <size_t> class Kernel, typename... Args>
+static size_t RunPattern(size_t k, Args... args)
+{
+	switch (k)
+	{
+	case 1: return Kernel<1>::Run(args...);
+	case 2: return Kernel<2>::Run(args...);
+	case 3: return Kernel<3>::Run(args...);
+	case 5: return Kernel<5>::Run(args...);
+	case 7: return Kernel<7>::Run(args...);
+	default: return 0;
+	}
+}
+
+#endif
+
+//=================================================================================================
+// AVX-512 statistics kernels
+//=================================================================================================
+
+#if defined(HAVE_AVX512)
+
+template <size_t K>
+struct FindMinMaxF32Pattern
+{
+	static size_t Run(const float * data, size_t count, float * laneMin, float * laneMax)
+	{
+		const size_t blockSize = K * MM512_ELEMENT_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		__m512 vMin[K];
+		__m512 vMax[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			vMin[j] = _mm512_loadu_ps(data + j * MM512_ELEMENT_COUNT);
+			vMax[j] = vMin[j];
+		}
+
+		for (size_t i = blockSize; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m512 v = _mm512_loadu_ps(data + i + j * MM512_ELEMENT_COUNT);
+				vMin[j] = _mm512_min_ps(vMin[j], v);
+				vMax[j] = _mm512_max_ps(vMax[j], v);
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm512_storeu_ps(laneMin + j * MM512_ELEMENT_COUNT, vMin[j]);
+			_mm512_storeu_ps(laneMax + j * MM512_ELEMENT_COUNT, vMax[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct FindMinMaxU8Pattern
+{
+	static size_t Run(const uint8_t * data, size_t count, uint8_t * laneMin, uint8_t * laneMax)
+	{
+		const size_t blockSize = K * MM512_BYTE_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		__m512i vMin[K];
+		__m512i vMax[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			vMin[j] = _mm512_loadu_si512(data + j * MM512_BYTE_COUNT);
+			vMax[j] = vMin[j];
+		}
+
+		for (size_t i = blockSize; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m512i v = _mm512_loadu_si512(data + i + j * MM512_BYTE_COUNT);
+				vMin[j] = _mm512_min_epu8(vMin[j], v);
+				vMax[j] = _mm512_max_epu8(vMax[j], v);
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm512_storeu_si512(laneMin + j * MM512_BYTE_COUNT, vMin[j]);
+			_mm512_storeu_si512(laneMax + j * MM512_BYTE_COUNT, vMax[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct SumF32Pattern
+{
+	static size_t Run(const float * data, size_t count, double * laneSum)
+	{
+		const size_t blockSize = K * MM512_ELEMENT_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		//accumulate in double to avoid precision loss on large images
+		__m512d sumLo[K];
+		__m512d sumHi[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			sumLo[j] = _mm512_setzero_pd();
+			sumHi[j] = _mm512_setzero_pd();
+		}
+
+		for (size_t i = 0; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m512 v = _mm512_loadu_ps(data + i + j * MM512_ELEMENT_COUNT);
+				__m256 hi = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1));
+				sumLo[j] = _mm512_add_pd(sumLo[j], _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+				sumHi[j] = _mm512_add_pd(sumHi[j], _mm512_cvtps_pd(hi));
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm512_storeu_pd(laneSum + j * MM512_ELEMENT_COUNT, sumLo[j]);
+			_mm512_storeu_pd(laneSum + j * MM512_ELEMENT_COUNT + 8, sumHi[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct SumU8Pattern
+{
+	static size_t Run(const uint8_t * data, size_t count, size_t channelsCount, size_t channelIndex,
+		uint64_t * sum)
+	{
+		const size_t blockSize = K * MM512_BYTE_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		//mask out other channels, then sum 8 neighbor bytes with SAD
+		uint8_t maskData[K * MM512_BYTE_COUNT];
+		for (size_t i = 0; i < K * MM512_BYTE_COUNT; i++)
+		{
+			maskData[i] = ((i % channelsCount) == channelIndex) ? 0xFF : 0x00;
+		}
+
+		__m512i mask[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			mask[j] = _mm512_loadu_si512(maskData + j * MM512_BYTE_COUNT);
+		}
+
+		const __m512i zero = _mm512_setzero_si512();
+		__m512i acc = _mm512_setzero_si512();
+
+		for (size_t i = 0; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m512i v = _mm512_loadu_si512(data + i + j * MM512_BYTE_COUNT);
+				acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_and_si512(v, mask[j]), zero));
+			}
+		}
+
+		uint64_t tmp[8];
+		_mm512_storeu_si512(tmp, acc);
+		*sum = tmp[0] + tmp[1] + tmp[2] + tmp[3] + tmp[4] + tmp[5] + tmp[6] + tmp[7];
+
+		return end;
+	}
+};
+
+#elif defined(HAVE_AVX2)
+
+//=================================================================================================
+// AVX2 statistics kernels
+//=================================================================================================
+
+template <size_t K>
+struct FindMinMaxF32Pattern
+{
+	static size_t Run(const float * data, size_t count, float * laneMin, float * laneMax)
+	{
+		const size_t blockSize = K * MM256_ELEMENT_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		__m256 vMin[K];
+		__m256 vMax[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			vMin[j] = _mm256_loadu_ps(data + j * MM256_ELEMENT_COUNT);
+			vMax[j] = vMin[j];
+		}
+
+		for (size_t i = blockSize; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m256 v = _mm256_loadu_ps(data + i + j * MM256_ELEMENT_COUNT);
+				vMin[j] = _mm256_min_ps(vMin[j], v);
+				vMax[j] = _mm256_max_ps(vMax[j], v);
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm256_storeu_ps(laneMin + j * MM256_ELEMENT_COUNT, vMin[j]);
+			_mm256_storeu_ps(laneMax + j * MM256_ELEMENT_COUNT, vMax[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct FindMinMaxU8Pattern
+{
+	static size_t Run(const uint8_t * data, size_t count, uint8_t * laneMin, uint8_t * laneMax)
+	{
+		const size_t blockSize = K * MM256_BYTE_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		__m256i vMin[K];
+		__m256i vMax[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			vMin[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + j * MM256_BYTE_COUNT));
+			vMax[j] = vMin[j];
+		}
+
+		for (size_t i = blockSize; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + j * MM256_BYTE_COUNT));
+				vMin[j] = _mm256_min_epu8(vMin[j], v);
+				vMax[j] = _mm256_max_epu8(vMax[j], v);
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(laneMin + j * MM256_BYTE_COUNT), vMin[j]);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(laneMax + j * MM256_BYTE_COUNT), vMax[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct SumF32Pattern
+{
+	static size_t Run(const float * data, size_t count, double * laneSum)
+	{
+		const size_t blockSize = K * MM256_ELEMENT_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		//accumulate in double to avoid precision loss on large images
+		__m256d sumLo[K];
+		__m256d sumHi[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			sumLo[j] = _mm256_setzero_pd();
+			sumHi[j] = _mm256_setzero_pd();
+		}
+
+		for (size_t i = 0; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m256 v = _mm256_loadu_ps(data + i + j * MM256_ELEMENT_COUNT);
+				sumLo[j] = _mm256_add_pd(sumLo[j], _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+				sumHi[j] = _mm256_add_pd(sumHi[j], _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm256_storeu_pd(laneSum + j * MM256_ELEMENT_COUNT, sumLo[j]);
+			_mm256_storeu_pd(laneSum + j * MM256_ELEMENT_COUNT + 4, sumHi[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct SumU8Pattern
+{
+	static size_t Run(const uint8_t * data, size_t count, size_t channelsCount, size_t channelIndex,
+		uint64_t * sum)
+	{
+		const size_t blockSize = K * MM256_BYTE_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		//mask out other channels, then sum 8 neighbor bytes with SAD
+		uint8_t maskData[K * MM256_BYTE_COUNT];
+		for (size_t i = 0; i < K * MM256_BYTE_COUNT; i++)
+		{
+			maskData[i] = ((i % channelsCount) == channelIndex) ? 0xFF : 0x00;
+		}
+
+		__m256i mask[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			mask[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(maskData + j * MM256_BYTE_COUNT));
+		}
+
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i acc = _mm256_setzero_si256();
+
+		for (size_t i = 0; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + j * MM256_BYTE_COUNT));
+				acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_and_si256(v, mask[j]), zero));
+			}
+		}
+
+		uint64_t tmp[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(tmp), acc);
+		*sum = tmp[0] + tmp[1] + tmp[2] + tmp[3];
+
+		return end;
+	}
+};
+
+#elif defined(HAVE_SSE41)
+
+//=================================================================================================
+// SSE4.1 statistics kernels
+//=================================================================================================
+
+template <size_t K>
+struct FindMinMaxF32Pattern
+{
+	static size_t Run(const float * data, size_t count, float * laneMin, float * laneMax)
+	{
+		const size_t blockSize = K * MM128_ELEMENT_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		__m128 vMin[K];
+		__m128 vMax[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			vMin[j] = _mm_loadu_ps(data + j * MM128_ELEMENT_COUNT);
+			vMax[j] = vMin[j];
+		}
+
+		for (size_t i = blockSize; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m128 v = _mm_loadu_ps(data + i + j * MM128_ELEMENT_COUNT);
+				vMin[j] = _mm_min_ps(vMin[j], v);
+				vMax[j] = _mm_max_ps(vMax[j], v);
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm_storeu_ps(laneMin + j * MM128_ELEMENT_COUNT, vMin[j]);
+			_mm_storeu_ps(laneMax + j * MM128_ELEMENT_COUNT, vMax[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct FindMinMaxU8Pattern
+{
+	static size_t Run(const uint8_t * data, size_t count, uint8_t * laneMin, uint8_t * laneMax)
+	{
+		const size_t blockSize = K * MM128_BYTE_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		__m128i vMin[K];
+		__m128i vMax[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			vMin[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j * MM128_BYTE_COUNT));
+			vMax[j] = vMin[j];
+		}
+
+		for (size_t i = blockSize; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + j * MM128_BYTE_COUNT));
+				vMin[j] = _mm_min_epu8(vMin[j], v);
+				vMax[j] = _mm_max_epu8(vMax[j], v);
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(laneMin + j * MM128_BYTE_COUNT), vMin[j]);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(laneMax + j * MM128_BYTE_COUNT), vMax[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct SumF32Pattern
+{
+	static size_t Run(const float * data, size_t count, double * laneSum)
+	{
+		const size_t blockSize = K * MM128_ELEMENT_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		//accumulate in double to avoid precision loss on large images
+		__m128d sumLo[K];
+		__m128d sumHi[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			sumLo[j] = _mm_setzero_pd();
+			sumHi[j] = _mm_setzero_pd();
+		}
+
+		for (size_t i = 0; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m128 v = _mm_loadu_ps(data + i + j * MM128_ELEMENT_COUNT);
+				sumLo[j] = _mm_add_pd(sumLo[j], _mm_cvtps_pd(v));
+				sumHi[j] = _mm_add_pd(sumHi[j], _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+			}
+		}
+
+		for (size_t j = 0; j < K; j++)
+		{
+			_mm_storeu_pd(laneSum + j * MM128_ELEMENT_COUNT, sumLo[j]);
+			_mm_storeu_pd(laneSum + j * MM128_ELEMENT_COUNT + 2, sumHi[j]);
+		}
+
+		return end;
+	}
+};
+
+template <size_t K>
+struct SumU8Pattern
+{
+	static size_t Run(const uint8_t * data, size_t count, size_t channelsCount, size_t channelIndex,
+		uint64_t * sum)
+	{
+		const size_t blockSize = K * MM128_BYTE_COUNT;
+		const size_t end = count - count % blockSize;
+		if (end == 0)
+		{
+			return 0;
+		}
+
+		//mask out other channels, then sum 8 neighbor bytes with SAD
+		uint8_t maskData[K * MM128_BYTE_COUNT];
+		for (size_t i = 0; i < K * MM128_BYTE_COUNT; i++)
+		{
+			maskData[i] = ((i % channelsCount) == channelIndex) ? 0xFF : 0x00;
+		}
+
+		__m128i mask[K];
+		for (size_t j = 0; j < K; j++)
+		{
+			mask[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(maskData + j * MM128_BYTE_COUNT));
+		}
+
+		const __m128i zero = _mm_setzero_si128();
+		__m128i acc = _mm_setzero_si128();
+
+		for (size_t i = 0; i < end; i += blockSize)
+		{
+			for (size_t j = 0; j < K; j++)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + j * MM128_BYTE_COUNT));
+				acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_and_si128(v, mask[j]), zero));
+			}
+		}
+
+		uint64_t tmp[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(tmp), acc);
+		*sum = tmp[0] + tmp[1];
+
+		return end;
+	}
+};
+
+#endif
+
+//=================================================================================================
+// Statistics
+//=================================================================================================
+
+/// <summary>
+/// Find min / max values of channelIndex in interleaved data
+/// If there are no pixels, min / max are set to 0
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="channelIndex"></param>
+/// <param name="min"></param>
+/// <param name="max"></param>
+static void FindMinMax(const float * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex, float & min, float & max)
+{
+	if (pixelsCount == 0)
+	{
+		min = 0.0f;
+		max = 0.0f;
+		return;
+	}
+
+	const size_t count = pixelsCount * channelsCount;
+	size_t processed = 0;
+
+	min = data[channelIndex];
+	max = data[channelIndex];
+
+#if defined(HAVE_SSE41)
+	if (channelsCount <= MAX_PATTERN_CHANNELS)
+	{
+		const size_t k = GetPatternLength(channelsCount, F32_LANES);
+
+		float laneMin[MAX_PATTERN_LENGTH * F32_LANES];
+		float laneMax[MAX_PATTERN_LENGTH * F32_LANES];
+
+		processed = RunPattern<FindMinMaxF32Pattern>(k, data, count, laneMin, laneMax);
+		if (processed > 0)
+		{
+			for (size_t i = channelIndex; i < k * F32_LANES; i += channelsCount)
+			{
+				min = MinValue(min, laneMin[i]);
+				max = MaxValue(max, laneMax[i]);
+			}
+		}
+	}
+#endif
+
+	for (size_t i = processed + channelIndex; i < count; i += channelsCount)
+	{
+		min = MinValue(min, data[i]);
+		max = MaxValue(max, data[i]);
+	}
+}
+
+static void FindMinMax(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex, uint8_t & min, uint8_t & max)
+{
+	if (pixelsCount == 0)
+	{
+		min = 0;
+		max = 0;
+		return;
+	}
+
+	const size_t count = pixelsCount * channelsCount;
+	size_t processed = 0;
+
+	min = data[channelIndex];
+	max = data[channelIndex];
+
+#if defined(HAVE_SSE41)
+	if (channelsCount <= MAX_PATTERN_CHANNELS)
+	{
+		const size_t k = GetPatternLength(channelsCount, U8_LANES);
+
+		uint8_t laneMin[MAX_PATTERN_LENGTH * U8_LANES];
+		uint8_t laneMax[MAX_PATTERN_LENGTH * U8_LANES];
+
+		processed = RunPattern<FindMinMaxU8Pattern>(k, data, count, laneMin, laneMax);
+		if (processed > 0)
+		{
+			for (size_t i = channelIndex; i < k * U8_LANES; i += channelsCount)
+			{
+				min = MinValue(min, laneMin[i]);
+				max = MaxValue(max, laneMax[i]);
+			}
+		}
+	}
+#endif
+
+	for (size_t i = processed + channelIndex; i < count; i += channelsCount)
+	{
+		min = MinValue(min, data[i]);
+		max = MaxValue(max, data[i]);
+	}
+}
+
+/// <summary>
+/// Sum all values of channelIndex in interleaved data
+/// Values are accumulated in double
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+static double Sum(const float * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex)
+{
+	const size_t count = pixelsCount * channelsCount;
+	size_t processed = 0;
+	double sum = 0.0;
+
+#if defined(HAVE_SSE41)
+	if (channelsCount <= MAX_PATTERN_CHANNELS)
+	{
+		const size_t k = GetPatternLength(channelsCount, F32_LANES);
+
+		double laneSum[MAX_PATTERN_LENGTH * F32_LANES];
+
+		processed = RunPattern<SumF32Pattern>(k, data, count, laneSum);
+		if (processed > 0)
+		{
+			for (size_t i = channelIndex; i < k * F32_LANES; i += channelsCount)
+			{
+				sum += laneSum[i];
+			}
+		}
+	}
+#endif
+
+	for (size_t i = processed + channelIndex; i < count; i += channelsCount)
+	{
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+/// <summary>
+/// Sum all values of channelIndex in interleaved data
+/// Values are accumulated in exact integer
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="channelIndex"></param>
+/// <returns></returns>
+static uint64_t Sum(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+	size_t channelIndex)
+{
+	const size_t count = pixelsCount * channelsCount;
+	size_t processed = 0;
+	uint64_t sum = 0;
+
+#if defined(HAVE_SSE41)
+	if (channelsCount <= MAX_PATTERN_CHANNELS)
+	{
+		const size_t k = GetPatternLength(channelsCount, U8_LANES);
+
+		processed = RunPattern<SumU8Pattern>(k, data, count, channelsCount, channelIndex, &sum);
+	}
+#endif
+
+	for (size_t i = processed + channelIndex; i < count; i += channelsCount)
+	{
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+//=================================================================================================
+// Per-element operations
+//=================================================================================================
+
+/// <summary>
+/// In-place absolute value of all elements
+/// </summary>
+/// <param name="data"></param>
+/// <param name="count"></param>
+static void Abs(float * data, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + MM512_ELEMENT_COUNT <= count; i += MM512_ELEMENT_COUNT)
+	{
+		__m512 v = _mm512_loadu_ps(data + i);
+		_mm512_storeu_ps(data + i, _mm512_abs_ps(v));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + MM256_ELEMENT_COUNT <= count; i += MM256_ELEMENT_COUNT)
+	{
+		__m256 v = _mm256_loadu_ps(data + i);
+		_mm256_storeu_ps(data + i, _my_mm256_abs_ps(v));
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + MM128_ELEMENT_COUNT <= count; i += MM128_ELEMENT_COUNT)
+	{
+		__m128 v = _mm_loadu_ps(data + i);
+		_mm_storeu_ps(data + i, _my_mm_abs_ps(v));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		data[i] = fabsf(data[i]);
+	}
+}
+
+/// <summary>
+/// Set all elements to value
+/// </summary>
+/// <param name="data"></param>
+/// <param name="count"></param>
+/// <param name="value"></param>
+static void Fill(float * data, size_t count, float value)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	const __m512 v = _mm512_set1_ps(value);
+	for (; i + MM512_ELEMENT_COUNT <= count; i += MM512_ELEMENT_COUNT)
+	{
+		_mm512_storeu_ps(data + i, v);
+	}
+#elif defined(HAVE_AVX2)
+	const __m256 v = _mm256_set1_ps(value);
+	for (; i + MM256_ELEMENT_COUNT <= count; i += MM256_ELEMENT_COUNT)
+	{
+		_mm256_storeu_ps(data + i, v);
+	}
+#elif defined(HAVE_SSE41)
+	const __m128 v = _mm_set1_ps(value);
+	for (; i + MM128_ELEMENT_COUNT <= count; i += MM128_ELEMENT_COUNT)
+	{
+		_mm_storeu_ps(data + i, v);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		data[i] = value;
+	}
+}
+
+static void Fill(uint8_t * data, size_t count, uint8_t value)
+{
+	//memset is already vectorized
+	if (count > 0)
+	{
+		memset(data, value, count);
+	}
+}
+
+/// <summary>
+/// Fill pixelsCount pixels with the same pixel of pixelBytes bytes
+/// SIMD stores start at pixel boundaries and move by whole pixels that fit
+/// to register (stores may overlap), last store is aligned to the end
+/// with pattern rotated to its phase
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="pixel"></param>
+/// <param name="pixelBytes"></param>
+static void FillPixels(uint8_t * data, size_t pixelsCount, const uint8_t * pixel, size_t pixelBytes)
+{
+	const size_t count = pixelsCount * pixelBytes;
+	size_t i = 0;
+
+#if defined(HAVE_SSE41)
+	if ((pixelBytes <= MM128_BYTE_COUNT) && (count >= MM128_BYTE_COUNT))
+	{
+		//pattern is long enough to be loaded at any phase [0, pixelBytes)
+		uint8_t pattern[MM512_BYTE_COUNT + MM128_BYTE_COUNT];
+		for (size_t b = 0; b < sizeof(pattern); b++)
+		{
+			pattern[b] = pixel[b % pixelBytes];
+		}
+
+#if defined(HAVE_AVX512)
+		const __m512i v4 = _mm512_loadu_si512(pattern);
+		const size_t step4 = (MM512_BYTE_COUNT / pixelBytes) * pixelBytes;
+		for (; i + MM512_BYTE_COUNT <= count; i += step4)
+		{
+			_mm512_storeu_si512(data + i, v4);
+		}
+#elif defined(HAVE_AVX2)
+		const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pattern));
+		const size_t step2 = (MM256_BYTE_COUNT / pixelBytes) * pixelBytes;
+		for (; i + MM256_BYTE_COUNT <= count; i += step2)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), v2);
+		}
+#endif
+
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern));
+		const size_t step = (MM128_BYTE_COUNT / pixelBytes) * pixelBytes;
+		for (; i + MM128_BYTE_COUNT <= count; i += step)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), v);
+		}
+
+		if (i < count)
+		{
+			const size_t last = count - MM128_BYTE_COUNT;
+			const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern + last % pixelBytes));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(data + last), tail);
+		}
+		return;
+	}
+#endif
+
+	for (; i < count; i += pixelBytes)
+	{
+		memcpy(data + i, pixel, pixelBytes);
+	}
+}
+
+/// <summary>
+/// Convert uint8_t to float (no scaling)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+static void Convert(const uint8_t * input, float * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + MM512_ELEMENT_COUNT <= count; i += MM512_ELEMENT_COUNT)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+		_mm512_storeu_ps(output + i, _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v)));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 2 * MM256_ELEMENT_COUNT <= count; i += 2 * MM256_ELEMENT_COUNT)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+		__m256i lo = _mm256_cvtepu8_epi32(v);
+		__m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(v, 8));
+		_mm256_storeu_ps(output + i, _mm256_cvtepi32_ps(lo));
+		_mm256_storeu_ps(output + i + MM256_ELEMENT_COUNT, _mm256_cvtepi32_ps(hi));
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+		_mm_storeu_ps(output + i, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)));
+		_mm_storeu_ps(output + i + 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4))));
+		_mm_storeu_ps(output + i + 8, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+		_mm_storeu_ps(output + i + 12, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12))));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] = static_cast<float>(input[i]);
+	}
+}
+
+/// <summary>
+/// Convert float to uint8_t (no scaling, values are truncated)
+/// Input data must be in range [0, 255]
+/// (SIMD path saturates values outside of the range)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+static void Convert(const float * input, uint8_t * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	const __m512i zero = _mm512_setzero_si512();
+	for (; i + MM512_ELEMENT_COUNT <= count; i += MM512_ELEMENT_COUNT)
+	{
+		__m512i v = _mm512_max_epi32(_mm512_cvttps_epi32(_mm512_loadu_ps(input + i)), zero);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm512_cvtusepi32_epi8(v));
+	}
+#elif defined(HAVE_AVX2)
+	//packs work within 128-bit lanes => fix order with final permute
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (; i + MM256_BYTE_COUNT <= count; i += MM256_BYTE_COUNT)
+	{
+		__m256i a = _mm256_cvttps_epi32(_mm256_loadu_ps(input + i));
+		__m256i b = _mm256_cvttps_epi32(_mm256_loadu_ps(input + i + 8));
+		__m256i c = _mm256_cvttps_epi32(_mm256_loadu_ps(input + i + 16));
+		__m256i d = _mm256_cvttps_epi32(_mm256_loadu_ps(input + i + 24));
+
+		__m256i ab = _mm256_packs_epi32(a, b);
+		__m256i cd = _mm256_packs_epi32(c, d);
+		__m256i abcd = _mm256_packus_epi16(ab, cd);
+
+		abcd = _mm256_permutevar8x32_epi32(abcd, order);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), abcd);
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+	{
+		__m128i a = _mm_cvttps_epi32(_mm_loadu_ps(input + i));
+		__m128i b = _mm_cvttps_epi32(_mm_loadu_ps(input + i + 4));
+		__m128i c = _mm_cvttps_epi32(_mm_loadu_ps(input + i + 8));
+		__m128i d = _mm_cvttps_epi32(_mm_loadu_ps(input + i + 12));
+
+		__m128i ab = _mm_packs_epi32(a, b);
+		__m128i cd = _mm_packs_epi32(c, d);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packus_epi16(ab, cd));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] = static_cast<uint8_t>(input[i]);
+	}
+}
+
+/// <summary>
+/// Convert float to uint8_t with rounding (half up)
+/// Values outside of [0, 255] are saturated
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+static void ConvertSaturated(const float * input, uint8_t * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	const __m512 half = _mm512_set1_ps(0.5f);
+	const __m512 zero = _mm512_setzero_ps();
+	const __m512 maxValue = _mm512_set1_ps(255.0f);
+	for (; i + MM512_ELEMENT_COUNT <= count; i += MM512_ELEMENT_COUNT)
+	{
+		__m512 v = _mm512_add_ps(_mm512_loadu_ps(input + i), half);
+		v = _mm512_min_ps(_mm512_max_ps(v, zero), maxValue);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(v)));
+	}
+#elif defined(HAVE_AVX2)
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 maxValue = _mm256_set1_ps(255.0f);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (; i + MM256_BYTE_COUNT <= count; i += MM256_BYTE_COUNT)
+	{
+		__m256i v[4];
+		for (size_t j = 0; j < 4; j++)
+		{
+			__m256 f = _mm256_add_ps(_mm256_loadu_ps(input + i + j * MM256_ELEMENT_COUNT), half);
+			f = _mm256_min_ps(_mm256_max_ps(f, zero), maxValue);
+			v[j] = _mm256_cvttps_epi32(f);
+		}
+
+		__m256i ab = _mm256_packs_epi32(v[0], v[1]);
+		__m256i cd = _mm256_packs_epi32(v[2], v[3]);
+		__m256i abcd = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, cd), order);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), abcd);
+	}
+#elif defined(HAVE_SSE41)
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 maxValue = _mm_set1_ps(255.0f);
+
+	for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+	{
+		__m128i v[4];
+		for (size_t j = 0; j < 4; j++)
+		{
+			__m128 f = _mm_add_ps(_mm_loadu_ps(input + i + j * MM128_ELEMENT_COUNT), half);
+			f = _mm_min_ps(_mm_max_ps(f, zero), maxValue);
+			v[j] = _mm_cvttps_epi32(f);
+		}
+
+		__m128i ab = _mm_packs_epi32(v[0], v[1]);
+		__m128i cd = _mm_packs_epi32(v[2], v[3]);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packus_epi16(ab, cd));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float v = input[i] + 0.5f;
+		v = (v < 0.0f) ? 0.0f : (v > 255.0f) ? 255.0f : v;
+		output[i] = static_cast<uint8_t>(v);
+	}
+}
+
+//=================================================================================================
+// Lookup tables
+//=================================================================================================
+
+/// <summary>
+/// output[i] = table[input[i]]
+/// SIMD version splits 256-entry table to 16 sub-tables of 16 values.
+/// Low nibble of value selects entry by byte shuffle,
+/// high nibble selects sub-table by compare + blend.
+/// SSE4.1 uses scalar code, 16 shuffles of 16 bytes are not faster than table loads.
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output">can be the same as input</param>
+/// <param name="count"></param>
+/// <param name="table">256 values</param>
+static void ApplyLut(const uint8_t * input, uint8_t * output, size_t count, const uint8_t * table)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	if (count >= MM512_BYTE_COUNT)
+	{
+		__m512i sub[16];
+		for (int k = 0; k < 16; k++)
+		{
+			sub[k] = _mm512_broadcast_i32x4(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table + 16 * k)));
+		}
+
+		const __m512i lowMask = _mm512_set1_epi8(0x0F);
+		const __m512i one = _mm512_set1_epi8(1);
+
+		for (; i + MM512_BYTE_COUNT <= count; i += MM512_BYTE_COUNT)
+		{
+			const __m512i x = _mm512_loadu_si512(input + i);
+			const __m512i lo = _mm512_and_si512(x, lowMask);
+			const __m512i hi = _mm512_and_si512(_mm512_srli_epi16(x, 4), lowMask);
+
+			__m512i res = _mm512_setzero_si512();
+			__m512i k = _mm512_setzero_si512();
+			for (int j = 0; j < 16; j++)
+			{
+				const __mmask64 m = _mm512_cmpeq_epi8_mask(hi, k);
+				res = _mm512_mask_shuffle_epi8(res, m, sub[j], lo);
+				k = _mm512_add_epi8(k, one);
+			}
+
+			_mm512_storeu_si512(output + i, res);
+		}
+	}
+#elif defined(HAVE_AVX2)
+	if (count >= 2 * MM256_BYTE_COUNT)
+	{
+		__m256i sub[16];
+		for (int k = 0; k < 16; k++)
+		{
+			sub[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table + 16 * k)));
+		}
+
+		const __m256i lowMask = _mm256_set1_epi8(0x0F);
+		const __m256i one = _mm256_set1_epi8(1);
+
+		//two independent vectors per iteration hide blend latency
+		for (; i + 2 * MM256_BYTE_COUNT <= count; i += 2 * MM256_BYTE_COUNT)
+		{
+			const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+			const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i + MM256_BYTE_COUNT));
+			const __m256i lo0 = _mm256_and_si256(x0, lowMask);
+			const __m256i lo1 = _mm256_and_si256(x1, lowMask);
+			const __m256i hi0 = _mm256_and_si256(_mm256_srli_epi16(x0, 4), lowMask);
+			const __m256i hi1 = _mm256_and_si256(_mm256_srli_epi16(x1, 4), lowMask);
+
+			__m256i res0 = _mm256_setzero_si256();
+			__m256i res1 = _mm256_setzero_si256();
+			__m256i k = _mm256_setzero_si256();
+			for (int j = 0; j < 16; j++)
+			{
+				res0 = _mm256_blendv_epi8(res0, _mm256_shuffle_epi8(sub[j], lo0), _mm256_cmpeq_epi8(hi0, k));
+				res1 = _mm256_blendv_epi8(res1, _mm256_shuffle_epi8(sub[j], lo1), _mm256_cmpeq_epi8(hi1, k));
+				k = _mm256_add_epi8(k, one);
+			}
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), res0);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i + MM256_BYTE_COUNT), res1);
+		}
+	}
+#endif
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const uint8_t v0 = table[input[i]];
+		const uint8_t v1 = table[input[i + 1]];
+		const uint8_t v2 = table[input[i + 2]];
+		const uint8_t v3 = table[input[i + 3]];
+		output[i] = v0;
+		output[i + 1] = v1;
+		output[i + 2] = v2;
+		output[i + 3] = v3;
+	}
+
+	for (; i < count; i++)
+	{
+		output[i] = table[input[i]];
+	}
+}
+
+/// <summary>
+/// Apply table of each channel to interleaved data
+/// output[i * c + ch] = tables[ch * 256 + input[i * c + ch]]
+/// (table depends on position, so it is not vectorized)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output">can be the same as input</param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="tables">channelsCount tables of 256 values</param>
+static void ApplyLutChannels(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+	size_t channelsCount, const uint8_t * tables)
+{
+	const size_t c = channelsCount;
+
+	if (c == 3)
+	{
+		const uint8_t * t0 = tables;
+		const uint8_t * t1 = tables + 256;
+		const uint8_t * t2 = tables + 512;
+		for (size_t i = 0; i < pixelsCount; i++)
+		{
+			const uint8_t * in = input + i * 3;
+			uint8_t * out = output + i * 3;
+			out[0] = t0[in[0]];
+			out[1] = t1[in[1]];
+			out[2] = t2[in[2]];
+		}
+		return;
+	}
+
+	if (c == 4)
+	{
+		const uint8_t * t0 = tables;
+		const uint8_t * t1 = tables + 256;
+		const uint8_t * t2 = tables + 512;
+		const uint8_t * t3 = tables + 768;
+		for (size_t i = 0; i < pixelsCount; i++)
+		{
+			const uint8_t * in = input + i * 4;
+			uint8_t * out = output + i * 4;
+			out[0] = t0[in[0]];
+			out[1] = t1[in[1]];
+			out[2] = t2[in[2]];
+			out[3] = t3[in[3]];
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < pixelsCount; i++)
+	{
+		for (size_t ch = 0; ch < c; ch++)
+		{
+			output[i * c + ch] = tables[ch * 256 + input[i * c + ch]];
+		}
+	}
+}
+
+//=================================================================================================
+// Convolution
+//=================================================================================================
+
+/// <summary>
+/// Weighted sum of shifted input
+/// output[i] (+)= sum_k input[i + k * step] * weights[k]
+///
+/// With step = channelsCount, it is horizontal convolution of interleaved row
+/// With step = row length, it is vertical convolution of consecutive rows
+/// Sum is computed in the same order in all versions (without FMA),
+/// so results do not depend on instruction set
+/// </summary>
+/// <param name="input"></param>
+/// <param name="count">number of output values</param>
+/// <param name="step">distance between input values of neighbor weights</param>
+/// <param name="weights"></param>
+/// <param name="weightsCount"></param>
+/// <param name="output"></param>
+/// <param name="accumulate">add sum to current output values</param>
+static void ConvolveRow(const float * input, size_t count, size_t step,
+	const float * weights, size_t weightsCount, float * output, bool accumulate)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + MM512_ELEMENT_COUNT <= count; i += MM512_ELEMENT_COUNT)
+	{
+		__m512 acc = (accumulate) ? _mm512_loadu_ps(output + i) : _mm512_setzero_ps();
+		for (size_t k = 0; k < weightsCount; k++)
+		{
+			__m512 v = _mm512_loadu_ps(input + i + k * step);
+			acc = _mm512_add_ps(acc, _mm512_mul_ps(v, _mm512_set1_ps(weights[k])));
+		}
+		_mm512_storeu_ps(output + i, acc);
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 2 * MM256_ELEMENT_COUNT <= count; i += 2 * MM256_ELEMENT_COUNT)
+	{
+		__m256 acc0 = (accumulate) ? _mm256_loadu_ps(output + i) : _mm256_setzero_ps();
+		__m256 acc1 = (accumulate) ? _mm256_loadu_ps(output + i + MM256_ELEMENT_COUNT) : _mm256_setzero_ps();
+		for (size_t k = 0; k < weightsCount; k++)
+		{
+			const float * in = input + i + k * step;
+			__m256 w = _mm256_set1_ps(weights[k]);
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(in), w));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(in + MM256_ELEMENT_COUNT), w));
+		}
+		_mm256_storeu_ps(output + i, acc0);
+		_mm256_storeu_ps(output + i + MM256_ELEMENT_COUNT, acc1);
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 2 * MM128_ELEMENT_COUNT <= count; i += 2 * MM128_ELEMENT_COUNT)
+	{
+		__m128 acc0 = (accumulate) ? _mm_loadu_ps(output + i) : _mm_setzero_ps();
+		__m128 acc1 = (accumulate) ? _mm_loadu_ps(output + i + MM128_ELEMENT_COUNT) : _mm_setzero_ps();
+		for (size_t k = 0; k < weightsCount; k++)
+		{
+			const float * in = input + i + k * step;
+			__m128 w = _mm_set1_ps(weights[k]);
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(in), w));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(in + MM128_ELEMENT_COUNT), w));
+		}
+		_mm_storeu_ps(output + i, acc0);
+		_mm_storeu_ps(output + i + MM128_ELEMENT_COUNT, acc1);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float acc = (accumulate) ? output[i] : 0.0f;
+		for (size_t k = 0; k < weightsCount; k++)
+		{
+			acc += input[i + k * step] * weights[k];
+		}
+		output[i] = acc;
+	}
+}
+
+/// <summary>
+/// Resample interleaved row
+/// output pixel x = sum_k input pixel (starts[x] + k) * weights[x * taps + k]
+/// (each channel separately)
+///
+/// Pixels with 3 or 4 channels are processed as single SSE register
+/// (3-channel pixels use 4th lane as padding, the last pixels fall back to scalar code)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="inputPixelsCount">bounds of SIMD loads (checked only by assert in scalar code)</param>
+/// <param name="channelsCount"></param>
+/// <param name="starts">first input pixel for each output pixel</param>
+/// <param name="weights">taps weights for each output pixel</param>
+/// <param name="taps"></param>
+/// <param name="outputPixelsCount"></param>
+/// <param name="output"></param>
+static void ResampleRow(const float * input, [[maybe_unused]] size_t inputPixelsCount, size_t channelsCount,
+	const int32_t * starts, const float * weights, size_t taps,
+	size_t outputPixelsCount, float * output)
+{
+	const size_t c = channelsCount;
+	size_t x = 0;
+
+#if defined(HAVE_SSE41)
+	if ((c == 3) || (c == 4))
+	{
+		//4th value of 3-channel pixel is read from the next pixel,
+		//output of the last pixel must not write it
+		const size_t inputCount = inputPixelsCount * c;
+		const size_t outputEnd = (c == 4) ? outputPixelsCount : (outputPixelsCount > 0 ? outputPixelsCount - 1 : 0);
+
+		for (; x < outputEnd; x++)
+		{
+			const size_t start = size_t(starts[x]);
+			if ((start + taps) * c + (4 - c) > inputCount)
+			{
+				break;
+			}
+
+			const float * in = input + start * c;
+			const float * w = weights + x * taps;
+
+			__m128 acc = _mm_setzero_ps();
+			for (size_t k = 0; k < taps; k++)
+			{
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + k * c), _mm_set1_ps(w[k])));
+			}
+			_mm_storeu_ps(output + x * c, acc);
+		}
+	}
+#endif
+
+	for (; x < outputPixelsCount; x++)
+	{
+		assert(size_t(starts[x]) + taps <= inputPixelsCount);
+
+		const float * in = input + size_t(starts[x]) * c;
+		const float * w = weights + x * taps;
+
+		for (size_t ch = 0; ch < c; ch++)
+		{
+			float acc = 0.0f;
+			for (size_t k = 0; k < taps; k++)
+			{
+				acc += in[k * c + ch] * w[k];
+			}
+			output[x * c + ch] = acc;
+		}
+	}
+}
+
+//=================================================================================================
+// Integral image
+//=================================================================================================
+
+/// <summary>
+/// Running sum of interleaved row (each channel separately)
+/// sums[i] = sums[i - channelsCount] + input[i]
+/// squares[i] = squares[i - channelsCount] + input[i]^2 (if squares is not nullptr)
+///
+/// Single channel rows use in-register prefix scan (AVX2),
+/// other rows have channelsCount independent chains
+/// </summary>
+/// <param name="input"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="sums"></param>
+/// <param name="squares">can be nullptr</param>
+static void PrefixSum(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+	uint64_t * sums, uint64_t * squares)
+{
+	const size_t count = pixelsCount * channelsCount;
+	size_t i = 0;
+
+#if defined(HAVE_AVX2)
+	if (channelsCount == 1)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i carry = zero;
+		__m256i carrySq = zero;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			int32_t packed;
+			memcpy(&packed, input + i, sizeof(int32_t));
+			__m256i v = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+			__m256i sq = _mm256_mul_epu32(v, v);
+
+			//[a b c d] => [a a+b b+c c+d] => [a a+b a+b+c a+b+c+d]
+			v = _mm256_add_epi64(v, _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x90), zero, 0x03));
+			v = _mm256_add_epi64(v, _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x40), zero, 0x0F));
+			v = _mm256_add_epi64(v, carry);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(sums + i), v);
+			carry = _mm256_permute4x64_epi64(v, 0xFF);
+
+			if (squares != nullptr)
+			{
+				sq = _mm256_add_epi64(sq, _mm256_blend_epi32(_mm256_permute4x64_epi64(sq, 0x90), zero, 0x03));
+				sq = _mm256_add_epi64(sq, _mm256_blend_epi32(_mm256_permute4x64_epi64(sq, 0x40), zero, 0x0F));
+				sq = _mm256_add_epi64(sq, carrySq);
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(squares + i), sq);
+				carrySq = _mm256_permute4x64_epi64(sq, 0xFF);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const uint64_t v = input[i];
+		sums[i] = (i < channelsCount) ? v : sums[i - channelsCount] + v;
+		if (squares != nullptr)
+		{
+			squares[i] = (i < channelsCount) ? v * v : squares[i - channelsCount] + v * v;
+		}
+	}
+}
+
+static void PrefixSum(const float * input, size_t pixelsCount, size_t channelsCount,
+	double * sums, double * squares)
+{
+	const size_t count = pixelsCount * channelsCount;
+	size_t i = 0;
+
+#if defined(HAVE_AVX2)
+	if (channelsCount == 1)
+	{
+		const __m256d zero = _mm256_setzero_pd();
+		__m256d carry = zero;
+		__m256d carrySq = zero;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256d v = _mm256_cvtps_pd(_mm_loadu_ps(input + i));
+			__m256d sq = _mm256_mul_pd(v, v);
+
+			v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x90), zero, 0x1));
+			v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, 0x40), zero, 0x3));
+			v = _mm256_add_pd(v, carry);
+			_mm256_storeu_pd(sums + i, v);
+			carry = _mm256_permute4x64_pd(v, 0xFF);
+
+			if (squares != nullptr)
+			{
+				sq = _mm256_add_pd(sq, _mm256_blend_pd(_mm256_permute4x64_pd(sq, 0x90), zero, 0x1));
+				sq = _mm256_add_pd(sq, _mm256_blend_pd(_mm256_permute4x64_pd(sq, 0x40), zero, 0x3));
+				sq = _mm256_add_pd(sq, carrySq);
+				_mm256_storeu_pd(squares + i, sq);
+				carrySq = _mm256_permute4x64_pd(sq, 0xFF);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const double v = input[i];
+		sums[i] = (i < channelsCount) ? v : sums[i - channelsCount] + v;
+		if (squares != nullptr)
+		{
+			squares[i] = (i < channelsCount) ? v * v : squares[i - channelsCount] + v * v;
+		}
+	}
+}
+
+/// <summary>
+/// output[i] += input[i]
+/// (column pass of integral image - add previous row)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="count"></param>
+static void Accumulate(const uint64_t * input, uint64_t * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m512i v = _mm512_add_epi64(_mm512_loadu_si512(input + i), _mm512_loadu_si512(output + i));
+		_mm512_storeu_si512(output + i, v);
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256i v = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i *>(output + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), v);
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128i v = _mm_add_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(output + i)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), v);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] += input[i];
+	}
+}
+
+static void Accumulate(const double * input, double * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm512_storeu_pd(output + i, _mm512_add_pd(_mm512_loadu_pd(input + i), _mm512_loadu_pd(output + i)));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm256_storeu_pd(output + i, _mm256_add_pd(_mm256_loadu_pd(input + i), _mm256_loadu_pd(output + i)));
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 2 <= count; i += 2)
+	{
+		_mm_storeu_pd(output + i, _mm_add_pd(_mm_loadu_pd(input + i), _mm_loadu_pd(output + i)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] += input[i];
+	}
+}
+
+//=================================================================================================
+// Element-wise min / max
+//=================================================================================================
+
+// scalar code returns b if any of values is NaN, the same as SIMD min / max instructions
+
+static void Min(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + 64 <= count; i += 64)
+	{
+		_mm512_storeu_si512(output + i, _mm512_min_epu8(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 32 <= count; i += 32)
+	{
+		__m256i v = _mm256_min_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), v);
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i v = _mm_min_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), v);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] = (a[i] < b[i]) ? a[i] : b[i];
+	}
+}
+
+static void Min(const float * a, const float * b, float * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm512_storeu_ps(output + i, _mm512_min_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm256_storeu_ps(output + i, _mm256_min_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(output + i, _mm_min_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] = (a[i] < b[i]) ? a[i] : b[i];
+	}
+}
+
+static void Max(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + 64 <= count; i += 64)
+	{
+		_mm512_storeu_si512(output + i, _mm512_max_epu8(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 32 <= count; i += 32)
+	{
+		__m256i v = _mm256_max_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), v);
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i v = _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), v);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] = (a[i] > b[i]) ? a[i] : b[i];
+	}
+}
+
+static void Max(const float * a, const float * b, float * output, size_t count)
+{
+	size_t i = 0;
+
+#if defined(HAVE_AVX512)
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm512_storeu_ps(output + i, _mm512_max_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+	}
+#elif defined(HAVE_AVX2)
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm256_storeu_ps(output + i, _mm256_max_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+#elif defined(HAVE_SSE41)
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(output + i, _mm_max_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		output[i] = (a[i] > b[i]) ? a[i] : b[i];
+	}
+}
+
+//=================================================================================================
+// Pixel shuffle
+//=================================================================================================
+
+/// <summary>
+/// Scalar shuffle of pixels in range [start, end)
+/// Input pixel is copied first, so in-place shuffle is possible
+/// </summary>
+static void ShufflePixelsScalar(const uint8_t * input, uint8_t * output, size_t start, size_t end,
+	const ImageKernels::PixelShuffle & shuffle)
+{
+	const size_t inBytes = shuffle.inputPixelBytes;
+	const size_t outBytes = shuffle.outputPixelBytes;
+
+	uint8_t px[ImageKernels::PixelShuffle::MAX_PIXEL_BYTES];
+
+	const uint8_t * in = input + start * inBytes;
+	uint8_t * out = output + start * outBytes;
+
+	for (size_t i = start; i < end; i++)
+	{
+		memcpy(px, in, inBytes);
+
+		for (size_t b = 0; b < outBytes; b++)
+		{
+			if (shuffle.source[b] == ImageKernels::PixelShuffle::CONSTANT)
+			{
+				out[b] = shuffle.constant[b];
+			}
+			else if (shuffle.source[b] != ImageKernels::PixelShuffle::KEEP)
+			{
+				out[b] = px[shuffle.source[b]];
+			}
+		}
+
+		in += inBytes;
+		out += outBytes;
+	}
+}
+
+/// <summary>
+/// Rearrange bytes of each pixel based on shuffle description
+/// Output bytes marked as KEEP are not modified, bytes marked as CONSTANT
+/// are set to shuffle.constant
+///
+/// SIMD version processes as many whole pixels as fit to 16 bytes
+/// with a single byte shuffle and blends KEEP bytes with the current output.
+/// AVX-512 version without KEEP bytes puts 4 such steps to 128-bit lanes
+/// of one register (steps must be whole 32-bit words, e.g. 3 <-> 4 channels uint8_t).
+/// Output can be same as input if output pixel is not larger than input pixel
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="shuffle"></param>
+static void ShufflePixels(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+	const ImageKernels::PixelShuffle & shuffle)
+{
+	size_t i = 0;
+
+#if defined(HAVE_SSE41)
+	const size_t inBytes = shuffle.inputPixelBytes;
+	const size_t outBytes = shuffle.outputPixelBytes;
+
+	if ((inBytes > 0) && (outBytes > 0) &&
+		(inBytes <= MM128_BYTE_COUNT) && (outBytes <= MM128_BYTE_COUNT))
+	{
+		const size_t pixelsPerStep = MinValue(MM128_BYTE_COUNT / inBytes, MM128_BYTE_COUNT / outBytes);
+		[[maybe_unused]] const size_t inStep = pixelsPerStep * inBytes;
+		const size_t outStep = pixelsPerStep * outBytes;
+
+		const size_t inSize = pixelsCount * inBytes;
+		const size_t outSize = pixelsCount * outBytes;
+
+		uint8_t shuffleData[MM128_BYTE_COUNT];
+		uint8_t keepData[MM128_BYTE_COUNT];
+		uint8_t constData[MM128_BYTE_COUNT];
+		bool hasKeep = false;
+		for (size_t b = 0; b < MM128_BYTE_COUNT; b++)
+		{
+			int8_t src = ImageKernels::PixelShuffle::KEEP;
+			if (b < outStep)
+			{
+				src = shuffle.source[b % outBytes];
+				hasKeep |= (src == ImageKernels::PixelShuffle::KEEP);
+			}
+
+			shuffleData[b] = 0x80;
+			keepData[b] = 0x00;
+			constData[b] = 0x00;
+
+			if (src == ImageKernels::PixelShuffle::KEEP)
+			{
+				keepData[b] = 0xFF;
+			}
+			else if (src == ImageKernels::PixelShuffle::CONSTANT)
+			{
+				constData[b] = shuffle.constant[b % outBytes];
+			}
+			else
+			{
+				shuffleData[b] = static_cast<uint8_t>((b / outBytes) * inBytes + src);
+			}
+		}
+
+		const __m128i sh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(shuffleData));
+		const __m128i keep = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keepData));
+		const __m128i cst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(constData));
+
+		//current output is blended to KEEP bytes and to the tail of 16-byte store
+		//(tail can be unprocessed input if data overlap, otherwise it is overwritten by next step)
+		const bool overlap = (input < output + outSize) && (output < input + inSize);
+		const bool blend = (hasKeep) || (overlap);
+
+#if defined(HAVE_AVX512)
+		if ((!hasKeep) && (inStep % 4 == 0) && (outStep % 4 == 0))
+		{
+			//4 steps in one register, step k is moved to 128-bit lane k before the shuffle
+			//and lanes are packed together after it
+			const size_t inWords = inStep / 4;
+			const size_t outWords = outStep / 4;
+
+			uint32_t inIndices[MM512_ELEMENT_COUNT];
+			uint32_t outIndices[MM512_ELEMENT_COUNT];
+			for (size_t k = 0; k < MM512_ELEMENT_COUNT; k++)
+			{
+				inIndices[k] = static_cast<uint32_t>(MinValue<size_t>((k / 4) * inWords + k % 4, 15));
+				outIndices[k] = (k < 4 * outWords) ? static_cast<uint32_t>((k / outWords) * 4 + k % outWords) : 0;
+			}
+
+			const __m512i inIdx = _mm512_loadu_si512(inIndices);
+			const __m512i outIdx = _mm512_loadu_si512(outIndices);
+			const __m512i sh4 = _mm512_broadcast_i32x4(sh);
+			const __m512i cst4 = _mm512_broadcast_i32x4(cst);
+
+			const size_t inBlock = 4 * inStep;
+			const size_t outBlock = 4 * outStep;
+			const __mmask64 inMask = (inBlock == MM512_BYTE_COUNT) ? ~__mmask64(0) : ((__mmask64(1) << inBlock) - 1);
+			const __mmask64 outMask = (outBlock == MM512_BYTE_COUNT) ? ~__mmask64(0) : ((__mmask64(1) << outBlock) - 1);
+
+			while ((i * inBytes + inBlock <= inSize) && (i * outBytes + outBlock <= outSize))
+			{
+				__m512i v = _mm512_maskz_loadu_epi8(inMask, input + i * inBytes);
+				v = _mm512_permutexvar_epi32(inIdx, v);
+				v = _mm512_or_si512(_mm512_shuffle_epi8(v, sh4), cst4);
+				v = _mm512_permutexvar_epi32(outIdx, v);
+				_mm512_mask_storeu_epi8(output + i * outBytes, outMask, v);
+
+				i += 4 * pixelsPerStep;
+			}
+		}
+#endif
+
+#if defined(HAVE_AVX2)
+		//two independent 16-byte steps in one register
+		//(byte shuffle works within 128-bit lanes)
+		const __m256i sh2 = _mm256_broadcastsi128_si256(sh);
+		const __m256i keep2 = _mm256_broadcastsi128_si256(keep);
+		const __m256i cst2 = _mm256_broadcastsi128_si256(cst);
+
+		while (((i + pixelsPerStep) * inBytes + MM128_BYTE_COUNT <= inSize) &&
+			((i + pixelsPerStep) * outBytes + MM128_BYTE_COUNT <= outSize))
+		{
+			const uint8_t * in = input + i * inBytes;
+			uint8_t * out = output + i * outBytes;
+
+			__m256i v = _mm256_set_m128i(
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + inStep)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)));
+			__m256i r = _mm256_or_si256(_mm256_shuffle_epi8(v, sh2), cst2);
+			if (blend)
+			{
+				__m256i o = _mm256_set_m128i(
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(out + outStep)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(out)));
+				r = _mm256_blendv_epi8(r, o, keep2);
+			}
+
+			//lower part first - its KEEP tail overlaps the upper part
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(r));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + outStep), _mm256_extracti128_si256(r, 1));
+
+			i += 2 * pixelsPerStep;
+		}
+#endif
+
+		while ((i * inBytes + MM128_BYTE_COUNT <= inSize) &&
+			(i * outBytes + MM128_BYTE_COUNT <= outSize))
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i * inBytes));
+
+			__m128i r = _mm_or_si128(_mm_shuffle_epi8(v, sh), cst);
+			if (blend)
+			{
+				__m128i o = _mm_loadu_si128(reinterpret_cast<const __m128i *>(output + i * outBytes));
+				r = _mm_blendv_epi8(r, o, keep);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i * outBytes), r);
+
+			i += pixelsPerStep;
+		}
+	}
+#endif
+
+	ShufflePixelsScalar(input, output, i, pixelsCount, shuffle);
+}
+
+//=================================================================================================
+// Palette
+//=================================================================================================
+
+/// <summary>
+/// Unpack bit-packed indices (MSB first, as in PNG) to one byte per index
+/// </summary>
+/// <param name="packed"></param>
+/// <param name="count">number of indices</param>
+/// <param name="bitDepth">1, 2, 4 or 8</param>
+/// <param name="indices"></param>
+static void UnpackIndices(const uint8_t * packed, size_t count, unsigned int bitDepth,
+	uint8_t * indices)
+{
+	size_t i = 0;
+
+	if (bitDepth == 8)
+	{
+		if (count > 0)
+		{
+			memcpy(indices, packed, count);
+		}
+		return;
+	}
+
+#if defined(HAVE_SSE41)
+	if (bitDepth == 1)
+	{
+		//16 packed bytes => 128 indices
+		//each byte is replicated 8x and tested against bit masks
+		const __m128i rep0 = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+		const __m128i bits = _mm_setr_epi8(
+			char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+			char(0x80), 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i two = _mm_set1_epi8(2);
+
+		for (; i + 8 * MM128_BYTE_COUNT <= count; i += 8 * MM128_BYTE_COUNT)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i / 8));
+			__m128i rep = rep0;
+			for (size_t k = 0; k < 8; k++)
+			{
+				__m128i t = _mm_and_si128(_mm_shuffle_epi8(v, rep), bits);
+				t = _mm_and_si128(_mm_cmpeq_epi8(t, bits), one);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(indices + i + k * MM128_BYTE_COUNT), t);
+				rep = _mm_add_epi8(rep, two);
+			}
+		}
+	}
+	else if (bitDepth == 2)
+	{
+		//16 packed bytes => 64 indices
+		const __m128i mask = _mm_set1_epi8(0x03);
+
+		for (; i + 4 * MM128_BYTE_COUNT <= count; i += 4 * MM128_BYTE_COUNT)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i / 4));
+			__m128i a = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+			__m128i b = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+			__m128i c = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+			__m128i d = _mm_and_si128(v, mask);
+
+			__m128i abLo = _mm_unpacklo_epi8(a, b);
+			__m128i abHi = _mm_unpackhi_epi8(a, b);
+			__m128i cdLo = _mm_unpacklo_epi8(c, d);
+			__m128i cdHi = _mm_unpackhi_epi8(c, d);
+
+			__m128i * out = reinterpret_cast<__m128i *>(indices + i);
+			_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(abLo, cdLo));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(abLo, cdLo));
+			_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(abHi, cdHi));
+			_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(abHi, cdHi));
+		}
+	}
+	else if (bitDepth == 4)
+	{
+		//16 packed bytes => 32 indices
+		const __m128i mask = _mm_set1_epi8(0x0F);
+
+		for (; i + 2 * MM128_BYTE_COUNT <= count; i += 2 * MM128_BYTE_COUNT)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i / 2));
+			__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+			__m128i lo = _mm_and_si128(v, mask);
+
+			__m128i * out = reinterpret_cast<__m128i *>(indices + i);
+			_mm_storeu_si128(out + 0, _mm_unpacklo_epi8(hi, lo));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi8(hi, lo));
+		}
+	}
+#endif
+
+	if (bitDepth == 1)
+	{
+		for (; i < count; i++)
+		{
+			indices[i] = (packed[i >> 3] >> (7 - (i & 7))) & 0x01;
+		}
+	}
+	else if (bitDepth == 2)
+	{
+		for (; i < count; i++)
+		{
+			indices[i] = (packed[i >> 2] >> (6 - 2 * (i & 3))) & 0x03;
+		}
+	}
+	else if (bitDepth == 4)
+	{
+		for (; i < count; i++)
+		{
+			indices[i] = (packed[i >> 1] >> (4 - 4 * (i & 1))) & 0x0F;
+		}
+	}
+}
+
+/// <summary>
+/// Scalar palette expansion of indices in range [start, end)
+/// </summary>
+template <size_t C>
+static void ExpandPaletteScalar(const uint8_t * indices, size_t start, size_t end,
+	const uint8_t * palette, uint8_t * output)
+{
+	for (size_t i = start; i < end; i++)
+	{
+		memcpy(output + i * C, palette + indices[i] * C, C);
+	}
+}
+
+/// <summary>
+/// Write palette colors for indices to output
+/// Palette has paletteSize entries with channelsCount bytes each
+/// and all indices must be smaller than paletteSize
+///
+/// Palettes with at most 16 entries are expanded with
+/// byte shuffles (palette is kept in registers)
+/// </summary>
+/// <param name="indices"></param>
+/// <param name="count"></param>
+/// <param name="palette"></param>
+/// <param name="paletteSize"></param>
+/// <param name="channelsCount">1 - 4</param>
+/// <param name="output"></param>
+static void ExpandPalette(const uint8_t * indices, size_t count, const uint8_t * palette,
+	[[maybe_unused]] size_t paletteSize, size_t channelsCount, uint8_t * output)
+{
+	size_t i = 0;
+
+#if defined(HAVE_SSE41)
+	if (paletteSize <= 16)
+	{
+		//one 16-entry table per channel
+		uint8_t lutData[4][16];
+		memset(lutData, 0, sizeof(lutData));
+		for (size_t p = 0; p < paletteSize; p++)
+		{
+			for (size_t c = 0; c < channelsCount; c++)
+			{
+				lutData[c][p] = palette[p * channelsCount + c];
+			}
+		}
+
+		__m128i lut[4];
+		for (size_t c = 0; c < 4; c++)
+		{
+			lut[c] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lutData[c]));
+		}
+
+		if (channelsCount == 1)
+		{
+#if defined(HAVE_AVX2)
+			const __m256i lut2 = _mm256_broadcastsi128_si256(lut[0]);
+			for (; i + MM256_BYTE_COUNT <= count; i += MM256_BYTE_COUNT)
+			{
+				__m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), _mm256_shuffle_epi8(lut2, idx));
+			}
+#endif
+			for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+			{
+				__m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_shuffle_epi8(lut[0], idx));
+			}
+		}
+		else if (channelsCount == 2)
+		{
+			for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+			{
+				__m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i));
+				__m128i c0 = _mm_shuffle_epi8(lut[0], idx);
+				__m128i c1 = _mm_shuffle_epi8(lut[1], idx);
+
+				__m128i * out = reinterpret_cast<__m128i *>(output + i * 2);
+				_mm_storeu_si128(out + 0, _mm_unpacklo_epi8(c0, c1));
+				_mm_storeu_si128(out + 1, _mm_unpackhi_epi8(c0, c1));
+			}
+		}
+		else if ((channelsCount == 3) || (channelsCount == 4))
+		{
+			//build 4 channel pixels, for 3 channels drop every 4th byte
+			const __m128i drop = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+				char(0x80), char(0x80), char(0x80), char(0x80));
+
+			//3 channel output is written with 16-byte stores that
+			//overlap 4 bytes behind the block
+			const size_t extra = (channelsCount == 3) ? 4 : 0;
+
+			while ((i + MM128_BYTE_COUNT) * channelsCount + extra <= count * channelsCount)
+			{
+				__m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i));
+				__m128i c0 = _mm_shuffle_epi8(lut[0], idx);
+				__m128i c1 = _mm_shuffle_epi8(lut[1], idx);
+				__m128i c2 = _mm_shuffle_epi8(lut[2], idx);
+				__m128i c3 = _mm_shuffle_epi8(lut[3], idx);
+
+				__m128i c01Lo = _mm_unpacklo_epi8(c0, c1);
+				__m128i c01Hi = _mm_unpackhi_epi8(c0, c1);
+				__m128i c23Lo = _mm_unpacklo_epi8(c2, c3);
+				__m128i c23Hi = _mm_unpackhi_epi8(c2, c3);
+
+				__m128i px[4] = {
+					_mm_unpacklo_epi16(c01Lo, c23Lo),
+					_mm_unpackhi_epi16(c01Lo, c23Lo),
+					_mm_unpacklo_epi16(c01Hi, c23Hi),
+					_mm_unpackhi_epi16(c01Hi, c23Hi)
+				};
+
+				uint8_t * out = output + i * channelsCount;
+				for (size_t k = 0; k < 4; k++)
+				{
+					if (channelsCount == 4)
+					{
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(out + k * 16), px[k]);
+					}
+					else
+					{
+						_mm_storeu_si128(reinterpret_cast<__m128i *>(out + k * 12), _mm_shuffle_epi8(px[k], drop));
+					}
+				}
+
+				i += MM128_BYTE_COUNT;
+			}
+		}
+	}
+#if defined(HAVE_AVX2)
+	else if (channelsCount == 4)
+	{
+		//large palette - gather whole pixels
+		const int * table = reinterpret_cast<const int *>(palette);
+		for (; i + MM256_ELEMENT_COUNT <= count; i += MM256_ELEMENT_COUNT)
+		{
+			__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(indices + i)));
+			__m256i px = _mm256_i32gather_epi32(table, idx, 4);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i * 4), px);
+		}
+	}
+#endif
+#endif
+
+	switch (channelsCount)
+	{
+	case 1: ExpandPaletteScalar<1>(indices, i, count, palette, output); break;
+	case 2: ExpandPaletteScalar<2>(indices, i, count, palette, output); break;
+	case 3: ExpandPaletteScalar<3>(indices, i, count, palette, output); break;
+	case 4: ExpandPaletteScalar<4>(indices, i, count, palette, output); break;
+	default: break;
+	}
+}
+
+//=================================================================================================
+// Layout conversion
+//=================================================================================================
+
+/// <summary>
+/// Scalar deinterleave of pixels in range [start, pixelsCount)
+/// </summary>
+template <typename T>
+static void DeinterleaveScalar(const T * input, size_t start, size_t pixelsCount, size_t channelsCount,
+	T * output)
+{
+	for (size_t c = 0; c < channelsCount; c++)
+	{
+		T * plane = output + c * pixelsCount;
+		for (size_t i = start; i < pixelsCount; i++)
+		{
+			plane[i] = input[i * channelsCount + c];
+		}
+	}
+}
+
+/// <summary>
+/// Scalar interleave of pixels in range [start, pixelsCount)
+/// </summary>
+template <typename T>
+static void InterleaveScalar(const T * input, size_t start, size_t pixelsCount, size_t channelsCount,
+	T * output)
+{
+	for (size_t c = 0; c < channelsCount; c++)
+	{
+		const T * plane = input + c * pixelsCount;
+		for (size_t i = start; i < pixelsCount; i++)
+		{
+			output[i * channelsCount + c] = plane[i];
+		}
+	}
+}
+
+#if defined(HAVE_SSE41)
+
+/// <summary>
+/// Transpose 4x4 block of 32-bit values
+/// </summary>
+static inline void Transpose4x4(__m128i & a, __m128i & b, __m128i & c, __m128i & d)
+{
+	__m128i t0 = _mm_unpacklo_epi32(a, b);
+	__m128i t1 = _mm_unpackhi_epi32(a, b);
+	__m128i t2 = _mm_unpacklo_epi32(c, d);
+	__m128i t3 = _mm_unpackhi_epi32(c, d);
+
+	a = _mm_unpacklo_epi64(t0, t2);
+	b = _mm_unpackhi_epi64(t0, t2);
+	c = _mm_unpacklo_epi64(t1, t3);
+	d = _mm_unpackhi_epi64(t1, t3);
+}
+
+#endif
+
+/// <summary>
+/// Convert interleaved data to planar
+/// (output has channelsCount planes with pixelsCount values each)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="output"></param>
+static void Deinterleave(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+	uint8_t * output)
+{
+	size_t i = 0;
+
+	if (channelsCount == 1)
+	{
+		if (pixelsCount > 0)
+		{
+			memcpy(output, input, pixelsCount);
+		}
+		return;
+	}
+
+#if defined(HAVE_SSE41)
+	uint8_t * p0 = output;
+	uint8_t * p1 = output + pixelsCount;
+	uint8_t * p2 = output + 2 * pixelsCount;
+	uint8_t * p3 = output + 3 * pixelsCount;
+
+	if (channelsCount == 2)
+	{
+		const __m128i sh = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+		for (; i + MM128_BYTE_COUNT <= pixelsCount; i += MM128_BYTE_COUNT)
+		{
+			__m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i * 2)), sh);
+			__m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i * 2 + 16)), sh);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(p0 + i), _mm_unpacklo_epi64(a, b));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(p1 + i), _mm_unpackhi_epi64(a, b));
+		}
+	}
+	else if ((channelsCount == 3) || (channelsCount == 4))
+	{
+		//group channels of 4 pixels, then transpose 4 groups
+		//3 channels are loaded by 12 bytes - last load reads 4 bytes behind the block
+		const __m128i sh = (channelsCount == 4) ?
+			_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15) :
+			_mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11,
+				char(0x80), char(0x80), char(0x80), char(0x80));
+		const size_t step = 4 * channelsCount;
+		const size_t extra = (channelsCount == 3) ? 4 : 0;
+
+		while ((i + MM128_BYTE_COUNT) * channelsCount + extra <= pixelsCount * channelsCount)
+		{
+			const uint8_t * in = input + i * channelsCount;
+			__m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)), sh);
+			__m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + step)), sh);
+			__m128i c = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * step)), sh);
+			__m128i d = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 3 * step)), sh);
+
+			Transpose4x4(a, b, c, d);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(p0 + i), a);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(p1 + i), b);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(p2 + i), c);
+			if (channelsCount == 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(p3 + i), d);
+			}
+
+			i += MM128_BYTE_COUNT;
+		}
+	}
+#endif
+
+	DeinterleaveScalar(input, i, pixelsCount, channelsCount, output);
+}
+
+static void Deinterleave(const float * input, size_t pixelsCount, size_t channelsCount,
+	float * output)
+{
+	size_t i = 0;
+
+	if (channelsCount == 1)
+	{
+		if (pixelsCount > 0)
+		{
+			memcpy(output, input, pixelsCount * sizeof(float));
+		}
+		return;
+	}
+
+#if defined(HAVE_SSE41)
+	float * p0 = output;
+	float * p1 = output + pixelsCount;
+	float * p2 = output + 2 * pixelsCount;
+	float * p3 = output + 3 * pixelsCount;
+
+	if (channelsCount == 2)
+	{
+		for (; i + MM128_ELEMENT_COUNT <= pixelsCount; i += MM128_ELEMENT_COUNT)
+		{
+			__m128 a = _mm_loadu_ps(input + i * 2);
+			__m128 b = _mm_loadu_ps(input + i * 2 + 4);
+			_mm_storeu_ps(p0 + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(p1 + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+	else if (channelsCount == 3)
+	{
+		//a = [r0 g0 b0 r1], b = [g1 b1 r2 g2], c = [b2 r3 g3 b3]
+		for (; i + MM128_ELEMENT_COUNT <= pixelsCount; i += MM128_ELEMENT_COUNT)
+		{
+			__m128 a = _mm_loadu_ps(input + i * 3);
+			__m128 b = _mm_loadu_ps(input + i * 3 + 4);
+			__m128 c = _mm_loadu_ps(input + i * 3 + 8);
+
+			__m128 r = _mm_blend_ps(_mm_blend_ps(a, b, 0x4), c, 0x2);
+			__m128 g = _mm_blend_ps(_mm_blend_ps(a, b, 0x9), c, 0x4);
+			__m128 bb = _mm_blend_ps(_mm_blend_ps(a, b, 0x2), c, 0x9);
+
+			_mm_storeu_ps(p0 + i, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 2, 3, 0)));
+			_mm_storeu_ps(p1 + i, _mm_shuffle_ps(g, g, _MM_SHUFFLE(2, 3, 0, 1)));
+			_mm_storeu_ps(p2 + i, _mm_shuffle_ps(bb, bb, _MM_SHUFFLE(3, 0, 1, 2)));
+		}
+	}
+	else if (channelsCount == 4)
+	{
+		for (; i + MM128_ELEMENT_COUNT <= pixelsCount; i += MM128_ELEMENT_COUNT)
+		{
+			__m128 a = _mm_loadu_ps(input + i * 4);
+			__m128 b = _mm_loadu_ps(input + i * 4 + 4);
+			__m128 c = _mm_loadu_ps(input + i * 4 + 8);
+			__m128 d = _mm_loadu_ps(input + i * 4 + 12);
+
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+
+			_mm_storeu_ps(p0 + i, a);
+			_mm_storeu_ps(p1 + i, b);
+			_mm_storeu_ps(p2 + i, c);
+			_mm_storeu_ps(p3 + i, d);
+		}
+	}
+#endif
+
+	DeinterleaveScalar(input, i, pixelsCount, channelsCount, output);
+}
+
+/// <summary>
+/// Convert planar data to interleaved
+/// (input has channelsCount planes with pixelsCount values each)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="channelsCount"></param>
+/// <param name="output"></param>
+static void Interleave(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+	uint8_t * output)
+{
+	size_t i = 0;
+
+	if (channelsCount == 1)
+	{
+		if (pixelsCount > 0)
+		{
+			memcpy(output, input, pixelsCount);
+		}
+		return;
+	}
+
+#if defined(HAVE_SSE41)
+	const uint8_t * p0 = input;
+	const uint8_t * p1 = input + pixelsCount;
+	const uint8_t * p2 = input + 2 * pixelsCount;
+	const uint8_t * p3 = input + 3 * pixelsCount;
+
+	if (channelsCount == 2)
+	{
+		for (; i + MM128_BYTE_COUNT <= pixelsCount; i += MM128_BYTE_COUNT)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p0 + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p1 + i));
+			__m128i * out = reinterpret_cast<__m128i *>(output + i * 2);
+			_mm_storeu_si128(out + 0, _mm_unpacklo_epi8(a, b));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi8(a, b));
+		}
+	}
+	else if ((channelsCount == 3) || (channelsCount == 4))
+	{
+		//build 4 channel pixels, for 3 channels drop every 4th byte
+		//(16-byte stores overlap 4 bytes behind the block)
+		const __m128i drop = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+			char(0x80), char(0x80), char(0x80), char(0x80));
+		const size_t extra = (channelsCount == 3) ? 4 : 0;
+
+		while ((i + MM128_BYTE_COUNT) * channelsCount + extra <= pixelsCount * channelsCount)
+		{
+			__m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p0 + i));
+			__m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p1 + i));
+			__m128i c2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p2 + i));
+			__m128i c3 = (channelsCount == 4) ?
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(p3 + i)) :
+				_mm_setzero_si128();
+
+			__m128i c01Lo = _mm_unpacklo_epi8(c0, c1);
+			__m128i c01Hi = _mm_unpackhi_epi8(c0, c1);
+			__m128i c23Lo = _mm_unpacklo_epi8(c2, c3);
+			__m128i c23Hi = _mm_unpackhi_epi8(c2, c3);
+
+			__m128i px[4] = {
+				_mm_unpacklo_epi16(c01Lo, c23Lo),
+				_mm_unpackhi_epi16(c01Lo, c23Lo),
+				_mm_unpacklo_epi16(c01Hi, c23Hi),
+				_mm_unpackhi_epi16(c01Hi, c23Hi)
+			};
+
+			uint8_t * out = output + i * channelsCount;
+			for (size_t k = 0; k < 4; k++)
+			{
+				if (channelsCount == 4)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + k * 16), px[k]);
+				}
+				else
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(out + k * 12), _mm_shuffle_epi8(px[k], drop));
+				}
+			}
+
+			i += MM128_BYTE_COUNT;
+		}
+	}
+#endif
+
+	InterleaveScalar(input, i, pixelsCount, channelsCount, output);
+}
+
+static void Interleave(const float * input, size_t pixelsCount, size_t channelsCount,
+	float * output)
+{
+	size_t i = 0;
+
+	if (channelsCount == 1)
+	{
+		if (pixelsCount > 0)
+		{
+			memcpy(output, input, pixelsCount * sizeof(float));
+		}
+		return;
+	}
+
+#if defined(HAVE_SSE41)
+	const float * p0 = input;
+	const float * p1 = input + pixelsCount;
+	const float * p2 = input + 2 * pixelsCount;
+	const float * p3 = input + 3 * pixelsCount;
+
+	if (channelsCount == 2)
+	{
+		for (; i + MM128_ELEMENT_COUNT <= pixelsCount; i += MM128_ELEMENT_COUNT)
+		{
+			__m128 a = _mm_loadu_ps(p0 + i);
+			__m128 b = _mm_loadu_ps(p1 + i);
+			_mm_storeu_ps(output + i * 2, _mm_unpacklo_ps(a, b));
+			_mm_storeu_ps(output + i * 2 + 4, _mm_unpackhi_ps(a, b));
+		}
+	}
+	else if (channelsCount == 3)
+	{
+		//inverse of Deinterleave - permute planes, then blend them together
+		for (; i + MM128_ELEMENT_COUNT <= pixelsCount; i += MM128_ELEMENT_COUNT)
+		{
+			__m128 r = _mm_loadu_ps(p0 + i);
+			__m128 g = _mm_loadu_ps(p1 + i);
+			__m128 b = _mm_loadu_ps(p2 + i);
+
+			r = _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 2, 3, 0));
+			g = _mm_shuffle_ps(g, g, _MM_SHUFFLE(2, 3, 0, 1));
+			b = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 1, 2));
+
+			_mm_storeu_ps(output + i * 3, _mm_blend_ps(_mm_blend_ps(r, g, 0x2), b, 0x4));
+			_mm_storeu_ps(output + i * 3 + 4, _mm_blend_ps(_mm_blend_ps(g, b, 0x2), r, 0x4));
+			_mm_storeu_ps(output + i * 3 + 8, _mm_blend_ps(_mm_blend_ps(b, r, 0x2), g, 0x4));
+		}
+	}
+	else if (channelsCount == 4)
+	{
+		for (; i + MM128_ELEMENT_COUNT <= pixelsCount; i += MM128_ELEMENT_COUNT)
+		{
+			__m128 a = _mm_loadu_ps(p0 + i);
+			__m128 b = _mm_loadu_ps(p1 + i);
+			__m128 c = _mm_loadu_ps(p2 + i);
+			__m128 d = _mm_loadu_ps(p3 + i);
+
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+
+			_mm_storeu_ps(output + i * 4, a);
+			_mm_storeu_ps(output + i * 4 + 4, b);
+			_mm_storeu_ps(output + i * 4 + 8, c);
+			_mm_storeu_ps(output + i * 4 + 12, d);
+		}
+	}
+#endif
+
+	InterleaveScalar(input, i, pixelsCount, channelsCount, output);
+}
+
+//=================================================================================================
+// Alpha
+//=================================================================================================
+
+//Alpha is the last channel of interleaved RGBA pixel
+//uint8_t colors are rounded: Div255(x) = round(x / 255), exact for x in [0, 255 * 255]
+
+static inline uint32_t Div255(uint32_t x)
+{
+	return ((x + 128) * 257) >> 16;
+}
+
+#if defined(HAVE_SSE41)
+
+//byte shuffle that copies alpha byte to all bytes of RGBA pixel
+static const uint8_t ALPHA_BROADCAST[MM128_BYTE_COUNT] = {
+	3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15
+};
+
+//bytes of alpha channel in 16 bytes of RGBA pixels
+static const uint8_t ALPHA_SELECT[MM128_BYTE_COUNT] = {
+	0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF, 0, 0, 0, 0xFF
+};
+
+/// <summary>
+/// round(a * b / 255) of 8 16-bit values (a * b <= 255 * 255)
+/// </summary>
+static inline __m128i MulDiv255(__m128i a, __m128i b)
+{
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+	return _mm_mulhi_epu16(t, _mm_set1_epi16(257));
+}
+
+#endif
+
+#if defined(HAVE_AVX2)
+
+static inline __m256i MulDiv255(__m256i a, __m256i b)
+{
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+	return _mm256_mulhi_epu16(t, _mm256_set1_epi16(257));
+}
+
+#endif
+
+#if defined(HAVE_AVX512)
+
+static inline __m512i MulDiv255(__m512i a, __m512i b)
+{
+	__m512i t = _mm512_add_epi16(_mm512_mullo_epi16(a, b), _mm512_set1_epi16(128));
+	return _mm512_mulhi_epu16(t, _mm512_set1_epi16(257));
+}
+
+#endif
+
+/// <summary>
+/// Multiply colors of RGBA pixels by alpha
+/// c = round(c * a / 255), alpha is not changed
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+static void PremultiplyAlpha(uint8_t * data, size_t pixelsCount)
+{
+	size_t i = 0;
+	const size_t count = pixelsCount * 4;
+
+#if defined(HAVE_SSE41)
+	const __m128i alphaBroadcast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ALPHA_BROADCAST));
+	const __m128i alphaSelect = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ALPHA_SELECT));
+#endif
+
+#if defined(HAVE_AVX512)
+	const __m512i alphaBroadcast4 = _mm512_broadcast_i32x4(alphaBroadcast);
+	const __m512i zero = _mm512_setzero_si512();
+	for (; i + MM512_BYTE_COUNT <= count; i += MM512_BYTE_COUNT)
+	{
+		__m512i v = _mm512_loadu_si512(data + i);
+		__m512i a = _mm512_shuffle_epi8(v, alphaBroadcast4);
+		__m512i lo = MulDiv255(_mm512_unpacklo_epi8(v, zero), _mm512_unpacklo_epi8(a, zero));
+		__m512i hi = MulDiv255(_mm512_unpackhi_epi8(v, zero), _mm512_unpackhi_epi8(a, zero));
+		__m512i r = _mm512_mask_blend_epi8(__mmask64(0x8888888888888888ULL), _mm512_packus_epi16(lo, hi), v);
+		_mm512_storeu_si512(data + i, r);
+	}
+#elif defined(HAVE_AVX2)
+	const __m256i alphaBroadcast2 = _mm256_broadcastsi128_si256(alphaBroadcast);
+	const __m256i alphaSelect2 = _mm256_broadcastsi128_si256(alphaSelect);
+	const __m256i zero = _mm256_setzero_si256();
+	for (; i + MM256_BYTE_COUNT <= count; i += MM256_BYTE_COUNT)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		__m256i a = _mm256_shuffle_epi8(v, alphaBroadcast2);
+		__m256i lo = MulDiv255(_mm256_unpacklo_epi8(v, zero), _mm256_unpacklo_epi8(a, zero));
+		__m256i hi = MulDiv255(_mm256_unpackhi_epi8(v, zero), _mm256_unpackhi_epi8(a, zero));
+		__m256i r = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), v, alphaSelect2);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), r);
+	}
+#endif
+
+#if defined(HAVE_SSE41)
+	for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		__m128i a = _mm_shuffle_epi8(v, alphaBroadcast);
+		__m128i lo = MulDiv255(_mm_cvtepu8_epi16(v), _mm_cvtepu8_epi16(a));
+		__m128i hi = MulDiv255(_mm_unpackhi_epi8(v, _mm_setzero_si128()), _mm_unpackhi_epi8(a, _mm_setzero_si128()));
+		__m128i r = _mm_blendv_epi8(_mm_packus_epi16(lo, hi), v, alphaSelect);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), r);
+	}
+#endif
+
+	for (; i < count; i += 4)
+	{
+		const uint32_t a = data[i + 3];
+		data[i] = static_cast<uint8_t>(Div255(data[i] * a));
+		data[i + 1] = static_cast<uint8_t>(Div255(data[i + 1] * a));
+		data[i + 2] = static_cast<uint8_t>(Div255(data[i + 2] * a));
+	}
+}
+
+static void PremultiplyAlpha(float * data, size_t pixelsCount)
+{
+	for (size_t i = 0; i < pixelsCount * 4; i += 4)
+	{
+		const float a = data[i + 3];
+		data[i] *= a;
+		data[i + 1] *= a;
+		data[i + 2] *= a;
+	}
+}
+
+/// <summary>
+/// Divide colors of RGBA pixels by alpha
+/// c = min(255, round(c * 255 / a)), c = 0 for a = 0, alpha is not changed
+/// SIMD version divides in float (exact for valid premultiplied colors c <= a)
+/// </summary>
+/// <param name="data"></param>
+/// <param name="pixelsCount"></param>
+static void UnpremultiplyAlpha(uint8_t * data, size_t pixelsCount)
+{
+	size_t i = 0;
+	const size_t count = pixelsCount * 4;
+
+#if defined(HAVE_SSE41)
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 maxValue = _mm_set1_ps(255.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + MM128_BYTE_COUNT <= count; i += MM128_BYTE_COUNT)
+	{
+		__m128i px[4];
+
+		for (size_t k = 0; k < 4; k++)
+		{
+			uint32_t p;
+			memcpy(&p, data + i + k * 4, sizeof(uint32_t));
+			__m128 c = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(p))));
+
+			__m128 a = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 r = _mm_add_ps(_mm_div_ps(_mm_mul_ps(c, scale), a), half);
+			r = _mm_min_ps(r, maxValue);
+			r = _mm_and_ps(r, _mm_cmpneq_ps(a, zero));
+			r = _mm_blend_ps(r, c, 0x8);
+			px[k] = _mm_cvttps_epi32(r);
+		}
+
+		__m128i r = _mm_packus_epi16(_mm_packus_epi32(px[0], px[1]), _mm_packus_epi32(px[2], px[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), r);
+	}
+#endif
+
+	for (; i < count; i += 4)
+	{
+		const uint32_t a = data[i + 3];
+		for (size_t c = 0; c < 3; c++)
+		{
+			data[i + c] = (a == 0) ? 0 : static_cast<uint8_t>(MinValue<uint32_t>(255, (data[i + c] * 255 + a / 2) / a));
+		}
+	}
+}
+
+static void UnpremultiplyAlpha(float * data, size_t pixelsCount)
+{
+	for (size_t i = 0; i < pixelsCount * 4; i += 4)
+	{
+		const float a = data[i + 3];
+		const float inv = (a == 0.0f) ? 0.0f : 1.0f / a;
+		data[i] *= inv;
+		data[i + 1] *= inv;
+		data[i + 2] *= inv;
+	}
+}
+
+/// <summary>
+/// Porter-Duff "over" of premultiplied RGBA source onto destination
+/// d = s + round(d * (255 - sa) / 255) for each channel
+/// Destination is premultiplied RGBA (dstChannelsCount 4) or opaque RGB (dstChannelsCount 3)
+/// </summary>
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="dstChannelsCount">3 or 4</param>
+static void BlendOver(const uint8_t * src, uint8_t * dst, size_t pixelsCount, size_t dstChannelsCount)
+{
+	size_t i = 0;
+
+#if defined(HAVE_SSE41)
+	const __m128i alphaBroadcast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ALPHA_BROADCAST));
+	const __m128i ones = _mm_set1_epi8(-1);
+
+	if (dstChannelsCount == 4)
+	{
+		const size_t count = pixelsCount * 4;
+		size_t b = 0;
+
+#if defined(HAVE_AVX512)
+		const __m512i alphaBroadcast4 = _mm512_broadcast_i32x4(alphaBroadcast);
+		const __m512i ones4 = _mm512_set1_epi8(-1);
+		const __m512i zero = _mm512_setzero_si512();
+		for (; b + MM512_BYTE_COUNT <= count; b += MM512_BYTE_COUNT)
+		{
+			__m512i s = _mm512_loadu_si512(src + b);
+			__m512i d = _mm512_loadu_si512(dst + b);
+			__m512i ia = _mm512_xor_si512(_mm512_shuffle_epi8(s, alphaBroadcast4), ones4);
+			__m512i lo = MulDiv255(_mm512_unpacklo_epi8(d, zero), _mm512_unpacklo_epi8(ia, zero));
+			__m512i hi = MulDiv255(_mm512_unpackhi_epi8(d, zero), _mm512_unpackhi_epi8(ia, zero));
+			_mm512_storeu_si512(dst + b, _mm512_adds_epu8(s, _mm512_packus_epi16(lo, hi)));
+		}
+#elif defined(HAVE_AVX2)
+		const __m256i alphaBroadcast2 = _mm256_broadcastsi128_si256(alphaBroadcast);
+		const __m256i ones2 = _mm256_set1_epi8(-1);
+		const __m256i zero = _mm256_setzero_si256();
+		for (; b + MM256_BYTE_COUNT <= count; b += MM256_BYTE_COUNT)
+		{
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + b));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + b));
+			__m256i ia = _mm256_xor_si256(_mm256_shuffle_epi8(s, alphaBroadcast2), ones2);
+			__m256i lo = MulDiv255(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(ia, zero));
+			__m256i hi = MulDiv255(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(ia, zero));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + b), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+		}
+#endif
+
+		for (; b + MM128_BYTE_COUNT <= count; b += MM128_BYTE_COUNT)
+		{
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + b));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + b));
+			__m128i ia = _mm_xor_si128(_mm_shuffle_epi8(s, alphaBroadcast), ones);
+			__m128i lo = MulDiv255(_mm_cvtepu8_epi16(d), _mm_cvtepu8_epi16(ia));
+			__m128i hi = MulDiv255(_mm_unpackhi_epi8(d, _mm_setzero_si128()), _mm_unpackhi_epi8(ia, _mm_setzero_si128()));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + b), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+		}
+
+		i = b / 4;
+	}
+	else if (dstChannelsCount == 3)
+	{
+		//4 RGB pixels are expanded to RGBA, blended and packed back
+		//(16 bytes are loaded and stored, last 4 bytes are not changed)
+		const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		const __m128i tail = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1);
+
+		for (; (i + 4) * 3 + 4 <= pixelsCount * 3; i += 4)
+		{
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+			__m128i d3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 3));
+			__m128i d = _mm_shuffle_epi8(d3, expand);
+			__m128i ia = _mm_xor_si128(_mm_shuffle_epi8(s, alphaBroadcast), ones);
+			__m128i lo = MulDiv255(_mm_cvtepu8_epi16(d), _mm_cvtepu8_epi16(ia));
+			__m128i hi = MulDiv255(_mm_unpackhi_epi8(d, _mm_setzero_si128()), _mm_unpackhi_epi8(ia, _mm_setzero_si128()));
+			__m128i r = _mm_shuffle_epi8(_mm_adds_epu8(s, _mm_packus_epi16(lo, hi)), pack);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3), _mm_blendv_epi8(r, d3, tail));
+		}
+	}
+#endif
+
+	for (; i < pixelsCount; i++)
+	{
+		const uint8_t * s = src + i * 4;
+		uint8_t * d = dst + i * dstChannelsCount;
+		const uint32_t ia = 255 - s[3];
+		for (size_t c = 0; c < dstChannelsCount; c++)
+		{
+			d[c] = static_cast<uint8_t>(MinValue<uint32_t>(255, s[c] + Div255(d[c] * ia)));
+		}
+	}
+}
+
+static void BlendOver(const float * src, float * dst, size_t pixelsCount, size_t dstChannelsCount)
+{
+	for (size_t i = 0; i < pixelsCount; i++)
+	{
+		const float * s = src + i * 4;
+		float * d = dst + i * dstChannelsCount;
+		const float ia = 1.0f - s[3];
+		for (size_t c = 0; c < dstChannelsCount; c++)
+		{
+			d[c] = s[c] + d[c] * ia;
+		}
+	}
+}
+
+//=================================================================================================
+// Geometric transforms
+//=================================================================================================
+
+/// <summary>
+/// Scalar transpose of block part x in [x0, x1), y in [y0, y1)
+/// Output rows are written one after another
+/// </summary>
+template <size_t PIXEL_BYTES>
+static void TransposeScalarFixed(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride, size_t x0, size_t x1, size_t y0, size_t y1)
+{
+	for (size_t x = x0; x < x1; x++)
+	{
+		const uint8_t * in = input + ptrdiff_t(y0) * inputStride + x * PIXEL_BYTES;
+		uint8_t * out = output + ptrdiff_t(x) * outputStride + y0 * PIXEL_BYTES;
+		for (size_t y = y0; y < y1; y++)
+		{
+			memcpy(out, in, PIXEL_BYTES);
+			in += inputStride;
+			out += PIXEL_BYTES;
+		}
+	}
+}
+
+static void TransposeScalar(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride, size_t x0, size_t x1, size_t y0, size_t y1,
+	size_t pixelBytes)
+{
+	if ((x0 >= x1) || (y0 >= y1))
+	{
+		return;
+	}
+
+	switch (pixelBytes)
+	{
+	case 1: TransposeScalarFixed<1>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	case 2: TransposeScalarFixed<2>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	case 3: TransposeScalarFixed<3>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	case 4: TransposeScalarFixed<4>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	case 8: TransposeScalarFixed<8>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	case 12: TransposeScalarFixed<12>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	case 16: TransposeScalarFixed<16>(input, inputStride, output, outputStride, x0, x1, y0, y1); return;
+	default: break;
+	}
+
+	for (size_t x = x0; x < x1; x++)
+	{
+		for (size_t y = y0; y < y1; y++)
+		{
+			memcpy(output + ptrdiff_t(x) * outputStride + y * pixelBytes,
+				input + ptrdiff_t(y) * inputStride + x * pixelBytes, pixelBytes);
+		}
+	}
+}
+
+#if defined(HAVE_SSE41)
+
+/// <summary>
+/// Reverse of bits of index (registers of unpack transpose
+/// hold columns in bit-reversed order)
+/// </summary>
+static inline size_t BitReverse(size_t v, size_t bits)
+{
+	size_t r = 0;
+	for (size_t i = 0; i < bits; i++)
+	{
+		r = (r << 1) | ((v >> i) & 1);
+	}
+	return r;
+}
+
+/// <summary>
+/// In-register transpose of 16x16 bytes
+/// 4 rounds of pairwise unpacks with 8, 16, 32, 64-bit elements
+/// </summary>
+static inline void TransposeBlock16x16U8(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride)
+{
+	__m128i r[16];
+	__m128i t[16];
+	for (size_t i = 0; i < 16; i++)
+	{
+		r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + ptrdiff_t(i) * inputStride));
+	}
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		t[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+		t[i + 8] = _mm_unpackhi_epi8(r[2 * i], r[2 * i + 1]);
+	}
+	for (size_t i = 0; i < 8; i++)
+	{
+		r[i] = _mm_unpacklo_epi16(t[2 * i], t[2 * i + 1]);
+		r[i + 8] = _mm_unpackhi_epi16(t[2 * i], t[2 * i + 1]);
+	}
+	for (size_t i = 0; i < 8; i++)
+	{
+		t[i] = _mm_unpacklo_epi32(r[2 * i], r[2 * i + 1]);
+		t[i + 8] = _mm_unpackhi_epi32(r[2 * i], r[2 * i + 1]);
+	}
+	for (size_t i = 0; i < 8; i++)
+	{
+		r[i] = _mm_unpacklo_epi64(t[2 * i], t[2 * i + 1]);
+		r[i + 8] = _mm_unpackhi_epi64(t[2 * i], t[2 * i + 1]);
+	}
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + ptrdiff_t(BitReverse(i, 4)) * outputStride), r[i]);
+	}
+}
+
+/// <summary>
+/// In-register transpose of 8x8 16-bit values
+/// </summary>
+static inline void TransposeBlock8x8U16(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride)
+{
+	__m128i r[8];
+	__m128i t[8];
+	for (size_t i = 0; i < 8; i++)
+	{
+		r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + ptrdiff_t(i) * inputStride));
+	}
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		t[i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+		t[i + 4] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+	}
+	for (size_t i = 0; i < 4; i++)
+	{
+		r[i] = _mm_unpacklo_epi32(t[2 * i], t[2 * i + 1]);
+		r[i + 4] = _mm_unpackhi_epi32(t[2 * i], t[2 * i + 1]);
+	}
+	for (size_t i = 0; i < 4; i++)
+	{
+		t[i] = _mm_unpacklo_epi64(r[2 * i], r[2 * i + 1]);
+		t[i + 4] = _mm_unpackhi_epi64(r[2 * i], r[2 * i + 1]);
+	}
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(output + ptrdiff_t(BitReverse(i, 3)) * outputStride), t[i]);
+	}
+}
+
+#if defined(HAVE_AVX2)
+
+/// <summary>
+/// In-register transpose of 8x8 32-bit values
+/// unpacks within 128-bit lanes, lanes are exchanged at the end
+/// </summary>
+static inline void TransposeBlock8x8U32(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride)
+{
+	__m256i r[8];
+	__m256i t[8];
+	for (size_t i = 0; i < 8; i++)
+	{
+		r[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + ptrdiff_t(i) * inputStride));
+	}
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		t[2 * i] = _mm256_unpacklo_epi32(r[2 * i], r[2 * i + 1]);
+		t[2 * i + 1] = _mm256_unpackhi_epi32(r[2 * i], r[2 * i + 1]);
+	}
+	for (size_t i = 0; i < 2; i++)
+	{
+		r[4 * i] = _mm256_unpacklo_epi64(t[4 * i], t[4 * i + 2]);
+		r[4 * i + 1] = _mm256_unpackhi_epi64(t[4 * i], t[4 * i + 2]);
+		r[4 * i + 2] = _mm256_unpacklo_epi64(t[4 * i + 1], t[4 * i + 3]);
+		r[4 * i + 3] = _mm256_unpackhi_epi64(t[4 * i + 1], t[4 * i + 3]);
+	}
+	for (size_t i = 0; i < 4; i++)
+	{
+		t[i] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x20);
+		t[i + 4] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x31);
+	}
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + ptrdiff_t(i) * outputStride), t[i]);
+	}
+}
+
+#else
+
+/// <summary>
+/// In-register transpose of 4x4 32-bit values
+/// </summary>
+static inline void TransposeBlock4x4U32(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride)
+{
+	__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+	__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + inputStride));
+	__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 2 * inputStride));
+	__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 3 * inputStride));
+
+	Transpose4x4(a, b, c, d);
+
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output), a);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output + outputStride), b);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output + 2 * outputStride), c);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output + 3 * outputStride), d);
+}
+
+#endif
+
+/// <summary>
+/// In-register transpose of 2x2 64-bit values
+/// </summary>
+static inline void TransposeBlock2x2U64(const uint8_t * input, ptrdiff_t inputStride,
+	uint8_t * output, ptrdiff_t outputStride)
+{
+	__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+	__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + inputStride));
+
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_unpacklo_epi64(a, b));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(output + outputStride), _mm_unpackhi_epi64(a, b));
+}
+
+#endif
+
+/// <summary>
+/// Transpose block of width x height pixels
+/// output row x, pixel y = input row y, pixel x
+/// Strides are in bytes and can be negative (e.g. rotation is transpose
+/// of vertically flipped input / to vertically flipped output)
+///
+/// SIMD version transposes square micro-blocks in registers
+/// (1 byte pixels - 16x16, 2 bytes - 8x8, 4 bytes - 8x8 / 4x4, 8 bytes - 2x2),
+/// remaining pixels and other pixel sizes are copied one by one.
+/// Input and output must not overlap
+/// </summary>
+/// <param name="input"></param>
+/// <param name="inputStride"></param>
+/// <param name="output"></param>
+/// <param name="outputStride"></param>
+/// <param name="width"></param>
+/// <param name="height"></param>
+/// <param name="pixelBytes"></param>
+static void TransposePixels(const uint8_t * input, ptrdiff_t inputStride, uint8_t * output,
+	ptrdiff_t outputStride, size_t width, size_t height, size_t pixelBytes)
+{
+	size_t blockSize = 0;
+
+#if defined(HAVE_SSE41)
+	void (*block)(const uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t) = nullptr;
+
+	switch (pixelBytes)
+	{
+	case 1: block = TransposeBlock16x16U8; blockSize = 16; break;
+	case 2: block = TransposeBlock8x8U16; blockSize = 8; break;
+#if defined(HAVE_AVX2)
+	case 4: block = TransposeBlock8x8U32; blockSize = 8; break;
+#else
+	case 4: block = TransposeBlock4x4U32; blockSize = 4; break;
+#endif
+	case 8: block = TransposeBlock2x2U64; blockSize = 2; break;
+	default: break;
+	}
+
+	if (block != nullptr)
+	{
+		for (size_t y = 0; y + blockSize <= height; y += blockSize)
+		{
+			for (size_t x = 0; x + blockSize <= width; x += blockSize)
+			{
+				block(input + ptrdiff_t(y) * inputStride + x * pixelBytes, inputStride,
+					output + ptrdiff_t(x) * outputStride + y * pixelBytes, outputStride);
+			}
+		}
+	}
+#endif
+
+	if (blockSize == 0)
+	{
+		TransposeScalar(input, inputStride, output, outputStride, 0, width, 0, height, pixelBytes);
+		return;
+	}
+
+	const size_t wBlocks = width - width % blockSize;
+	const size_t hBlocks = height - height % blockSize;
+
+	TransposeScalar(input, inputStride, output, outputStride, wBlocks, width, 0, height, pixelBytes);
+	TransposeScalar(input, inputStride, output, outputStride, 0, wBlocks, hBlocks, height, pixelBytes);
+}
+
+/// <summary>
+/// Reverse order of pixels
+/// output[i] = input[pixelsCount - 1 - i]
+/// Pixels are processed from both ends at once, so output can be the same as input
+/// SIMD version reverses 16 / 32 bytes in register if pixel size is power of 2 (up to 16 bytes)
+/// </summary>
+/// <param name="input"></param>
+/// <param name="output"></param>
+/// <param name="pixelsCount"></param>
+/// <param name="pixelBytes"></param>
+static void ReversePixels(const uint8_t * input, uint8_t * output, size_t pixelsCount, size_t pixelBytes)
+{
+	size_t left = 0;
+	size_t right = pixelsCount * pixelBytes;
+
+#if defined(HAVE_SSE41)
+	if ((pixelBytes <= MM128_BYTE_COUNT) && ((MM128_BYTE_COUNT % pixelBytes) == 0))
+	{
+		uint8_t shuffleData[MM128_BYTE_COUNT];
+		for (size_t b = 0; b < MM128_BYTE_COUNT; b++)
+		{
+			const size_t px = MM128_BYTE_COUNT / pixelBytes - 1 - b / pixelBytes;
+			shuffleData[b] = static_cast<uint8_t>(px * pixelBytes + b % pixelBytes);
+		}
+		const __m128i sh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(shuffleData));
+
+#if defined(HAVE_AVX2)
+		const __m256i sh2 = _mm256_broadcastsi128_si256(sh);
+		while (right - left >= 2 * MM256_BYTE_COUNT)
+		{
+			right -= MM256_BYTE_COUNT;
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + left));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + right));
+			a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, sh2), 0x4E);
+			b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, sh2), 0x4E);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + left), b);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + right), a);
+			left += MM256_BYTE_COUNT;
+		}
+#endif
+
+		while (right - left >= 2 * MM128_BYTE_COUNT)
+		{
+			right -= MM128_BYTE_COUNT;
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + left));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + right));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(output + left), _mm_shuffle_epi8(b, sh));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(output + right), _mm_shuffle_epi8(a, sh));
+			left += MM128_BYTE_COUNT;
+		}
+	}
+#endif
+
+	uint8_t px[MM128_BYTE_COUNT];
+	while (right - left >= 2 * pixelBytes)
+	{
+		right -= pixelBytes;
+		if (pixelBytes <= MM128_BYTE_COUNT)
+		{
+			memcpy(px, input + left, pixelBytes);
+			memcpy(output + left, input + right, pixelBytes);
+			memcpy(output + right, px, pixelBytes);
+		}
+		else
+		{
+			for (size_t b = 0; b < pixelBytes; b++)
+			{
+				const uint8_t v = input[left + b];
+				output[left + b] = input[right + b];
+				output[right + b] = v;
+			}
+		}
+		left += pixelBytes;
+	}
+
+	if ((right > left) && (input != output))
+	{
+		//middle pixel
+		memcpy(output + left, input + left, pixelBytes);
+	}
+}
+
+//=================================================================================================
+// Table
+//=================================================================================================
+
+/// <summary>
+/// Get table with kernels for this instruction set
+/// </summary>
+/// <returns></returns>
+const ImageKernelsTable * GetTable()
+{
+	static const ImageKernelsTable table = []() {
+		ImageKernelsTable t;
+		t.findMinMaxF32 = FindMinMax;
+		t.findMinMaxU8 = FindMinMax;
+		t.sumF32 = Sum;
+		t.sumU8 = Sum;
+		t.absF32 = Abs;
+		t.fillF32 = Fill;
+		t.fillU8 = Fill;
+		t.fillPixels = FillPixels;
+		t.convertU8ToF32 = Convert;
+		t.convertF32ToU8 = Convert;
+		t.convertF32ToU8Saturated = ConvertSaturated;
+		t.convolveRowF32 = ConvolveRow;
+		t.resampleRowF32 = ResampleRow;
+		t.applyLutU8 = ApplyLut;
+		t.applyLutChannelsU8 = ApplyLutChannels;
+		t.prefixSumU8 = PrefixSum;
+		t.prefixSumF32 = PrefixSum;
+		t.accumulateU64 = Accumulate;
+		t.accumulateF64 = Accumulate;
+		t.minU8 = Min;
+		t.minF32 = Min;
+		t.maxU8 = Max;
+		t.maxF32 = Max;
+		t.shufflePixels = ShufflePixels;
+		t.unpackIndices = UnpackIndices;
+		t.expandPalette = ExpandPalette;
+		t.deinterleaveU8 = Deinterleave;
+		t.deinterleaveF32 = Deinterleave;
+		t.interleaveU8 = Interleave;
+		t.interleaveF32 = Interleave;
+		t.premultiplyAlphaU8 = PremultiplyAlpha;
+		t.premultiplyAlphaF32 = PremultiplyAlpha;
+		t.unpremultiplyAlphaU8 = UnpremultiplyAlpha;
+		t.unpremultiplyAlphaF32 = UnpremultiplyAlpha;
+		t.blendOverU8 = BlendOver;
+		t.blendOverF32 = BlendOver;
+		t.transposePixels = TransposePixels;
+		t.reversePixels = ReversePixels;
+		return t;
+	}();
+
+	return &table;
+}
+
+}
@@ -0,0 +1,11 @@
+//SSE4.1 version of image kernels
+//(compiled with SSE4.1 enabled, used only if CPU supports it)
+
+#if !defined(_MSC_VER) && !defined(__SSE4_1__)
+#	error ImageKernelsSSE41.cpp must be compiled with SSE4.1 enabled
+#endif
+
+#define KERNELS_ISA_LEVEL ISA_LEVEL_SSE41
+#define KERNELS_NAMESPACE ImageKernelsSSE41
+
+#include "./ImageKernelsImpl.h"
@@ -0,0 +1,7 @@
+//Scalar version of image kernels
+//(always compiled, used if SIMD is disabled or not supported by CPU)
+
+#define KERNELS_ISA_LEVEL ISA_LEVEL_SCALAR
+#define KERNELS_NAMESPACE ImageKernelsScalar
+
+#include "./ImageKernelsImpl.h"
@@ -0,0 +1,111 @@
+#ifndef IMAGE_KERNELS_TABLE_H
+#define IMAGE_KERNELS_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "./ImageKernels.h"
+
+/// <summary>
+/// Table of kernel implementations for one instruction set
+/// Each instruction set has its own translation unit that compiles
+/// ImageKernelsImpl.h with the matching compiler flags
+/// </summary>
+struct ImageKernelsTable
+{
+	void (*findMinMaxF32)(const float * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex, float & min, float & max);
+	void (*findMinMaxU8)(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex, uint8_t & min, uint8_t & max);
+
+	double (*sumF32)(const float * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex);
+	uint64_t (*sumU8)(const uint8_t * data, size_t pixelsCount, size_t channelsCount,
+		size_t channelIndex);
+
+	void (*absF32)(float * data, size_t count);
+
+	void (*fillF32)(float * data, size_t count, float value);
+	void (*fillU8)(uint8_t * data, size_t count, uint8_t value);
+	void (*fillPixels)(uint8_t * data, size_t pixelsCount, const uint8_t * pixel, size_t pixelBytes);
+
+	void (*convertU8ToF32)(const uint8_t * input, float * output, size_t count);
+	void (*convertF32ToU8)(const float * input, uint8_t * output, size_t count);
+	void (*convertF32ToU8Saturated)(const float * input, uint8_t * output, size_t count);
+
+	void (*convolveRowF32)(const float * input, size_t count, size_t step,
+		const float * weights, size_t weightsCount, float * output, bool accumulate);
+	void (*resampleRowF32)(const float * input, size_t inputPixelsCount, size_t channelsCount,
+		const int32_t * starts, const float * weights, size_t taps,
+		size_t outputPixelsCount, float * output);
+	void (*applyLutU8)(const uint8_t * input, uint8_t * output, size_t count, const uint8_t * table);
+	void (*applyLutChannelsU8)(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+		size_t channelsCount, const uint8_t * tables);
+
+	void (*prefixSumU8)(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+		uint64_t * sums, uint64_t * squares);
+	void (*prefixSumF32)(const float * input, size_t pixelsCount, size_t channelsCount,
+		double * sums, double * squares);
+	void (*accumulateU64)(const uint64_t * input, uint64_t * output, size_t count);
+	void (*accumulateF64)(const double * input, double * output, size_t count);
+
+	void (*minU8)(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count);
+	void (*minF32)(const float * a, const float * b, float * output, size_t count);
+	void (*maxU8)(const uint8_t * a, const uint8_t * b, uint8_t * output, size_t count);
+	void (*maxF32)(const float * a, const float * b, float * output, size_t count);
+
+	void (*shufflePixels)(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+		const ImageKernels::PixelShuffle & shuffle);
+
+	void (*unpackIndices)(const uint8_t * packed, size_t count, unsigned int bitDepth,
+		uint8_t * indices);
+	void (*expandPalette)(const uint8_t * indices, size_t count, const uint8_t * palette,
+		size_t paletteSize, size_t channelsCount, uint8_t * output);
+
+	void (*deinterleaveU8)(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+		uint8_t * output);
+	void (*deinterleaveF32)(const float * input, size_t pixelsCount, size_t channelsCount,
+		float * output);
+	void (*interleaveU8)(const uint8_t * input, size_t pixelsCount, size_t channelsCount,
+		uint8_t * output);
+	void (*interleaveF32)(const float * input, size_t pixelsCount, size_t channelsCount,
+		float * output);
+
+	void (*premultiplyAlphaU8)(uint8_t * data, size_t pixelsCount);
+	void (*premultiplyAlphaF32)(float * data, size_t pixelsCount);
+	void (*unpremultiplyAlphaU8)(uint8_t * data, size_t pixelsCount);
+	void (*unpremultiplyAlphaF32)(float * data, size_t pixelsCount);
+	void (*blendOverU8)(const uint8_t * src, uint8_t * dst, size_t pixelsCount, size_t dstChannelsCount);
+	void (*blendOverF32)(const float * src, float * dst, size_t pixelsCount, size_t dstChannelsCount);
+
+	void (*transposePixels)(const uint8_t * input, ptrdiff_t inputStride, uint8_t * output,
+		ptrdiff_t outputStride, size_t width, size_t height, size_t pixelBytes);
+	void (*reversePixels)(const uint8_t * input, uint8_t * output, size_t pixelsCount,
+		size_t pixelBytes);
+};
+
+namespace ImageKernelsScalar
+{
+	const ImageKernelsTable * GetTable();
+}
+
+#ifdef ENABLE_SIMD
+
+namespace ImageKernelsSSE41
+{
+	const ImageKernelsTable * GetTable();
+}
+
+namespace ImageKernelsAVX2
+{
+	const ImageKernelsTable * GetTable();
+}
+
+namespace ImageKernelsAVX512
+{
+	const ImageKernelsTable * GetTable();
+}
+
+#endif
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SIMD_UTILS_H
+#define SIMD_UTILS_H
+
+//values must match CpuFeatures::IsaLevel
+#define ISA_LEVEL_SCALAR 0
+#define ISA_LEVEL_SSE41 1
+#define ISA_LEVEL_AVX2 2
+#define ISA_LEVEL_AVX512 3
+
+//Kernel translation units set KERNELS_ISA_LEVEL explicitly
+//(and are compiled with the matching compiler flags).
+//Otherwise, available instruction sets are deduced from the compiler flags
+//SIMD code is compiled only if ENABLE_SIMD is defined
+
+#ifndef KERNELS_ISA_LEVEL
+#	ifdef ENABLE_SIMD
+#		if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+#			define KERNELS_ISA_LEVEL ISA_LEVEL_AVX512
+#		elif defined(__AVX2__)
+#			define KERNELS_ISA_LEVEL ISA_LEVEL_AVX2
+#		elif defined(__SSE4_1__) || defined(__AVX__)
+#			define KERNELS_ISA_LEVEL ISA_LEVEL_SSE41
+#		else
+#			define KERNELS_ISA_LEVEL ISA_LEVEL_SCALAR
+#		endif
+#	else
+#		define KERNELS_ISA_LEVEL ISA_LEVEL_SCALAR
+#	endif
+#endif
+
+#if KERNELS_ISA_LEVEL >= ISA_LEVEL_AVX512
+#	define HAVE_AVX512 1
+#endif
+
+#if KERNELS_ISA_LEVEL >= ISA_LEVEL_AVX2
+#	define HAVE_AVX2 1
+#endif
+
+#if KERNELS_ISA_LEVEL >= ISA_LEVEL_SSE41
+#	define HAVE_SSE41 1
+#endif
+
+//GCC 12 headers implement _mm512_undefined_* as a self-initialized local (__Y),
+//every intrinsic with an implicit pass-through then trips -Wmaybe-uninitialized
+//(GCC bug 105593); warning location is inside the header, so silence it there
+#if defined(HAVE_AVX512) || defined(HAVE_AVX2) || defined(HAVE_SSE41)
+#	if defined(__GNUC__) && !defined(__clang__)
+#		pragma GCC diagnostic push
+#		pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#		pragma GCC diagnostic ignored "-Wuninitialized"
+#	endif
+#	include <immintrin.h>
+#	if defined(__GNUC__) && !defined(__clang__)
+#		pragma GCC diagnostic pop
+#	endif
+#endif
+
+#define MM128_ELEMENT_COUNT 4	//number of floats in __m128
+#define MM256_ELEMENT_COUNT 8	//number of floats in __m256
+#define MM512_ELEMENT_COUNT 16	//number of floats in __m512
+
+#define MM128_BYTE_COUNT 16		//number of uint8_t in __m128i
+#define MM256_BYTE_COUNT 32		//number of uint8_t in __m256i
+#define MM512_BYTE_COUNT 64		//number of uint8_t in __m512i
+
+//Helpers are static - translation units compiled with different
+//instruction sets must not share a single (inline) definition
+
+
+#ifdef HAVE_SSE41
+
+/// <summary>
+/// Absolute value of 4 floats
+/// - clear sign bit
+/// </summary>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline __m128 _my_mm_abs_ps(__m128 v)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+#endif
+
+#ifdef HAVE_AVX2
+
+/// <summary>
+/// Absolute value of 8 floats
+/// - clear sign bit
+/// </summary>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline __m256 _my_mm256_abs_ps(__m256 v)
+{
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+#endif
+
+#endif
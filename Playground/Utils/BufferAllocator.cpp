@@ -0,0 +1,214 @@
+#include "./BufferAllocator.h"
+
+#include <atomic>
+
+using namespace MyUtils;
+
+//=================================================================================================
+// IBufferAllocator
+//=================================================================================================
+
+static std::atomic<IBufferAllocator *> activeAllocator(nullptr);
+
+/// <summary>
+/// Get default 64-byte aligned allocator
+/// Allocator is never destroyed, so buffers of static images
+/// can be safely released at exit
+/// </summary>
+/// <returns></returns>
+static IBufferAllocator * GetAlignedAllocator() noexcept
+{
+	static AlignedBufferAllocator * allocator = new AlignedBufferAllocator();
+	return allocator;
+}
+
+/// <summary>
+/// Get allocator used for new buffers
+/// (64-byte aligned allocator, if not changed with SetDefault)
+/// </summary>
+/// <returns></returns>
+IBufferAllocator * IBufferAllocator::GetDefault() noexcept
+{
+	IBufferAllocator * allocator = activeAllocator.load(std::memory_order_acquire);
+	if (allocator == nullptr)
+	{
+		allocator = GetAlignedAllocator();
+	}
+	return allocator;
+}
+
+/// <summary>
+/// Set allocator used for new buffers
+/// Existing buffers keep their allocator
+/// If allocator is nullptr, default aligned allocator is used
+/// </summary>
+/// <param name="allocator"></param>
+void IBufferAllocator::SetDefault(IBufferAllocator * allocator) noexcept
+{
+	activeAllocator.store(allocator, std::memory_order_release);
+}
+
+//=================================================================================================
+// AlignedBufferAllocator
+//=================================================================================================
+
+/// <summary>
+/// ctor
+/// </summary>
+/// <param name="alignment">must be power of 2</param>
+AlignedBufferAllocator::AlignedBufferAllocator(size_t alignment) :
+	alignment(alignment)
+{
+}
+
+size_t AlignedBufferAllocator::GetAlignment() const noexcept
+{
+	return this->alignment;
+}
+
+void * AlignedBufferAllocator::Allocate(size_t bytes)
+{
+	return ::operator new(bytes, std::align_val_t(this->alignment));
+}
+
+void AlignedBufferAllocator::Deallocate(void * ptr, size_t) noexcept
+{
+	::operator delete(ptr, std::align_val_t(this->alignment));
+}
+
+//=================================================================================================
+// BufferPool
+//=================================================================================================
+
+/// <summary>
+/// ctor
+/// </summary>
+/// <param name="maxCachedBytes">if total size of cached buffers would be larger,
+/// released buffer is freed</param>
+/// <param name="alignment"></param>
+BufferPool::BufferPool(size_t maxCachedBytes, size_t alignment) :
+	allocator(alignment),
+	maxCachedBytes(maxCachedBytes),
+	cachedBytes(0)
+{
+}
+
+/// <summary>
+/// dtor
+/// Free all cached buffers
+/// Buffers that are still in use must not be released after the pool is destroyed
+/// </summary>
+BufferPool::~BufferPool()
+{
+	this->Clear();
+}
+
+size_t BufferPool::GetCachedBytes() const
+{
+	std::lock_guard<std::mutex> lk(this->m);
+	return this->cachedBytes;
+}
+
+/// <summary>
+/// Round size up to the bucket size
+/// Between each two powers of 2, there are BUCKETS_PER_POWER buckets
+/// so at most 25% of memory is wasted
+/// </summary>
+/// <param name="bytes"></param>
+/// <returns></returns>
+size_t BufferPool::GetBucketSize(size_t bytes) noexcept
+{
+	if (bytes <= MIN_BUCKET_SIZE)
+	{
+		return MIN_BUCKET_SIZE;
+	}
+
+	//find power: power < bytes <= 2 * power
+	size_t power = MIN_BUCKET_SIZE;
+	while (2 * power < bytes)
+	{
+		power *= 2;
+	}
+
+	size_t step = power / BUCKETS_PER_POWER;
+	return power + ((bytes - power + step - 1) / step) * step;
+}
+
+/// <summary>
+/// Get buffer from cache or allocate new one
+/// </summary>
+/// <param name="bytes"></param>
+/// <returns></returns>
+void * BufferPool::Allocate(size_t bytes)
+{
+	size_t bucketSize = BufferPool::GetBucketSize(bytes);
+
+	{
+		std::lock_guard<std::mutex> lk(this->m);
+
+		auto it = this->freeBuffers.find(bucketSize);
+		if ((it != this->freeBuffers.end()) && (it->second.empty() == false))
+		{
+			void * ptr = it->second.back();
+			it->second.pop_back();
+			this->cachedBytes -= bucketSize;
+			return ptr;
+		}
+	}
+
+	return this->allocator.Allocate(bucketSize);
+}
+
+/// <summary>
+/// Return buffer to cache
+/// If cache is full, buffer is freed
+/// </summary>
+/// <param name="ptr"></param>
+/// <param name="bytes"></param>
+void BufferPool::Deallocate(void * ptr, size_t bytes) noexcept
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+
+	size_t bucketSize = BufferPool::GetBucketSize(bytes);
+
+	{
+		std::lock_guard<std::mutex> lk(this->m);
+
+		if (this->cachedBytes + bucketSize <= this->maxCachedBytes)
+		{
+			try
+			{
+				this->freeBuffers[bucketSize].push_back(ptr);
+				this->cachedBytes += bucketSize;
+				return;
+			}
+			catch (...)
+			{
+				//unable to cache - buffer is freed
+			}
+		}
+	}
+
+	this->allocator.Deallocate(ptr, bucketSize);
+}
+
+/// <summary>
+/// Free all cached buffers
+/// </summary>
+void BufferPool::Clear()
+{
+	std::lock_guard<std::mutex> lk(this->m);
+
+	for (auto & it : this->freeBuffers)
+	{
+		for (void * ptr : it.second)
+		{
+			this->allocator.Deallocate(ptr, it.first);
+		}
+	}
+	this->freeBuffers.clear();
+	this->cachedBytes = 0;
+}
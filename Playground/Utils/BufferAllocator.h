@@ -0,0 +1,171 @@
+#ifndef BUFFER_ALLOCATOR_H
+#define BUFFER_ALLOCATOR_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace MyUtils
+{
+	/// <summary>
+	/// Interface for allocators of raw memory buffers
+	/// (used for pixel data of Image2d)
+	///
+	/// Allocator must outlive all buffers allocated by it
+	/// </summary>
+	class IBufferAllocator
+	{
+	public:
+		static const size_t DEFAULT_ALIGNMENT = 64;
+
+		static IBufferAllocator * GetDefault() noexcept;
+		static void SetDefault(IBufferAllocator * allocator) noexcept;
+
+		virtual ~IBufferAllocator() = default;
+
+		virtual void * Allocate(size_t bytes) = 0;
+		virtual void Deallocate(void * ptr, size_t bytes) noexcept = 0;
+	};
+
+	//=========================================================================
+
+	/// <summary>
+	/// Allocate each buffer separately with given alignment
+	/// </summary>
+	class AlignedBufferAllocator : public IBufferAllocator
+	{
+	public:
+		AlignedBufferAllocator(size_t alignment = DEFAULT_ALIGNMENT);
+
+		size_t GetAlignment() const noexcept;
+
+		void * Allocate(size_t bytes) override;
+		void Deallocate(void * ptr, size_t bytes) noexcept override;
+
+	protected:
+		size_t alignment;
+	};
+
+	//=========================================================================
+
+	/// <summary>
+	/// Pool of aligned buffers
+	/// Released buffers are not freed, but cached and reused
+	/// by the next allocation with the same bucket size.
+	/// Requested sizes are rounded up to buckets (4 buckets for each power of 2)
+	///
+	/// Pool is thread-safe
+	/// </summary>
+	class BufferPool : public IBufferAllocator
+	{
+	public:
+		static const size_t DEFAULT_MAX_CACHED_BYTES = size_t(256) * 1024 * 1024;
+
+		BufferPool(size_t maxCachedBytes = DEFAULT_MAX_CACHED_BYTES,
+			size_t alignment = DEFAULT_ALIGNMENT);
+		~BufferPool();
+
+		size_t GetCachedBytes() const;
+
+		void * Allocate(size_t bytes) override;
+		void Deallocate(void * ptr, size_t bytes) noexcept override;
+
+		void Clear();
+
+	protected:
+		static const size_t MIN_BUCKET_SIZE = 64;
+		static const size_t BUCKETS_PER_POWER = 4;
+
+		AlignedBufferAllocator allocator;
+		size_t maxCachedBytes;
+		size_t cachedBytes;
+
+		std::unordered_map<size_t, std::vector<void *>> freeBuffers;
+		mutable std::mutex m;
+
+		static size_t GetBucketSize(size_t bytes) noexcept;
+	};
+
+	//=========================================================================
+
+	/// <summary>
+	/// Standard library allocator that uses IBufferAllocator
+	/// Allocator is taken from IBufferAllocator::GetDefault() when created.
+	///
+	/// Default construction of elements (resize(n), vector(n)) leaves
+	/// trivial types uninitialized. Use resize(n, T(0)) for zero fill.
+	/// </summary>
+	template <typename T>
+	class StdBufferAllocator
+	{
+	public:
+		typedef T value_type;
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		StdBufferAllocator() noexcept :
+			allocator(IBufferAllocator::GetDefault())
+		{
+		}
+
+		StdBufferAllocator(IBufferAllocator * allocator) noexcept :
+			allocator(allocator)
+		{
+		}
+
+		template <typename U>
+		StdBufferAllocator(const StdBufferAllocator<U> & other) noexcept :
+			allocator(other.GetAllocator())
+		{
+		}
+
+		IBufferAllocator * GetAllocator() const noexcept
+		{
+			return this->allocator;
+		}
+
+		T * allocate(size_t n)
+		{
+			return static_cast<T *>(this->allocator->Allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T * p, size_t n) noexcept
+		{
+			this->allocator->Deallocate(p, n * sizeof(T));
+		}
+
+		template <typename U>
+		void construct(U * p) noexcept(std::is_nothrow_default_constructible<U>::value)
+		{
+			::new (static_cast<void *>(p)) U;
+		}
+
+		template <typename U, typename... Args>
+		void construct(U * p, Args &&... args)
+		{
+			::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+		}
+
+		template <typename U>
+		bool operator==(const StdBufferAllocator<U> & other) const noexcept
+		{
+			return this->allocator == other.GetAllocator();
+		}
+
+		template <typename U>
+		bool operator!=(const StdBufferAllocator<U> & other) const noexcept
+		{
+			return this->allocator != other.GetAllocator();
+		}
+
+	protected:
+		IBufferAllocator * allocator;
+	};
+}
+
+#endif
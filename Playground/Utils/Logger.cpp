@@ -31,7 +31,6 @@ std::shared_ptr<Logger> Logger::instanceLogger = nullptr;
 
 
 Logger::Logger() :
-	colorsEnabled(false),
 	enableErrors{ true, true, true },
 	enableWarnings{ true, true, true },
 #if defined(_DEBUG) || defined(DEBUG)
@@ -39,7 +38,8 @@ Logger::Logger() :
 #else
 	enableInfo{ false, false, false },
 #endif
-	loggerOutput{ 0, 0, 0 }
+	loggerOutput{ 0, 0, 0 },
+	colorsEnabled(false)
 {
 	this->LogToStdout();
 }
@@ -95,7 +95,7 @@ void Logger::SetColorsEnabled(bool val)
 	this->colorsEnabled = val;
 }
 
-void Logger::StartColor(int colorID)
+void Logger::StartColor([[maybe_unused]] int colorID)
 {
 	if (colorsEnabled == false)
 	{
@@ -108,7 +108,7 @@ void Logger::StartColor(int colorID)
 #endif
 }
 
-void Logger::EndColor(int colorID)
+void Logger::EndColor([[maybe_unused]] int colorID)
 {
 	if (colorsEnabled == false)
 	{
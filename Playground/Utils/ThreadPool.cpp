@@ -0,0 +1,308 @@
+#include "./ThreadPool.h"
+
+using namespace MyUtils;
+
+std::shared_ptr<ThreadPool> ThreadPool::instance = nullptr;
+std::mutex ThreadPool::instanceMutex;
+
+//pool and queue index of the current worker thread
+static thread_local ThreadPool * currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+//=================================================================================================
+// Shared instance
+//=================================================================================================
+
+/// <summary>
+/// Create shared instance with given number of threads
+/// Pool that is still used by running tasks is destroyed after they finish
+/// </summary>
+/// <param name="threadsCount">0 - use hardware concurrency</param>
+void ThreadPool::Initialize(size_t threadsCount)
+{
+	if (threadsCount == 0)
+	{
+		threadsCount = std::thread::hardware_concurrency();
+	}
+
+	std::lock_guard<std::mutex> lk(instanceMutex);
+	instance = std::make_shared<ThreadPool>(threadsCount);
+}
+
+void ThreadPool::Destroy()
+{
+	std::lock_guard<std::mutex> lk(instanceMutex);
+	instance = nullptr;
+}
+
+/// <summary>
+/// Get shared instance
+/// If not initialized, it is created with hardware concurrency threads
+/// </summary>
+/// <returns></returns>
+std::shared_ptr<ThreadPool> ThreadPool::GetInstance()
+{
+	std::lock_guard<std::mutex> lk(instanceMutex);
+	if (instance == nullptr)
+	{
+		instance = std::make_shared<ThreadPool>(std::thread::hardware_concurrency());
+	}
+	return instance;
+}
+
+//=================================================================================================
+// ctors & dtor
+//=================================================================================================
+
+/// <summary>
+/// Create pool
+/// Thread that waits for tasks also executes them,
+/// so threadsCount - 1 worker threads are started
+/// </summary>
+/// <param name="threadsCount">total number of threads executing tasks</param>
+ThreadPool::ThreadPool(size_t threadsCount) :
+	nextQueue(0),
+	pendingTasks(0),
+	stop(false)
+{
+	size_t workersCount = (threadsCount > 1) ? threadsCount - 1 : 0;
+
+	for (size_t i = 0; i < workersCount; i++)
+	{
+		this->queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (size_t i = 0; i < workersCount; i++)
+	{
+		this->workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+/// <summary>
+/// dtor
+/// Wait for all workers to finish
+/// </summary>
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lk(this->wakeMutex);
+		this->stop = true;
+	}
+	this->wakeCv.notify_all();
+
+	for (auto & t : this->workers)
+	{
+		t.join();
+	}
+}
+
+/// <summary>
+/// Get number of threads executing tasks
+/// (workers and the waiting thread)
+/// </summary>
+/// <returns></returns>
+size_t ThreadPool::GetThreadsCount() const noexcept
+{
+	return this->workers.size() + 1;
+}
+
+//=================================================================================================
+// Tasks
+//=================================================================================================
+
+/// <summary>
+/// Run all tasks and wait until they are finished
+/// Calling thread executes tasks while waiting
+/// If any task throws, tasks that were not started yet are skipped
+/// and the first exception is rethrown after the running tasks are finished
+/// </summary>
+/// <param name="tasks"></param>
+void ThreadPool::RunTasks(std::vector<std::function<void()>> & tasks)
+{
+	if (tasks.empty())
+	{
+		return;
+	}
+
+	if (this->workers.empty())
+	{
+		for (auto & t : tasks)
+		{
+			t();
+		}
+		return;
+	}
+
+	TaskGroup group;
+	group.remaining = tasks.size();
+	group.failed = false;
+
+	//counter is raised before tasks are published,
+	//so workers that pop them never decrement it below the number of queued tasks
+	{
+		std::lock_guard<std::mutex> lk(this->wakeMutex);
+		this->pendingTasks += tasks.size();
+	}
+
+	if (currentPool == this)
+	{
+		//nested call from worker - other workers will steal from our queue
+		WorkerQueue * q = this->queues[currentQueue].get();
+		std::lock_guard<std::mutex> lk(q->m);
+		for (auto & t : tasks)
+		{
+			q->tasks.push_back({ &t, &group });
+		}
+	}
+	else
+	{
+		size_t start = 0;
+		{
+			std::lock_guard<std::mutex> lk(this->wakeMutex);
+			start = this->nextQueue;
+			this->nextQueue = (this->nextQueue + 1) % this->queues.size();
+		}
+
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			WorkerQueue * q = this->queues[(start + i) % this->queues.size()].get();
+			std::lock_guard<std::mutex> lk(q->m);
+			q->tasks.push_back({ &tasks[i], &group });
+		}
+	}
+
+	this->wakeCv.notify_all();
+
+	//help with execution until all tasks of the group are finished
+	size_t index = (currentPool == this) ? currentQueue : this->queues.size();
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lk(group.m);
+			if (group.remaining == 0)
+			{
+				break;
+			}
+		}
+
+		Task task;
+		if (this->TryPopTask(index, task))
+		{
+			this->ExecuteTask(task);
+			continue;
+		}
+
+		//all remaining tasks are running in other threads
+		std::unique_lock<std::mutex> lk(group.m);
+		group.cv.wait(lk, [&group]() {
+			return group.remaining == 0;
+		});
+		break;
+	}
+
+	//all tasks are finished, no other thread accesses group
+	if (group.exception != nullptr)
+	{
+		std::rethrow_exception(group.exception);
+	}
+}
+
+/// <summary>
+/// Get task from own queue (back) or steal from other queue (front)
+/// </summary>
+/// <param name="index">own queue index (queues count for non-worker thread)</param>
+/// <param name="task"></param>
+/// <returns></returns>
+bool ThreadPool::TryPopTask(size_t index, Task & task)
+{
+	const size_t count = this->queues.size();
+
+	if (index < count)
+	{
+		WorkerQueue * q = this->queues[index].get();
+		std::lock_guard<std::mutex> lk(q->m);
+		if (q->tasks.empty() == false)
+		{
+			task = q->tasks.back();
+			q->tasks.pop_back();
+			this->pendingTasks--;
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i <= count; i++)
+	{
+		WorkerQueue * q = this->queues[(index + i) % count].get();
+		std::lock_guard<std::mutex> lk(q->m);
+		if (q->tasks.empty() == false)
+		{
+			task = q->tasks.front();
+			q->tasks.pop_front();
+			this->pendingTasks--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Run task and notify its group
+/// The first exception of the group is stored and rethrown by RunTasks,
+/// tasks of the group started after it are skipped
+/// </summary>
+/// <param name="task"></param>
+void ThreadPool::ExecuteTask(Task & task)
+{
+	std::exception_ptr exception = nullptr;
+	if (task.group->failed.load(std::memory_order_relaxed) == false)
+	{
+		try
+		{
+			(*task.func)();
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+	}
+
+	//group can be destroyed by the waiting thread as soon as the lock is released
+	std::lock_guard<std::mutex> lk(task.group->m);
+	if ((exception != nullptr) && (task.group->exception == nullptr))
+	{
+		task.group->exception = exception;
+		task.group->failed.store(true, std::memory_order_relaxed);
+	}
+	task.group->remaining--;
+	if (task.group->remaining == 0)
+	{
+		task.group->cv.notify_all();
+	}
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+	currentPool = this;
+	currentQueue = index;
+
+	while (true)
+	{
+		Task task;
+		if (this->TryPopTask(index, task))
+		{
+			this->ExecuteTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lk(this->wakeMutex);
+		this->wakeCv.wait(lk, [this]() {
+			return (this->stop) || (this->pendingTasks > 0);
+		});
+
+		if ((this->stop) && (this->pendingTasks == 0))
+		{
+			return;
+		}
+	}
+}
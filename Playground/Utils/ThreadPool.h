@@ -0,0 +1,172 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MyUtils
+{
+	/// <summary>
+	/// Work-stealing thread pool
+	/// Each worker has its own task queue. Worker takes tasks from the back
+	/// of its own queue and if it is empty, it steals from the front of other queues.
+	/// Thread that waits for its tasks helps with their execution,
+	/// so parallel loops can be nested.
+	///
+	/// ParallelFor / ParallelReduce split range to chunks of grain size.
+	/// Chunks depend only on the range and grain (not on the threads count)
+	/// and reduction combines chunk results in chunk order,
+	/// so results are deterministic.
+	///
+	/// If a task throws, tasks of the same call that were not started yet are skipped
+	/// and the first exception is rethrown in the calling thread
+	/// after the already running tasks finish.
+	/// </summary>
+	class ThreadPool
+	{
+	public:
+		static void Initialize(size_t threadsCount);
+		static void Destroy();
+		static std::shared_ptr<ThreadPool> GetInstance();
+
+		ThreadPool(size_t threadsCount);
+		~ThreadPool();
+
+		size_t GetThreadsCount() const noexcept;
+
+		void RunTasks(std::vector<std::function<void()>> & tasks);
+
+		template <typename Func>
+		void ParallelFor(size_t begin, size_t end, size_t grain, Func && func);
+
+		template <typename R, typename Map, typename Reduce>
+		R ParallelReduce(size_t begin, size_t end, size_t grain, R init, Map && map, Reduce && reduce);
+
+	protected:
+
+		struct TaskGroup
+		{
+			size_t remaining;
+			std::atomic<bool> failed;
+			std::exception_ptr exception;
+			std::mutex m;
+			std::condition_variable cv;
+		};
+
+		struct Task
+		{
+			std::function<void()> * func;
+			TaskGroup * group;
+		};
+
+		struct WorkerQueue
+		{
+			std::mutex m;
+			std::deque<Task> tasks;
+		};
+
+		static std::shared_ptr<ThreadPool> instance;
+		static std::mutex instanceMutex;
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		size_t nextQueue;
+
+		std::mutex wakeMutex;
+		std::condition_variable wakeCv;
+		std::atomic<size_t> pendingTasks;
+		bool stop;
+
+		void WorkerLoop(size_t index);
+		bool TryPopTask(size_t index, Task & task);
+		void ExecuteTask(Task & task);
+	};
+
+	/// <summary>
+	/// Run func(chunkBegin, chunkEnd) for all chunks of [begin, end)
+	/// Each chunk has grain elements (the last one can be smaller)
+	/// Returns after all chunks are processed
+	/// </summary>
+	/// <param name="begin"></param>
+	/// <param name="end"></param>
+	/// <param name="grain"></param>
+	/// <param name="func"></param>
+	template <typename Func>
+	void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, Func && func)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		grain = (grain == 0) ? 1 : grain;
+		const size_t chunksCount = (end - begin + grain - 1) / grain;
+
+		if ((chunksCount == 1) || (this->workers.empty()))
+		{
+			for (size_t i = begin; i < end; i += grain)
+			{
+				func(i, (end - i > grain) ? i + grain : end);
+			}
+			return;
+		}
+
+		std::vector<std::function<void()>> tasks;
+		tasks.reserve(chunksCount);
+		for (size_t i = begin; i < end; i += grain)
+		{
+			size_t chunkEnd = (end - i > grain) ? i + grain : end;
+			tasks.emplace_back([&func, i, chunkEnd]() {
+				func(i, chunkEnd);
+			});
+		}
+
+		this->RunTasks(tasks);
+	}
+
+	/// <summary>
+	/// Compute map(chunkBegin, chunkEnd) for all chunks of [begin, end)
+	/// and combine chunk results with reduce(a, b) in chunk order
+	/// (starting with init)
+	/// </summary>
+	/// <param name="begin"></param>
+	/// <param name="end"></param>
+	/// <param name="grain"></param>
+	/// <param name="init"></param>
+	/// <param name="map"></param>
+	/// <param name="reduce"></param>
+	/// <returns></returns>
+	template <typename R, typename Map, typename Reduce>
+	R ThreadPool::ParallelReduce(size_t begin, size_t end, size_t grain, R init, Map && map, Reduce && reduce)
+	{
+		if (begin >= end)
+		{
+			return init;
+		}
+
+		grain = (grain == 0) ? 1 : grain;
+		const size_t chunksCount = (end - begin + grain - 1) / grain;
+
+		std::vector<R> results(chunksCount, init);
+
+		this->ParallelFor(begin, end, grain, [&](size_t chunkBegin, size_t chunkEnd) {
+			results[(chunkBegin - begin) / grain] = map(chunkBegin, chunkEnd);
+		});
+
+		R res = init;
+		for (const R & r : results)
+		{
+			res = reduce(res, r);
+		}
+		return res;
+	}
+}
+
+#endif